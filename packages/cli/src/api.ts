@@ -66,6 +66,23 @@ export const batchCreateNodes = async (bd: { shallowBranch: string; data: unknow
   return response
 }
 
+export const batchIngestNodes = async (shallowBranch: string, nodes: unknown[]) => {
+  const ndjson = nodes.map((node) => JSON.stringify(node)).join('\n')
+  const response = await apiRequest<{ message: string }>(
+    `nodes/batch-ingest?shallowBranch=${encodeURIComponent(shallowBranch)}`,
+    {
+      method: 'POST',
+      headers: {
+        'Content-Type': 'application/x-ndjson',
+        'Content-Encoding': 'gzip',
+      },
+      body: gzipSync(ndjson),
+    },
+  )
+
+  return response
+}
+
 export const commitCreatedNodes = async (bd: {
   shallowBranch: string
   projectNames: string[]
@@ -1,5 +1,5 @@
 import { randomUUID } from 'node:crypto'
-import { batchCreateNodes, commitCreatedNodes, rollbackCreatedNodes, updateAction } from '../api'
+import { batchIngestNodes, commitCreatedNodes, rollbackCreatedNodes, updateAction } from '../api'
 import type { RunCodeQLResult } from '../codeql'
 import { getContext } from '../context'
 import debug, { error as errLog } from '../utils/debug'
@@ -38,8 +38,9 @@ export async function uploadResults(results: RunCodeQLResult): Promise<UploadRes
   try {
     debug('Uploading %d nodes to server', nodesToUpload.length)
 
-    // Upload nodes in batches to avoid overwhelming the server
-    const batchSize = 100
+    // Upload nodes in batches to avoid overwhelming the server; each batch is
+    // parsed and inserted in one statement by the server's native ingest
+    const batchSize = 5000
     const batches = []
     for (let i = 0; i < nodesToUpload.length; i += batchSize) {
       batches.push(nodesToUpload.slice(i, i + batchSize))
@@ -53,10 +54,7 @@ export async function uploadResults(results: RunCodeQLResult): Promise<UploadRes
       debug('Uploading batch %d/%d (%d nodes)', i + 1, batches.length, batch.length)
 
       try {
-        const result = await batchCreateNodes({
-          shallowBranch,
-          data: batch,
-        })
+        const result = await batchIngestNodes(shallowBranch, batch)
 
         totalUploaded += batch.length
         debug('Batch %d uploaded successfully: %s', i + 1, result.message)
@@ -0,0 +1,602 @@
+// Native graph benchmark
+//
+// Generates synthetic Project/Node/Connection datasets shaped like real
+// analysis output and times the hot paths of the SQLite extension against
+// them. Results are printed as one JSON document on stdout, or written to the
+// --out file instead (progress goes to stderr), so CI can diff them against a
+// previous run.
+//
+//   pnpm build:addon && ./build/Release/graph_bench --edges 10000,100000,1000000
+//
+// The extension is linked in statically and registered through
+// sqlite3_auto_extension, so every database opened here has the same SQL
+// functions as the Prisma connections in the server.
+
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/native/graph.h"
+#include "../src/native/gzip-writer.h"
+
+extern "C" int sqlite3_extension_init(sqlite3* db, char** pzErrMsg, const struct sqlite3_api_routines* pApi);
+
+namespace fs = std::filesystem;
+
+struct BenchOptions {
+    std::vector<long> edgeCounts = { 10000, 100000, 1000000 };
+    int branches = 2;
+    double libShare = 0.3;       // fraction of projects that are shared libs
+    double zipfExponent = 1.2;   // fan-in skew over libs and their exports
+    double cycleDensity = 0.01;  // probability a lib import points "upwards"
+    double eventShare = 0.05;    // fraction of edges produced by EventOn -> EventEmit
+    int depth = 3;
+    int iterations = 3;
+    int cycleLimit = 20000;      // DetectCycles is skipped above this many vertices
+    unsigned long seed = 42;
+    std::string migrations = "prisma/migrations";
+    std::string dbDir = fs::temp_directory_path().string();
+    std::string out;
+    bool keep = false;
+};
+
+struct StageResult {
+    long edges;
+    std::string stage;
+    std::vector<double> samplesMs;
+    std::vector<std::pair<std::string, double>> metrics;
+    std::string skipped;
+};
+
+// --- Helpers ---
+
+static void Fail(const char* what, sqlite3* db) {
+    fprintf(stderr, "%s: %s\n", what, db ? sqlite3_errmsg(db) : "");
+    exit(1);
+}
+
+static void Exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        fprintf(stderr, "SQL failed: %s\n%s\n", err, sql.substr(0, 200).c_str());
+        sqlite3_free(err);
+        exit(1);
+    }
+}
+
+static long QueryLong(sqlite3* db, const std::string& sql) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) Fail("prepare", db);
+    long v = sqlite3_step(stmt) == SQLITE_ROW ? (long)sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+static std::string QueryText(sqlite3* db, const std::string& sql) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) Fail("prepare", db);
+    const unsigned char* text = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_text(stmt, 0) : nullptr;
+    std::string v = text ? (const char*)text : "";
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+static double Ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static StageResult Measure(long edges, const std::string& stage, int iterations,
+                           const std::function<void()>& setup, const std::function<void()>& body) {
+    StageResult r{ edges, stage, {}, {}, {} };
+    for (int i = 0; i < iterations; ++i) {
+        if (setup) setup();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        r.samplesMs.push_back(Ms(start));
+    }
+    fprintf(stderr, "  %-24s %10.2f ms\n", stage.c_str(), *std::min_element(r.samplesMs.begin(), r.samplesMs.end()));
+    return r;
+}
+
+// cuid-shaped ids, so hashing and comparisons cost what they cost in production
+static std::string MakeId(std::mt19937_64& rng) {
+    static const char alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    std::string id = "c";
+    for (int i = 0; i < 24; ++i) id += alphabet[rng() % 36];
+    return id;
+}
+
+// Samples ranks 0..n-1 with P(k) proportional to 1 / (k + 1)^s
+class Zipf {
+    std::vector<double> cdf;
+public:
+    Zipf(size_t n, double s) : cdf(n) {
+        double sum = 0;
+        for (size_t k = 0; k < n; ++k) { sum += 1.0 / std::pow((double)(k + 1), s); cdf[k] = sum; }
+        for (auto& c : cdf) c /= sum;
+    }
+    size_t operator()(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return std::min((size_t)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), cdf.size() - 1);
+    }
+};
+
+// --- Dataset ---
+
+struct Dataset {
+    std::string hubNodeId;   // most depended-on export on the first branch
+    std::string firstBranch;
+    long nodes = 0;
+};
+
+static void ApplyMigrations(sqlite3* db, const std::string& dir) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        fs::path sql = entry.path() / "migration.sql";
+        if (fs::exists(sql)) files.push_back(sql);
+    }
+    if (files.empty()) {
+        fprintf(stderr, "No migrations found in %s (run from packages/server or pass --migrations)\n", dir.c_str());
+        exit(1);
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& f : files) {
+        std::ifstream in(f);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        Exec(db, ss.str());
+    }
+}
+
+static Dataset Generate(sqlite3* db, long targetEdges, const BenchOptions& opt, std::mt19937_64& rng) {
+    Dataset ds;
+
+    long edgesPerBranch = std::max(1L, targetEdges / opt.branches);
+    long eventEdges = (long)(edgesPerBranch * opt.eventShare);
+    long importEdges = edgesPerBranch - eventEdges;
+
+    int projects = (int)std::max(20L, targetEdges / 500);
+    int libs = std::max(2, (int)(projects * opt.libShare));
+    int exportsPerLib = (int)std::max(4L, importEdges / (libs * 4L));
+
+    std::vector<std::string> projectIds, projectNames;
+    sqlite3_stmt* insProject;
+    if (sqlite3_prepare_v2(db, "INSERT INTO Project (id, addr, name, type, updatedAt) VALUES (?, ?, ?, ?, 0)", -1, &insProject, nullptr) != SQLITE_OK) Fail("prepare project", db);
+    for (int p = 0; p < projects; ++p) {
+        std::string id = MakeId(rng);
+        std::string name = (p < libs ? "@bench/lib-" : "@bench/app-") + std::to_string(p);
+        sqlite3_bind_text(insProject, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insProject, 2, ("https://git.example.com/" + name).c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insProject, 3, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insProject, 4, p < libs ? "Lib" : "App", -1, SQLITE_STATIC);
+        if (sqlite3_step(insProject) != SQLITE_DONE) Fail("insert project", db);
+        sqlite3_reset(insProject);
+        projectIds.push_back(id);
+        projectNames.push_back(name);
+    }
+    sqlite3_finalize(insProject);
+
+    sqlite3_stmt* insNode;
+    const char* nodeSql =
+        "INSERT INTO Node (id, branch, projectId, projectName, version, type, name, relativePath, "
+        "startLine, startColumn, endLine, endColumn, meta, updatedAt, import_pkg, import_name, import_subpkg, export_entry) "
+        "VALUES (?, ?, ?, ?, '1.0.0', ?, ?, ?, ?, 1, ?, 20, '{}', 0, ?, ?, ?, ?)";
+    if (sqlite3_prepare_v2(db, nodeSql, -1, &insNode, nullptr) != SQLITE_OK) Fail("prepare node", db);
+
+    std::vector<int> lineCounter(projects, 0);
+    auto insert = [&](const std::string& branch, int p, const char* type, const std::string& name,
+                      const char* importPkg, const char* importName, const char* importSubpkg, const char* exportEntry) {
+        std::string id = MakeId(rng);
+        int line = ++lineCounter[p];
+        std::string file = "src/f" + std::to_string(line / 50) + ".ts";
+        sqlite3_bind_text(insNode, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insNode, 2, branch.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insNode, 3, projectIds[p].c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insNode, 4, projectNames[p].c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insNode, 5, type, -1, SQLITE_STATIC);
+        sqlite3_bind_text(insNode, 6, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insNode, 7, file.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(insNode, 8, line);
+        sqlite3_bind_int(insNode, 9, line);
+        if (importPkg) sqlite3_bind_text(insNode, 10, importPkg, -1, SQLITE_TRANSIENT); else sqlite3_bind_null(insNode, 10);
+        if (importName) sqlite3_bind_text(insNode, 11, importName, -1, SQLITE_TRANSIENT); else sqlite3_bind_null(insNode, 11);
+        if (importSubpkg) sqlite3_bind_text(insNode, 12, importSubpkg, -1, SQLITE_TRANSIENT); else sqlite3_bind_null(insNode, 12);
+        if (exportEntry) sqlite3_bind_text(insNode, 13, exportEntry, -1, SQLITE_TRANSIENT); else sqlite3_bind_null(insNode, 13);
+        if (sqlite3_step(insNode) != SQLITE_DONE) Fail("insert node", db);
+        sqlite3_reset(insNode);
+        ds.nodes++;
+        return id;
+    };
+
+    Zipf libRank(libs, opt.zipfExponent);
+    Zipf exportRank(exportsPerLib, opt.zipfExponent);
+    Zipf projectRank(projects, opt.zipfExponent);
+    std::uniform_int_distribution<int> anyProject(0, projects - 1);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    Exec(db, "BEGIN");
+    for (int b = 0; b < opt.branches; ++b) {
+        std::string branch = b == 0 ? "main" : "feature-" + std::to_string(b);
+        if (b == 0) ds.firstBranch = branch;
+
+        // Exports of every lib
+        for (int l = 0; l < libs; ++l) {
+            for (int e = 0; e < exportsPerLib; ++e) {
+                std::string id = insert(branch, l, "NamedExport", "exp" + std::to_string(e), nullptr, nullptr, nullptr, "index");
+                if (b == 0 && l == 0 && e == 0) ds.hubNodeId = id;
+            }
+        }
+
+        // Imports: apps import any lib, lib i imports only more foundational
+        // libs (j < i) unless it rolls a cycle.
+        for (long i = 0; i < importEdges; ++i) {
+            int p = anyProject(rng);
+            int target = -1;
+            for (int attempt = 0; attempt < 8 && target < 0; ++attempt) {
+                int j = (int)libRank(rng);
+                if (j == p) continue;
+                if (p < libs && j > p && coin(rng) >= opt.cycleDensity) continue;
+                target = j;
+            }
+            if (target < 0) { p = libs + (int)(i % std::max(1, projects - libs)); target = (int)libRank(rng); }
+            if (p == target) continue;
+
+            std::string exportName = "exp" + std::to_string(exportRank(rng));
+            const std::string& pkg = projectNames[target];
+            double kind = coin(rng);
+            if (kind < 0.05) {
+                insert(branch, p, "RuntimeDynamicImport", pkg + ".Nil." + exportName, pkg.c_str(), exportName.c_str(), "Nil", nullptr);
+            } else {
+                insert(branch, p, "NamedImport", pkg + "." + exportName, pkg.c_str(), exportName.c_str(), nullptr, nullptr);
+            }
+        }
+
+        // Events: one emitter and two listeners per name, in distinct projects
+        for (long e = 0; e < eventEdges / 2; ++e) {
+            std::string name = "event:" + std::to_string(e);
+            int emitter = (int)projectRank(rng);
+            insert(branch, emitter, "EventEmit", name, nullptr, nullptr, nullptr, nullptr);
+            for (int k = 0; k < 2; ++k) {
+                int listener = anyProject(rng);
+                if (listener == emitter) listener = (listener + 1) % projects;
+                insert(branch, listener, "EventOn", name, nullptr, nullptr, nullptr, nullptr);
+            }
+        }
+    }
+    Exec(db, "COMMIT");
+    sqlite3_finalize(insNode);
+    Exec(db, "ANALYZE");
+    return ds;
+}
+
+// Keep in sync with src/workers/create-connections.ts
+static const char* ConnectionRules[] = {
+    "INSERT OR IGNORE INTO Connection (fromKey, toKey) SELECT nFrom.rowid, nTo.rowid FROM Node nFrom "
+    "JOIN Node nTo ON nFrom.import_pkg = nTo.projectName AND nFrom.import_name = nTo.name AND nFrom.branch = nTo.branch "
+    "WHERE nFrom.type = 'NamedImport' AND nTo.type = 'NamedExport' AND nFrom.projectName != nTo.projectName",
+
+    "INSERT OR IGNORE INTO Connection (fromKey, toKey) SELECT nFrom.rowid, nTo.rowid FROM Node nFrom "
+    "JOIN Node nTo ON nFrom.import_pkg = nTo.projectName "
+    "AND (nFrom.import_subpkg = nTo.export_entry OR (nFrom.import_subpkg = 'Nil' AND nTo.export_entry = 'index')) "
+    "AND nFrom.import_name = nTo.name AND nFrom.branch = nTo.branch "
+    "WHERE nFrom.type = 'RuntimeDynamicImport' AND nTo.type = 'NamedExport' AND nFrom.projectName != nTo.projectName",
+
+    "INSERT OR IGNORE INTO Connection (fromKey, toKey) SELECT nFrom.rowid, nTo.rowid FROM Node nFrom "
+    "JOIN Node nTo ON nFrom.import_pkg = nTo.projectName AND nFrom.import_name = nTo.export_entry AND nFrom.branch = nTo.branch "
+    "WHERE nFrom.type = 'DynamicModuleFederationReference' AND nTo.type = 'NamedExport' AND nFrom.projectName != nTo.projectName",
+
+    "INSERT OR IGNORE INTO Connection (fromKey, toKey) SELECT nFrom.rowid, nTo.rowid FROM Node nFrom "
+    "JOIN Node nTo ON nFrom.name = nTo.name AND nFrom.branch = nTo.branch "
+    "WHERE ((nFrom.type = 'GlobalVarRead' AND nTo.type = 'GlobalVarWrite') OR "
+    "(nFrom.type = 'WebStorageRead' AND nTo.type = 'WebStorageWrite') OR "
+    "(nFrom.type = 'EventOn' AND nTo.type = 'EventEmit') OR "
+    "(nFrom.type = 'UrlParamRead' AND nTo.type = 'UrlParamWrite')) "
+    "AND nFrom.projectName != nTo.projectName",
+};
+
+// --- Suite ---
+
+static void RunSuite(long edges, const BenchOptions& opt, std::vector<StageResult>& results) {
+    fprintf(stderr, "dataset: %ld edges\n", edges);
+    std::mt19937_64 rng(opt.seed + edges);
+
+    std::string dbPath = (fs::path(opt.dbDir) / ("dms-bench-" + std::to_string(edges) + ".db")).string();
+    fs::remove(dbPath);
+    fs::remove(dbPath + "-wal");
+    fs::remove(dbPath + "-shm");
+
+    sqlite3* db;
+    if (sqlite3_open(dbPath.c_str(), &db) != SQLITE_OK) Fail("open", db);
+    Exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL; PRAGMA foreign_keys=ON;");
+    ApplyMigrations(db, opt.migrations);
+
+    Dataset ds;
+    {
+        StageResult r = Measure(edges, "generate", 1, nullptr, [&] { ds = Generate(db, edges, opt, rng); });
+        r.metrics.push_back({ "nodes", (double)ds.nodes });
+        results.push_back(r);
+    }
+
+    {
+        StageResult r = Measure(edges, "connection_rules", opt.iterations,
+            [&] { Exec(db, "DELETE FROM Connection"); },
+            [&] { for (const char* rule : ConnectionRules) Exec(db, rule); });
+        r.metrics.push_back({ "connections", (double)QueryLong(db, "SELECT count(*) FROM Connection") });
+        results.push_back(r);
+    }
+    {
+        // The same rules as matched by the native partitioned matcher
+        StageResult r = Measure(edges, "connection_matcher", opt.iterations,
+            [&] { Exec(db, "DELETE FROM Connection"); },
+            [&] { QueryLong(db, "SELECT length(dms_match_connections())"); });
+        r.metrics.push_back({ "connections", (double)QueryLong(db, "SELECT count(*) FROM Connection") });
+        results.push_back(r);
+    }
+
+    std::vector<GraphNode> nodes;
+    std::vector<GraphConnection> connections;
+    auto traverse = [&] {
+        nodes.clear();
+        connections.clear();
+        NodeTraversal traversal(db, ds.hubNodeId, opt.depth, TraversalDirection::Both);
+        std::vector<GraphNode> levelNodes;
+        std::vector<GraphConnection> levelConnections;
+        while (traversal.Next(levelNodes, levelConnections)) {
+            nodes.insert(nodes.end(), levelNodes.begin(), levelNodes.end());
+            connections.insert(connections.end(), levelConnections.begin(), levelConnections.end());
+        }
+    };
+    {
+        StageResult r = Measure(edges, "bfs", opt.iterations, nullptr, traverse);
+        r.metrics.push_back({ "depth", (double)opt.depth });
+        r.metrics.push_back({ "vertices", (double)nodes.size() });
+        r.metrics.push_back({ "edgesVisited", (double)connections.size() });
+        results.push_back(r);
+    }
+    {
+        // What "bfs" would cost with each strategy forced; scans are rebuilt
+        // every time because the disabled result cache can't vouch for a
+        // resident adjacency
+        QueryLong(db, "SELECT length(traversal_stats('probe'))");
+        results.push_back(Measure(edges, "bfs_probe", opt.iterations, nullptr, traverse));
+        QueryLong(db, "SELECT length(traversal_stats('scan'))");
+        QueryLong(db, "SELECT length(result_cache_stats(0))");
+        results.push_back(Measure(edges, "bfs_scan", opt.iterations, nullptr, traverse));
+        QueryLong(db, "SELECT length(result_cache_stats(64 * 1024 * 1024))");
+        QueryLong(db, "SELECT length(traversal_stats('auto'))");
+    }
+
+    OrthogonalGraph og;
+    results.push_back(Measure(edges, "build_orthogonal_graph", opt.iterations, nullptr,
+        [&] { og = BuildOrthogonalGraph(nodes, connections); }));
+
+    std::vector<std::vector<GraphNode>> cycles;
+    if ((int)og.vertices.size() <= opt.cycleLimit) {
+        StageResult r = Measure(edges, "detect_cycles", opt.iterations, nullptr, [&] { cycles = DetectCycles(og); });
+        r.metrics.push_back({ "cycles", (double)cycles.size() });
+        results.push_back(r);
+    } else {
+        StageResult r{ edges, "detect_cycles", {}, {}, "vertices above --cycle-limit" };
+        r.metrics.push_back({ "vertices", (double)og.vertices.size() });
+        results.push_back(r);
+        fprintf(stderr, "  %-24s    skipped\n", "detect_cycles");
+    }
+
+    {
+        size_t bytes = 0;
+        StageResult r = Measure(edges, "serialize_graph", opt.iterations, nullptr,
+            [&] { bytes = SerializeGraph(og, cycles).size(); });
+        r.metrics.push_back({ "bytes", (double)bytes });
+        results.push_back(r);
+    }
+
+    {
+        std::string compressed;
+        StageResult r = Measure(edges, "serialize_graph_gzip", opt.iterations, nullptr, [&] {
+            GzipWriter gzip;
+            SerializeGraph([&](std::string_view chunk) { gzip.write(chunk); }, og, cycles);
+            gzip.finish(compressed);
+        });
+        r.metrics.push_back({ "bytes", (double)compressed.size() });
+        results.push_back(r);
+    }
+
+    {
+        GraphLayout layout;
+        StageResult r = Measure(edges, "layered_layout", opt.iterations, nullptr,
+            [&] { layout = ComputeLayeredLayout(og); });
+        r.metrics.push_back({ "layers", (double)layout.layers });
+        r.metrics.push_back({ "width", (double)layout.width });
+        results.push_back(r);
+    }
+
+    {
+        // Stages above measure computation, not the result cache
+        QueryLong(db, "SELECT length(result_cache_stats(0))");
+        long bytes = 0;
+        std::string sql = "SELECT length(get_project_dependency_graph('*', '" + ds.firstBranch + "'))";
+        StageResult r = Measure(edges, "project_graph_all", opt.iterations, nullptr, [&] { bytes = QueryLong(db, sql); });
+        r.metrics.push_back({ "bytes", (double)bytes });
+        results.push_back(r);
+    }
+
+    {
+        long bytes = 0;
+        std::string sql = "SELECT length(project_clusters('" + ds.firstBranch + "'))";
+        StageResult r = Measure(edges, "project_clusters", opt.iterations, nullptr, [&] { bytes = QueryLong(db, sql); });
+        r.metrics.push_back({ "bytes", (double)bytes });
+        results.push_back(r);
+    }
+
+    for (const char* metric : { "indegree", "pagerank", "betweenness" }) {
+        std::string sql = "SELECT length(rank_nodes('" + ds.firstBranch + "', '" + metric + "'))";
+        StageResult r = Measure(edges, std::string("rank_") + metric, opt.iterations, nullptr, [&] { QueryLong(db, sql); });
+        results.push_back(r);
+    }
+
+    {
+        long bytes = 0;
+        std::string sql = "SELECT length(get_node_dependency_graph('" + ds.hubNodeId + "', " + std::to_string(opt.depth) + "))";
+        QueryLong(db, "SELECT length(result_cache_stats(256 * 1024 * 1024))");
+        QueryLong(db, sql); // warm
+        StageResult r = Measure(edges, "node_graph_cached", opt.iterations, nullptr, [&] { bytes = QueryLong(db, sql); });
+        r.metrics.push_back({ "bytes", (double)bytes });
+        results.push_back(r);
+        QueryLong(db, "SELECT length(result_cache_stats(0))");
+    }
+
+    {
+        long rows = 0;
+        StageResult r = Measure(edges, "impact_sketches", opt.iterations, nullptr,
+            [&] { rows = QueryLong(db, "SELECT impact_sketch_build()"); });
+        r.metrics.push_back({ "nodes", (double)rows });
+        r.metrics.push_back({ "bytes", (double)QueryLong(db, "SELECT sum(length(nodeSketch) + length(projectSketch)) FROM ImpactSketch") });
+        results.push_back(r);
+    }
+
+    // Last, as each commit replaces the first branch's nodes of the committed
+    // projects (and, through the cascade, their connections) with fresh rows
+    {
+        std::string branch = "'" + ds.firstBranch + "'";
+        std::string largest = QueryText(db, "SELECT json_array(projectName) FROM Node WHERE branch = " + branch +
+                                                " GROUP BY projectName ORDER BY count(*) DESC LIMIT 1");
+        std::string all = QueryText(db, "SELECT json_group_array(DISTINCT projectName) FROM Node WHERE branch = " + branch);
+        for (const auto& stage : { std::make_pair("commit_shallow_project", largest),
+                                   std::make_pair("commit_shallow_all", all) }) {
+            std::string projects = "'" + stage.second + "'";
+            long staged = 0;
+            StageResult r = Measure(edges, stage.first, opt.iterations,
+                [&] {
+                    Exec(db, "INSERT INTO Node (id, branch, projectId, projectName, version, type, name, relativePath, "
+                             "startLine, startColumn, endLine, endColumn, meta, updatedAt, import_pkg, import_name, "
+                             "import_subpkg, export_entry) "
+                             "SELECT 'c' || lower(hex(randomblob(12))), 'shallow', projectId, projectName, version, type, "
+                             "name, relativePath, startLine, startColumn, endLine, endColumn, meta, 0, import_pkg, "
+                             "import_name, import_subpkg, export_entry FROM Node WHERE branch = " + branch +
+                             " AND projectName IN (SELECT value FROM json_each(" + projects + "))");
+                    QueryLong(db, "SELECT length(dms_match_connections(" + branch + "))");
+                    staged = QueryLong(db, "SELECT count(*) FROM Node WHERE branch = 'shallow'");
+                },
+                [&] { QueryLong(db, "SELECT length(dms_commit_shallow('shallow', " + branch + ", " + projects + "))"); });
+            r.metrics.push_back({ "nodes", (double)staged });
+            results.push_back(r);
+        }
+    }
+
+    sqlite3_close(db);
+    if (!opt.keep) {
+        fs::remove(dbPath);
+        fs::remove(dbPath + "-wal");
+        fs::remove(dbPath + "-shm");
+    }
+}
+
+// --- Output ---
+
+static std::string ToJson(const BenchOptions& opt, const std::vector<StageResult>& results) {
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("benchmark"); jb.string("graph"); jb.comma();
+    jb.key("sqlite"); jb.string(sqlite3_libversion()); jb.comma();
+    jb.key("params"); jb.beginObject();
+        jb.key("seed"); jb.number((int)opt.seed); jb.comma();
+        jb.key("branches"); jb.number(opt.branches); jb.comma();
+        jb.key("depth"); jb.number(opt.depth); jb.comma();
+        jb.key("iterations"); jb.number(opt.iterations); jb.comma();
+        jb.key("libShare"); jb.raw(std::to_string(opt.libShare)); jb.comma();
+        jb.key("zipfExponent"); jb.raw(std::to_string(opt.zipfExponent)); jb.comma();
+        jb.key("cycleDensity"); jb.raw(std::to_string(opt.cycleDensity)); jb.comma();
+        jb.key("eventShare"); jb.raw(std::to_string(opt.eventShare));
+    jb.endObject(); jb.comma();
+    jb.key("results"); jb.beginArray();
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        if (i > 0) jb.comma();
+        jb.beginObject();
+        jb.key("edges"); jb.raw(std::to_string(r.edges)); jb.comma();
+        jb.key("stage"); jb.string(r.stage);
+        if (!r.skipped.empty()) {
+            jb.comma(); jb.key("skipped"); jb.string(r.skipped);
+        }
+        if (!r.samplesMs.empty()) {
+            std::vector<double> sorted = r.samplesMs;
+            std::sort(sorted.begin(), sorted.end());
+            jb.comma(); jb.key("minMs"); jb.raw(std::to_string(sorted.front()));
+            jb.comma(); jb.key("medianMs"); jb.raw(std::to_string(sorted[sorted.size() / 2]));
+            jb.comma(); jb.key("maxMs"); jb.raw(std::to_string(sorted.back()));
+        }
+        for (const auto& m : r.metrics) {
+            jb.comma(); jb.key(m.first); jb.raw(std::to_string((long long)m.second));
+        }
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.endObject();
+    return jb.str();
+}
+
+static std::vector<long> ParseList(const char* s) {
+    std::vector<long> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) out.push_back(std::stol(item));
+    return out;
+}
+
+static void Usage() {
+    fprintf(stderr,
+        "usage: graph_bench [--edges 10000,100000,1000000] [--branches 2] [--lib-share 0.3]\n"
+        "                   [--zipf 1.2] [--cycle-density 0.01] [--event-share 0.05] [--depth 3]\n"
+        "                   [--iterations 3] [--cycle-limit 20000] [--seed 42]\n"
+        "                   [--migrations prisma/migrations] [--db-dir DIR] [--out FILE] [--keep]\n");
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) { Usage(); exit(2); }
+            return argv[++i];
+        };
+        if (a == "--edges") opt.edgeCounts = ParseList(value());
+        else if (a == "--branches") opt.branches = std::max(1, atoi(value()));
+        else if (a == "--lib-share") opt.libShare = atof(value());
+        else if (a == "--zipf") opt.zipfExponent = atof(value());
+        else if (a == "--cycle-density") opt.cycleDensity = atof(value());
+        else if (a == "--event-share") opt.eventShare = atof(value());
+        else if (a == "--depth") opt.depth = atoi(value());
+        else if (a == "--iterations") opt.iterations = std::max(1, atoi(value()));
+        else if (a == "--cycle-limit") opt.cycleLimit = atoi(value());
+        else if (a == "--seed") opt.seed = strtoul(value(), nullptr, 10);
+        else if (a == "--migrations") opt.migrations = value();
+        else if (a == "--db-dir") opt.dbDir = value();
+        else if (a == "--out") opt.out = value();
+        else if (a == "--keep") opt.keep = true;
+        else { Usage(); return 2; }
+    }
+
+    sqlite3_auto_extension((void (*)(void))sqlite3_extension_init);
+
+    std::vector<StageResult> results;
+    for (long edges : opt.edgeCounts) RunSuite(edges, opt, results);
+
+    std::string json = ToJson(opt, results);
+    if (opt.out.empty()) {
+        printf("%s\n", json.c_str());
+    } else if (!(std::ofstream(opt.out) << json << "\n")) {
+        fprintf(stderr, "Failed to write %s\n", opt.out.c_str());
+        return 1;
+    }
+    return 0;
+}
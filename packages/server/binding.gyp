@@ -2,11 +2,22 @@
   "targets": [
     {
       "target_name": "sqlite_hook",
-      "sources": [ "src/native/sqlite-hook.cc" ],
+      "sources": [ "src/native/sqlite-hook.cc", "src/native/graph-binding.cc", "src/native/graph.cc", "src/native/db-state.cc", "src/native/fuzzy-index.cc", "src/native/graph-layout.cc", "src/native/node-ingest.cc", "src/native/branch-commit.cc", "src/native/impact-sketch.cc", "src/native/change-impact.cc", "src/native/result-cache.cc", "src/native/graph-query.cc", "src/native/project-clusters.cc", "src/native/centrality.cc", "src/native/traversal-planner.cc", "src/native/branch-overlay.cc", "src/native/connection-matcher.cc", "src/native/path-match.cc", "src/native/graph-delta.cc", "src/native/graph-spill.cc", "src/native/orphan-nodes.cc", "src/native/content-hash.cc" ],
       "cflags_cc": [ "-std=c++17" ],
       "xcode_settings": {
         "CLANG_CXX_LANGUAGE_STANDARD": "c++17"
       }
+    },
+    {
+      "target_name": "graph_bench",
+      "type": "executable",
+      "sources": [ "bench/graph-bench.cc", "src/native/sqlite-hook.cc", "src/native/graph.cc", "src/native/db-state.cc", "src/native/fuzzy-index.cc", "src/native/graph-layout.cc", "src/native/node-ingest.cc", "src/native/branch-commit.cc", "src/native/impact-sketch.cc", "src/native/change-impact.cc", "src/native/result-cache.cc", "src/native/graph-query.cc", "src/native/project-clusters.cc", "src/native/centrality.cc", "src/native/traversal-planner.cc", "src/native/branch-overlay.cc", "src/native/connection-matcher.cc", "src/native/path-match.cc", "src/native/graph-delta.cc", "src/native/graph-spill.cc", "src/native/orphan-nodes.cc", "src/native/content-hash.cc" ],
+      "libraries": [ "-lsqlite3", "-lz", "-lpthread" ],
+      "cflags_cc": [ "-std=c++17", "-O2" ],
+      "xcode_settings": {
+        "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+        "GCC_OPTIMIZATION_LEVEL": "2"
+      }
     }
   ]
 }
@@ -0,0 +1,72 @@
+-- Integer node keys for the native graph traversal.
+--
+-- Node gets an explicit "key" column. Declared INTEGER PRIMARY KEY it is the
+-- table's rowid, so the extension can refer to nodes by it and a VACUUM does
+-- not renumber it. Existing rows keep their current rowid as key.
+--
+-- Connection is then keyed by the keys of its endpoints instead of their
+-- cuids: (fromKey, toKey) is the primary key and the only other index is the
+-- reverse one, so each edge is stored as two short integer tuples rather than
+-- four indexes of TEXT ids. The cuids are a join away through Node.
+--
+-- Connection stays a rowid table: the change hook and the result cache track
+-- its rows by rowid, and the update hook skips WITHOUT ROWID tables.
+
+-- RedefineTables
+PRAGMA defer_foreign_keys=ON;
+PRAGMA foreign_keys=OFF;
+CREATE TABLE "new_Node" (
+    "key" INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+    "id" TEXT NOT NULL,
+    "branch" TEXT NOT NULL,
+    "projectId" TEXT NOT NULL,
+    "projectName" TEXT NOT NULL,
+    "version" TEXT NOT NULL,
+    "type" TEXT NOT NULL,
+    "name" TEXT NOT NULL,
+    "relativePath" TEXT NOT NULL,
+    "startLine" INTEGER NOT NULL,
+    "startColumn" INTEGER NOT NULL,
+    "endLine" INTEGER NOT NULL,
+    "endColumn" INTEGER NOT NULL,
+    "meta" JSONB NOT NULL,
+    "createdAt" DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    "updatedAt" DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    "qlsVersion" TEXT NOT NULL DEFAULT '0.1.0',
+    "import_pkg" TEXT,
+    "import_name" TEXT,
+    "import_subpkg" TEXT,
+    "export_entry" TEXT,
+    CONSTRAINT "Node_projectId_fkey" FOREIGN KEY ("projectId") REFERENCES "Project" ("id") ON DELETE CASCADE ON UPDATE CASCADE
+);
+INSERT INTO "new_Node" ("key", "branch", "createdAt", "endColumn", "endLine", "export_entry", "id", "import_name", "import_pkg", "import_subpkg", "meta", "name", "projectId", "projectName", "qlsVersion", "relativePath", "startColumn", "startLine", "type", "updatedAt", "version") SELECT "rowid", "branch", "createdAt", "endColumn", "endLine", "export_entry", "id", "import_name", "import_pkg", "import_subpkg", "meta", "name", "projectId", "projectName", "qlsVersion", "relativePath", "startColumn", "startLine", "type", "updatedAt", "version" FROM "Node";
+DROP TABLE "Node";
+ALTER TABLE "new_Node" RENAME TO "Node";
+CREATE TABLE "new_Connection" (
+    "fromKey" INTEGER NOT NULL,
+    "toKey" INTEGER NOT NULL,
+    "createdAt" DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+
+    PRIMARY KEY ("fromKey", "toKey"),
+    CONSTRAINT "Connection_fromKey_fkey" FOREIGN KEY ("fromKey") REFERENCES "Node" ("key") ON DELETE CASCADE ON UPDATE CASCADE,
+    CONSTRAINT "Connection_toKey_fkey" FOREIGN KEY ("toKey") REFERENCES "Node" ("key") ON DELETE CASCADE ON UPDATE CASCADE
+);
+INSERT INTO "new_Connection" ("fromKey", "toKey", "createdAt") SELECT "nFrom"."key", "nTo"."key", "Connection"."createdAt" FROM "Connection" JOIN "Node" AS "nFrom" ON "nFrom"."id" = "Connection"."fromId" JOIN "Node" AS "nTo" ON "nTo"."id" = "Connection"."toId" ORDER BY "nFrom"."key", "nTo"."key";
+DROP TABLE "Connection";
+ALTER TABLE "new_Connection" RENAME TO "Connection";
+CREATE UNIQUE INDEX "Node_id_key" ON "Node"("id");
+CREATE INDEX "Node_projectName_idx" ON "Node"("projectName");
+CREATE INDEX "Node_type_idx" ON "Node"("type");
+CREATE INDEX "Node_name_idx" ON "Node"("name");
+CREATE INDEX "Node_branch_idx" ON "Node"("branch");
+CREATE INDEX "Node_version_idx" ON "Node"("version");
+CREATE INDEX "Node_qlsVersion_idx" ON "Node"("qlsVersion");
+CREATE INDEX "idx_scan_named_imports" ON "Node"("type", "import_pkg", "import_name", "branch", "projectName", "id");
+CREATE INDEX "idx_scan_dynamic_imports" ON "Node"("type", "import_pkg", "import_subpkg", "import_name", "branch", "projectName", "id");
+CREATE INDEX "idx_lookup_named_exports" ON "Node"("projectName", "branch", "name", "type", "id", "export_entry");
+CREATE INDEX "idx_lookup_federation_exports" ON "Node"("projectName", "branch", "export_entry", "type", "id");
+CREATE INDEX "idx_join_generics" ON "Node"("name", "branch", "type", "projectName", "id");
+CREATE UNIQUE INDEX "Node_projectId_branch_relativePath_type_name_startLine_startColumn_endLine_endColumn_qlsVersion_key" ON "Node"("projectId", "branch", "relativePath", "type", "name", "startLine", "startColumn", "endLine", "endColumn", "qlsVersion");
+CREATE INDEX "idx_connection_to_key" ON "Connection"("toKey", "fromKey");
+PRAGMA foreign_keys=ON;
+PRAGMA defer_foreign_keys=OFF;
@@ -0,0 +1,13 @@
+-- CreateTable
+CREATE TABLE "ImpactSketch" (
+    "nodeId" TEXT NOT NULL PRIMARY KEY,
+    "branch" TEXT NOT NULL,
+    "dependents" INTEGER NOT NULL,
+    "projects" INTEGER NOT NULL,
+    "nodeSketch" BLOB NOT NULL,
+    "projectSketch" BLOB NOT NULL,
+    CONSTRAINT "ImpactSketch_nodeId_fkey" FOREIGN KEY ("nodeId") REFERENCES "Node" ("id") ON DELETE CASCADE ON UPDATE CASCADE
+);
+
+-- CreateIndex
+CREATE INDEX "ImpactSketch_branch_idx" ON "ImpactSketch"("branch");
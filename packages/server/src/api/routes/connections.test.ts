@@ -164,8 +164,8 @@ describe('Connections API', () => {
 
     await prisma.connection.create({
       data: {
-        fromId: fromNode.id,
-        toId: toNode.id,
+        fromKey: fromNode.key,
+        toKey: toNode.key,
       },
     })
 
@@ -177,6 +177,8 @@ describe('Connections API', () => {
     expect(response.statusCode).toBe(200)
     const result = response.json()
     expect(result.data).toHaveLength(1)
+    expect(result.data[0].fromId).toBe(fromNode.id)
+    expect(result.data[0].toId).toBe(toNode.id)
   })
   it('should delete a connection', async () => {
     const { headers } = await getAuthHeaders(server)
@@ -228,23 +230,23 @@ describe('Connections API', () => {
 
     const connection = await prisma.connection.create({
       data: {
-        fromId: fromNode.id,
-        toId: toNode.id,
+        fromKey: fromNode.key,
+        toKey: toNode.key,
       },
     })
 
     const response = await server.inject({
       method: 'DELETE',
-      url: `/connections?fromId=${connection.fromId}&toId=${connection.toId}`,
+      url: `/connections?fromId=${fromNode.id}&toId=${toNode.id}`,
       headers,
     })
 
     expect(response.statusCode).toBe(200)
     const check = await prisma.connection.findUnique({
       where: {
-        fromId_toId: {
-          fromId: connection.fromId,
-          toId: connection.toId,
+        fromKey_toKey: {
+          fromKey: connection.fromKey,
+          toKey: connection.toKey,
         },
       },
     })
@@ -301,8 +303,8 @@ describe('Connections API', () => {
 
     await prisma.connection.create({
       data: {
-        fromId: fromNode.id,
-        toId: toNode.id,
+        fromKey: fromNode.key,
+        toKey: toNode.key,
       },
     })
 
@@ -314,7 +316,7 @@ describe('Connections API', () => {
 
     expect(response.statusCode).toBe(200)
     const count = await prisma.connection.count({
-      where: { fromId: fromNode.id },
+      where: { fromKey: fromNode.key },
     })
     expect(count).toBe(0)
   })
@@ -1,10 +1,9 @@
 import { FastifyInstance } from 'fastify'
 import * as repository from '../../database/repository'
 import type { ConnectionQuery } from '../types'
-import type { Connection, Prisma } from '../../generated/prisma/client'
+import type { Prisma } from '../../generated/prisma/client'
 import { formatStringToNumber } from '../request_parameter'
 import { authenticate } from '../../auth/middleware'
-import { onlyQuery } from '../../utils'
 
 import { ConnectionWorkerPool } from '../../workers/connection-pool'
 import { error as logError } from '../../logging'
@@ -18,8 +17,11 @@ function connectionsRoutes(fastify: FastifyInstance) {
       )
       const isFuzzy = fuzzy === 'true' || fuzzy === true
 
-      // Build the where clause with node field filters
-      const where: Prisma.ConnectionFindManyArgs['where'] = onlyQuery(filters, ['fromId', 'toId'])
+      // Build the where clause with node field filters. Connection rows hold node keys, so the
+      // node ids are matched through the relations.
+      const where: Prisma.ConnectionWhereInput = {}
+      if (filters.fromId) where.fromNode = { id: filters.fromId }
+      if (filters.toId) where.toNode = { id: filters.toId }
 
       // Build AND conditions for node field filters
       const andConditions: Prisma.ConnectionWhereInput[] = []
@@ -28,9 +30,16 @@ function connectionsRoutes(fastify: FastifyInstance) {
       if (filters?.fromNodeName || filters?.fromNodeProjectName || filters.fromNodeType) {
         const fromNodeCondition: Prisma.NodeWhereInput = {}
         if (filters.fromNodeName) {
-          fromNodeCondition.name = isFuzzy
-            ? { contains: filters.fromNodeName }
-            : { equals: filters.fromNodeName }
+          const ids = isFuzzy
+            ? await repository.findNodeIdsContaining(filters.fromNodeName, 'name')
+            : null
+          if (ids) {
+            fromNodeCondition.id = { in: ids }
+          } else {
+            fromNodeCondition.name = isFuzzy
+              ? { contains: filters.fromNodeName }
+              : { equals: filters.fromNodeName }
+          }
         }
         if (filters.fromNodeProjectName) {
           fromNodeCondition.projectName = isFuzzy
@@ -47,9 +56,16 @@ function connectionsRoutes(fastify: FastifyInstance) {
       if (filters.toNodeName || filters.toNodeProjectName || filters.toNodeType) {
         const toNodeCondition: Prisma.NodeWhereInput = {}
         if (filters.toNodeName) {
-          toNodeCondition.name = isFuzzy
-            ? { contains: filters.toNodeName }
-            : { equals: filters.toNodeName }
+          const ids = isFuzzy
+            ? await repository.findNodeIdsContaining(filters.toNodeName, 'name')
+            : null
+          if (ids) {
+            toNodeCondition.id = { in: ids }
+          } else {
+            toNodeCondition.name = isFuzzy
+              ? { contains: filters.toNodeName }
+              : { equals: filters.toNodeName }
+          }
         }
         if (filters.toNodeProjectName) {
           toNodeCondition.projectName = isFuzzy
@@ -94,7 +110,7 @@ function connectionsRoutes(fastify: FastifyInstance) {
     },
     async (request, reply) => {
       try {
-        const { fromId, toId } = request.body as Omit<Connection, 'id' | 'createdAt'>
+        const { fromId, toId } = request.body as { fromId: string; toId: string }
         const connection = await repository.createConnection(fromId, toId)
         reply.code(201).send(connection)
       } catch (error) {
@@ -114,7 +130,7 @@ function connectionsRoutes(fastify: FastifyInstance) {
     },
     async (request, reply) => {
       try {
-        const { fromId } = request.params as Pick<Connection, 'fromId'>
+        const { fromId } = request.params as { fromId: string }
         const success = await repository.deleteConnectionsByFrom(fromId)
 
         if (!success) {
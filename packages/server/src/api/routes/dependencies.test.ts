@@ -2,18 +2,56 @@ import { describe, it, expect, beforeAll, afterAll, beforeEach, afterEach, vi }
 import buildServer from '../../server'
 import { prisma } from '../../database/prisma'
 import { FastifyInstance } from 'fastify'
+import { gunzipSync, gzipSync } from 'node:zlib'
+import { Readable } from 'node:stream'
+import { cache, projectGraphCacheKey } from '../../cache/instance'
 
 // Mock dependency builder worker pool
 vi.mock('../../workers/dependency-builder-pool', () => ({
   DependencyBuilderWorkerPool: {
     getPool: () => ({
-      getNodeDependencyGraph: async () =>
-        JSON.stringify({
+      getNodeDependencyGraph: async () => ({
+        body: JSON.stringify({
           vertices: [{ data: { id: 'n1' } }, { data: { id: 'n2' } }],
           edges: [{ from: 'n1', to: 'n2' }],
         }),
-      getProjectLevelDependencyGraph: async () =>
-        JSON.stringify({ vertices: [{ data: { id: 'p1' } }], edges: [] }),
+        contentHash: '0123456789abcdef',
+      }),
+      streamNodeDependencyGraph: async () =>
+        Readable.from([
+          '{"depth":0,"vertices":[{"data":{"id":"n1"}}],"edges":[]}\n',
+          '{"depth":1,"vertices":[{"data":{"id":"n2"}}],"edges":[{"data":{"id":"n1-n2"}}]}\n',
+          '{"done":true,"depth":1,"vertexCount":2,"edgeCount":1}\n',
+        ]),
+      getProjectLevelDependencyGraph: async (
+        _projectId: string,
+        _branch: string,
+        opts?: { encoding?: 'gzip' },
+      ) => {
+        const json = JSON.stringify({ vertices: [{ data: { id: 'p1' } }], edges: [] })
+        return {
+          body: opts?.encoding === 'gzip' ? gzipSync(json) : json,
+          contentHash: 'fedcba9876543210',
+        }
+      },
+      rankNodes: async (branch: string, metric: string, topK?: number) =>
+        JSON.stringify({ branch, metric, topK, nodes: [], projects: [] }),
+      // Rejected like the worker rejects what the native side flags as invalid input
+      matchPattern: async (_branch: string, pattern: string) => {
+        if (pattern === 'broken') {
+          throw Object.assign(new Error('pattern: expected ( at offset 0'), {
+            code: 'SQLITE_FORMAT',
+          })
+        }
+        if (pattern === 'failing') throw new Error('database is locked')
+        return JSON.stringify({ branch: 'main', matches: [], truncated: false })
+      },
+      getImpactOfChanges: async () =>
+        JSON.stringify({
+          seeds: ['n1'],
+          nodeCount: 2,
+          projects: [{ projectId: 'p1', projectName: 'P1', nodes: [{ id: 'n1' }, { id: 'n2' }] }],
+        }),
     }),
   },
 }))
@@ -55,6 +93,22 @@ describe('Dependencies API', () => {
     expect(result.edges).toHaveLength(1)
   })
 
+  it('should stream node dependencies as NDJSON (mocked)', async () => {
+    const response = await server.inject({
+      method: 'GET',
+      url: '/dependencies/nodes/test-node-id/stream?depth=3',
+    })
+
+    expect(response.statusCode).toBe(200)
+    expect(response.headers['content-type']).toContain('application/x-ndjson')
+    const lines = response.payload
+      .trimEnd()
+      .split('\n')
+      .map((line) => JSON.parse(line))
+    expect(lines.map((l) => l.depth)).toEqual([0, 1, 1])
+    expect(lines.at(-1).done).toBe(true)
+  })
+
   it('should get project dependencies (mocked)', async () => {
     const response = await server.inject({
       method: 'GET',
@@ -65,4 +119,114 @@ describe('Dependencies API', () => {
     const result = response.json()
     expect(result.vertices).toHaveLength(1)
   })
+
+  it('should serve the cached all-projects graph gzip-encoded (mocked)', async () => {
+    await cache.clear('projects/graphs')
+    try {
+      // Miss (compressed by the pool), then hit (streamed from the cache file)
+      for (let i = 0; i < 2; i++) {
+        const response = await server.inject({
+          method: 'GET',
+          url: '/dependencies/projects/*/main',
+          headers: { 'accept-encoding': 'gzip, deflate' },
+        })
+        expect(response.statusCode).toBe(200)
+        expect(response.headers['content-encoding']).toBe('gzip')
+        expect(JSON.parse(gunzipSync(response.rawPayload).toString()).vertices).toHaveLength(1)
+      }
+
+      const identity = await server.inject({ method: 'GET', url: '/dependencies/projects/*/main' })
+      expect(identity.headers['content-encoding']).toBeUndefined()
+      expect(identity.json().vertices).toHaveLength(1)
+    } finally {
+      await cache.clear('projects/graphs')
+    }
+  })
+
+  it('should answer a matching If-None-Match with 304 (mocked)', async () => {
+    const first = await server.inject({ method: 'GET', url: '/dependencies/nodes/test-node-id' })
+    expect(first.headers.etag).toBe('W/"0123456789abcdef"')
+
+    const notModified = await server.inject({
+      method: 'GET',
+      url: '/dependencies/nodes/test-node-id',
+      headers: { 'if-none-match': `"stale", ${first.headers.etag}` },
+    })
+    expect(notModified.statusCode).toBe(304)
+    expect(notModified.payload).toBe('')
+
+    const stale = await server.inject({
+      method: 'GET',
+      url: '/dependencies/nodes/test-node-id',
+      headers: { 'if-none-match': 'W/"stale"' },
+    })
+    expect(stale.statusCode).toBe(200)
+  })
+
+  it('should revalidate the cached all-projects graph without reading it (mocked)', async () => {
+    await cache.clear('projects/graphs')
+    try {
+      const miss = await server.inject({ method: 'GET', url: '/dependencies/projects/*/main' })
+      expect(miss.headers.etag).toBe('W/"fedcba9876543210"')
+      await vi.waitFor(async () =>
+        expect(await cache.has(projectGraphCacheKey('main'))).toBe(true),
+      )
+
+      const hit = await server.inject({
+        method: 'GET',
+        url: '/dependencies/projects/*/main',
+        headers: { 'if-none-match': '"fedcba9876543210"', 'accept-encoding': 'gzip' },
+      })
+      expect(hit.statusCode).toBe(304)
+      expect(hit.headers.etag).toBe('W/"fedcba9876543210"')
+    } finally {
+      await cache.clear('projects/graphs')
+    }
+  })
+
+  it('should get the impact of changed lines (mocked)', async () => {
+    const response = await server.inject({
+      method: 'POST',
+      url: '/dependencies/projects/test-project-id/main/impact',
+      payload: { changes: [{ relativePath: 'src/index.ts', startLine: 1, endLine: 5 }] },
+    })
+
+    expect(response.statusCode).toBe(200)
+    expect(response.json().nodeCount).toBe(2)
+
+    const invalid = await server.inject({
+      method: 'POST',
+      url: '/dependencies/projects/test-project-id/main/impact',
+      payload: { changes: [{ startLine: 1 }] },
+    })
+    expect(invalid.statusCode).toBe(400)
+  })
+
+  it('should validate top on the rank route (mocked)', async () => {
+    const rank = (top?: string) =>
+      server.inject({
+        method: 'GET',
+        url: '/dependencies/rank/main',
+        query: top === undefined ? { metric: 'pagerank' } : { metric: 'pagerank', top },
+      })
+
+    expect((await rank()).json().topK).toBeUndefined()
+    expect((await rank('25')).json().topK).toBe(25)
+    expect((await rank('10000')).statusCode).toBe(200)
+    for (const top of ['0', '-1', '2.5', 'ten', '10001', '']) {
+      expect((await rank(top)).statusCode).toBe(400)
+    }
+  })
+
+  it('should answer invalid match patterns with 400 and other failures with 500 (mocked)', async () => {
+    const match = (pattern: string) =>
+      server.inject({
+        method: 'GET',
+        url: `/dependencies/match/main?pattern=${encodeURIComponent(pattern)}`,
+      })
+
+    expect((await match('(App)-->(Lib)')).statusCode).toBe(200)
+    expect((await match('broken')).statusCode).toBe(400)
+    expect((await match('failing')).statusCode).toBe(500)
+  })
 })
@@ -1,7 +1,74 @@
-import { FastifyInstance } from 'fastify'
+import { FastifyInstance, FastifyReply, FastifyRequest } from 'fastify'
+import { Readable } from 'node:stream'
+import { createGunzip } from 'node:zlib'
 import { DependencyBuilderWorkerPool } from '../../workers/dependency-builder-pool'
 import { error } from '../../logging'
-import { cache } from '../../cache/instance'
+import { isInvalidInputError } from '../../database/prisma'
+import { cache, projectGraphCacheKey, projectGraphEtagKey } from '../../cache/instance'
+import type { ChangedRange, GraphFilter, RankMetric } from '../../workers/dependency-builder-worker'
+
+interface GraphQuery {
+  depth?: number
+  layout?: string
+  nodeTypes?: string
+  excludeProjects?: string
+  branches?: string
+}
+
+// Comma-separated query parameters -> filter for the native traversal
+const parseGraphFilter = (query: GraphQuery): GraphFilter | undefined => {
+  const list = (value?: string) =>
+    value
+      ?.split(',')
+      .map((v) => v.trim())
+      .filter(Boolean)
+
+  const filter: GraphFilter = {
+    nodeTypes: list(query.nodeTypes),
+    excludeProjects: list(query.excludeProjects),
+    branches: list(query.branches),
+  }
+  const isEmpty = Object.values(filter).every((v) => !v || v.length === 0)
+  return isEmpty ? undefined : filter
+}
+
+const acceptsGzip = (request: FastifyRequest) =>
+  /\bgzip\b/.test(String(request.headers['accept-encoding'] ?? ''))
+
+// Sends a gzip-encoded graph as is, or inflated for clients that can't take it
+const sendGzippedJson = (
+  request: FastifyRequest,
+  reply: FastifyReply,
+  body: Buffer | Readable,
+) => {
+  reply.header('Content-Type', 'application/json').header('Vary', 'Accept-Encoding')
+  if (acceptsGzip(request)) {
+    return reply.header('Content-Encoding', 'gzip').send(body)
+  }
+  const stream = body instanceof Readable ? body : Readable.from([body])
+  return reply.send(stream.pipe(createGunzip()))
+}
+
+// Weak: one validator covers both the gzip and the identity encoding of a graph
+const graphEtag = (contentHash: string) => `W/"${contentHash}"`
+
+// If-None-Match uses the weak comparison: W/ prefixes are ignored
+const matchesEtag = (request: FastifyRequest, etag: string) => {
+  const header = request.headers['if-none-match']
+  if (!header) return false
+  if (header.trim() === '*') return true
+  const opaque = (tag: string) => tag.trim().replace(/^W\//, '')
+  return header.split(',').some((tag) => opaque(tag) === opaque(etag))
+}
+
+// Sets the graph's ETag; sends 304 and returns true when the client's copy is current
+const sendNotModified = (request: FastifyRequest, reply: FastifyReply, contentHash: string) => {
+  const etag = graphEtag(contentHash)
+  reply.header('ETag', etag)
+  if (!matchesEtag(request, etag)) return false
+  reply.header('Vary', 'Accept-Encoding').code(304).send()
+  return true
+}
 
 // Custom error class for not found errors
 class NotFoundError extends Error {
@@ -19,19 +86,26 @@ const isNotFoundError = (error: unknown): error is NotFoundError => {
   )
 }
 
+// Most nodes and projects one ranking returns; rank_nodes clamps to the same bound
+// (MaxTopK in src/native/centrality.cc)
+const MAX_RANK_TOP = 10000
+
 function dependenciesRoutes(fastify: FastifyInstance) {
   // GET /dependencies/nodes/:nodeId - Get dependency graph for a specific node (recursive)
   fastify.get('/dependencies/nodes/:nodeId', async (request, reply) => {
     try {
       const { nodeId } = request.params as { nodeId: string }
-      const { depth } = request.query as { depth?: number }
+      const query = request.query as GraphQuery
 
-      const graphJson = await DependencyBuilderWorkerPool.getPool().getNodeDependencyGraph(nodeId, {
-        depth,
+      const graph = await DependencyBuilderWorkerPool.getPool().getNodeDependencyGraph(nodeId, {
+        depth: query.depth,
+        filter: parseGraphFilter(query),
+        layout: query.layout === 'true',
       })
+      if (sendNotModified(request, reply, graph.contentHash)) return
 
       // Send raw JSON string directly
-      reply.header('Content-Type', 'application/json').send(graphJson)
+      reply.header('Content-Type', 'application/json').send(graph.body)
     } catch (error) {
       if (isNotFoundError(error)) {
         reply.code(404).send({
@@ -47,24 +121,50 @@ function dependenciesRoutes(fastify: FastifyInstance) {
     }
   })
 
+  // GET /dependencies/nodes/:nodeId/stream - The same graph as NDJSON, one line per BFS
+  // level (or slice of one), each sent as soon as the traversal has walked it
+  fastify.get('/dependencies/nodes/:nodeId/stream', async (request, reply) => {
+    try {
+      const { nodeId } = request.params as { nodeId: string }
+      const query = request.query as GraphQuery
+
+      const stream = await DependencyBuilderWorkerPool.getPool().streamNodeDependencyGraph(nodeId, {
+        depth: query.depth,
+        filter: parseGraphFilter(query),
+      })
+      // Stops the traversal once the client goes away
+      reply.raw.on('close', () => stream.destroy())
+
+      return reply.header('Content-Type', 'application/x-ndjson').send(stream)
+    } catch (error) {
+      reply.code(500).send({
+        error: 'Failed to stream node dependency graph',
+        details: error instanceof Error ? error.message : 'Unknown error',
+      })
+    }
+  })
+
   // GET /dependencies/projects/:projectId - Get project-level dependency graph
   fastify.get('/dependencies/projects/:projectId/:branch', async (request, reply) => {
     try {
       const { projectId, branch } = request.params as { projectId: string; branch: string }
-      const { depth } = request.query as { depth?: number }
+      const query = request.query as GraphQuery
+      const filter = parseGraphFilter(query)
 
-      const useCache = projectId === '*'
-      const cacheKey = `projects/graphs/${branch}`
+      // Filtered graphs are cheap to rebuild and would multiply cache entries
+      const useCache = projectId === '*' && !filter
+      const cacheKey = projectGraphCacheKey(branch)
+      const etagKey = projectGraphEtagKey(branch)
 
       // Cache-first strategy: check cache before calling worker
       if (useCache) {
         const cacheExists = await cache.has(cacheKey)
         if (cacheExists) {
-          // Stream cached file directly to HTTP response
-          const readStream = cache.createReadStream(cacheKey)
-
-          reply.header('Content-Type', 'application/json')
-          return reply.send(readStream)
+          // A file cached without its hash is still served, just without an ETag
+          const contentHash = await cache.get(etagKey)
+          if (contentHash && sendNotModified(request, reply, contentHash)) return
+          // Stream the compressed file directly to the HTTP response
+          return sendGzippedJson(request, reply, cache.createReadStream(cacheKey))
         }
       }
 
@@ -73,19 +173,30 @@ function dependenciesRoutes(fastify: FastifyInstance) {
         projectId,
         branch,
         {
-          depth,
+          depth: query.depth,
+          filter,
+          // The cached '*' graph always carries the layout so clients can render it as is
+          layout: useCache || query.layout === 'true',
+          // The cached graph is compressed once, natively, and served as stored
+          encoding: useCache ? 'gzip' : undefined,
         },
       )
 
-      // Write to cache asynchronously (fire and forget)
       if (useCache) {
-        cache.set(cacheKey, result).catch((e) => {
-          console.warn(`Failed to write cache: ${e}`)
-        })
+        // Write to cache asynchronously (fire and forget); the hash goes first so
+        // a cached file always has its ETag
+        cache
+          .set(etagKey, result.contentHash)
+          .then(() => cache.set(cacheKey, result.body))
+          .catch((e) => {
+            console.warn(`Failed to write cache: ${e}`)
+          })
       }
+      if (sendNotModified(request, reply, result.contentHash)) return
+      if (useCache) return sendGzippedJson(request, reply, result.body as Buffer)
 
       // Send Buffer directly to response (more efficient than converting to string)
-      reply.header('Content-Type', 'application/json').send(result)
+      reply.header('Content-Type', 'application/json').send(result.body)
     } catch (err) {
       error(err)
       if (isNotFoundError(err)) {
@@ -101,6 +212,193 @@ function dependenciesRoutes(fastify: FastifyInstance) {
       }
     }
   })
+
+  // GET /dependencies/clusters/:branch - Projects as super-vertices, for a first paint
+  fastify.get('/dependencies/clusters/:branch', async (request, reply) => {
+    try {
+      const { branch } = request.params as { branch: string }
+      const json = await DependencyBuilderWorkerPool.getPool().getProjectClusters(
+        branch,
+        parseGraphFilter(request.query as GraphQuery),
+      )
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      reply.code(500).send({
+        error: 'Failed to fetch project clusters',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
+
+  // GET /dependencies/clusters/:branch/:projectId - Boundary nodes of one expanded cluster
+  fastify.get('/dependencies/clusters/:branch/:projectId', async (request, reply) => {
+    try {
+      const { branch, projectId } = request.params as { branch: string; projectId: string }
+      const json = await DependencyBuilderWorkerPool.getPool().expandProject(
+        projectId,
+        branch,
+        parseGraphFilter(request.query as GraphQuery),
+      )
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      if (isNotFoundError(err)) {
+        reply.code(404).send({ error: 'Project not found', details: err.message })
+      } else {
+        error(err)
+        reply.code(500).send({
+          error: 'Failed to expand project',
+          details: err instanceof Error ? err.message : 'Unknown error',
+        })
+      }
+    }
+  })
+
+  // GET /dependencies/rank/:branch?metric=pagerank&top=50 - Most central nodes and projects
+  fastify.get('/dependencies/rank/:branch', async (request, reply) => {
+    const { branch } = request.params as { branch: string }
+    const query = request.query as GraphQuery & { metric?: string; top?: string }
+    const metric = (query.metric ?? 'indegree') as RankMetric
+    if (!['indegree', 'pagerank', 'betweenness'].includes(metric)) {
+      return reply.code(400).send({ error: 'metric must be indegree, pagerank or betweenness' })
+    }
+    const { top } = query
+    if (
+      top !== undefined &&
+      (!/^\d+$/.test(top) || Number(top) < 1 || Number(top) > MAX_RANK_TOP)
+    ) {
+      return reply.code(400).send({ error: `top must be an integer between 1 and ${MAX_RANK_TOP}` })
+    }
+
+    try {
+      const json = await DependencyBuilderWorkerPool.getPool().rankNodes(
+        branch,
+        metric,
+        top !== undefined ? Number(top) : undefined,
+        parseGraphFilter(query),
+      )
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      reply.code(500).send({
+        error: 'Failed to rank nodes',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
+
+  // GET /dependencies/delta/:branch?since=<generation> - Changes to the '*' graph since a generation.
+  // Without since (or when the log can't cover it) the answer is {reload: true, generation}:
+  // fetch the full graph, then poll with that generation.
+  fastify.get('/dependencies/delta/:branch', async (request, reply) => {
+    const { branch } = request.params as { branch: string }
+    const { since } = request.query as { since?: string }
+    if (since !== undefined && !/^\d+$/.test(since)) {
+      return reply.code(400).send({ error: 'since must be a generation returned by an earlier call' })
+    }
+
+    try {
+      const json = await DependencyBuilderWorkerPool.getPool().getProjectGraphDelta(
+        branch,
+        since !== undefined ? Number(since) : undefined,
+      )
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      reply.code(500).send({
+        error: 'Failed to get project graph delta',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
+
+  // GET /dependencies/match/:branch?pattern=(App)-[NamedImport*1..3]->(Lib)&limit=100 - Path-pattern query
+  fastify.get('/dependencies/match/:branch', async (request, reply) => {
+    const { branch } = request.params as { branch: string }
+    const query = request.query as { pattern?: string; limit?: string }
+    if (!query.pattern) {
+      return reply.code(400).send({ error: 'pattern is required' })
+    }
+
+    try {
+      const json = await DependencyBuilderWorkerPool.getPool().matchPattern(
+        branch,
+        query.pattern,
+        query.limit ? Number(query.limit) : undefined,
+      )
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      // Syntax errors in the pattern are the caller's
+      reply.code(isInvalidInputError(err) ? 400 : 500).send({
+        error: 'Failed to match pattern',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
+
+  // GET /dependencies/unused-exports/:branch - Exports no node imports, grouped by project
+  fastify.get('/dependencies/unused-exports/:branch', async (request, reply) => {
+    const { branch } = request.params as { branch: string }
+
+    try {
+      const json = await DependencyBuilderWorkerPool.getPool().findUnusedExports(branch)
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      reply.code(500).send({
+        error: 'Failed to find unused exports',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
+
+  // GET /dependencies/unresolved-imports/:branch - Imports that resolve to no node, grouped by project
+  fastify.get('/dependencies/unresolved-imports/:branch', async (request, reply) => {
+    const { branch } = request.params as { branch: string }
+
+    try {
+      const json = await DependencyBuilderWorkerPool.getPool().findUnresolvedImports(branch)
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      reply.code(500).send({
+        error: 'Failed to find unresolved imports',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
+
+  // POST /dependencies/projects/:projectId/:branch/impact - Nodes affected by a diff
+  fastify.post('/dependencies/projects/:projectId/:branch/impact', async (request, reply) => {
+    const { projectId, branch } = request.params as { projectId: string; branch: string }
+    const { changes, depth } = (request.body ?? {}) as { changes?: ChangedRange[]; depth?: number }
+
+    if (
+      !Array.isArray(changes) ||
+      changes.some((c) => !c || typeof c.relativePath !== 'string' || c.relativePath === '')
+    ) {
+      return reply
+        .code(400)
+        .send({ error: 'changes must be an array of { relativePath, startLine?, endLine? }' })
+    }
+
+    try {
+      const json = await DependencyBuilderWorkerPool.getPool().getImpactOfChanges(
+        projectId,
+        branch,
+        changes,
+        depth,
+      )
+      reply.header('Content-Type', 'application/json').send(json)
+    } catch (err) {
+      error(err)
+      reply.code(500).send({
+        error: 'Failed to compute impact of changes',
+        details: err instanceof Error ? err.message : 'Unknown error',
+      })
+    }
+  })
 }
 
 export default dependenciesRoutes
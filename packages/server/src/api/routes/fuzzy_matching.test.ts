@@ -146,4 +146,101 @@ describe('Fuzzy Matching API', () => {
     const body = JSON.parse(response.body)
     expect(body.data).toHaveLength(0)
   })
+
+  it('should keep substring semantics for indexed name lookups', async () => {
+    const response = await app.inject({
+      method: 'GET',
+      url: '/nodes',
+      query: {
+        name: 'nodeserv',
+        fuzzy: 'true',
+      },
+    })
+
+    expect(response.statusCode).toBe(200)
+    const body = JSON.parse(response.body)
+    expect(body.data).toHaveLength(1)
+    expect(body.data[0].name).toBe('FuzzyNodeService')
+  })
+
+  it('should match projectName and relativePath through the index when fuzzy', async () => {
+    const response = await app.inject({
+      method: 'GET',
+      url: '/nodes',
+      query: {
+        projectName: 'zzyproj',
+        relativePath: 'service',
+        fuzzy: 'true',
+      },
+    })
+
+    expect(response.statusCode).toBe(200)
+    const body = JSON.parse(response.body)
+    expect(body.data.map((node: { name: string }) => node.name)).toEqual(['FuzzyNodeService'])
+
+    const exact = await app.inject({
+      method: 'GET',
+      url: '/nodes',
+      query: { relativePath: 'service', fuzzy: 'false' },
+    })
+    expect(JSON.parse(exact.body).data).toHaveLength(0)
+  })
+
+  it('should rank substring matches before typo-tolerant ones in /nodes/search', async () => {
+    const response = await app.inject({
+      method: 'GET',
+      url: '/nodes/search',
+      query: {
+        q: 'FuzyNodeService',
+        field: 'name',
+      },
+    })
+
+    expect(response.statusCode).toBe(200)
+    const body = JSON.parse(response.body)
+    expect(body.data).toHaveLength(1)
+    expect(body.data[0]).toMatchObject({ name: 'FuzzyNodeService', contains: false })
+
+    const exact = await app.inject({
+      method: 'GET',
+      url: '/nodes/search',
+      query: { q: 'node', field: 'name' },
+    })
+    const exactBody = JSON.parse(exact.body)
+    expect(exactBody.data.map((hit: { name: string }) => hit.name)).toEqual([
+      'ExactNode',
+      'FuzzyNodeService',
+    ])
+    expect(exactBody.data.every((hit: { contains: boolean }) => hit.contains)).toBe(true)
+  })
+
+  it('should cap /nodes/search at limit', async () => {
+    const response = await app.inject({
+      method: 'GET',
+      url: '/nodes/search',
+      query: { q: 'node', field: 'name', limit: '1' },
+    })
+
+    expect(response.statusCode).toBe(200)
+    expect(JSON.parse(response.body).data).toHaveLength(1)
+
+    for (const limit of ['0', '-3', 'many']) {
+      const invalid = await app.inject({
+        method: 'GET',
+        url: '/nodes/search',
+        query: { q: 'node', limit },
+      })
+      expect(invalid.statusCode).toBe(400)
+    }
+  })
+
+  it('should reject unknown search fields', async () => {
+    const response = await app.inject({
+      method: 'GET',
+      url: '/nodes/search',
+      query: { q: 'Fuzzy', field: 'meta' },
+    })
+
+    expect(response.statusCode).toBe(400)
+  })
 })
@@ -3,6 +3,7 @@ import buildServer from '../../server'
 import { prisma } from '../../database/prisma'
 import { FastifyInstance } from 'fastify'
 import { getAuthHeaders } from '../../../test/auth-helper'
+import * as repository from '../../database/repository'
 
 describe('Nodes API', () => {
   let server: FastifyInstance
@@ -299,6 +300,58 @@ describe('Nodes API', () => {
     expect(result.data).toHaveLength(2)
   })
 
+  it('should estimate transitive impact from sketches', async () => {
+    const project = await prisma.project.create({
+      data: { name: 'impact-project', addr: 'https://github.com/test/impact', type: 'App' },
+    })
+    const other = await prisma.project.create({
+      data: { name: 'impact-other', addr: 'https://github.com/test/impact-other', type: 'App' },
+    })
+    const makeNode = (name: string, projectId: string, projectName: string) =>
+      prisma.node.create({
+        data: {
+          projectId,
+          projectName,
+          branch: 'main',
+          type: 'NamedExport',
+          name,
+          relativePath: `src/${name}.ts`,
+          startLine: 1,
+          startColumn: 1,
+          endLine: 1,
+          endColumn: 1,
+          version: '1.0.0',
+          meta: {},
+        },
+      })
+    const target = await makeNode('target', project.id, project.name)
+    const direct = await makeNode('direct', other.id, other.name)
+    const indirect = await makeNode('indirect', other.id, other.name)
+    // indirect -> direct -> target
+    await prisma.connection.create({ data: { fromKey: direct.key, toKey: target.key } })
+    await prisma.connection.create({ data: { fromKey: indirect.key, toKey: direct.key } })
+
+    const { count } = await repository.rebuildImpactSketches('main')
+    expect(count).toBe(3)
+
+    const res = await server.inject({ method: 'GET', url: `/nodes/${target.id}/impact` })
+    expect(res.statusCode).toBe(200)
+    expect(res.json()).toMatchObject({ dependents: 2, projects: 1 })
+
+    const leaf = await server.inject({ method: 'GET', url: `/nodes/${indirect.id}/impact` })
+    expect(leaf.json()).toMatchObject({ dependents: 0, projects: 0 })
+
+    const merged = await server.inject({
+      method: 'POST',
+      url: '/nodes/impact',
+      payload: { ids: [target.id, direct.id] },
+    })
+    expect(merged.json().data).toMatchObject({ dependents: 2, nodes: 2 })
+
+    const missing = await server.inject({ method: 'GET', url: '/nodes/unknown/impact' })
+    expect(missing.statusCode).toBe(404)
+  })
+
   it('should batch create nodes and commit', async () => {
     const { headers } = await getAuthHeaders(server)
 
@@ -355,6 +408,7 @@ describe('Nodes API', () => {
       },
     })
     expect(commitRes.statusCode).toBe(201)
+    expect(commitRes.json().projectIds).toHaveLength(1)
 
     // Verify nodes moved to target branch
     const mainNodes = await prisma.node.findMany({
@@ -364,6 +418,110 @@ describe('Nodes API', () => {
     expect(mainNodes[0].name).toBe('node1')
   })
 
+  it('should replace target branch nodes on commit', async () => {
+    const { headers } = await getAuthHeaders(server)
+
+    const project = await prisma.project.create({
+      data: {
+        name: 'test-project-10',
+        addr: 'https://github.com/test/project-10',
+        type: 'App',
+      },
+    })
+    const base = {
+      projectName: 'test-project-10',
+      relativePath: 'src/index.ts',
+      startLine: 1,
+      startColumn: 1,
+      endLine: 10,
+      endColumn: 1,
+      qlsVersion: '1.0.0',
+      meta: {},
+    }
+    await prisma.node.create({
+      data: { ...base, projectId: project.id, branch: 'main', version: '1.0.0', type: 'NamedExport', name: 'old' },
+    })
+
+    await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-create',
+      headers,
+      payload: {
+        shallowBranch: 'shallow-branch-5',
+        data: [{ ...base, branch: 'main', version: '2.0.0', type: 'NamedExport', name: 'new' }],
+      },
+    })
+
+    const commitRes = await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-create/commit',
+      headers,
+      payload: {
+        shallowBranch: 'shallow-branch-5',
+        targetBranch: 'main',
+        projectNames: ['test-project-10'],
+      },
+    })
+    expect(commitRes.statusCode).toBe(201)
+    expect(commitRes.json().projectIds).toEqual([project.id])
+
+    const mainNodes = await prisma.node.findMany({
+      where: { branch: 'main', projectName: 'test-project-10' },
+    })
+    expect(mainNodes.map((node) => node.name)).toEqual(['new'])
+    expect(await prisma.node.count({ where: { branch: 'shallow-branch-5' } })).toBe(0)
+  })
+
+  it('should restore the Node indexes after a commit that rebuilds them', async () => {
+    const { headers } = await getAuthHeaders(server)
+    const indexes = () =>
+      prisma.$queryRawUnsafe<Array<{ name: string; sql: string }>>(
+        `SELECT name, sql FROM sqlite_master WHERE type = 'index' AND tbl_name = 'Node' ORDER BY name`,
+      )
+    const before = await indexes()
+
+    await prisma.project.create({
+      data: { name: 'test-project-11', addr: 'https://github.com/test/project-11', type: 'App' },
+    })
+    // The only nodes in the table, so the commit takes the rebuild path
+    await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-create',
+      headers,
+      payload: {
+        shallowBranch: 'shallow-branch-6',
+        data: ['a', 'b', 'c'].map((name, i) => ({
+          projectName: 'test-project-11',
+          branch: 'main',
+          type: 'NamedExport',
+          name,
+          relativePath: 'src/index.ts',
+          startLine: i + 1,
+          startColumn: 1,
+          endLine: i + 1,
+          endColumn: 10,
+          version: '1.0.0',
+          qlsVersion: '1.0.0',
+          meta: {},
+        })),
+      },
+    })
+
+    const commitRes = await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-create/commit',
+      headers,
+      payload: {
+        shallowBranch: 'shallow-branch-6',
+        targetBranch: 'main',
+        projectNames: ['test-project-11'],
+      },
+    })
+    expect(commitRes.statusCode).toBe(201)
+    expect(await prisma.node.count({ where: { branch: 'main', projectName: 'test-project-11' } })).toBe(3)
+    expect(await indexes()).toEqual(before)
+  })
+
   it('should rollback batch', async () => {
     const { headers } = await getAuthHeaders(server)
 
@@ -418,4 +576,208 @@ describe('Nodes API', () => {
     })
     expect(nodes).toHaveLength(0)
   })
+
+  it('should ingest NDJSON nodes and derive join columns', async () => {
+    const { headers } = await getAuthHeaders(server)
+
+    await prisma.project.create({
+      data: {
+        name: 'test-project-9',
+        addr: 'https://github.com/test/project-9',
+        type: 'App',
+      },
+    })
+
+    const base = {
+      projectName: 'test-project-9',
+      branch: 'main',
+      relativePath: 'src/index.ts',
+      startLine: 1,
+      startColumn: 1,
+      endLine: 10,
+      endColumn: 1,
+      version: '1.0.0',
+      qlsVersion: '1.0.0',
+    }
+    const payload = [
+      { ...base, type: 'NamedExport', name: 'foo', meta: { entryName: './utils' } },
+      { ...base, type: 'NamedImport', name: 'lib.bar', meta: {} },
+      { ...base, type: 'RuntimeDynamicImport', name: 'app.sub.baz', meta: {} },
+    ]
+      .map((node) => JSON.stringify(node))
+      .join('\n')
+
+    const res = await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-ingest?shallowBranch=shallow-branch-3',
+      headers: { ...headers, 'content-type': 'application/x-ndjson' },
+      payload,
+    })
+    expect(res.statusCode).toBe(201)
+
+    const nodes = await prisma.node.findMany({
+      where: { branch: 'shallow-branch-3' },
+      orderBy: { name: 'asc' },
+    })
+    expect(nodes).toHaveLength(3)
+    expect(nodes.every((node) => node.projectId && node.id)).toBe(true)
+    expect(nodes[0]).toMatchObject({
+      name: 'app.sub.baz',
+      import_pkg: 'app',
+      import_subpkg: 'sub',
+      import_name: 'baz',
+    })
+    expect(nodes[1]).toMatchObject({ name: 'foo', export_entry: './utils', meta: { entryName: './utils' } })
+    expect(nodes[2]).toMatchObject({ name: 'lib.bar', import_pkg: 'lib', import_name: 'bar' })
+
+    // Invalid batches insert nothing
+    const badRes = await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-ingest?shallowBranch=shallow-branch-4',
+      headers: { ...headers, 'content-type': 'application/x-ndjson' },
+      payload: `${JSON.stringify({ ...base, type: 'EventOn', name: 'e' })}\n${JSON.stringify({ ...base, type: 'Unknown', name: 'x' })}`,
+    })
+    expect(badRes.statusCode).toBe(400)
+    expect(await prisma.node.count({ where: { branch: 'shallow-branch-4' } })).toBe(0)
+  })
+
+  it('should reject malformed ingest payloads as bad requests', async () => {
+    const { headers } = await getAuthHeaders(server)
+
+    await prisma.project.create({
+      data: {
+        name: 'test-project-11',
+        addr: 'https://github.com/test/project-11',
+        type: 'App',
+      },
+    })
+
+    const base = {
+      projectName: 'test-project-11',
+      branch: 'main',
+      type: 'NamedExport',
+      relativePath: 'src/index.ts',
+      startLine: 1,
+      startColumn: 1,
+      endLine: 10,
+      endColumn: 1,
+      version: '1.0.0',
+      qlsVersion: '1.0.0',
+      meta: {},
+    }
+    const ingest = (payload: string) =>
+      server.inject({
+        method: 'POST',
+        url: '/nodes/batch-ingest?shallowBranch=shallow-branch-5',
+        headers: { ...headers, 'content-type': 'application/x-ndjson' },
+        payload,
+      })
+
+    const mixedBranches = await ingest(
+      [{ ...base, name: 'a' }, { ...base, name: 'b', branch: 'other' }]
+        .map((node) => JSON.stringify(node))
+        .join('\n'),
+    )
+    expect(mixedBranches.statusCode).toBe(400)
+    expect(mixedBranches.json().details).toContain('Expected only 1 branch')
+
+    const malformed = await ingest(`${JSON.stringify({ ...base, name: 'a' })}\n{"projectName": `)
+    expect(malformed.statusCode).toBe(400)
+
+    const unknownProject = await ingest(JSON.stringify({ ...base, projectName: 'missing' }))
+    expect(unknownProject.statusCode).toBe(400)
+
+    expect(await prisma.node.count({ where: { branch: 'shallow-branch-5' } })).toBe(0)
+  })
+
+  it('should take the project of ingested nodes from projectName', async () => {
+    const { headers } = await getAuthHeaders(server)
+
+    const project = await prisma.project.create({
+      data: {
+        name: 'test-project-12',
+        addr: 'https://github.com/test/project-12',
+        type: 'App',
+      },
+    })
+    const other = await prisma.project.create({
+      data: {
+        name: 'test-project-13',
+        addr: 'https://github.com/test/project-13',
+        type: 'App',
+      },
+    })
+
+    const res = await server.inject({
+      method: 'POST',
+      url: '/nodes/batch-ingest?shallowBranch=shallow-branch-6',
+      headers: { ...headers, 'content-type': 'application/x-ndjson' },
+      payload: JSON.stringify({
+        projectName: 'test-project-12',
+        projectId: other.id,
+        branch: 'main',
+        type: 'NamedExport',
+        name: 'foo',
+        relativePath: 'src/index.ts',
+        startLine: 1,
+        startColumn: 1,
+        endLine: 10,
+        endColumn: 1,
+        version: '1.0.0',
+        qlsVersion: '1.0.0',
+        meta: {},
+      }),
+    })
+    expect(res.statusCode).toBe(201)
+
+    const nodes = await prisma.node.findMany({ where: { branch: 'shallow-branch-6' } })
+    expect(nodes).toHaveLength(1)
+    expect(nodes[0].projectId).toBe(project.id)
+  })
+
+  it('should store every ingested node on the shallow branch', async () => {
+    const { headers } = await getAuthHeaders(server)
+
+    await prisma.project.create({
+      data: {
+        name: 'test-project-10',
+        addr: 'https://github.com/test/project-10',
+        type: 'App',
+      },
+    })
+
+    // Longer than any small-string buffer, so the bound branch lives on the heap
+    const shallowBranch = 'feature/shallow-ingest-' + 'x'.repeat(64)
+    const payload = Array.from({ length: 200 }, (_, i) =>
+      JSON.stringify({
+        projectName: 'test-project-10',
+        branch: 'main',
+        type: 'NamedExport',
+        name: `export${i}`,
+        relativePath: `src/file${i}.ts`,
+        startLine: 1,
+        startColumn: 1,
+        endLine: 10,
+        endColumn: 1,
+        version: '1.0.0',
+        qlsVersion: '1.0.0',
+        meta: {},
+      }),
+    ).join('\n')
+
+    const res = await server.inject({
+      method: 'POST',
+      url: `/nodes/batch-ingest?shallowBranch=${encodeURIComponent(shallowBranch)}`,
+      headers: { ...headers, 'content-type': 'application/x-ndjson' },
+      payload,
+    })
+    expect(res.statusCode).toBe(201)
+
+    const branches = await prisma.node.groupBy({
+      by: ['branch'],
+      where: { name: { startsWith: 'export' } },
+      _count: true,
+    })
+    expect(branches).toEqual([{ branch: shallowBranch, _count: 200 }])
+  })
 })
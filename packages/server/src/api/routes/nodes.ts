@@ -1,10 +1,17 @@
 import { FastifyInstance } from 'fastify'
 import { onlyQuery, queryContains } from '../../utils'
 import * as repository from '../../database/repository'
-import type { NodeQuery, NodeCreationBody, NodeBatchCreationBody } from '../types'
+import type {
+  NodeQuery,
+  NodeSearchQuery,
+  NodeCreationBody,
+  NodeBatchCreationBody,
+} from '../types'
 import { formatStringToNumber } from '../request_parameter'
 import { authenticate } from '../../auth/middleware'
+import { cache, projectGraphCacheKey, projectGraphEtagKey } from '../../cache/instance'
 import { Prisma } from '../../generated/prisma/client'
+import { isInvalidInputError } from '../../database/prisma'
 
 function nodesRoutes(fastify: FastifyInstance) {
   // GET /nodes - Get nodes with query parameters
@@ -13,16 +20,31 @@ function nodesRoutes(fastify: FastifyInstance) {
       const { take, skip, fuzzy, ...filters } = formatStringToNumber(request.query as NodeQuery)
       const isFuzzy = fuzzy === 'true' || fuzzy === true
 
+      // Indexed fields are matched through the trigram index when it can narrow
+      // the result down to an id list; everything else stays a LIKE scan
+      let ids: string[] | null = null
       if (isFuzzy) {
-        queryContains(filters, ['name', 'branch', 'projectName'])
+        for (const field of ['name', 'projectName', 'relativePath'] as const) {
+          const value = filters[field]
+          const fieldIds = value ? await repository.findNodeIdsContaining(value, field) : null
+          if (!fieldIds) continue
+          delete filters[field]
+          const matched = new Set(fieldIds)
+          ids = ids ? ids.filter((id) => matched.has(id)) : fieldIds
+        }
+        queryContains(filters, ['name', 'branch', 'projectName', 'relativePath'])
       }
 
       const where: Prisma.NodeFindManyArgs['where'] = onlyQuery(filters, [
         'branch',
         'name',
         'projectName',
+        'relativePath',
         'type',
       ])
+      if (ids) {
+        where.id = { in: ids }
+      }
 
       // Handle standalone filter - nodes that don't have any connections
       const { standalone } = filters
@@ -61,6 +83,42 @@ function nodesRoutes(fastify: FastifyInstance) {
     }
   })
 
+  // GET /nodes/search - Ranked, typo-tolerant search over name, projectName and relativePath
+  fastify.get('/nodes/search', async (request, reply) => {
+    try {
+      const { q, field, branch, limit } = request.query as NodeSearchQuery
+
+      if (!q) {
+        reply.code(400).send({ error: 'Missing query parameter q' })
+        return
+      }
+
+      if (field && !['name', 'projectName', 'relativePath', '*'].includes(field)) {
+        reply
+          .code(400)
+          .send({ error: "field must be one of 'name', 'projectName', 'relativePath', '*'" })
+        return
+      }
+
+      if (limit !== undefined && !(Number.isInteger(Number(limit)) && Number(limit) > 0)) {
+        reply.code(400).send({ error: 'limit must be a positive integer' })
+        return
+      }
+
+      const data = await repository.searchNodes(String(q), {
+        limit: limit === undefined ? undefined : Number(limit),
+        field,
+        branch,
+      })
+      return { data }
+    } catch (error) {
+      reply.code(500).send({
+        error: 'Failed to search nodes',
+        details: error instanceof Error ? error.message : 'Unknown error',
+      })
+    }
+  })
+
   // POST /nodes/batch - Get multiple nodes by IDs
   fastify.post('/nodes/batch', async (request, reply) => {
     try {
@@ -81,6 +139,46 @@ function nodesRoutes(fastify: FastifyInstance) {
     }
   })
 
+  // POST /nodes/impact - Merged blast radius estimate for several nodes
+  fastify.post('/nodes/impact', async (request, reply) => {
+    try {
+      const { ids } = (request.body ?? {}) as { ids?: string[] }
+
+      if (!ids || !Array.isArray(ids)) {
+        reply.code(400).send({ error: 'Invalid request body. Expected { ids: string[] }' })
+        return
+      }
+
+      const estimate = await repository.getImpactEstimate(ids)
+      return { data: estimate }
+    } catch (error) {
+      reply.code(500).send({
+        error: 'Failed to estimate impact',
+        details: error instanceof Error ? error.message : 'Unknown error',
+      })
+    }
+  })
+
+  // GET /nodes/:id/impact - Approximate transitive dependents of a node
+  fastify.get('/nodes/:id/impact', async (request, reply) => {
+    try {
+      const { id } = request.params as { id: string }
+      const estimate = await repository.getImpactEstimate([id])
+
+      if (!estimate) {
+        reply.code(404).send({ error: 'No impact estimate for node' })
+        return
+      }
+
+      return estimate
+    } catch (error) {
+      reply.code(500).send({
+        error: 'Failed to estimate impact',
+        details: error instanceof Error ? error.message : 'Unknown error',
+      })
+    }
+  })
+
   // GET /nodes/:id - Get node by ID
   fastify.get('/nodes/:id', async (request, reply) => {
     try {
@@ -232,6 +330,40 @@ function nodesRoutes(fastify: FastifyInstance) {
     },
   )
 
+  // POST /nodes/batch-ingest?shallowBranch=... - NDJSON body, one node per line
+  fastify.post(
+    '/nodes/batch-ingest',
+    {
+      preHandler: [authenticate],
+    },
+    async (request, reply) => {
+      try {
+        const { shallowBranch } = request.query as { shallowBranch?: string }
+        const payload = request.body
+
+        if (!shallowBranch || typeof payload !== 'string') {
+          reply.code(400).send({
+            error:
+              'Invalid request. Expected ?shallowBranch=<branch> and an application/x-ndjson body',
+          })
+          return
+        }
+
+        const createdNodes = await repository.ingestNodes(payload, shallowBranch)
+
+        reply.code(201).send({
+          message: `Successfully created ${createdNodes.count} shallow nodes`,
+        })
+      } catch (error) {
+        // Malformed rows and mixed branches or versions are the uploader's
+        reply.code(isInvalidInputError(error) ? 400 : 500).send({
+          error: 'Failed to create nodes in batch',
+          details: error instanceof Error ? error.message : 'Unknown error',
+        })
+      }
+    },
+  )
+
   fastify.post(
     '/nodes/batch-create/commit',
     {
@@ -259,8 +391,13 @@ function nodesRoutes(fastify: FastifyInstance) {
           req.projectNames,
         )
 
+        // Only the target branch's project graph can have changed
+        await cache.delete(projectGraphCacheKey(req.targetBranch))
+        await cache.delete(projectGraphEtagKey(req.targetBranch))
+
         reply.code(201).send({
           message: `Successfully created ${createdNodes.committedNodes} nodes`,
+          projectIds: createdNodes.projectIds,
         })
       } catch (error) {
         reply.code(500).send({
@@ -5,12 +5,20 @@ export interface NodeQuery {
   branch?: string
   type?: NodeType
   name?: string
+  relativePath?: string
   standalone?: boolean | string
   limit?: number
   offset?: number
   fuzzy?: boolean | string
 }
 
+export interface NodeSearchQuery {
+  q?: string
+  field?: 'name' | 'projectName' | 'relativePath' | '*'
+  branch?: string
+  limit?: number
+}
+
 export interface NodeCreationBody {
   projectId?: string
   projectName: string
@@ -31,7 +31,7 @@ export class Cache implements ICache {
     return this.storage.get(key)
   }
 
-  async set(key: string, value: string): Promise<void> {
+  async set(key: string, value: string | Buffer): Promise<void> {
     await this.storage.set(key, value)
   }
 
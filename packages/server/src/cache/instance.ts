@@ -2,3 +2,9 @@ import { Cache } from '.'
 
 // Singleton cache instance to be shared across the application
 export const cache = new Cache()
+
+// The '*' project graph of a branch, stored gzip-compressed as the addon produced it
+export const projectGraphCacheKey = (branch: string) => `projects/graphs/${branch}.json.gz`
+
+// Content hash of that graph, served as its ETag while the file is cached
+export const projectGraphEtagKey = (branch: string) => `projects/graphs/${branch}.etag`
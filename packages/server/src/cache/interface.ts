@@ -2,7 +2,7 @@ import { Readable } from 'node:stream'
 
 export interface IStorage {
   get(key: string): Promise<string | null>
-  set(key: string, value: string): Promise<void>
+  set(key: string, value: string | Buffer): Promise<void>
   delete(key: string): Promise<void>
   clear(prefix: string): Promise<void>
   has(key: string): Promise<boolean>
@@ -11,7 +11,7 @@ export interface IStorage {
 
 export interface ICache {
   get(key: string): Promise<string | null>
-  set(key: string, value: string): Promise<void>
+  set(key: string, value: string | Buffer): Promise<void>
   delete(key: string): Promise<void>
   clear(prefix: string): Promise<void>
   has(key: string): Promise<boolean>
@@ -38,10 +38,13 @@ export class FileStorage implements IStorage {
     }
   }
 
-  async set(key: string, value: string): Promise<void> {
+  async set(key: string, value: string | Buffer): Promise<void> {
     const filePath = this.getFilePath(key)
     await this.ensureDir(filePath)
-    await fs.writeFile(filePath, value, 'utf-8')
+    // Write then rename, so a concurrent reader never streams a partial (compressed) file
+    const tempPath = `${filePath}.${process.pid}.${Date.now()}.tmp`
+    await fs.writeFile(tempPath, value, 'utf-8')
+    await fs.rename(tempPath, filePath)
   }
 
   async delete(key: string): Promise<void> {
@@ -79,6 +82,7 @@ export class FileStorage implements IStorage {
 
   createReadStream(key: string) {
     const filePath = this.getFilePath(key)
-    return fss.createReadStream(filePath, { encoding: 'utf-8' })
+    // Raw bytes: entries may be compressed
+    return fss.createReadStream(filePath)
   }
 }
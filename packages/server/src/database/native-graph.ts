@@ -0,0 +1,144 @@
+import { createRequire } from 'node:module'
+import path from 'node:path'
+import { PassThrough, type Readable } from 'node:stream'
+import { prisma, NATIVE_EXTENSION_PATH } from './prisma'
+import { error } from '../logging'
+import type { GraphOptions, GraphResult } from '../workers/dependency-builder-worker'
+
+type NativeGraph = ArrayBuffer & { contentHash: string }
+
+/**
+ * Direct graph API exported by sqlite_hook.node. Queries run on the libuv
+ * threadpool against read-only connections owned by the addon and resolve to
+ * an ArrayBuffer wrapping the native JSON string, so neither Prisma nor a
+ * worker hop copies the result. With encoding 'gzip' the buffer holds the
+ * graph compressed while it was serialized. contentHash is the XXH64 of the
+ * plain JSON either way, as 16 hex digits. streamNodeGraph hands out the node
+ * graph as NDJSON lines, one BFS level (or slice of one) at a time, while the
+ * deeper levels are still being walked; onLine returning false stops the walk,
+ * and returning a promise pauses it until the promise settles.
+ */
+interface GraphBinding {
+  getNodeGraph(
+    dbPath: string,
+    nodeId: string,
+    depth?: number,
+    filterJson?: string | null,
+    layout?: boolean,
+    encoding?: 'gzip' | null,
+  ): Promise<NativeGraph>
+  getProjectGraph(
+    dbPath: string,
+    projectId: string,
+    branch: string,
+    depth?: number,
+    filterJson?: string | null,
+    layout?: boolean,
+    encoding?: 'gzip' | null,
+  ): Promise<NativeGraph>
+  streamNodeGraph(
+    dbPath: string,
+    nodeId: string,
+    depth: number | undefined,
+    filterJson: string | null,
+    onLine: (line: ArrayBuffer) => boolean | void | Promise<boolean>,
+  ): Promise<void>
+}
+
+let binding: Promise<GraphBinding | null> | null = null
+
+// DATABASE_URL is `file:<path>`, relative paths resolve against the working directory
+const databasePath = () =>
+  path.resolve(process.cwd(), (process.env.DATABASE_URL ?? '').replace(/^file:/, ''))
+
+/**
+ * Loads the addon once. The graph API calls SQLite through the routines
+ * better-sqlite3 hands the extension, so Prisma must have connected (and
+ * loaded the extension) first. Resolves to null when the addon can't be used;
+ * callers then fall back to the worker pool.
+ */
+export const getGraphBinding = (): Promise<GraphBinding | null> => {
+  binding ??= (async () => {
+    try {
+      await prisma.$connect()
+      const require = createRequire(import.meta.url)
+      return require(NATIVE_EXTENSION_PATH) as GraphBinding
+    } catch (e) {
+      error('Native graph binding unavailable, using worker pool: ' + e)
+      return null
+    }
+  })()
+  return binding
+}
+
+const serializeFilter = (opts?: GraphOptions) => (opts?.filter ? JSON.stringify(opts.filter) : null)
+
+// Query strings arrive as strings; the addon wants a number
+const depthOf = (opts?: GraphOptions) => Number(opts?.depth ?? 100)
+
+export const getNativeNodeGraph = async (
+  native: GraphBinding,
+  nodeId: string,
+  opts?: GraphOptions,
+): Promise<GraphResult<Buffer>> => {
+  const result = await native.getNodeGraph(
+    databasePath(),
+    nodeId,
+    depthOf(opts),
+    serializeFilter(opts),
+    opts?.layout ?? false,
+    opts?.encoding ?? null,
+  )
+  return { body: Buffer.from(result), contentHash: result.contentHash }
+}
+
+export const getNativeProjectGraph = async (
+  native: GraphBinding,
+  projectId: string,
+  branch: string,
+  opts?: GraphOptions,
+): Promise<GraphResult<Buffer>> => {
+  const result = await native.getProjectGraph(
+    databasePath(),
+    projectId,
+    branch,
+    depthOf(opts),
+    serializeFilter(opts),
+    opts?.layout ?? false,
+    opts?.encoding ?? null,
+  )
+  return { body: Buffer.from(result), contentHash: result.contentHash }
+}
+
+/**
+ * The node graph as an NDJSON stream. Resolves with the first line, so a
+ * filter that doesn't parse still rejects before anything has been sent.
+ * While the stream's buffer is full the walk waits for it to drain.
+ */
+export const streamNativeNodeGraph = (
+  native: GraphBinding,
+  nodeId: string,
+  opts?: GraphOptions,
+): Promise<Readable> =>
+  new Promise((resolve, reject) => {
+    const stream = new PassThrough()
+    let started = false
+    native
+      .streamNodeGraph(databasePath(), nodeId, depthOf(opts), serializeFilter(opts), (line) => {
+        started = true
+        resolve(stream)
+        if (stream.destroyed) return false
+        if (stream.write(Buffer.from(line))) return true
+        return new Promise<boolean>((resume) => {
+          const settle = () => {
+            stream.off('drain', settle).off('close', settle)
+            resume(!stream.destroyed)
+          }
+          stream.on('drain', settle).on('close', settle)
+        })
+      })
+      .then(
+        () => resolve(stream.end()),
+        (e) => (started ? stream.destroy(e) : reject(e)),
+      )
+  })
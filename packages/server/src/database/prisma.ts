@@ -12,6 +12,34 @@ const globalForPrisma = globalThis as unknown as {
   }
 }
 
+// Loaded into every connection as an SQLite extension; the same file is also an N-API addon
+export const NATIVE_EXTENSION_PATH = path.resolve(process.cwd(), 'build/Release/sqlite_hook.node')
+
+// Result code the native SQL functions fail with when their arguments (a malformed
+// payload or pattern) are at fault rather than the database; see src/native/input-error.h
+const INVALID_INPUT_CODE = 'SQLITE_FORMAT'
+
+// Thrown by the worker pools in place of a failure the native side reported as invalid input
+export class InvalidInputError extends Error {
+  constructor(message: string) {
+    super(message)
+    this.name = 'InvalidInputError'
+  }
+}
+
+// True for failures a route should answer with 400. better-sqlite3 reports the result
+// code as SqliteError.code, which Prisma keeps on the driver adapter error behind the
+// one it throws for a raw query.
+export const isInvalidInputError = (err: unknown): boolean => {
+  let e: any = err
+  for (let depth = 0; e && typeof e === 'object' && depth < 4; depth++) {
+    if (e instanceof InvalidInputError) return true
+    if (e.code === INVALID_INPUT_CODE || e.originalCode === INVALID_INPUT_CODE) return true
+    e = e.cause ?? e.meta?.driverAdapterError
+  }
+  return false
+}
+
 // Initialize the Factory
 const factory = new PrismaBetterSqlite3({ url: process.env.DATABASE_URL! })
 
@@ -24,9 +52,8 @@ const proxyAdapter = {
 
     // Load the native extension
     try {
-      const extensionPath = path.resolve(process.cwd(), 'build/Release/sqlite_hook.node')
       const db = (adapter as any).client
-      db.loadExtension(extensionPath)
+      db.loadExtension(NATIVE_EXTENSION_PATH)
 
       // Setup the NAPI callback
 
@@ -51,6 +51,83 @@ export async function getNodesByIds(ids: string[]) {
   return nodes
 }
 
+export type NodeSearchField = 'name' | 'projectName' | 'relativePath' | '*'
+
+export interface NodeSearchHit {
+  id: string
+  name: string
+  type: string
+  projectName: string
+  branch: string
+  relativePath: string
+  field: Exclude<NodeSearchField, '*'>
+  score: number
+  contains: boolean
+}
+
+// Ranked search through the native trigram index (node_fuzzy_search).
+// Substring matches come first, then typo-tolerant ones.
+export async function searchNodes(
+  query: string,
+  options: { limit?: number; field?: NodeSearchField; branch?: string } = {},
+): Promise<NodeSearchHit[]> {
+  const { limit = 50, field = '*', branch = null } = options
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    'SELECT node_fuzzy_search(?, ?, ?, ?) as json',
+    query,
+    limit,
+    field,
+    branch,
+  )
+  return JSON.parse(result[0].json)
+}
+
+// Upper bound on ids handed back to Prisma as an IN list
+const FUZZY_ID_LIMIT = 1000
+
+// Ids of nodes whose field contains the query (case-insensitive), or null when
+// the caller should fall back to a LIKE scan: queries under 3 characters can't
+// use trigrams, and very broad queries are cheaper to scan than to list.
+export async function findNodeIdsContaining(
+  query: string,
+  field: Exclude<NodeSearchField, '*'>,
+): Promise<string[] | null> {
+  if (query.length < 3) {
+    return null
+  }
+
+  const hits = await searchNodes(query, { limit: FUZZY_ID_LIMIT + 1, field })
+  const ids = hits.filter((hit) => hit.contains).map((hit) => hit.id)
+  return ids.length > FUZZY_ID_LIMIT ? null : ids
+}
+
+export interface ImpactEstimate {
+  /** Approximate number of nodes that transitively depend on the node(s) */
+  dependents: number
+  /** Approximate number of distinct projects among those dependents */
+  projects: number
+  /** How many of the requested nodes had a sketch */
+  nodes: number
+}
+
+// Recomputes the persisted HyperLogLog impact sketches (all branches by default)
+export async function rebuildImpactSketches(branch?: string) {
+  const result = await prisma.$queryRawUnsafe<Array<{ count: number | bigint }>>(
+    'SELECT impact_sketch_build(?) as count',
+    branch ?? null,
+  )
+  return { count: Number(result[0].count) }
+}
+
+// Merged estimate over the given nodes; null when none of them has a sketch yet
+export async function getImpactEstimate(nodeIds: string[]): Promise<ImpactEstimate | null> {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string | null }>>(
+    'SELECT impact_estimate(?) as json',
+    JSON.stringify(nodeIds),
+  )
+  return result[0].json ? JSON.parse(result[0].json) : null
+}
+
 export async function createNode(
   node: Omit<Prisma.NodeUncheckedCreateInput, 'id' | 'createdAt' | 'updatedAt'>,
 ) {
@@ -109,39 +186,31 @@ export async function createBatchNodes(
   return createdNodes
 }
 
+// Parses and inserts an NDJSON (or JSON array) node payload inside the native
+// extension; join columns are derived there when the payload omits them
+export async function ingestNodes(payload: string, shallowBranch: string) {
+  const result = await prisma.$queryRawUnsafe<Array<{ count: number | bigint }>>(
+    'SELECT dms_ingest_nodes(?, ?) as count',
+    payload,
+    shallowBranch,
+  )
+  return { count: Number(result[0].count) }
+}
+
+// Promotes staged nodes natively (see src/native/branch-commit.cc). The touched
+// project ids let callers refresh connections and graph caches incrementally.
 export async function commitShallowNodes(
   shallowBranch: string,
   targetBranch: string,
   projectNames: string[],
-) {
-  return await prisma.$transaction(async (tx) => {
-    const count = await tx.node.count({
-      where: { branch: shallowBranch },
-    })
-
-    if (count === 0) {
-      throw new Error('No staged nodes found to commit.')
-    }
-
-    await tx.node.deleteMany({
-      where: {
-        branch: targetBranch,
-        projectName: { in: projectNames },
-      },
-    })
-
-    await tx.node.updateMany({
-      where: {
-        branch: shallowBranch,
-        projectName: { in: projectNames },
-      },
-      data: {
-        branch: targetBranch,
-      },
-    })
-
-    return { committedNodes: count }
-  })
+): Promise<{ committedNodes: number; deletedNodes: number; projectIds: string[] }> {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    'SELECT dms_commit_shallow(?, ?, ?) as json',
+    shallowBranch,
+    targetBranch,
+    JSON.stringify(projectNames),
+  )
+  return JSON.parse(result[0].json)
 }
 
 export async function rollbackBatch(shallowBranch: string) {
@@ -190,8 +259,13 @@ export async function getConnections(query: Prisma.ConnectionFindManyArgs) {
     prisma.connection.count({ where }),
   ])
 
+  // Connection rows hold node keys; the API keeps addressing nodes by id
   return {
-    data,
+    data: data.map((connection) => ({
+      fromId: connection.fromNode.id,
+      toId: connection.toNode.id,
+      ...connection,
+    })),
     total,
   }
 }
@@ -209,29 +283,27 @@ export async function createConnection(fromId: string, toId: string) {
 
   const connection = await prisma.connection.create({
     data: {
-      fromId,
-      toId,
+      fromKey: fromNode.key,
+      toKey: toNode.key,
     },
   })
 
   return {
-    fromId: connection.fromId,
-    toId: connection.toId,
+    fromId,
+    toId,
     createdAt: connection.createdAt,
   }
 }
 
 export async function deleteConnection(fromId: string, toId: string) {
   try {
-    await prisma.connection.delete({
+    const { count } = await prisma.connection.deleteMany({
       where: {
-        fromId_toId: {
-          fromId,
-          toId,
-        },
+        fromNode: { id: fromId },
+        toNode: { id: toId },
       },
     })
-    return true
+    return count > 0
   } catch {
     return false
   }
@@ -240,7 +312,7 @@ export async function deleteConnection(fromId: string, toId: string) {
 export async function deleteConnectionsByFrom(fromId: string) {
   try {
     await prisma.connection.deleteMany({
-      where: { fromId },
+      where: { fromNode: { id: fromId } },
     })
     return true
   } catch {
@@ -1,18 +1,28 @@
 import { describe, it, expect, beforeEach, afterEach } from 'vitest'
-import { prisma } from '../database/prisma'
+import { gunzipSync } from 'node:zlib'
+import { PrismaBetterSqlite3 } from '@prisma/adapter-better-sqlite3'
+import { isInvalidInputError, prisma, NATIVE_EXTENSION_PATH } from '../database/prisma'
 import { NodeType } from '../generated/prisma/client'
+import type { GraphFilter } from '../workers/dependency-builder-worker'
+import {
+  getGraphBinding,
+  getNativeNodeGraph,
+  getNativeProjectGraph,
+  streamNativeNodeGraph,
+} from '../database/native-graph'
 
 // Import test helper to access worker functions for testing
 // Note: In production these are only called via worker pool, but tests call them directly
 const getNodeDependencyGraph = async (
   nodeId: string,
-  opts?: { depth?: number },
+  opts?: { depth?: number; filter?: GraphFilter },
 ): Promise<string> => {
   const depth = opts?.depth ?? 100
   const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
-    `SELECT get_node_dependency_graph(?, ?) as json`,
+    `SELECT get_node_dependency_graph(?, ?, ?) as json`,
     nodeId,
     depth,
+    opts?.filter ? JSON.stringify(opts.filter) : null,
   )
   if (!result || result.length === 0 || !result[0].json) {
     return JSON.stringify({ vertices: [], edges: [] })
@@ -23,14 +33,15 @@ const getNodeDependencyGraph = async (
 const getProjectLevelDependencyGraph = async (
   projectId: string,
   branch: string,
-  opts?: { depth?: number },
+  opts?: { depth?: number; filter?: GraphFilter },
 ): Promise<ArrayBuffer> => {
   const depth = opts?.depth ?? 100
   const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
-    `SELECT get_project_dependency_graph(?, ?, ?) as json`,
+    `SELECT get_project_dependency_graph(?, ?, ?, ?) as json`,
     projectId,
     branch,
     depth,
+    opts?.filter ? JSON.stringify(opts.filter) : null,
   )
   if (!result || result.length === 0 || !result[0].json) {
     const emptyGraph = JSON.stringify({ vertices: [], edges: [] })
@@ -89,6 +100,15 @@ describe('Native Dependency Graph', () => {
     })
   }
 
+  // A second connection with the extension loaded, as each worker opens, for
+  // transactions the test commits itself
+  const openConnection = async () => {
+    const adapter = await new PrismaBetterSqlite3({ url: process.env.DATABASE_URL! }).connect()
+    const db = (adapter as any).client
+    db.loadExtension(NATIVE_EXTENSION_PATH)
+    return { db, close: () => adapter.dispose() }
+  }
+
   describe('getNodeDependencyGraph', () => {
     it('should return orthogonal graph for nodes', async () => {
       // Create test data
@@ -98,7 +118,7 @@ describe('Native Dependency Graph', () => {
 
       // n2 -> n1
       await prisma.connection.create({
-        data: { fromId: n2.id, toId: n1.id },
+        data: { fromKey: n2.key, toKey: n1.key },
       })
 
       const graphJson = await getNodeDependencyGraph(n2.id, { depth: 5 })
@@ -119,6 +139,61 @@ describe('Native Dependency Graph', () => {
       expect(v2?.outDegree).toBe(1)
       expect(v2?.firstOut).not.toBe(-1)
     })
+
+    it('should fill vertex rows and cycle members after walking the keys', async () => {
+      const p = await createProject('p1')
+      const a = await createNode(p, 'a', 'NamedExport')
+      const b = await createNode(p, 'b', 'NamedImport')
+      const c = await createNode(p, 'c', 'NamedImport')
+      await prisma.connection.createMany({
+        data: [
+          { fromKey: a.key, toKey: b.key },
+          { fromKey: b.key, toKey: a.key },
+          { fromKey: c.key, toKey: b.key },
+        ],
+      })
+
+      const graph = JSON.parse(await getNodeDependencyGraph(a.id, { depth: 2 }))
+
+      // BFS order: the root, then its level
+      expect(graph.vertices.map((v: any) => v.data.name)).toEqual(['a', 'b', 'c'])
+      expect(graph.vertices[2].data).toMatchObject({
+        id: c.id,
+        type: 'NamedImport',
+        projectName: 'p1',
+        branch: 'main',
+        relativePath: 'src/index.ts',
+      })
+      expect(graph.edges.map((e: any) => e.data.id)).toContain(`${c.id}-${b.id}`)
+      expect(graph.cycles[0].map((n: any) => n.name).sort()).toEqual(['a', 'a', 'b'])
+    })
+
+    it('should stream the same graph one level per line', async () => {
+      const p = await createProject('p1')
+      const a = await createNode(p, 'a', 'NamedExport')
+      const b = await createNode(p, 'b', 'NamedImport')
+      const c = await createNode(p, 'c', 'NamedImport')
+      await prisma.connection.createMany({
+        data: [
+          { fromKey: b.key, toKey: a.key },
+          { fromKey: c.key, toKey: b.key },
+        ],
+      })
+
+      const result = await prisma.$queryRawUnsafe<Array<{ ndjson: string }>>(
+        `SELECT get_node_dependency_graph_levels(?, 5) as ndjson`,
+        a.id,
+      )
+      const lines = result[0].ndjson.trimEnd().split('\n').map((line) => JSON.parse(line))
+      expect(lines.map((l) => l.depth)).toEqual([0, 1, 2, 2])
+      expect(lines[1].vertices.map((v: any) => v.data.name)).toEqual(['b'])
+      expect(lines[2].edges.map((e: any) => e.data.id)).toEqual([`${c.id}-${b.id}`])
+      expect(lines[3]).toEqual({ done: true, depth: 2, vertexCount: 3, edgeCount: 2 })
+
+      const graph = JSON.parse(await getNodeDependencyGraph(a.id, { depth: 5 }))
+      const streamed = lines.flatMap((l) => l.vertices ?? []).map((v: any) => v.data)
+      expect(streamed).toEqual(graph.vertices.map((v: any) => v.data))
+    })
   })
 
   describe('getProjectLevelDependencyGraph', () => {
@@ -131,12 +206,12 @@ describe('Native Dependency Graph', () => {
       const n2 = await createNode(p2, 'N2', 'NamedImport')
 
       // P2 (N2) -> P1 (N1)
-      await prisma.connection.create({ data: { fromId: n2.id, toId: n1.id } })
+      await prisma.connection.create({ data: { fromKey: n2.key, toKey: n1.key } })
 
       // Cycle: P1 -> P2
       const n3 = await createNode(p1, 'N3', 'NamedImport')
       const n4 = await createNode(p2, 'N4', 'NamedExport')
-      await prisma.connection.create({ data: { fromId: n3.id, toId: n4.id } })
+      await prisma.connection.create({ data: { fromKey: n3.key, toKey: n4.key } })
 
       const arrayBuffer = await getProjectLevelDependencyGraph(p1.id, 'main', { depth: 5 })
       const graphJson = Buffer.from(arrayBuffer as ArrayBuffer).toString('utf-8')
@@ -161,7 +236,7 @@ describe('Native Dependency Graph', () => {
 
       // Connect P1 -> P2
       await prisma.connection.create({
-        data: { fromId: n1.id, toId: n2.id },
+        data: { fromKey: n1.key, toKey: n2.key },
       })
 
       const arrayBuffer = await getProjectLevelDependencyGraph('*', 'main')
@@ -179,4 +254,921 @@ describe('Native Dependency Graph', () => {
       expect(g3.vertices.length).toBe(1)
     })
   })
+
+  describe('layered layout', () => {
+    it('should rank vertices along edges and stack cycles over several layers', async () => {
+      const p1 = await createProject('P1')
+      const entry = await createNode(p1, 'entry', NodeType.NamedImport)
+      const a = await createNode(p1, 'a', NodeType.NamedExport)
+      const b = await createNode(p1, 'b', NodeType.NamedImport)
+      const leaf = await createNode(p1, 'leaf', NodeType.NamedExport)
+
+      // entry -> a <-> b -> leaf
+      await prisma.connection.create({ data: { fromKey: entry.key, toKey: a.key } })
+      await prisma.connection.create({ data: { fromKey: a.key, toKey: b.key } })
+      await prisma.connection.create({ data: { fromKey: b.key, toKey: a.key } })
+      await prisma.connection.create({ data: { fromKey: b.key, toKey: leaf.key } })
+
+      const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+        `SELECT get_node_dependency_graph(?, ?, ?, ?) as json`,
+        entry.id,
+        10,
+        null,
+        1,
+      )
+      const graph = JSON.parse(result[0].json)
+      const layerOf = (id: string) => graph.vertices.find((v: any) => v.data.id === id).layer
+
+      expect(layerOf(entry.id)).toBe(0)
+      expect(layerOf(a.id)).toBe(1)
+      expect(layerOf(b.id)).toBe(2)
+      expect(layerOf(leaf.id)).toBe(3)
+      expect(graph.layout).toMatchObject({ layers: 4 })
+      graph.vertices.forEach((v: any) => {
+        expect(typeof v.x).toBe('number')
+        expect(v.y).toBe(v.layer * 120)
+      })
+
+      const plain = JSON.parse(await getNodeDependencyGraph(entry.id))
+      expect(plain.layout).toBeUndefined()
+    })
+  })
+
+  describe('traversal filters', () => {
+    it('should prune filtered node types and projects inside the traversal', async () => {
+      const app = await createProject('App')
+      const lib = await createProject('Lib')
+      const vendor = await createProject('Vendor')
+      const imp = await createNode(app, 'imp', NodeType.NamedImport)
+      const exp = await createNode(lib, 'exp', NodeType.NamedExport)
+      const event = await createNode(lib, 'evt', NodeType.EventEmit)
+      const vendorExp = await createNode(vendor, 'vendorExp', NodeType.NamedExport)
+      const behindEvent = await createNode(app, 'behindEvent', NodeType.EventOn)
+
+      // imp -> exp, imp -> vendorExp, exp -> evt -> behindEvent
+      await prisma.connection.create({ data: { fromKey: imp.key, toKey: exp.key } })
+      await prisma.connection.create({ data: { fromKey: imp.key, toKey: vendorExp.key } })
+      await prisma.connection.create({ data: { fromKey: exp.key, toKey: event.key } })
+      await prisma.connection.create({ data: { fromKey: event.key, toKey: behindEvent.key } })
+
+      const graph = JSON.parse(
+        await getNodeDependencyGraph(imp.id, {
+          filter: {
+            nodeTypes: [NodeType.NamedImport, NodeType.NamedExport],
+            excludeProjects: ['Vendor'],
+          },
+        }),
+      )
+      const ids = graph.vertices.map((v: any) => v.data.id).sort()
+      expect(ids).toEqual([imp.id, exp.id].sort())
+      expect(graph.edges).toHaveLength(1)
+
+      const projectGraph = JSON.parse(
+        Buffer.from(
+          await getProjectLevelDependencyGraph(app.id, 'main', {
+            filter: { excludeProjects: ['Vendor'] },
+          }),
+        ).toString('utf-8'),
+      )
+      const projectNames = projectGraph.vertices.map((v: any) => v.data.name).sort()
+      expect(projectNames).toEqual(['App', 'Lib'])
+    })
+
+    it('should reject unknown filter keys', async () => {
+      await expect(
+        prisma.$queryRawUnsafe(
+          `SELECT get_node_dependency_graph(?, ?, ?) as json`,
+          'x',
+          1,
+          '{"nodeType":["NamedImport"]}',
+        ),
+      ).rejects.toThrow()
+    })
+  })
+
+  describe('N-API binding', () => {
+    it('should return the same graphs as the SQL functions', async () => {
+      const p1 = await createProject('P1')
+      const p2 = await createProject('P2')
+      const n1 = await createNode(p1, 'n1', NodeType.NamedImport)
+      const n2 = await createNode(p2, 'n2', NodeType.NamedExport)
+      await prisma.connection.create({ data: { fromKey: n1.key, toKey: n2.key } })
+
+      const native = await getGraphBinding()
+      expect(native).not.toBeNull()
+
+      const nodeGraph = await getNativeNodeGraph(native!, n1.id, { depth: 5 })
+      expect(nodeGraph.body.toString()).toBe(await getNodeDependencyGraph(n1.id, { depth: 5 }))
+
+      const projectGraph = JSON.parse(
+        (await getNativeProjectGraph(native!, p1.id, 'main', { depth: 5 })).body.toString(),
+      )
+      expect(projectGraph.vertices.map((v: any) => v.data.id).sort()).toEqual([p1.id, p2.id].sort())
+
+      await expect(
+        getNativeNodeGraph(native!, n1.id, { filter: { bogus: [] } as GraphFilter }),
+      ).rejects.toThrow(/unknown filter key/)
+    })
+
+    it('should gzip graphs while serializing them', async () => {
+      const p1 = await createProject('P1')
+      const p2 = await createProject('P2')
+      const n1 = await createNode(p1, 'n1', NodeType.NamedImport)
+      const n2 = await createNode(p2, 'n2', NodeType.NamedExport)
+      await prisma.connection.create({ data: { fromKey: n1.key, toKey: n2.key } })
+
+      const native = await getGraphBinding()
+      const plain = await getNativeProjectGraph(native!, '*', 'main', { layout: true })
+      const gzipped = await getNativeProjectGraph(native!, '*', 'main', {
+        layout: true,
+        encoding: 'gzip',
+      })
+      expect(gzipped.body.subarray(0, 2)).toEqual(Buffer.from([0x1f, 0x8b]))
+      expect(gunzipSync(gzipped.body).toString()).toBe(plain.body.toString())
+    })
+
+    it('should stream levels as they are walked', async () => {
+      const p = await createProject('P1')
+      const nodes = await Promise.all(
+        ['n0', 'n1', 'n2', 'n3'].map((name) => createNode(p, name, NodeType.NamedImport)),
+      )
+      await prisma.connection.createMany({
+        data: nodes.slice(1).map((n, i) => ({ fromKey: nodes[i].key, toKey: n.key })),
+      })
+
+      const native = await getGraphBinding()
+      const stream = await streamNativeNodeGraph(native!, nodes[0].id, { depth: 10 })
+      let ndjson = ''
+      for await (const chunk of stream) ndjson += chunk.toString()
+      const lines = ndjson.trimEnd().split('\n').map((line) => JSON.parse(line))
+      expect(lines.map((l) => l.depth)).toEqual([0, 1, 2, 3, 3])
+      expect(lines.at(-1)).toMatchObject({ done: true, vertexCount: 4, edgeCount: 3 })
+
+      // Stopping early ends the walk without an error
+      const stopped: string[] = []
+      await native!.streamNodeGraph(
+        process.env.DATABASE_URL!.replace(/^file:/, ''),
+        nodes[0].id,
+        10,
+        null,
+        (line) => {
+          stopped.push(Buffer.from(line).toString())
+          return false
+        },
+      )
+      expect(stopped).toHaveLength(1)
+
+      await expect(
+        streamNativeNodeGraph(native!, nodes[0].id, { filter: { bogus: [] } as GraphFilter }),
+      ).rejects.toThrow(/unknown filter key/)
+    })
+
+    it('should pause the walk while nobody reads the stream', async () => {
+      const p = await createProject('P1')
+      const nodes = await Promise.all(
+        Array.from({ length: 400 }, (_, i) => createNode(p, `n${i}`, NodeType.NamedImport)),
+      )
+      await prisma.connection.createMany({
+        data: nodes.slice(1).map((n, i) => ({ fromKey: nodes[i].key, toKey: n.key })),
+      })
+
+      const native = await getGraphBinding()
+      const stream = await streamNativeNodeGraph(native!, nodes[0].id, { depth: 1000 })
+      await new Promise((resolve) => setTimeout(resolve, 200))
+      const buffered = stream.readableLength + stream.writableLength
+      expect(stream.writableEnded).toBe(false)
+
+      let ndjson = ''
+      for await (const chunk of stream) ndjson += chunk.toString()
+      expect(ndjson.trimEnd().split('\n')).toHaveLength(401)
+      expect(buffered).toBeLessThan(ndjson.length / 2)
+    })
+
+    it('should hash the plain JSON of a graph, however it is encoded', async () => {
+      const p1 = await createProject('P1')
+      const p2 = await createProject('P2')
+      const n1 = await createNode(p1, 'n1', NodeType.NamedImport)
+      const n2 = await createNode(p2, 'n2', NodeType.NamedExport)
+      await prisma.connection.create({ data: { fromKey: n1.key, toKey: n2.key } })
+
+      const native = await getGraphBinding()
+      const plain = await getNativeProjectGraph(native!, '*', 'main')
+      const gzipped = await getNativeProjectGraph(native!, '*', 'main', { encoding: 'gzip' })
+      const cached = await getNativeProjectGraph(native!, '*', 'main')
+      expect(plain.contentHash).toMatch(/^[0-9a-f]{16}$/)
+      expect(gzipped.contentHash).toBe(plain.contentHash)
+      expect(cached.contentHash).toBe(plain.contentHash)
+
+      const result = await prisma.$queryRawUnsafe<Array<{ hash: string }>>(
+        `SELECT content_hash(?) as hash`,
+        plain.body.toString(),
+      )
+      expect(result[0].hash).toBe(plain.contentHash)
+
+      // XXH64 reference value
+      const abc = await prisma.$queryRawUnsafe<Array<{ hash: string }>>(
+        `SELECT content_hash('abc') as hash`,
+      )
+      expect(abc[0].hash).toBe('44bc2cf5ad770999')
+
+      const nodeGraph = await getNativeNodeGraph(native!, n1.id)
+      await prisma.connection.deleteMany()
+      expect((await getNativeNodeGraph(native!, n1.id)).contentHash).not.toBe(
+        nodeGraph.contentHash,
+      )
+    })
+  })
+
+  describe('result cache', () => {
+    const stats = async () => {
+      const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+        `SELECT result_cache_stats() as json`,
+      )
+      return JSON.parse(result[0].json) as { hits: number; misses: number }
+    }
+
+    it('should serve repeated graphs until a write touches their branch', async () => {
+      const p = await createProject('cached')
+      const n1 = await createNode(p, 'n1', NodeType.NamedExport)
+      const n2 = await createNode(p, 'n2', NodeType.NamedImport)
+      await prisma.connection.create({ data: { fromKey: n2.key, toKey: n1.key } })
+
+      const first = await getNodeDependencyGraph(n1.id, { depth: 5 })
+      const before = await stats()
+      expect(await getNodeDependencyGraph(n1.id, { depth: 5 })).toBe(first)
+      expect((await stats()).hits).toBe(before.hits + 1)
+
+      const n3 = await createNode(p, 'n3', NodeType.NamedImport)
+      await prisma.connection.create({ data: { fromKey: n3.key, toKey: n1.key } })
+
+      const updated = JSON.parse(await getNodeDependencyGraph(n1.id, { depth: 5 }))
+      expect(updated.vertices).toHaveLength(3)
+    })
+
+    it('should only see writes of another connection once they commit', async () => {
+      const p = await createProject('cached')
+      const n1 = await createNode(p, 'n1', NodeType.NamedExport)
+      const n2 = await createNode(p, 'n2', NodeType.NamedImport)
+
+      // The binding reads on its own connection
+      const native = await getGraphBinding()
+      const vertices = async () =>
+        JSON.parse((await getNativeNodeGraph(native!, n1.id, { depth: 5 })).body.toString())
+          .vertices.length
+
+      expect(await vertices()).toBe(1)
+      await prisma.$transaction(async (tx) => {
+        await tx.connection.create({ data: { fromKey: n2.key, toKey: n1.key } })
+        // The writer's own view is neither served from nor kept in the cache
+        const own = await tx.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT get_node_dependency_graph(?, 5) as json`,
+          n1.id,
+        )
+        expect(JSON.parse(own[0].json).vertices).toHaveLength(2)
+        expect(await vertices()).toBe(1)
+      })
+      expect(await vertices()).toBe(2)
+    })
+
+    it('should attribute writes to rows with large keys to their branch', async () => {
+      const p = await createProject('cached')
+      const n1 = await createNode(p, 'n1', NodeType.NamedExport)
+      await getNodeDependencyGraph(n1.id, { depth: 5 })
+
+      // Keys only grow; one far past every other row is still tracked
+      const far = await prisma.node.create({
+        data: {
+          key: 2 ** 27,
+          name: 'far',
+          type: NodeType.NamedExport,
+          projectId: p.id,
+          projectName: p.name,
+          branch: 'feature',
+          version: '1.0.0',
+          relativePath: 'src/index.ts',
+          startLine: 1,
+          startColumn: 1,
+          endLine: 1,
+          endColumn: 10,
+          meta: {},
+        },
+      })
+      await getNodeDependencyGraph(n1.id, { depth: 5 })
+      await prisma.node.delete({ where: { key: far.key } })
+
+      const before = await stats()
+      await getNodeDependencyGraph(n1.id, { depth: 5 })
+      expect((await stats()).hits).toBe(before.hits + 1)
+    })
+
+    it('should serve graphs read through the binding from the cache', async () => {
+      const p = await createProject('cached')
+      const n1 = await createNode(p, 'n1', NodeType.NamedExport)
+      const n2 = await createNode(p, 'n2', NodeType.NamedImport)
+      await prisma.connection.create({ data: { fromKey: n2.key, toKey: n1.key } })
+
+      const native = await getGraphBinding()
+      const first = await getNativeNodeGraph(native!, n1.id, { depth: 5 })
+      const before = await stats()
+      const second = await getNativeNodeGraph(native!, n1.id, { depth: 5 })
+      expect(second.body.toString()).toBe(first.body.toString())
+      expect((await stats()).hits).toBe(before.hits + 1)
+    })
+  })
+
+  describe('memory budget', () => {
+    // Every import of app uses every export of lib: 400 edges between 40
+    // nodes, so the edges are far past a budget the visited nodes fit in
+    const createMesh = async () => {
+      const lib = await createProject('lib')
+      const app = await createProject('app')
+      const names = Array.from({ length: 20 }, (_, i) => `n${i}`)
+      const exports = await Promise.all(
+        names.map((name) => createNode(lib, name, NodeType.NamedExport)),
+      )
+      const imports = await Promise.all(
+        names.map((name) => createNode(app, name, NodeType.NamedImport)),
+      )
+      await prisma.connection.createMany({
+        data: imports.flatMap((i) => exports.map((e) => ({ fromKey: i.key, toKey: e.key }))),
+      })
+      return exports[0]
+    }
+
+    const graph = async (nodeId: string, memoryBudget: number) => {
+      const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+        `SELECT get_node_dependency_graph(?, 10, NULL, 0, ?) as json`,
+        nodeId,
+        memoryBudget,
+      )
+      return JSON.parse(result[0].json)
+    }
+
+    it('should spill past the budget and serialize the same vertices and edges', async () => {
+      const root = await createMesh()
+
+      // Spilled graphs aren't cached, so the in-memory one is built afterwards
+      const { spilled, ...rest } = await graph(root.id, 8192)
+      const inMemory = await graph(root.id, 0)
+      expect(spilled).toBe(true)
+      expect(inMemory.spilled).toBeUndefined()
+      expect(rest).toEqual(inMemory)
+      expect(rest.vertices).toHaveLength(40)
+      expect(rest.edges).toHaveLength(400)
+    })
+
+    it('should fail when the visited nodes alone exceed the budget', async () => {
+      const root = await createMesh()
+
+      await expect(graph(root.id, 256)).rejects.toThrow(/exceeds the memory budget/)
+    })
+  })
+
+  describe('traversal planner', () => {
+    const query = async (sql: string, ...args: unknown[]) => {
+      const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(sql, ...args)
+      return JSON.parse(result[0].json)
+    }
+    const edges = async (nodeId: string) =>
+      (
+        await prisma.$queryRawUnsafe<Array<{ edge: string }>>(
+          `SELECT level || ':' || fromId || '>' || toId as edge FROM graph_edges(?, 10)`,
+          nodeId,
+        )
+      ).map((row) => row.edge)
+
+    afterEach(async () => {
+      await query(`SELECT traversal_stats('auto') as json`)
+    })
+
+    it('should produce the same traversal with every strategy and report its choice', async () => {
+      const p = await createProject('planned')
+      const nodes = await Promise.all(
+        ['a', 'b', 'c', 'd', 'e'].map((name) => createNode(p, name, NodeType.NamedExport)),
+      )
+      await prisma.connection.createMany({
+        data: [
+          { fromKey: nodes[0].key, toKey: nodes[1].key },
+          { fromKey: nodes[1].key, toKey: nodes[2].key },
+          { fromKey: nodes[3].key, toKey: nodes[1].key },
+          { fromKey: nodes[2].key, toKey: nodes[0].key },
+          { fromKey: nodes[4].key, toKey: nodes[3].key },
+        ],
+      })
+
+      const planned = await edges(nodes[0].id)
+      expect(planned).toHaveLength(5)
+      expect((await query(`SELECT traversal_stats() as json`)).last).toMatchObject({
+        strategy: 'probe',
+        reason: 'small frontier',
+      })
+
+      await query(`SELECT traversal_stats('scan') as json`)
+      expect(await edges(nodes[0].id)).toEqual(planned)
+      const scanned = await query(`SELECT traversal_stats() as json`)
+      expect(scanned.last.strategy).toBe('scan')
+      expect(scanned.residentEdges).toBe(5)
+
+      expect(await edges(nodes[0].id)).toEqual(planned)
+      expect((await query(`SELECT traversal_stats() as json`)).resident).toBe(scanned.resident + 1)
+
+      // A write retires the resident adjacency
+      await prisma.connection.create({ data: { fromKey: nodes[4].key, toKey: nodes[0].key } })
+      expect(await edges(nodes[0].id)).toHaveLength(6)
+      expect((await query(`SELECT traversal_stats() as json`)).last.strategy).toBe('scan')
+    })
+
+    it('should reuse the resident adjacency for traversals through the binding', async () => {
+      const p = await createProject('planned')
+      const nodes = await Promise.all(
+        ['a', 'b', 'c'].map((name) => createNode(p, name, NodeType.NamedExport)),
+      )
+      await prisma.connection.createMany({
+        data: [
+          { fromKey: nodes[0].key, toKey: nodes[1].key },
+          { fromKey: nodes[1].key, toKey: nodes[2].key },
+        ],
+      })
+
+      await query(`SELECT traversal_stats('scan') as json`)
+      const native = await getGraphBinding()
+      // Different depths, so the second isn't answered from the result cache
+      await getNativeNodeGraph(native!, nodes[0].id, { depth: 5 })
+      expect((await query(`SELECT traversal_stats() as json`)).last.strategy).toBe('scan')
+      await getNativeNodeGraph(native!, nodes[0].id, { depth: 6 })
+      expect((await query(`SELECT traversal_stats() as json`)).last.strategy).toBe('resident')
+    })
+
+    it('should keep the resident adjacency out of uncommitted transactions', async () => {
+      const p = await createProject('planned')
+      const [a, b, c] = await Promise.all(
+        ['a', 'b', 'c'].map((name) => createNode(p, name, NodeType.NamedExport)),
+      )
+      await prisma.connection.create({ data: { fromKey: a.key, toKey: b.key } })
+
+      await query(`SELECT traversal_stats('scan') as json`)
+      expect(await edges(a.id)).toHaveLength(1)
+
+      const rolledBack = new Error('roll back')
+      await expect(
+        prisma.$transaction(async (tx) => {
+          await tx.connection.create({ data: { fromKey: b.key, toKey: c.key } })
+          const inside = await tx.$queryRawUnsafe<Array<{ edge: string }>>(
+            `SELECT fromId as edge FROM graph_edges(?, 10)`,
+            a.id,
+          )
+          expect(inside).toHaveLength(2)
+          throw rolledBack
+        }),
+      ).rejects.toBe(rolledBack)
+
+      // Neither retired nor replaced by what the transaction saw
+      expect(await edges(a.id)).toHaveLength(1)
+      expect((await query(`SELECT traversal_stats() as json`)).last.strategy).toBe('resident')
+    })
+
+    it('should reject an unknown mode', async () => {
+      await expect(query(`SELECT traversal_stats('fast') as json`)).rejects.toThrow(/mode must be/)
+    })
+  })
+
+  describe('project clusters', () => {
+    it('should aggregate projects and expand one to its boundary nodes', async () => {
+      const app = await createProject('app')
+      const lib = await createProject('lib')
+      const importA = await createNode(app, 'importA', NodeType.NamedImport)
+      const importB = await createNode(app, 'importB', NodeType.NamedImport)
+      const internal = await createNode(app, 'internal', NodeType.NamedExport)
+      const exportA = await createNode(lib, 'exportA', NodeType.NamedExport)
+      const exportB = await createNode(lib, 'exportB', NodeType.NamedExport)
+      await prisma.connection.createMany({
+        data: [
+          { fromKey: importA.key, toKey: exportA.key },
+          { fromKey: importB.key, toKey: exportB.key },
+          { fromKey: internal.key, toKey: importA.key },
+        ],
+      })
+
+      const query = async (sql: string, ...args: unknown[]) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(sql, ...args)
+        return JSON.parse(result[0].json)
+      }
+
+      const clusters = await query(`SELECT project_clusters(?) as json`, 'main')
+      expect(
+        clusters.vertices.map((v: any) => [v.data.name, v.nodeCount, v.boundaryCount]),
+      ).toEqual([
+        ['app', 3, 2],
+        ['lib', 2, 2],
+      ])
+      expect(clusters.edges).toHaveLength(1)
+      expect(clusters.edges[0].data).toMatchObject({ fromId: app.id, toId: lib.id })
+      expect(clusters.edges[0].weight).toBe(2)
+
+      const expanded = await query(`SELECT expand_project(?, ?) as json`, app.id, 'main')
+      expect(expanded.project.id).toBe(app.id)
+      expect(expanded.vertices.map((v: any) => v.data.id).sort()).toEqual(
+        [importA.id, importB.id].sort(),
+      )
+      expect(expanded.edges).toHaveLength(2)
+      expect(expanded.edges.every((e: any) => e.toProjectId === lib.id)).toBe(true)
+
+      await expect(
+        query(`SELECT expand_project(?, ?) as json`, 'missing', 'main'),
+      ).rejects.toThrow(/project not found/)
+    })
+  })
+
+  describe('rank_nodes', () => {
+    it('should rank the most depended-on exports first', async () => {
+      const lib = await createProject('lib')
+      const app = await createProject('app')
+      const hub = await createNode(lib, 'hub', NodeType.NamedExport)
+      const leaf = await createNode(lib, 'leaf', NodeType.NamedExport)
+      const importers = await Promise.all(
+        ['i1', 'i2', 'i3'].map((name) => createNode(app, name, NodeType.NamedImport)),
+      )
+      await prisma.connection.createMany({
+        data: [
+          ...importers.map((i) => ({ fromKey: i.key, toKey: hub.key })),
+          { fromKey: importers[0].key, toKey: leaf.key },
+        ],
+      })
+
+      const rank = async (metric: string, filter?: object) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT rank_nodes(?, ?, ?, ?) as json`,
+          'main',
+          metric,
+          2,
+          filter ? JSON.stringify(filter) : null,
+        )
+        return JSON.parse(result[0].json)
+      }
+
+      const indegree = await rank('indegree', { nodeTypes: ['NamedExport'] })
+      expect(indegree.nodes.map((n: any) => [n.id, n.score])).toEqual([
+        [hub.id, 3],
+        [leaf.id, 1],
+      ])
+      expect(indegree.projects[0].projectId).toBe(lib.id)
+
+      const pagerank = await rank('pagerank')
+      expect(pagerank.nodes[0].id).toBe(hub.id)
+      expect(pagerank.nodeCount).toBe(5)
+
+      await expect(rank('bogus')).rejects.toThrow(/unknown metric/)
+    })
+  })
+
+  describe('branch overlay', () => {
+    it('should share unchanged projects with the base branch and diff the rest', async () => {
+      const app = await createProject('app')
+      const lib = await createProject('lib')
+      const onBranch = (branch: string, project: { id: string; name: string }, name: string, type: NodeType) =>
+        prisma.node.create({
+          data: {
+            name,
+            type,
+            projectId: project.id,
+            projectName: project.name,
+            branch,
+            version: '1.0.0',
+            relativePath: 'src/index.ts',
+            startLine: 1,
+            startColumn: 1,
+            endLine: 1,
+            endColumn: 10,
+            meta: {},
+          },
+        })
+
+      for (const branch of ['main', 'feature']) {
+        const exportA = await onBranch(branch, lib, 'exportA', NodeType.NamedExport)
+        const exportB = await onBranch(branch, lib, 'exportB', NodeType.NamedExport)
+        const importA = await onBranch(branch, app, 'importA', NodeType.NamedImport)
+        // feature re-points the import and adds one
+        const target = branch === 'main' ? exportA : exportB
+        await prisma.connection.create({ data: { fromKey: importA.key, toKey: target.key } })
+        if (branch === 'feature') await onBranch(branch, app, 'importC', NodeType.NamedImport)
+      }
+
+      const query = async (sql: string, ...args: unknown[]) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(sql, ...args)
+        return JSON.parse(result[0].json)
+      }
+
+      const before = await query(`SELECT branch_store_stats() as json`)
+      const overlay = await query(`SELECT branch_overlay(?, ?) as json`, 'feature', 'main')
+      expect(overlay.sharedProjects).toBe(1)
+      expect(overlay.projects).toEqual([
+        { projectId: app.id, projectName: 'app', addedNodes: 1, removedNodes: 0, addedEdges: 1, removedEdges: 1 },
+      ])
+      const stats = await query(`SELECT branch_store_stats() as json`)
+      expect(stats.loads - before.loads).toBe(4)
+      expect(stats.shared - before.shared).toBe(1)
+
+      // A write only reloads the project it touched
+      await onBranch('feature', lib, 'exportC', NodeType.NamedExport)
+      const after = await query(`SELECT branch_overlay(?, ?) as json`, 'feature', 'main')
+      expect(after.sharedProjects).toBe(0)
+      expect(after.projects.map((p: any) => [p.projectName, p.addedNodes])).toEqual([
+        ['app', 1],
+        ['lib', 1],
+      ])
+      expect((await query(`SELECT branch_store_stats() as json`)).loads).toBe(stats.loads + 1)
+    })
+
+    it('should reload a project only once another connection commits to it', async () => {
+      const app = await createProject('app')
+      const lib = await createProject('lib')
+      const importA = await createNode(app, 'importA', NodeType.NamedImport)
+      const exportA = await createNode(lib, 'exportA', NodeType.NamedExport)
+      await prisma.connection.create({ data: { fromKey: importA.key, toKey: exportA.key } })
+
+      const query = async (sql: string, ...args: unknown[]) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(sql, ...args)
+        return JSON.parse(result[0].json)
+      }
+      const overlay = () => query(`SELECT branch_overlay(?, ?) as json`, 'main', 'main')
+      const loads = async () => (await query(`SELECT branch_store_stats() as json`)).loads
+
+      expect((await overlay()).sharedProjects).toBe(2)
+      const loaded = await loads()
+
+      const writer = await openConnection()
+      try {
+        writer.db.exec('BEGIN')
+        writer.db.prepare('DELETE FROM Connection WHERE fromKey = ?').run(importA.key)
+        expect((await overlay()).sharedProjects).toBe(2)
+        expect(await loads()).toBe(loaded)
+
+        writer.db.exec('COMMIT')
+        expect((await overlay()).sharedProjects).toBe(2)
+        expect(await loads()).toBe(loaded + 1)
+      } finally {
+        await writer.close()
+      }
+    })
+  })
+
+  describe('project graph delta', () => {
+    it('should return only the vertices and edges changed since a generation', async () => {
+      const app = await createProject('app')
+      const lib = await createProject('lib')
+      const importX = await createNode(app, 'x', NodeType.NamedImport)
+      const exportX = await createNode(lib, 'x', NodeType.NamedExport)
+
+      const delta = async (since?: number) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT get_project_dependency_graph_delta(?, ?) as json`,
+          'main',
+          since ?? null,
+        )
+        return JSON.parse(result[0].json)
+      }
+
+      const initial = await delta()
+      expect(initial.reload).toBe(true)
+      expect((await delta(initial.generation)).edges).toEqual({ added: [], removed: [] })
+
+      await prisma.connection.create({ data: { fromKey: importX.key, toKey: exportX.key } })
+      const added = await delta(initial.generation)
+      expect(added.reload).toBe(false)
+      expect(added.edges.added).toEqual([{ id: `${app.id}-${lib.id}`, fromId: app.id, toId: lib.id }])
+      expect(added.vertices).toEqual({ added: [], removed: [] })
+
+      // A renamed project is replaced; changes since the first generation fold together
+      await prisma.project.update({ where: { id: lib.id }, data: { name: 'lib2' } })
+      const folded = await delta(initial.generation)
+      expect(folded.generation).toBeGreaterThan(added.generation)
+      expect(folded.vertices.removed).toEqual([lib.id])
+      expect(folded.vertices.added.map((v: any) => v.name)).toEqual(['lib2'])
+      expect(folded.edges.added).toHaveLength(1)
+
+      expect((await delta(1)).reload).toBe(true)
+    })
+
+    it('should report the writes of another connection once they commit', async () => {
+      const app = await createProject('app')
+      const lib = await createProject('lib')
+      const importX = await createNode(app, 'x', NodeType.NamedImport)
+      const exportX = await createNode(lib, 'x', NodeType.NamedExport)
+
+      const delta = async (since?: number) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT get_project_dependency_graph_delta(?, ?) as json`,
+          'main',
+          since ?? null,
+        )
+        return JSON.parse(result[0].json)
+      }
+      const initial = await delta()
+
+      const writer = await openConnection()
+      try {
+        writer.db.exec('BEGIN')
+        writer.db
+          .prepare('INSERT INTO Connection (fromKey, toKey) VALUES (?, ?)')
+          .run(importX.key, exportX.key)
+        const open = await delta(initial.generation)
+        expect(open.generation).toBe(initial.generation)
+        expect(open.edges.added).toEqual([])
+
+        writer.db.exec('COMMIT')
+        const committed = await delta(initial.generation)
+        expect(committed.reload).toBe(false)
+        expect(committed.edges.added).toEqual([
+          { id: `${app.id}-${lib.id}`, fromId: app.id, toId: lib.id },
+        ])
+      } finally {
+        await writer.close()
+      }
+    })
+  })
+
+  describe('find_unused_exports / find_unresolved_imports', () => {
+    it('should report unconnected exports and imports grouped by project', async () => {
+      const app = await createProject('app')
+      const lib = await createProject('lib')
+      const resolved = await createNode(app, 'x', NodeType.NamedImport)
+      const unresolved = await createNode(app, 'y', NodeType.RuntimeDynamicImport)
+      const used = await createNode(lib, 'x', NodeType.NamedExport)
+      const unused = await createNode(lib, 'z', NodeType.NamedExport)
+      await createNode(lib, 'changed', NodeType.EventEmit)
+      await prisma.connection.create({ data: { fromKey: resolved.key, toKey: used.key } })
+
+      const report = async (fn: string, branch = 'main') => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT ${fn}(?) as json`,
+          branch,
+        )
+        return JSON.parse(result[0].json)
+      }
+
+      const exports = await report('find_unused_exports')
+      expect(exports.count).toBe(1)
+      expect(exports.projects).toEqual([
+        {
+          projectId: lib.id,
+          projectName: 'lib',
+          nodes: [expect.objectContaining({ id: unused.id, name: 'z', type: 'NamedExport' })],
+        },
+      ])
+
+      const imports = await report('find_unresolved_imports')
+      expect(imports.count).toBe(1)
+      expect(imports.projects.map((p: any) => p.projectName)).toEqual(['app'])
+      expect(imports.projects[0].nodes.map((n: any) => n.id)).toEqual([unresolved.id])
+
+      expect(await report('find_unused_exports', 'other')).toEqual({
+        branch: 'other',
+        projects: [],
+        count: 0,
+      })
+    })
+  })
+
+  describe('dms_match', () => {
+    it('should bind projects to a path pattern within its hop bounds', async () => {
+      const app = await createProject('app')
+      const core = await prisma.project.create({ data: { name: 'core', addr: 'x', type: 'Lib' } })
+      const events = await prisma.project.create({ data: { name: 'events', addr: 'x', type: 'Lib' } })
+      const appImport = await createNode(app, 'x', NodeType.NamedImport)
+      const coreExport = await createNode(core, 'x', NodeType.NamedExport)
+      const coreImport = await createNode(core, 'y', NodeType.NamedImport)
+      const eventsExport = await createNode(events, 'y', NodeType.NamedExport)
+      await createNode(events, 'changed', NodeType.EventEmit)
+      await prisma.connection.createMany({
+        data: [
+          { fromKey: appImport.key, toKey: coreExport.key },
+          { fromKey: coreImport.key, toKey: eventsExport.key },
+        ],
+      })
+
+      const match = async (pattern: string, limit?: number) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT dms_match(?, ?, ?) as json`,
+          pattern,
+          'main',
+          limit ?? null,
+        )
+        return JSON.parse(result[0].json)
+      }
+      const names = (result: any) => result.matches.map((m: any) => m.projects.map((p: any) => p.name))
+
+      const direct = await match('(App)-[NamedImport]->(Lib)')
+      expect(names(direct)).toEqual([['app', 'core']])
+
+      const reach = await match(`(App)-[NamedImport*1..3]->({has:'EventEmit'})`)
+      expect(names(reach)).toEqual([['app', 'events']])
+      expect(reach.matches[0].hops).toEqual([2])
+
+      expect(names(await match('(Lib)<-[*]-(App)'))).toEqual([
+        ['core', 'app'],
+        ['events', 'app'],
+      ])
+      expect((await match('(App)-[EventOn]->()')).matches).toEqual([])
+
+      const limited = await match('()-[*]->()', 1)
+      expect(limited.matches).toHaveLength(1)
+      expect(limited.truncated).toBe(true)
+
+      await expect(match('(App)-[Bogus]->()')).rejects.toThrow(/unknown node type/)
+      expect(await match('(App)-[Bogus]->()').catch(isInvalidInputError)).toBe(true)
+      await expect(match('(App)-[*3..2]->()')).rejects.toThrow(/hop bounds/)
+    })
+  })
+
+  describe('impact_of_changes', () => {
+    it('should seed from overlapping line ranges and walk dependents only', async () => {
+      const lib = await createProject('lib')
+      const app = await createProject('app')
+      const changed = await createNode(lib, 'changed', NodeType.NamedExport)
+      const untouched = await prisma.node.update({
+        where: { id: (await createNode(lib, 'untouched', NodeType.NamedExport)).id },
+        data: { startLine: 20, endLine: 30 },
+      })
+      const consumer = await createNode(app, 'consumer', NodeType.NamedImport)
+      const dependency = await createNode(lib, 'dependency', NodeType.NamedImport)
+
+      // consumer -> changed -> dependency
+      await prisma.connection.create({ data: { fromKey: consumer.key, toKey: changed.key } })
+      await prisma.connection.create({ data: { fromKey: changed.key, toKey: dependency.key } })
+
+      const impact = async (changes: unknown) => {
+        const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+          `SELECT impact_of_changes(?, ?, ?, ?) as json`,
+          lib.id,
+          'main',
+          JSON.stringify(changes),
+          10,
+        )
+        return JSON.parse(result[0].json)
+      }
+
+      const result = await impact([{ relativePath: 'src/index.ts', startLine: 1, endLine: 1 }])
+      expect(result.seeds.sort()).toEqual([changed.id, dependency.id].sort())
+      expect(result.nodeCount).toBe(3)
+      const byProject = Object.fromEntries(
+        result.projects.map((p: any) => [p.projectName, p.nodes.map((n: any) => n.id)]),
+      )
+      expect(byProject.app).toEqual([consumer.id])
+      expect(byProject.lib).not.toContain(untouched.id)
+      expect(result.projects.find((p: any) => p.projectName === 'app').projectId).toBe(app.id)
+
+      const whole = await impact([{ relativePath: 'src/index.ts' }])
+      expect(whole.seeds).toContain(untouched.id)
+
+      const none = await impact([{ relativePath: 'src/index.ts', startLine: 11, endLine: 19 }])
+      expect(none).toEqual({ seeds: [], nodeCount: 0, projects: [] })
+    })
+  })
+
+  describe('graph_vertices / graph_edges', () => {
+    it('should stream the traversal level by level', async () => {
+      const p1 = await createProject('P1')
+      const p2 = await createProject('P2')
+      const n1 = await createNode(p1, 'n1', NodeType.NamedImport)
+      const n2 = await createNode(p2, 'n2', NodeType.NamedExport)
+      const n3 = await createNode(p2, 'n3', NodeType.NamedImport)
+      const n4 = await createNode(p1, 'n4', NodeType.NamedExport)
+
+      // n1 -> n2 -> n3 -> n4
+      await prisma.connection.create({ data: { fromKey: n1.key, toKey: n2.key } })
+      await prisma.connection.create({ data: { fromKey: n2.key, toKey: n3.key } })
+      await prisma.connection.create({ data: { fromKey: n3.key, toKey: n4.key } })
+
+      const vertices = await prisma.$queryRawUnsafe<Array<{ id: string; level: number }>>(
+        `SELECT id, level FROM graph_vertices(?, ?, ?)`,
+        n1.id,
+        10,
+        'out',
+      )
+      expect(vertices.map((v) => v.id)).toEqual([n1.id, n2.id, n3.id, n4.id])
+      expect(vertices.map((v) => Number(v.level))).toEqual([0, 1, 2, 3])
+
+      const page = await prisma.$queryRawUnsafe<Array<{ id: string }>>(
+        `SELECT id FROM graph_vertices(?, ?, ?) LIMIT 2 OFFSET 1`,
+        n1.id,
+        10,
+        'out',
+      )
+      expect(page.map((v) => v.id)).toEqual([n2.id, n3.id])
+
+      const edges = await prisma.$queryRawUnsafe<Array<{ fromId: string; toId: string }>>(
+        `SELECT fromId, toId FROM graph_edges(?, ?, ?)`,
+        n4.id,
+        1,
+        'in',
+      )
+      expect(edges).toEqual([{ fromId: n3.id, toId: n4.id }])
+    })
+
+    it('should reject an unknown direction', async () => {
+      await expect(
+        prisma.$queryRawUnsafe(`SELECT * FROM graph_vertices(?, ?, ?)`, 'x', 1, 'sideways'),
+      ).rejects.toThrow()
+    })
+  })
 })
@@ -0,0 +1,281 @@
+#include "branch-commit.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json-reader.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Shallow Branch Commit ---
+//
+// Promotes an uploaded shallow branch: the target branch's nodes for each
+// listed project are deleted and the staged nodes are renamed into it.
+//
+// The Prisma version ran one set-based DELETE and UPDATE, which visits rows in
+// whatever order the chosen index yields and scatters writes over the table
+// and every index that contains `branch`. Here the rowids of both sides are
+// collected first and written in ascending order, so the table B-tree is
+// walked front-to-back. A larger page cache for the duration keeps the
+// touched pages resident, so they are written once at the end instead of
+// being spilled and re-read.
+//
+// The index entries can't follow that order: each one is keyed differently,
+// so every promoted row still re-inserts a scattered entry into each index
+// containing `branch`, and every deleted row removes one from every index.
+// Once a commit rewrites more than 1/BulkRebuildDivisor of the table, those
+// indexes are dropped before the writes and recreated after them instead.
+// CREATE INDEX sorts the whole table, so it only pays off for commits that
+// rewrite a large part of it (a full-branch upload); on a 190k-node table the
+// two broke even at about 45% of the rows. The drop and recreate run inside
+// the commit's savepoint, so a failed commit gets them back as they were.
+// Indexes led by `id` stay, as foreign keys reference Node through them, and
+// the planner statistics of the others are carried over.
+
+static const int CommitCacheKiB = 64 * 1024;
+static const size_t BulkRebuildDivisor = 2;
+
+static bool ParseProjectNames(const char* json, std::vector<std::string>& names, std::string& error) {
+    JsonReader r(json ? std::string_view(json) : std::string_view());
+    if (!r.expect('[')) {
+        error = "projectNames must be a JSON array of strings: " + r.error();
+        return false;
+    }
+    if (!r.consume(']')) {
+        std::string name;
+        do {
+            if (!r.readString(name)) {
+                error = "projectNames must be a JSON array of strings: " + r.error();
+                return false;
+            }
+            names.push_back(name);
+        } while (r.consume(','));
+        if (!r.expect(']')) {
+            error = "projectNames must be a JSON array of strings: " + r.error();
+            return false;
+        }
+    }
+    // Sorted to match the projectName-leading index order
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return true;
+}
+
+static int QueryInt(sqlite3* db, const char* sql, int fallback) {
+    sqlite3_stmt* stmt;
+    int value = fallback;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// Appends the rowids and project ids of one project's nodes on a branch
+static bool CollectRows(sqlite3_stmt* select, const std::string& projectName, const char* branch,
+                        std::vector<sqlite3_int64>& rowids, std::set<std::string>& projectIds) {
+    sqlite3_bind_text(select, 1, projectName.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(select, 2, branch, -1, SQLITE_STATIC);
+    int rc;
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW) {
+        rowids.push_back(sqlite3_column_int64(select, 0));
+        const unsigned char* projectId = sqlite3_column_text(select, 1);
+        if (projectId) projectIds.insert((const char*)projectId);
+    }
+    sqlite3_reset(select);
+    return rc == SQLITE_DONE;
+}
+
+// Steps stmt once per rowid, bound as the last parameter
+static bool WriteRows(sqlite3* db, sqlite3_stmt* stmt, int param, const std::vector<sqlite3_int64>& rowids,
+                      std::string& error) {
+    for (sqlite3_int64 rowid : rowids) {
+        sqlite3_bind_int64(stmt, param, rowid);
+        int rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if (rc != SQLITE_DONE) {
+            error = sqlite3_errmsg(db);
+            return false;
+        }
+    }
+    return true;
+}
+
+struct DroppedIndex {
+    std::string name;
+    std::string sql;
+    std::string stat; // its sqlite_stat1 row, if the database was analyzed
+};
+
+// Drops the Node indexes a bulk commit would otherwise maintain row by row
+static bool DropNodeIndexes(sqlite3* db, std::vector<DroppedIndex>& dropped, std::string& error) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT name, sql FROM sqlite_master m WHERE type = 'index' AND tbl_name = 'Node' "
+                           "AND sql IS NOT NULL "
+                           "AND (SELECT name FROM pragma_index_info(m.name) WHERE seqno = 0) != 'id'",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        dropped.push_back({ (const char*)sqlite3_column_text(stmt, 0), (const char*)sqlite3_column_text(stmt, 1), "" });
+    }
+    sqlite3_finalize(stmt);
+
+    // No sqlite_stat1 table (never analyzed) leaves the stats empty
+    if (sqlite3_prepare_v2(db, "SELECT stat FROM sqlite_stat1 WHERE tbl = 'Node' AND idx = ?", -1, &stmt, NULL) ==
+        SQLITE_OK) {
+        for (DroppedIndex& index : dropped) {
+            sqlite3_bind_text(stmt, 1, index.name.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) == SQLITE_ROW) index.stat = (const char*)sqlite3_column_text(stmt, 0);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    for (const DroppedIndex& index : dropped) {
+        if (sqlite3_exec(db, ("DROP INDEX \"" + index.name + "\"").c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+            error = sqlite3_errmsg(db);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool RecreateNodeIndexes(sqlite3* db, const std::vector<DroppedIndex>& dropped, std::string& error) {
+    for (const DroppedIndex& index : dropped) {
+        if (sqlite3_exec(db, index.sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+            error = sqlite3_errmsg(db);
+            return false;
+        }
+    }
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "INSERT INTO sqlite_stat1 (tbl, idx, stat) VALUES ('Node', ?, ?)", -1, &stmt, NULL) !=
+        SQLITE_OK) {
+        return true; // nothing to restore
+    }
+    for (const DroppedIndex& index : dropped) {
+        if (index.stat.empty()) continue;
+        sqlite3_bind_text(stmt, 1, index.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, index.stat.c_str(), -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+void CommitShallowBranch(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* shallowBranch = (const char*)sqlite3_value_text(argv[0]);
+    const char* targetBranch = (const char*)sqlite3_value_text(argv[1]);
+    if (!shallowBranch || !targetBranch) {
+        sqlite3_result_error(context, "shallowBranch and targetBranch are required", -1);
+        return;
+    }
+
+    std::vector<std::string> projectNames;
+    std::string error;
+    if (!ParseProjectNames((const char*)sqlite3_value_text(argv[2]), projectNames, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+
+    sqlite3_stmt* count = nullptr;
+    sqlite3_stmt* select = nullptr;
+    sqlite3_stmt* remove = nullptr;
+    sqlite3_stmt* promote = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT count(*), strftime('%Y-%m-%dT%H:%M:%f+00:00', 'now') FROM Node WHERE branch = ?",
+                           -1, &count, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT rowid, projectId FROM Node WHERE projectName = ? AND branch = ?",
+                           -1, &select, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "DELETE FROM Node WHERE rowid = ?", -1, &remove, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "UPDATE Node SET branch = ?1, updatedAt = ?2 WHERE rowid = ?3",
+                           -1, &promote, NULL) != SQLITE_OK) {
+        sqlite3_result_error(context, sqlite3_errmsg(db), -1);
+        sqlite3_finalize(count);
+        sqlite3_finalize(select);
+        sqlite3_finalize(remove);
+        return;
+    }
+
+    int previousCache = QueryInt(db, "PRAGMA cache_size", -2000);
+    int previousCacheKiB = previousCache < 0 ? -previousCache : previousCache * 4; // assume 4 KiB pages
+    if (previousCacheKiB < CommitCacheKiB) {
+        sqlite3_exec(db, ("PRAGMA cache_size = -" + std::to_string(CommitCacheKiB)).c_str(), NULL, NULL, NULL);
+    }
+
+    sqlite3_exec(db, "SAVEPOINT dms_commit_shallow", NULL, NULL, NULL);
+
+    int committed = 0;
+    std::string timestamp;
+    std::set<std::string> projectIds;
+    std::vector<sqlite3_int64> removed, promoted;
+
+    sqlite3_bind_text(count, 1, shallowBranch, -1, SQLITE_STATIC);
+    if (sqlite3_step(count) == SQLITE_ROW) {
+        committed = sqlite3_column_int(count, 0);
+        timestamp = (const char*)sqlite3_column_text(count, 1);
+    }
+    sqlite3_reset(count);
+    if (committed == 0) error = "No staged nodes found to commit.";
+
+    // Everything is read before the first write, while the indexes are there
+    for (size_t i = 0; error.empty() && i < projectNames.size(); ++i) {
+        if (!CollectRows(select, projectNames[i], targetBranch, removed, projectIds) ||
+            !CollectRows(select, projectNames[i], shallowBranch, promoted, projectIds)) {
+            error = sqlite3_errmsg(db);
+        }
+    }
+    std::sort(removed.begin(), removed.end());
+    std::sort(promoted.begin(), promoted.end());
+
+    std::vector<DroppedIndex> dropped;
+    size_t rows = removed.size() + promoted.size();
+    bool bulk = error.empty() && rows * BulkRebuildDivisor > (size_t)QueryInt(db, "SELECT count(*) FROM Node", 0);
+    if (bulk) DropNodeIndexes(db, dropped, error);
+
+    // Deleting cascades into Connection for the replaced nodes
+    if (error.empty() && WriteRows(db, remove, 1, removed, error)) {
+        sqlite3_bind_text(promote, 1, targetBranch, -1, SQLITE_STATIC);
+        sqlite3_bind_text(promote, 2, timestamp.c_str(), -1, SQLITE_STATIC);
+        WriteRows(db, promote, 3, promoted, error);
+    }
+    if (bulk && error.empty()) RecreateNodeIndexes(db, dropped, error);
+    sqlite3_finalize(count);
+    sqlite3_finalize(select);
+    sqlite3_finalize(remove);
+    sqlite3_finalize(promote);
+
+    if (error.empty()) {
+        sqlite3_exec(db, "RELEASE dms_commit_shallow", NULL, NULL, NULL);
+    } else {
+        sqlite3_exec(db, "ROLLBACK TO dms_commit_shallow; RELEASE dms_commit_shallow", NULL, NULL, NULL);
+    }
+    if (previousCacheKiB < CommitCacheKiB) {
+        sqlite3_exec(db, ("PRAGMA cache_size = " + std::to_string(previousCache)).c_str(), NULL, NULL, NULL);
+    }
+
+    if (!error.empty()) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    std::string json = "{\"committedNodes\":" + std::to_string(committed) +
+                       ",\"deletedNodes\":" + std::to_string(removed.size()) + ",\"projectIds\":[";
+    bool first = true;
+    for (const std::string& id : projectIds) {
+        if (!first) json += ',';
+        first = false;
+        json += '"';
+        json += id; // cuids never need escaping
+        json += '"';
+    }
+    json += "]}";
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// dms_commit_shallow(shallowBranch, targetBranch, projectNamesJson) - promotes
+// staged nodes to targetBranch, replacing the target's nodes for the listed
+// projects. Returns {"committedNodes":n,"deletedNodes":n,"projectIds":[...]}.
+void CommitShallowBranch(sqlite3_context* context, int argc, sqlite3_value** argv);
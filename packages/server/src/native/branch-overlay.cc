@@ -0,0 +1,583 @@
+#include "branch-overlay.h"
+
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include "db-state.h"
+#include "graph.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Branch Store ---
+//
+// Node and Connection rows are duplicated per branch, so every branch-wide
+// builder used to read the whole branch (and the whole Connection table) on
+// each call. The store keeps branches resident as segments instead and asks
+// the result cache which (branch, project) slots were written since a
+// segment was read; only those are read again, through the
+// (projectId, branch, ...) unique index and the fromKey index. A first load,
+// or one after writes to many projects, reads the branch in a single pass.
+//
+// A freshly read segment is interned by its digest. When an identical one is
+// already resident (the same project on the base branch, or an unchanged
+// re-upload) that one is shared and the new copy dropped, so memory grows
+// with the overlays rather than with the number of branches. Segments name
+// connection targets by project and node identity, never by rowid, which is
+// what makes them comparable across branches.
+
+static const size_t MaxResidentBranches = 32; // least recently used branches beyond this are dropped
+static const size_t BulkReadDivisor = 4;      // read the whole branch at once when 1/4 of its projects are stale
+
+struct ResidentProject {
+    std::shared_ptr<const ProjectSegment> segment;
+    uint64_t generation;
+};
+
+struct ResidentBranch {
+    std::unordered_map<std::string, ResidentProject> projects; // by projectId
+    uint64_t global = 0;
+    uint64_t lastUsed = 0;
+};
+
+struct BranchStore {
+    std::mutex mutex; // guards everything below
+    std::unordered_map<std::string, ResidentBranch> branches;
+    std::unordered_map<uint64_t, std::weak_ptr<const ProjectSegment>> segments; // by digest
+    uint64_t clock = 0;
+    uint64_t loads = 0;  // segments read from the database
+    uint64_t shared = 0; // reads that found an identical segment resident
+};
+
+static BranchStore& GetBranchStore(DatabaseState& state) {
+    static std::mutex createMutex;
+    BranchStore* store = state.branchStore.load(std::memory_order_acquire);
+    if (store) return *store;
+
+    std::lock_guard<std::mutex> lock(createMutex);
+    store = state.branchStore.load();
+    if (!store) {
+        store = new BranchStore();
+        state.branchStore.store(store, std::memory_order_release);
+    }
+    return *store;
+}
+
+// --- Segments ---
+
+static uint64_t Mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t HashString(uint64_t h, const std::string& s) {
+    h ^= 0xCBF29CE484222325ULL; // FNV-1a, chained
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    return Mix64(h ^ s.size());
+}
+
+static uint64_t HashInt(uint64_t h, uint64_t v) {
+    return Mix64(h ^ v);
+}
+
+bool SegmentNode::operator==(const SegmentNode& o) const {
+    return startLine == o.startLine && startColumn == o.startColumn && endLine == o.endLine &&
+           endColumn == o.endColumn && name == o.name && type == o.type && relativePath == o.relativePath &&
+           qlsVersion == o.qlsVersion;
+}
+
+uint64_t NodeIdentity(const SegmentNode& node) {
+    uint64_t h = HashString(0, node.relativePath);
+    h = HashString(h, node.type);
+    h = HashString(h, node.name);
+    h = HashInt(h, (uint64_t)(uint32_t)node.startLine << 32 | (uint32_t)node.startColumn);
+    h = HashInt(h, (uint64_t)(uint32_t)node.endLine << 32 | (uint32_t)node.endColumn);
+    return HashString(h, node.qlsVersion);
+}
+
+int ProjectSegment::Find(uint64_t identity) const {
+    auto it = std::lower_bound(byIdentity.begin(), byIdentity.end(), std::make_pair(identity, (uint32_t)0));
+    return it != byIdentity.end() && it->first == identity ? (int)it->second : -1;
+}
+
+size_t ProjectSegment::Bytes() const {
+    size_t bytes = sizeof(ProjectSegment) + projectId.size() + projectName.size();
+    for (const SegmentNode& n : nodes) {
+        bytes += sizeof(SegmentNode) + n.relativePath.size() + n.type.size() + n.name.size() + n.qlsVersion.size();
+    }
+    for (const std::string& p : targetProjects) bytes += sizeof(std::string) + p.size();
+    return bytes + identities.size() * sizeof(uint64_t) + byIdentity.size() * sizeof(byIdentity[0]) +
+           edges.size() * sizeof(SegmentEdge);
+}
+
+static std::string ColumnText(sqlite3_stmt* stmt, int col) {
+    const char* text = (const char*)sqlite3_column_text(stmt, col);
+    return text ? text : "";
+}
+
+static void ReadSegmentNode(sqlite3_stmt* stmt, int col, SegmentNode& n) {
+    n.relativePath = ColumnText(stmt, col);
+    n.type = ColumnText(stmt, col + 1);
+    n.name = ColumnText(stmt, col + 2);
+    n.startLine = sqlite3_column_int(stmt, col + 3);
+    n.startColumn = sqlite3_column_int(stmt, col + 4);
+    n.endLine = sqlite3_column_int(stmt, col + 5);
+    n.endColumn = sqlite3_column_int(stmt, col + 6);
+    n.qlsVersion = ColumnText(stmt, col + 7);
+}
+
+static const char* NodeColumns = "relativePath, type, name, startLine, startColumn, endLine, endColumn, qlsVersion";
+
+// A segment while it is read: nodes in row order, edges against those rows
+struct SegmentReader {
+    std::shared_ptr<ProjectSegment> segment = std::make_shared<ProjectSegment>();
+    std::unordered_map<std::string, uint32_t> targetIndex;
+
+    void AddNode(sqlite3_stmt* stmt, int col, int projectNameCol) {
+        segment->nodes.emplace_back();
+        ReadSegmentNode(stmt, col, segment->nodes.back());
+        if (segment->projectName.empty()) segment->projectName = ColumnText(stmt, projectNameCol);
+    }
+
+    void AddEdge(uint32_t from, const std::string& toProject, uint64_t toIdentity) {
+        auto inserted = targetIndex.emplace(toProject, (uint32_t)segment->targetProjects.size());
+        if (inserted.second) segment->targetProjects.push_back(toProject);
+        segment->edges.push_back({ from, inserted.first->second, toIdentity });
+    }
+
+    // Rows come in whatever order the query produced, which differs per branch:
+    // sort nodes by the unique index columns and targets by id, then digest
+    std::shared_ptr<ProjectSegment> Finish() {
+        ProjectSegment& s = *segment;
+        std::vector<uint32_t> order(s.nodes.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        auto columns = [&](uint32_t i) {
+            const SegmentNode& n = s.nodes[i];
+            return std::tie(n.relativePath, n.type, n.name, n.startLine, n.startColumn, n.endLine, n.endColumn, n.qlsVersion);
+        };
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return columns(a) < columns(b); });
+        std::vector<uint32_t> position(order.size());
+        std::vector<SegmentNode> nodes;
+        nodes.reserve(order.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            position[order[i]] = i;
+            nodes.push_back(std::move(s.nodes[order[i]]));
+        }
+        s.nodes = std::move(nodes);
+
+        s.identities.clear();
+        s.byIdentity.clear();
+        for (uint32_t i = 0; i < s.nodes.size(); ++i) {
+            s.identities.push_back(NodeIdentity(s.nodes[i]));
+            s.byIdentity.push_back({ s.identities.back(), i });
+        }
+        std::sort(s.byIdentity.begin(), s.byIdentity.end());
+
+        std::vector<std::string> sorted = s.targetProjects;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<uint32_t> renumber(sorted.size());
+        for (uint32_t p = 0; p < sorted.size(); ++p) renumber[targetIndex[sorted[p]]] = p;
+        for (SegmentEdge& e : s.edges) {
+            e.from = position[e.from];
+            e.toProject = renumber[e.toProject];
+        }
+        s.targetProjects = std::move(sorted);
+        std::sort(s.edges.begin(), s.edges.end(), [](const SegmentEdge& a, const SegmentEdge& b) {
+            return std::tie(a.from, a.toProject, a.toIdentity) < std::tie(b.from, b.toProject, b.toIdentity);
+        });
+
+        uint64_t digest = HashString(HashString(0, s.projectId), s.projectName);
+        for (uint64_t identity : s.identities) digest = HashInt(digest, identity);
+        for (const std::string& p : s.targetProjects) digest = HashString(digest, p);
+        for (const SegmentEdge& e : s.edges) digest = HashInt(HashInt(HashInt(digest, e.from), e.toProject), e.toIdentity);
+        s.digest = digest;
+        return segment;
+    }
+};
+
+// One project through the (projectId, branch, ...) unique index, and its
+// connections by probing the fromKey index per node
+static bool ReadSegment(sqlite3* db, const std::string& branch, SegmentReader& reader, std::string& error) {
+    std::vector<sqlite3_int64> rowids;
+    sqlite3_stmt* stmt;
+    std::string sql = std::string("SELECT rowid, ") + NodeColumns + ", projectName FROM Node WHERE projectId = ? AND branch = ?";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, reader.segment->projectId.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        rowids.push_back(sqlite3_column_int64(stmt, 0));
+        reader.AddNode(stmt, 1, 9);
+    }
+    sqlite3_finalize(stmt);
+
+    sql = "SELECT T.projectId, T.relativePath, T.type, T.name, T.startLine, T.startColumn, T.endLine, T.endColumn, T.qlsVersion "
+          "FROM Connection C JOIN Node T ON T.rowid = C.toKey WHERE C.fromKey = ? AND T.branch = ?";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
+    SegmentNode target;
+    for (uint32_t i = 0; i < rowids.size(); ++i) {
+        sqlite3_bind_int64(stmt, 1, rowids[i]);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            ReadSegmentNode(stmt, 1, target);
+            reader.AddEdge(i, ColumnText(stmt, 0), NodeIdentity(target));
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+// Many projects at once (a first load): one pass over the branch's rows and
+// one over the Connection key index, as the per-node probes would cost more
+struct BranchRow {
+    uint32_t project; // index into the projectIds of ReadBranchSegments
+    uint32_t node;    // index into the reader's nodes, if the project is read
+    uint64_t identity;
+    SegmentReader* reader;
+};
+
+static bool ReadBranchSegments(sqlite3* db, const std::string& branch, std::vector<SegmentReader>& readers,
+                               std::string& error) {
+    std::unordered_map<std::string, uint32_t> projectIndex;
+    std::vector<std::string> projectIds;
+    std::unordered_map<std::string, SegmentReader*> readerOf;
+    for (SegmentReader& reader : readers) readerOf.emplace(reader.segment->projectId, &reader);
+
+    std::unordered_map<sqlite3_int64, BranchRow> rows;
+    sqlite3_stmt* stmt;
+    std::string sql = std::string("SELECT rowid, projectId, ") + NodeColumns + ", projectName FROM Node WHERE branch = ?";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    SegmentNode node;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        std::string projectId = ColumnText(stmt, 1);
+        auto p = projectIndex.emplace(projectId, (uint32_t)projectIds.size());
+        if (p.second) projectIds.push_back(projectId);
+        BranchRow row{ p.first->second, 0, 0, nullptr };
+        auto r = readerOf.find(projectId);
+        if (r != readerOf.end()) {
+            row.reader = r->second;
+            row.node = (uint32_t)row.reader->segment->nodes.size();
+            row.reader->AddNode(stmt, 2, 10);
+            row.identity = NodeIdentity(row.reader->segment->nodes.back());
+        } else {
+            ReadSegmentNode(stmt, 2, node);
+            row.identity = NodeIdentity(node);
+        }
+        rows.emplace(sqlite3_column_int64(stmt, 0), row);
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db, "SELECT fromKey, toKey FROM Connection", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto from = rows.find(sqlite3_column_int64(stmt, 0));
+        if (from == rows.end() || !from->second.reader) continue;
+        auto to = rows.find(sqlite3_column_int64(stmt, 1));
+        if (to == rows.end()) continue;
+        from->second.reader->AddEdge(from->second.node, projectIds[to->second.project], to->second.identity);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+static bool SameContent(const ProjectSegment& a, const ProjectSegment& b) {
+    return a.projectId == b.projectId && a.projectName == b.projectName && a.nodes == b.nodes &&
+           a.targetProjects == b.targetProjects && a.edges == b.edges;
+}
+
+// Called with store.mutex held
+static std::shared_ptr<const ProjectSegment> Intern(BranchStore& store, std::shared_ptr<const ProjectSegment> segment) {
+    store.loads++;
+    std::weak_ptr<const ProjectSegment>& pooled = store.segments[segment->digest];
+    if (auto existing = pooled.lock()) {
+        if (SameContent(*existing, *segment)) {
+            store.shared++;
+            return existing;
+        }
+        return segment; // digest collision: keep both, the pool keeps pointing at the first
+    }
+    pooled = segment;
+    return segment;
+}
+
+// Called with store.mutex held
+static void EvictBranches(BranchStore& store) {
+    if (store.branches.size() <= MaxResidentBranches) return;
+    while (store.branches.size() > MaxResidentBranches) {
+        auto oldest = store.branches.begin();
+        for (auto it = store.branches.begin(); it != store.branches.end(); ++it) {
+            if (it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        store.branches.erase(oldest);
+    }
+    for (auto it = store.segments.begin(); it != store.segments.end();) {
+        it = it->second.expired() ? store.segments.erase(it) : std::next(it);
+    }
+}
+
+// --- Branch Graph ---
+
+int BranchGraph::SegmentOf(int vertex) const {
+    return (int)(std::upper_bound(offsets.begin(), offsets.end(), vertex) - offsets.begin()) - 1;
+}
+
+const SegmentNode& BranchGraph::Node(int vertex) const {
+    int s = SegmentOf(vertex);
+    return segments[s]->nodes[vertex - offsets[s]];
+}
+
+bool LoadBranchGraph(sqlite3* db, const std::string& branch, BranchGraph& graph, std::string& error) {
+    graph = BranchGraph();
+    std::vector<ProjectGeneration> projects;
+    uint64_t global = 0;
+    if (!ResultCacheBranchProjects(db, branch, projects, global)) return false;
+    std::sort(projects.begin(), projects.end(),
+              [](const ProjectGeneration& a, const ProjectGeneration& b) { return a.projectId < b.projectId; });
+
+    BranchStore& store = GetBranchStore(GetDatabaseState(db));
+    graph.segments.resize(projects.size());
+    std::vector<size_t> stale;
+    {
+        std::lock_guard<std::mutex> lock(store.mutex);
+        ResidentBranch& resident = store.branches[branch];
+        resident.lastUsed = ++store.clock;
+        if (resident.global != global) resident.projects.clear();
+        for (size_t i = 0; i < projects.size(); ++i) {
+            auto it = resident.projects.find(projects[i].projectId);
+            if (it != resident.projects.end() && it->second.generation == projects[i].generation) {
+                graph.segments[i] = it->second.segment;
+            } else {
+                stale.push_back(i);
+            }
+        }
+    }
+
+    // Read outside the lock; other connections keep using the store meanwhile
+    std::vector<SegmentReader> readers(stale.size());
+    for (size_t k = 0; k < stale.size(); ++k) readers[k].segment->projectId = projects[stale[k]].projectId;
+    if (stale.size() * BulkReadDivisor >= projects.size() && !stale.empty()) {
+        if (!ReadBranchSegments(db, branch, readers, error)) return false;
+    } else {
+        for (SegmentReader& reader : readers) {
+            if (!ReadSegment(db, branch, reader, error)) return false;
+        }
+    }
+    std::vector<std::shared_ptr<const ProjectSegment>> read;
+    for (SegmentReader& reader : readers) read.push_back(reader.Finish());
+
+    {
+        std::lock_guard<std::mutex> lock(store.mutex);
+        for (size_t k = 0; k < stale.size(); ++k) graph.segments[stale[k]] = Intern(store, read[k]);
+
+        ResidentBranch& resident = store.branches[branch];
+        resident.lastUsed = ++store.clock;
+        resident.global = global;
+        resident.projects.clear();
+        for (size_t i = 0; i < projects.size(); ++i) {
+            resident.projects[projects[i].projectId] = { graph.segments[i], projects[i].generation };
+        }
+        EvictBranches(store);
+    }
+
+    std::unordered_map<std::string, int> segmentOf;
+    graph.offsets.push_back(0);
+    for (size_t s = 0; s < graph.segments.size(); ++s) {
+        segmentOf.emplace(graph.segments[s]->projectId, (int)s);
+        graph.offsets.push_back(graph.offsets.back() + (int)graph.segments[s]->nodes.size());
+    }
+    for (size_t s = 0; s < graph.segments.size(); ++s) {
+        const ProjectSegment& segment = *graph.segments[s];
+        std::vector<int> targetSegment(segment.targetProjects.size(), -1);
+        for (size_t p = 0; p < segment.targetProjects.size(); ++p) {
+            auto it = segmentOf.find(segment.targetProjects[p]);
+            if (it != segmentOf.end()) targetSegment[p] = it->second;
+        }
+        for (const SegmentEdge& e : segment.edges) {
+            int t = targetSegment[e.toProject];
+            if (t < 0) continue;
+            int to = graph.segments[t]->Find(e.toIdentity);
+            if (to >= 0) graph.edges.push_back({ graph.offsets[s] + (int)e.from, graph.offsets[t] + to });
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> BranchNodeIds(sqlite3* db, const std::string& branch, const BranchGraph& graph,
+                                       const std::vector<int>& vertices) {
+    std::vector<std::string> ids(vertices.size());
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT id FROM Node WHERE projectId = ? AND branch = ? AND relativePath = ? AND type = ? "
+                           "AND name = ? AND startLine = ? AND startColumn = ? AND endLine = ? AND endColumn = ? AND qlsVersion = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return ids;
+    }
+    sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const ProjectSegment& segment = *graph.segments[graph.SegmentOf(vertices[i])];
+        const SegmentNode& n = graph.Node(vertices[i]);
+        sqlite3_bind_text(stmt, 1, segment.projectId.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, n.relativePath.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, n.type.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 5, n.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 6, n.startLine);
+        sqlite3_bind_int(stmt, 7, n.startColumn);
+        sqlite3_bind_int(stmt, 8, n.endLine);
+        sqlite3_bind_int(stmt, 9, n.endColumn);
+        sqlite3_bind_text(stmt, 10, n.qlsVersion.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) ids[i] = ColumnText(stmt, 0);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return ids;
+}
+
+// --- Overlay ---
+
+struct OverlayDiff {
+    const ProjectSegment* segment; // either side, for the id and name
+    int addedNodes = 0, removedNodes = 0, addedEdges = 0, removedEdges = 0;
+};
+
+// Connection keys that survive renumbering: source identity, target project and identity
+static std::unordered_set<uint64_t> EdgeKeys(const ProjectSegment* segment) {
+    std::unordered_set<uint64_t> keys;
+    if (!segment) return keys;
+    for (const SegmentEdge& e : segment->edges) {
+        keys.insert(HashInt(HashString(HashInt(0, segment->identities[e.from]), segment->targetProjects[e.toProject]),
+                            e.toIdentity));
+    }
+    return keys;
+}
+
+static void CountMissing(const std::unordered_set<uint64_t>& from, const std::unordered_set<uint64_t>& in, int& count) {
+    for (uint64_t key : from) {
+        if (!in.count(key)) count++;
+    }
+}
+
+static OverlayDiff Diff(const ProjectSegment* base, const ProjectSegment* branch) {
+    OverlayDiff diff{ branch ? branch : base };
+    std::unordered_set<uint64_t> baseNodes, branchNodes;
+    if (base) baseNodes.insert(base->identities.begin(), base->identities.end());
+    if (branch) branchNodes.insert(branch->identities.begin(), branch->identities.end());
+    CountMissing(branchNodes, baseNodes, diff.addedNodes);
+    CountMissing(baseNodes, branchNodes, diff.removedNodes);
+
+    std::unordered_set<uint64_t> baseEdges = EdgeKeys(base), branchEdges = EdgeKeys(branch);
+    CountMissing(branchEdges, baseEdges, diff.addedEdges);
+    CountMissing(baseEdges, branchEdges, diff.removedEdges);
+    return diff;
+}
+
+void BranchOverlay(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* branch = (const char*)sqlite3_value_text(argv[0]);
+    const char* base = (const char*)sqlite3_value_text(argv[1]);
+    if (!branch || !base) {
+        sqlite3_result_error(context, "branch and base are required", -1);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    BranchGraph branchGraph, baseGraph;
+    std::string error;
+    if (!LoadBranchGraph(db, base, baseGraph, error) || !LoadBranchGraph(db, branch, branchGraph, error)) {
+        if (error.empty()) error = "branch_overlay needs the result cache to track writes, but it is disabled or busy";
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    // Both segment lists are in projectId order
+    std::vector<OverlayDiff> diffs;
+    int shared = 0;
+    size_t i = 0, j = 0;
+    while (i < baseGraph.segments.size() || j < branchGraph.segments.size()) {
+        const ProjectSegment* a = i < baseGraph.segments.size() ? baseGraph.segments[i].get() : nullptr;
+        const ProjectSegment* b = j < branchGraph.segments.size() ? branchGraph.segments[j].get() : nullptr;
+        int order = !a ? 1 : !b ? -1 : a->projectId.compare(b->projectId);
+        if (order < 0) {
+            diffs.push_back(Diff(a, nullptr));
+            i++;
+        } else if (order > 0) {
+            diffs.push_back(Diff(nullptr, b));
+            j++;
+        } else {
+            if (a == b) shared++;
+            else diffs.push_back(Diff(a, b));
+            i++;
+            j++;
+        }
+    }
+    std::sort(diffs.begin(), diffs.end(), [](const OverlayDiff& a, const OverlayDiff& b) {
+        if (a.segment->projectName != b.segment->projectName) return a.segment->projectName < b.segment->projectName;
+        return a.segment->projectId < b.segment->projectId;
+    });
+
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("branch"); jb.string(branch); jb.comma();
+    jb.key("base"); jb.string(base); jb.comma();
+    jb.key("sharedProjects"); jb.number(shared); jb.comma();
+    jb.key("projects");
+    jb.beginArray();
+    for (size_t k = 0; k < diffs.size(); ++k) {
+        if (k > 0) jb.comma();
+        const OverlayDiff& d = diffs[k];
+        jb.beginObject();
+            jb.key("projectId"); jb.string(d.segment->projectId); jb.comma();
+            jb.key("projectName"); jb.string(d.segment->projectName); jb.comma();
+            jb.key("addedNodes"); jb.number(d.addedNodes); jb.comma();
+            jb.key("removedNodes"); jb.number(d.removedNodes); jb.comma();
+            jb.key("addedEdges"); jb.number(d.addedEdges); jb.comma();
+            jb.key("removedEdges"); jb.number(d.removedEdges);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.endObject();
+    std::string json = jb.str();
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
+
+// --- Stats ---
+
+void BranchStoreStats(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    BranchStore& store = GetBranchStore(GetDatabaseState(sqlite3_context_db_handle(context)));
+    std::lock_guard<std::mutex> lock(store.mutex);
+
+    size_t projects = 0, bytes = 0;
+    std::unordered_set<const ProjectSegment*> distinct;
+    for (const auto& branch : store.branches) {
+        projects += branch.second.projects.size();
+        for (const auto& project : branch.second.projects) {
+            if (distinct.insert(project.second.segment.get()).second) bytes += project.second.segment->Bytes();
+        }
+    }
+    std::string json = "{\"branches\":" + std::to_string(store.branches.size()) +
+                       ",\"projects\":" + std::to_string(projects) +
+                       ",\"segments\":" + std::to_string(distinct.size()) +
+                       ",\"bytes\":" + std::to_string(bytes) +
+                       ",\"loads\":" + std::to_string(store.loads) +
+                       ",\"shared\":" + std::to_string(store.shared) + "}";
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sqlite3.h"
+
+// --- Branch Store ---
+//
+// A resident, copy-on-write view of branch graphs. Each branch is a list of
+// per-project segments; a segment holds the project's nodes in a
+// branch-independent form (no rowids or cuids) and their outgoing
+// connections by target identity. Segments are interned by content, so a
+// feature branch that re-uploaded main's projects unchanged shares them with
+// main, and only the projects that differ (the overlay) cost memory. After
+// the first load only projects whose rows or connections were written since
+// are read again.
+
+struct SegmentNode {
+    std::string relativePath;
+    std::string type;
+    std::string name;
+    int startLine = 0, startColumn = 0, endLine = 0, endColumn = 0;
+    std::string qlsVersion;
+
+    bool operator==(const SegmentNode& o) const;
+};
+
+struct SegmentEdge {
+    uint32_t from;       // index into nodes
+    uint32_t toProject;  // index into targetProjects
+    uint64_t toIdentity; // NodeIdentity of the target
+
+    bool operator==(const SegmentEdge& o) const {
+        return from == o.from && toProject == o.toProject && toIdentity == o.toIdentity;
+    }
+};
+
+struct ProjectSegment {
+    std::string projectId;
+    std::string projectName;
+    std::vector<SegmentNode> nodes;       // in (projectId, branch, ...) unique index order
+    std::vector<uint64_t> identities;     // NodeIdentity per node
+    std::vector<std::string> targetProjects;
+    std::vector<SegmentEdge> edges;       // by from, then target
+    std::vector<std::pair<uint64_t, uint32_t>> byIdentity; // (identity, node), sorted
+    uint64_t digest = 0;
+
+    // Index of the node with this identity, or -1
+    int Find(uint64_t identity) const;
+    size_t Bytes() const;
+};
+
+// Hash of the unique-index columns below (projectId, branch)
+uint64_t NodeIdentity(const SegmentNode& node);
+
+// A branch assembled from its segments. Vertices are numbered segment by
+// segment (segments in projectId order); edges only join nodes of the branch.
+struct BranchGraph {
+    std::vector<std::shared_ptr<const ProjectSegment>> segments;
+    std::vector<int> offsets;                // first vertex of each segment, plus the vertex count
+    std::vector<std::pair<int, int>> edges;  // (from, to) vertices
+
+    int VertexCount() const { return offsets.empty() ? 0 : offsets.back(); }
+    int SegmentOf(int vertex) const;
+    const SegmentNode& Node(int vertex) const;
+};
+
+// Builds branch from resident segments, reading only projects written since
+// they were loaded. False when the result cache is disabled or db reads an
+// older snapshot (see SnapshotCurrent), as changes can't be tracked then, and
+// callers fall back to SQL; also false, with error set, when a query fails.
+bool LoadBranchGraph(sqlite3* db, const std::string& branch, BranchGraph& graph, std::string& error);
+
+// Current cuids of the given vertices on branch, read through the unique index
+std::vector<std::string> BranchNodeIds(sqlite3* db, const std::string& branch, const BranchGraph& graph,
+                                       const std::vector<int>& vertices);
+
+// branch_overlay(branch, base) - branch as base plus an overlay: projects
+// whose segment is shared with base are only counted, the others are diffed
+//   {"branch","base","sharedProjects",
+//    "projects":[{projectId,projectName,addedNodes,removedNodes,addedEdges,removedEdges}]}
+void BranchOverlay(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+// branch_store_stats() - {"branches","projects","segments","bytes","loads","shared"};
+// projects counts (branch, project) pairs, segments the distinct ones behind them
+void BranchStoreStats(sqlite3_context* context, int argc, sqlite3_value** argv);
@@ -0,0 +1,451 @@
+#include "centrality.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "branch-overlay.h"
+#include "graph.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Centrality ---
+//
+// The branch graph is loaded once into CSR arrays: dense vertex indices (in
+// branch store order, or Node rowid order when the store is unavailable), with the out- and in-neighbours of every vertex stored
+// contiguously. PageRank pulls over the in-edges, so each thread only writes
+// its own slice of the next rank vector and no atomics are needed.
+// Betweenness runs Brandes' algorithm from a fixed, seeded sample of sources,
+// spread over the threads with per-thread accumulators. Results go through the
+// result cache, so they are computed once per branch generation.
+
+static const int DefaultTopK = 50;
+static const int MaxTopK = 10000;
+static const double Damping = 0.85;
+static const double PageRankTolerance = 1e-6; // L1 change of the rank vector
+static const int PageRankMaxIterations = 100;
+static const int BetweennessSamples = 256;
+static const int ParallelMinVertices = 50000;
+static const unsigned MaxThreads = 8;
+
+struct CsrGraph {
+    std::vector<sqlite3_int64> keys; // vertex -> Node rowid; empty when built from the branch store
+    BranchGraph branch;              // the resident graph the vertices come from, if any
+    int vertexCount = 0;
+    std::vector<int> project;        // vertex -> index into projectIds
+    std::vector<char> listed;        // vertex passes the output filter
+    std::vector<std::string> projectIds;
+    std::vector<std::string> projectNames;
+    std::vector<int> outOffsets, outTargets; // outTargets[outOffsets[v]..outOffsets[v+1]]
+    std::vector<int> inOffsets, inSources;
+
+    int VertexCount() const { return vertexCount; }
+    int EdgeCount() const { return (int)outTargets.size(); }
+    int OutDegree(int v) const { return outOffsets[v + 1] - outOffsets[v]; }
+    int InDegree(int v) const { return inOffsets[v + 1] - inOffsets[v]; }
+};
+
+static unsigned ThreadCount(int vertices) {
+    if (vertices < ParallelMinVertices) return 1;
+    return std::max(1u, std::min(MaxThreads, std::thread::hardware_concurrency()));
+}
+
+// Runs fn(begin, end) over [0, n) split into one contiguous range per thread
+template <typename Fn>
+static void ParallelFor(int n, unsigned threads, Fn fn) {
+    if (threads <= 1 || n < (int)threads) {
+        fn(0, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    int chunk = (n + threads - 1) / threads;
+    for (int begin = 0; begin < n; begin += chunk) {
+        workers.emplace_back(fn, begin, std::min(n, begin + chunk));
+    }
+    for (std::thread& t : workers) t.join();
+}
+
+static void BuildOffsets(int n, const std::vector<std::pair<int, int>>& edges, bool bySource, std::vector<int>& offsets,
+                         std::vector<int>& targets) {
+    offsets.assign(n + 1, 0);
+    for (const auto& e : edges) offsets[(bySource ? e.first : e.second) + 1]++;
+    for (int v = 0; v < n; ++v) offsets[v + 1] += offsets[v];
+    targets.resize(edges.size());
+    std::vector<int> next(offsets.begin(), offsets.end() - 1);
+    for (const auto& e : edges) {
+        if (bySource) targets[next[e.first]++] = e.second;
+        else targets[next[e.second]++] = e.first;
+    }
+}
+
+// Vertices and edges from the resident branch store. False (with error empty)
+// when the store can't serve the branch, so the caller reads SQL instead.
+static bool LoadResidentCsrGraph(sqlite3* db, const std::string& branch, const TraversalFilter& filter, CsrGraph& g,
+                                 std::string& error) {
+    if (!LoadBranchGraph(db, branch, g.branch, error)) return false;
+
+    g.vertexCount = g.branch.VertexCount();
+    for (const auto& segment : g.branch.segments) {
+        int p = (int)g.projectIds.size();
+        g.projectIds.push_back(segment->projectId);
+        g.projectNames.push_back(segment->projectName);
+        bool excluded = filter.excludeProjects.count(segment->projectName) > 0;
+        for (const SegmentNode& node : segment->nodes) {
+            g.project.push_back(p);
+            g.listed.push_back(!excluded && (filter.nodeTypes.empty() || filter.nodeTypes.count(node.type) > 0));
+        }
+    }
+
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(g.branch.edges.size());
+    for (const auto& e : g.branch.edges) {
+        if (e.first != e.second) edges.push_back(e);
+    }
+    BuildOffsets(g.vertexCount, edges, true, g.outOffsets, g.outTargets);
+    BuildOffsets(g.vertexCount, edges, false, g.inOffsets, g.inSources);
+    return true;
+}
+
+static bool LoadCsrGraph(sqlite3* db, const std::string& branch, const TraversalFilter& filter, CsrGraph& g,
+                         std::string& error) {
+    if (LoadResidentCsrGraph(db, branch, filter, g, error)) return true;
+    if (!error.empty()) return false;
+    g = CsrGraph();
+
+    std::unordered_map<sqlite3_int64, int> vertexOf;
+    std::unordered_map<std::string, int> projectOf;
+    sqlite3_stmt* stmt;
+
+    std::string sql = "SELECT N.rowid, N.projectId, N.projectName, (1" + filter.ToSql("N") +
+                      ") FROM Node N WHERE N.branch = ? ORDER BY N.rowid";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        sqlite3_int64 key = sqlite3_column_int64(stmt, 0);
+        auto p = projectOf.emplace((const char*)sqlite3_column_text(stmt, 1), (int)g.projectIds.size());
+        if (p.second) {
+            g.projectIds.push_back(p.first->first);
+            g.projectNames.push_back((const char*)sqlite3_column_text(stmt, 2));
+        }
+        vertexOf.emplace(key, (int)g.keys.size());
+        g.keys.push_back(key);
+        g.project.push_back(p.first->second);
+        g.listed.push_back(sqlite3_column_int(stmt, 3) != 0);
+    }
+    sqlite3_finalize(stmt);
+    g.vertexCount = (int)g.keys.size();
+
+    std::vector<std::pair<int, int>> edges;
+    if (sqlite3_prepare_v2(db, "SELECT fromKey, toKey FROM Connection", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto from = vertexOf.find(sqlite3_column_int64(stmt, 0));
+        if (from == vertexOf.end()) continue;
+        auto to = vertexOf.find(sqlite3_column_int64(stmt, 1));
+        if (to == vertexOf.end() || from->second == to->second) continue;
+        edges.push_back({ from->second, to->second });
+    }
+    sqlite3_finalize(stmt);
+
+    int n = g.VertexCount();
+    BuildOffsets(n, edges, true, g.outOffsets, g.outTargets);
+    BuildOffsets(n, edges, false, g.inOffsets, g.inSources);
+    return true;
+}
+
+// --- Metrics ---
+
+static std::vector<double> InDegreeScores(const CsrGraph& g) {
+    std::vector<double> scores(g.VertexCount());
+    for (int v = 0; v < g.VertexCount(); ++v) scores[v] = g.InDegree(v);
+    return scores;
+}
+
+static std::vector<double> PageRankScores(const CsrGraph& g) {
+    int n = g.VertexCount();
+    std::vector<double> rank(n, n ? 1.0 / n : 0), next(n), contribution(n);
+    if (n == 0) return rank;
+    unsigned threads = ThreadCount(n);
+
+    for (int iteration = 0; iteration < PageRankMaxIterations; ++iteration) {
+        // Rank of vertices without out-edges is spread evenly over all vertices
+        double dangling = 0;
+        for (int v = 0; v < n; ++v) {
+            int degree = g.OutDegree(v);
+            if (degree == 0) dangling += rank[v];
+            contribution[v] = degree ? rank[v] / degree : 0;
+        }
+        double base = (1.0 - Damping) / n + Damping * dangling / n;
+
+        std::vector<double> delta(threads, 0);
+        std::atomic<unsigned> slot{ 0 };
+        ParallelFor(n, threads, [&](int begin, int end) {
+            double localDelta = 0;
+            for (int v = begin; v < end; ++v) {
+                double sum = 0;
+                for (int i = g.inOffsets[v]; i < g.inOffsets[v + 1]; ++i) sum += contribution[g.inSources[i]];
+                next[v] = base + Damping * sum;
+                localDelta += std::fabs(next[v] - rank[v]);
+            }
+            delta[slot++] = localDelta;
+        });
+        rank.swap(next);
+
+        double total = 0;
+        for (double d : delta) total += d;
+        if (total < PageRankTolerance) break;
+    }
+    return rank;
+}
+
+// Brandes over sampled sources, scaled by n / samples
+static std::vector<double> BetweennessScores(const CsrGraph& g) {
+    int n = g.VertexCount();
+    std::vector<double> scores(n, 0);
+    if (n == 0) return scores;
+
+    // Seeded so repeated calls rank the same graph identically
+    std::vector<int> sources(n);
+    for (int v = 0; v < n; ++v) sources[v] = v;
+    int samples = std::min(n, BetweennessSamples);
+    std::mt19937 rng(42);
+    for (int i = 0; i < samples; ++i) {
+        std::uniform_int_distribution<int> pick(i, n - 1);
+        std::swap(sources[i], sources[pick(rng)]);
+    }
+
+    unsigned threads = std::min<unsigned>(ThreadCount(n), samples);
+    std::vector<std::vector<double>> partial(threads);
+    // Samples are dealt to threads statically so the sums are reproducible
+    auto worker = [&](unsigned t) {
+        std::vector<double>& local = partial[t];
+        local.assign(n, 0);
+        std::vector<int> distance(n, -1), order, queue;
+        std::vector<double> paths(n, 0), dependency(n, 0);
+        order.reserve(n);
+        queue.reserve(n);
+        for (int s = (int)t; s < samples; s += (int)threads) {
+            int source = sources[s];
+            order.clear();
+            queue.clear();
+            distance[source] = 0;
+            paths[source] = 1;
+            queue.push_back(source);
+            for (size_t head = 0; head < queue.size(); ++head) {
+                int v = queue[head];
+                order.push_back(v);
+                for (int i = g.outOffsets[v]; i < g.outOffsets[v + 1]; ++i) {
+                    int w = g.outTargets[i];
+                    if (distance[w] < 0) {
+                        distance[w] = distance[v] + 1;
+                        queue.push_back(w);
+                    }
+                    if (distance[w] == distance[v] + 1) paths[w] += paths[v];
+                }
+            }
+            // Accumulate dependencies in reverse BFS order; predecessors are
+            // the in-neighbours one level closer to the source
+            for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                int w = *it;
+                for (int i = g.inOffsets[w]; i < g.inOffsets[w + 1]; ++i) {
+                    int v = g.inSources[i];
+                    if (distance[v] >= 0 && distance[v] == distance[w] - 1) {
+                        dependency[v] += paths[v] / paths[w] * (1 + dependency[w]);
+                    }
+                }
+                if (w != source) local[w] += dependency[w];
+            }
+            for (int v : order) {
+                distance[v] = -1;
+                paths[v] = 0;
+                dependency[v] = 0;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(worker, t);
+    worker(0);
+    for (std::thread& t : workers) t.join();
+
+    double scale = (double)n / samples;
+    for (const std::vector<double>& local : partial) {
+        for (int v = 0; v < n; ++v) scores[v] += local[v] * scale;
+    }
+    return scores;
+}
+
+// --- Output ---
+
+static void WriteScore(JsonBuilder& jb, double score) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", score);
+    jb.raw(buf);
+}
+
+static std::string KeyList(const std::vector<sqlite3_int64>& keys) {
+    std::string list;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i > 0) list += ",";
+        list += std::to_string(keys[i]);
+    }
+    return list;
+}
+
+static std::string BuildRanking(sqlite3* db, const CsrGraph& g, const std::string& metric, const std::string& branch,
+                                const std::vector<double>& scores, int topK) {
+    int n = g.VertexCount();
+
+    // Ties break on vertex index so the ranking is stable
+    auto byScore = [&](int a, int b) { return scores[a] != scores[b] ? scores[a] > scores[b] : a < b; };
+    std::vector<int> candidates;
+    for (int v = 0; v < n; ++v) {
+        if (g.listed[v]) candidates.push_back(v);
+    }
+    size_t top = std::min(candidates.size(), (size_t)topK);
+    std::partial_sort(candidates.begin(), candidates.begin() + top, candidates.end(), byScore);
+    candidates.resize(top);
+
+    std::vector<double> projectScores(g.projectIds.size(), 0);
+    for (int v = 0; v < n; ++v) projectScores[g.project[v]] += scores[v];
+    std::vector<int> projects(g.projectIds.size());
+    for (size_t p = 0; p < projects.size(); ++p) projects[p] = (int)p;
+    size_t topProjects = std::min(projects.size(), (size_t)topK);
+    std::partial_sort(projects.begin(), projects.begin() + topProjects, projects.end(), [&](int a, int b) {
+        return projectScores[a] != projectScores[b] ? projectScores[a] > projectScores[b] : g.projectNames[a] < g.projectNames[b];
+    });
+    projects.resize(topProjects);
+
+    // Node details are only read for the listed vertices
+    std::vector<sqlite3_int64> keys;
+    std::unordered_map<sqlite3_int64, GraphNode> details;
+    if (g.keys.empty()) {
+        // Resident vertices carry everything but the cuid
+        std::vector<std::string> ids = BranchNodeIds(db, branch, g.branch, candidates);
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const SegmentNode& node = g.branch.Node(candidates[i]);
+            GraphNode& d = details[candidates[i]];
+            d.id = ids[i];
+            d.name = node.name;
+            d.type = node.type;
+            d.relativePath = node.relativePath;
+            d.startLine = node.startLine;
+        }
+    } else {
+        for (int v : candidates) keys.push_back(g.keys[v]);
+    }
+    if (!keys.empty()) {
+        std::string sql = "SELECT rowid, id, name, type, relativePath, startLine FROM Node WHERE rowid IN (" + KeyList(keys) + ")";
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                GraphNode& d = details[sqlite3_column_int64(stmt, 0)];
+                d.id = (const char*)sqlite3_column_text(stmt, 1);
+                d.name = (const char*)sqlite3_column_text(stmt, 2);
+                d.type = (const char*)sqlite3_column_text(stmt, 3);
+                const char* path = (const char*)sqlite3_column_text(stmt, 4);
+                d.relativePath = path ? path : "";
+                d.startLine = sqlite3_column_int(stmt, 5);
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("metric"); jb.string(metric); jb.comma();
+    jb.key("branch"); jb.string(branch); jb.comma();
+    jb.key("nodeCount"); jb.number(n); jb.comma();
+    jb.key("edgeCount"); jb.number(g.EdgeCount()); jb.comma();
+    jb.key("nodes");
+    jb.beginArray();
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (i > 0) jb.comma();
+        int v = candidates[i];
+        const GraphNode& d = details[g.keys.empty() ? v : g.keys[v]];
+        jb.beginObject();
+            jb.key("id"); jb.string(d.id); jb.comma();
+            jb.key("name"); jb.string(d.name); jb.comma();
+            jb.key("type"); jb.string(d.type); jb.comma();
+            jb.key("projectId"); jb.string(g.projectIds[g.project[v]]); jb.comma();
+            jb.key("projectName"); jb.string(g.projectNames[g.project[v]]); jb.comma();
+            jb.key("relativePath"); jb.string(d.relativePath); jb.comma();
+            jb.key("startLine"); jb.number(d.startLine); jb.comma();
+            jb.key("score"); WriteScore(jb, scores[v]);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.comma();
+    jb.key("projects");
+    jb.beginArray();
+    for (size_t i = 0; i < projects.size(); ++i) {
+        if (i > 0) jb.comma();
+        int p = projects[i];
+        jb.beginObject();
+            jb.key("projectId"); jb.string(g.projectIds[p]); jb.comma();
+            jb.key("projectName"); jb.string(g.projectNames[p]); jb.comma();
+            jb.key("score"); WriteScore(jb, projectScores[p]);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.endObject();
+    return jb.str();
+}
+
+void RankNodes(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* branch = (const char*)sqlite3_value_text(argv[0]);
+    const char* metric = (const char*)sqlite3_value_text(argv[1]);
+    if (!branch || !metric) {
+        sqlite3_result_error(context, "branch and metric are required", -1);
+        return;
+    }
+    std::vector<double> (*compute)(const CsrGraph&) = nullptr;
+    if (strcmp(metric, "indegree") == 0) compute = InDegreeScores;
+    else if (strcmp(metric, "pagerank") == 0) compute = PageRankScores;
+    else if (strcmp(metric, "betweenness") == 0) compute = BetweennessScores;
+    else {
+        std::string error = std::string("unknown metric '") + metric + "', expected indegree, pagerank or betweenness";
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    int topK = DefaultTopK;
+    if (argc > 2 && sqlite3_value_type(argv[2]) != SQLITE_NULL) topK = sqlite3_value_int(argv[2]);
+    topK = std::max(1, std::min(topK, MaxTopK));
+
+    std::string rawFilter, error;
+    if (argc > 3 && sqlite3_value_type(argv[3]) != SQLITE_NULL) rawFilter = (const char*)sqlite3_value_text(argv[3]);
+    TraversalFilter filter;
+    if (!ParseTraversalFilter(rawFilter.c_str(), filter, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+    filter.branches.clear();
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::string key = ResultCacheKey("rank_nodes", { branch, metric, std::to_string(topK), rawFilter });
+    std::string json;
+    ResultCacheTicket ticket;
+    if (!ResultCacheLookup(db, key, json, ticket)) {
+        CsrGraph g;
+        if (!LoadCsrGraph(db, branch, filter, g, error)) {
+            sqlite3_result_error(context, error.c_str(), -1);
+            return;
+        }
+        json = BuildRanking(db, g, metric, branch, compute(g), topK);
+        ResultCacheStore(db, ticket, key, json, { branch });
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// rank_nodes(branch, metric [, topK [, filterJson]]) - the topK nodes of a
+// branch by metric ("indegree", "pagerank" or "betweenness"), computed over
+// the whole branch graph, plus projects ranked by the sum of their nodes'
+// scores. The filter (nodeTypes/excludeProjects) only selects which nodes are
+// listed, e.g. {"nodeTypes":["NamedExport"]} for the most depended-on exports.
+// Returns
+//   {"metric","branch","nodeCount","edgeCount",
+//    "nodes":[{id,name,type,projectId,projectName,relativePath,startLine,score}],
+//    "projects":[{projectId,projectName,score}]}
+// Betweenness is estimated from a fixed sample of BFS sources.
+void RankNodes(sqlite3_context* context, int argc, sqlite3_value** argv);
@@ -0,0 +1,236 @@
+#include "change-impact.h"
+
+#include <limits.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "graph.h"
+#include "json-reader.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Change Impact ---
+//
+// CI posts the line ranges of a merge request; the answer is every node whose
+// span overlaps a range (the seeds) and everything that reaches a seed through
+// Connection. Ranges are grouped per file so each file costs one probe of the
+// (projectId, branch, relativePath, ...) unique index; the overlap test is a
+// binary search over the file's merged, sorted ranges. All seeds then start a
+// single dependents-only traversal, so shared dependents are visited once
+// instead of once per changed node.
+
+static const int DefaultImpactDepth = 100;
+
+struct LineRange {
+    int start;
+    int end;
+};
+
+static bool ParseRanges(const char* json, std::map<std::string, std::vector<LineRange>>& files, std::string& error) {
+    JsonReader r(json ? std::string_view(json) : std::string_view());
+    auto fail = [&](const std::string& message) {
+        error = "ranges must be a JSON array of {relativePath, startLine, endLine}: " + message;
+        return false;
+    };
+    if (!r.expect('[')) return fail(r.error());
+    if (r.consume(']')) return true;
+    do {
+        if (!r.expect('{')) return fail(r.error());
+        std::string path;
+        bool hasPath = false;
+        double start = 0, end = (double)INT_MAX;
+        if (!r.consume('}')) {
+            do {
+                std::string key;
+                if (!r.readString(key) || !r.expect(':')) return fail(r.error());
+                if (key == "relativePath") {
+                    if (!r.readString(path)) return fail(r.error());
+                    hasPath = true;
+                } else if (key == "startLine" || key == "endLine") {
+                    double v = 0;
+                    if (r.consumeNull()) continue;
+                    if (!r.readNumber(v)) return fail(r.error());
+                    (key == "startLine" ? start : end) = v;
+                } else {
+                    std::string_view ignored;
+                    if (!r.readRaw(ignored)) return fail(r.error());
+                }
+            } while (r.consume(','));
+            if (!r.expect('}')) return fail(r.error());
+        }
+        if (!hasPath) return fail("relativePath is required");
+        if (end < start) return fail("endLine is before startLine in " + path);
+        files[path].push_back({ (int)std::max(start, 0.0), (int)std::min(end, (double)INT_MAX) });
+    } while (r.consume(','));
+    if (!r.expect(']')) return fail(r.error());
+
+    // Sorted and merged, so the ranges of a file are disjoint and ordered
+    for (auto& entry : files) {
+        std::vector<LineRange>& ranges = entry.second;
+        std::sort(ranges.begin(), ranges.end(), [](const LineRange& a, const LineRange& b) { return a.start < b.start; });
+        std::vector<LineRange> merged;
+        for (const LineRange& range : ranges) {
+            if (!merged.empty() && range.start <= merged.back().end) {
+                merged.back().end = std::max(merged.back().end, range.end);
+            } else {
+                merged.push_back(range);
+            }
+        }
+        ranges.swap(merged);
+    }
+    return true;
+}
+
+static bool Overlaps(const std::vector<LineRange>& ranges, int startLine, int endLine) {
+    // Last range starting at or before endLine is the only candidate
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), endLine,
+                               [](int line, const LineRange& r) { return line < r.start; });
+    if (it == ranges.begin()) return false;
+    return std::prev(it)->end >= startLine;
+}
+
+static bool FindSeeds(sqlite3* db, const char* projectId, const char* branch,
+                      const std::map<std::string, std::vector<LineRange>>& files,
+                      std::vector<sqlite3_int64>& seeds, std::string& error) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT rowid, startLine, endLine FROM Node WHERE projectId = ? AND branch = ? AND relativePath = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, projectId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, branch, -1, SQLITE_STATIC);
+    for (const auto& entry : files) {
+        sqlite3_bind_text(stmt, 3, entry.first.c_str(), (int)entry.first.size(), SQLITE_STATIC);
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (Overlaps(entry.second, sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2))) {
+                seeds.push_back(sqlite3_column_int64(stmt, 0));
+            }
+        }
+        sqlite3_reset(stmt);
+        if (rc != SQLITE_DONE) {
+            error = sqlite3_errmsg(db);
+            sqlite3_finalize(stmt);
+            return false;
+        }
+    }
+    sqlite3_finalize(stmt);
+    std::sort(seeds.begin(), seeds.end());
+    return true;
+}
+
+struct AffectedNode {
+    GraphNode node;
+    int depth;
+};
+
+void ImpactOfChanges(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* projectId = (const char*)sqlite3_value_text(argv[0]);
+    const char* branch = (const char*)sqlite3_value_text(argv[1]);
+    if (!projectId || !branch) {
+        sqlite3_result_error(context, "projectId and branch are required", -1);
+        return;
+    }
+    int maxDepth = DefaultImpactDepth;
+    if (argc > 3 && sqlite3_value_type(argv[3]) != SQLITE_NULL) maxDepth = sqlite3_value_int(argv[3]);
+    if (maxDepth < 0) maxDepth = 0;
+
+    std::map<std::string, std::vector<LineRange>> files;
+    std::string error;
+    if (!ParseRanges((const char*)sqlite3_value_text(argv[2]), files, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::vector<sqlite3_int64> seeds;
+    if (!FindSeeds(db, projectId, branch, files, seeds, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    // projectName -> affected nodes; std::map keeps the output order stable
+    std::map<std::string, std::vector<AffectedNode>> byProject;
+    std::vector<std::string> seedIds;
+    int nodeCount = 0;
+    if (!seeds.empty()) {
+        NodeTraversal traversal(db, seeds, maxDepth, TraversalDirection::Incoming);
+        std::vector<GraphNode> nodes;
+        std::vector<GraphConnection> connections;
+        while (traversal.Next(nodes, connections)) {
+            int depth = traversal.Depth();
+            for (GraphNode& n : nodes) {
+                if (depth == 0) seedIds.push_back(n.id);
+                byProject[n.projectName].push_back({ std::move(n), depth });
+                nodeCount++;
+            }
+        }
+    }
+
+    sqlite3_stmt* projectStmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT projectId FROM Node WHERE rowid = ?", -1, &projectStmt, NULL);
+
+    JsonBuilder json;
+    json.beginObject();
+    json.key("seeds");
+    json.beginArray();
+    for (size_t i = 0; i < seedIds.size(); ++i) {
+        if (i > 0) json.comma();
+        json.string(seedIds[i]);
+    }
+    json.endArray();
+    json.comma();
+    json.key("nodeCount");
+    json.number(nodeCount);
+    json.comma();
+    json.key("projects");
+    json.beginArray();
+    bool firstProject = true;
+    for (const auto& entry : byProject) {
+        const std::vector<AffectedNode>& affected = entry.second;
+        std::string affectedProjectId;
+        if (projectStmt) {
+            sqlite3_bind_int64(projectStmt, 1, affected.front().node.key);
+            if (sqlite3_step(projectStmt) == SQLITE_ROW) {
+                affectedProjectId = (const char*)sqlite3_column_text(projectStmt, 0);
+            }
+            sqlite3_reset(projectStmt);
+        }
+
+        if (!firstProject) json.comma();
+        firstProject = false;
+        json.beginObject();
+        json.key("projectId");
+        json.string(affectedProjectId);
+        json.comma();
+        json.key("projectName");
+        json.string(entry.first);
+        json.comma();
+        json.key("nodes");
+        json.beginArray();
+        for (size_t i = 0; i < affected.size(); ++i) {
+            const GraphNode& n = affected[i].node;
+            if (i > 0) json.comma();
+            json.beginObject();
+            json.key("id"); json.string(n.id); json.comma();
+            json.key("name"); json.string(n.name); json.comma();
+            json.key("type"); json.string(n.type); json.comma();
+            json.key("relativePath"); json.string(n.relativePath); json.comma();
+            json.key("startLine"); json.number(n.startLine); json.comma();
+            json.key("depth"); json.number(affected[i].depth);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    sqlite3_finalize(projectStmt);
+
+    std::string result = json.str();
+    sqlite3_result_text(context, result.c_str(), (int)result.size(), SQLITE_TRANSIENT);
+}
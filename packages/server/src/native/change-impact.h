@@ -0,0 +1,11 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// impact_of_changes(projectId, branch, rangesJson [, depth]) - nodes of one
+// project/branch touched by a diff, plus everything that transitively depends
+// on them, grouped by project. rangesJson is
+// [{"relativePath":"src/a.ts","startLine":10,"endLine":20}, ...]; a range
+// without lines covers the whole file. Returns
+// {"seeds":[ids],"nodeCount":n,"projects":[{"projectId","projectName","nodes":[...]}]}.
+void ImpactOfChanges(sqlite3_context* context, int argc, sqlite3_value** argv);
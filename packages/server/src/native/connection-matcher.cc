@@ -0,0 +1,300 @@
+#include "connection-matcher.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Connection Matcher ---
+//
+// The connection rules used to run as four INSERT OR IGNORE ... SELECT
+// self-joins of Node, one after the other, each planned on its own and each
+// holding the write lock while it searched. Here the join columns of every
+// relevant node are read in a single scan and turned into rule-tagged join
+// keys (the branch is part of every key). Keys are hash-partitioned, so both
+// sides of a match always land in the same partition, and the partitions are
+// matched on a pool of threads with no shared state. Only the final insert
+// of the de-duplicated pairs, sorted by fromKey, runs as a write.
+
+static const int PartitionCount = 64;
+static const size_t ParallelMinKeys = 50000;
+static const unsigned MaxThreads = 8;
+static const int InsertCacheKiB = 64 * 1024; // keeps both Connection indexes resident while inserting
+static const size_t InsertBatchRows = 128;    // rows per INSERT, each execution opens a statement journal
+
+static const char* const MatchedTypes =
+    "'NamedImport','NamedExport','RuntimeDynamicImport','DynamicModuleFederationReference',"
+    "'GlobalVarRead','GlobalVarWrite','WebStorageRead','WebStorageWrite',"
+    "'EventOn','EventEmit','UrlParamRead','UrlParamWrite'";
+
+// Read/write pairs joined on name alone
+struct NameRule {
+    const char* from;
+    const char* to;
+};
+
+static const NameRule NameRules[] = {
+    { "GlobalVarRead", "GlobalVarWrite" },
+    { "WebStorageRead", "WebStorageWrite" },
+    { "EventOn", "EventEmit" },
+    { "UrlParamRead", "UrlParamWrite" },
+};
+
+struct MatchNode {
+    sqlite3_int64 rowid;
+    uint32_t project; // interned projectName
+};
+
+struct JoinKey {
+    uint64_t hash;
+    uint32_t node;
+    std::string key;
+
+    bool operator<(const JoinKey& o) const { return hash != o.hash ? hash < o.hash : key < o.key; }
+};
+
+struct Partition {
+    std::vector<JoinKey> sources; // connection sources (imports, reads)
+    std::vector<JoinKey> targets; // connection targets (exports, writes)
+};
+
+static uint64_t HashKey(const std::string& key) {
+    uint64_t h = 0xCBF29CE484222325ULL; // FNV-1a, then a splitmix finalizer
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    h += 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+// Parts are joined with NUL, which column text never contains. A NULL part
+// never matches, as with SQL equality.
+static void AddKey(std::vector<Partition>& partitions, bool source, uint32_t node,
+                   std::initializer_list<const char*> parts) {
+    std::string key;
+    for (const char* part : parts) {
+        if (!part) return;
+        key += part;
+        key += '\0';
+    }
+    uint64_t hash = HashKey(key);
+    Partition& p = partitions[hash % partitions.size()];
+    (source ? p.sources : p.targets).push_back({ hash, node, std::move(key) });
+}
+
+static const char* Text(sqlite3_stmt* stmt, int col) {
+    return (const char*)sqlite3_column_text(stmt, col);
+}
+
+// Reads the join columns of one branch (or all) and fills the partitions
+static bool ScanNodes(sqlite3* db, const char* branch, std::vector<MatchNode>& nodes,
+                      std::vector<Partition>& partitions, std::string& error) {
+    std::string sql = std::string("SELECT rowid, branch, type, projectName, name, import_pkg, import_name, "
+                                  "import_subpkg, export_entry FROM Node WHERE type IN (") + MatchedTypes + ")";
+    if (branch) sql += " AND branch = ?";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    if (branch) sqlite3_bind_text(stmt, 1, branch, -1, SQLITE_STATIC);
+
+    std::unordered_map<std::string, uint32_t> projects;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        uint32_t n = (uint32_t)nodes.size();
+        const char* projectName = Text(stmt, 3);
+        auto project = projects.emplace(projectName ? projectName : "", (uint32_t)projects.size());
+        nodes.push_back({ sqlite3_column_int64(stmt, 0), project.first->second });
+
+        const char* nodeBranch = Text(stmt, 1);
+        const char* type = Text(stmt, 2);
+        const char* name = Text(stmt, 4);
+        const char* pkg = Text(stmt, 5);
+        const char* importName = Text(stmt, 6);
+        const char* subpkg = Text(stmt, 7);
+        const char* entry = Text(stmt, 8);
+        if (!type) continue;
+
+        if (strcmp(type, "NamedExport") == 0) {
+            AddKey(partitions, false, n, { "import", nodeBranch, projectName, name });
+            AddKey(partitions, false, n, { "dynamic", nodeBranch, projectName, entry, name });
+            AddKey(partitions, false, n, { "federation", nodeBranch, projectName, entry });
+        } else if (strcmp(type, "NamedImport") == 0) {
+            AddKey(partitions, true, n, { "import", nodeBranch, pkg, importName });
+        } else if (strcmp(type, "RuntimeDynamicImport") == 0) {
+            AddKey(partitions, true, n, { "dynamic", nodeBranch, pkg, subpkg, importName });
+            // A 'Nil' subpackage is the package's index entry
+            if (subpkg && strcmp(subpkg, "Nil") == 0) {
+                AddKey(partitions, true, n, { "dynamic", nodeBranch, pkg, "index", importName });
+            }
+        } else if (strcmp(type, "DynamicModuleFederationReference") == 0) {
+            AddKey(partitions, true, n, { "federation", nodeBranch, pkg, importName });
+        } else {
+            for (const NameRule& rule : NameRules) {
+                if (strcmp(type, rule.from) == 0) AddKey(partitions, true, n, { rule.from, nodeBranch, name });
+                else if (strcmp(type, rule.to) == 0) AddKey(partitions, false, n, { rule.from, nodeBranch, name });
+            }
+        }
+    }
+    if (rc != SQLITE_DONE) error = sqlite3_errmsg(db);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// Cross-project (source, target) node pairs of one partition
+static void MatchPartition(Partition& p, const std::vector<MatchNode>& nodes,
+                           std::vector<std::pair<uint32_t, uint32_t>>& pairs) {
+    std::sort(p.targets.begin(), p.targets.end());
+    for (const JoinKey& source : p.sources) {
+        auto range = std::equal_range(p.targets.begin(), p.targets.end(), source);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (nodes[source.node].project != nodes[it->node].project) pairs.push_back({ source.node, it->node });
+        }
+    }
+    p = Partition(); // keys are no longer needed
+}
+
+static unsigned ThreadCount(size_t keys) {
+    if (keys < ParallelMinKeys) return 1;
+    return std::max(1u, std::min(MaxThreads, std::thread::hardware_concurrency()));
+}
+
+// INSERT OR IGNORE of rows (fromKey, toKey) pairs
+static bool PrepareInsert(sqlite3* db, size_t rows, sqlite3_stmt*& stmt) {
+    std::string sql = "INSERT OR IGNORE INTO Connection (fromKey, toKey) VALUES ";
+    for (size_t i = 0; i < rows; ++i) sql += i > 0 ? ",(?,?)" : "(?,?)";
+    return sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK;
+}
+
+static int QueryInt(sqlite3* db, const char* sql, int fallback) {
+    sqlite3_stmt* stmt;
+    int value = fallback;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string Number(double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", value);
+    return buf;
+}
+
+void MatchConnections(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* branch = argc > 0 ? (const char*)sqlite3_value_text(argv[0]) : nullptr;
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::string error;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<MatchNode> nodes;
+    std::vector<Partition> partitions(PartitionCount);
+    if (!ScanNodes(db, branch, nodes, partitions, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+    double scanMs = ElapsedMs(start);
+
+    // Partitions are claimed one at a time, as their sizes follow the key skew
+    start = std::chrono::steady_clock::now();
+    size_t keys = 0;
+    for (const Partition& p : partitions) keys += p.sources.size() + p.targets.size();
+    unsigned threads = ThreadCount(keys);
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> found(threads);
+    std::atomic<int> next{ 0 };
+    auto worker = [&](unsigned t) {
+        for (int i; (i = next.fetch_add(1)) < PartitionCount;) MatchPartition(partitions[i], nodes, found[t]);
+    };
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for (std::thread& t : pool) t.join();
+    }
+
+    std::vector<std::pair<sqlite3_int64, sqlite3_int64>> rows; // (fromKey, toKey)
+    for (const auto& pairs : found) {
+        for (const auto& p : pairs) rows.push_back({ nodes[p.first].rowid, nodes[p.second].rowid });
+    }
+    found.clear();
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    double matchMs = ElapsedMs(start);
+
+    // The only write: existing pairs are ignored by the (fromKey, toKey) key
+    start = std::chrono::steady_clock::now();
+    int previousCache = QueryInt(db, "PRAGMA cache_size", -2000);
+    int previousCacheKiB = previousCache < 0 ? -previousCache : previousCache * 4; // assume 4 KiB pages
+    if (previousCacheKiB < InsertCacheKiB) {
+        sqlite3_exec(db, ("PRAGMA cache_size = -" + std::to_string(InsertCacheKiB)).c_str(), NULL, NULL, NULL);
+    }
+    sqlite3_exec(db, "SAVEPOINT dms_match_connections", NULL, NULL, NULL);
+    int created = 0;
+    sqlite3_stmt* insert = nullptr;
+    size_t prepared = 0; // rows per execution of insert
+    for (size_t begin = 0; begin < rows.size(); begin += InsertBatchRows) {
+        size_t count = std::min(rows.size() - begin, InsertBatchRows);
+        if (count != prepared) {
+            sqlite3_finalize(insert);
+            prepared = count;
+            if (!PrepareInsert(db, count, insert)) {
+                error = sqlite3_errmsg(db);
+                break;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            sqlite3_bind_int64(insert, (int)i * 2 + 1, rows[begin + i].first);
+            sqlite3_bind_int64(insert, (int)i * 2 + 2, rows[begin + i].second);
+        }
+        int rc = sqlite3_step(insert);
+        sqlite3_reset(insert);
+        if (rc != SQLITE_DONE) {
+            error = sqlite3_errmsg(db);
+            break;
+        }
+        created += sqlite3_changes(db);
+    }
+    sqlite3_finalize(insert);
+    if (error.empty()) {
+        sqlite3_exec(db, "RELEASE dms_match_connections", NULL, NULL, NULL);
+    } else {
+        sqlite3_exec(db, "ROLLBACK TO dms_match_connections; RELEASE dms_match_connections", NULL, NULL, NULL);
+    }
+    if (previousCacheKiB < InsertCacheKiB) {
+        sqlite3_exec(db, ("PRAGMA cache_size = " + std::to_string(previousCache)).c_str(), NULL, NULL, NULL);
+    }
+    if (!error.empty()) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+    double insertMs = ElapsedMs(start);
+
+    std::string json = "{\"createdConnections\":" + std::to_string(created) +
+                       ",\"matchedConnections\":" + std::to_string(rows.size()) +
+                       ",\"partitions\":" + std::to_string(PartitionCount) +
+                       ",\"threads\":" + std::to_string(threads) +
+                       ",\"scanMs\":" + Number(scanMs) +
+                       ",\"matchMs\":" + Number(matchMs) +
+                       ",\"insertMs\":" + Number(insertMs) + "}";
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// dms_match_connections([branch]) - derives Connection rows from the join
+// columns of Node (the NamedImport, RuntimeDynamicImport, module federation
+// and read/write rules) for one branch, or all branches when NULL/omitted.
+// Returns {"createdConnections","matchedConnections","partitions","threads",
+// "scanMs","matchMs","insertMs"}; matched pairs that already existed count
+// as matched but not created.
+void MatchConnections(sqlite3_context* context, int argc, sqlite3_value** argv);
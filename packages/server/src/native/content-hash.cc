@@ -0,0 +1,142 @@
+#include "content-hash.h"
+
+#include <string.h>
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- XXH64 ---
+//
+// The reference algorithm: four lanes over 32-byte stripes, merged and
+// avalanched at the end. Inputs are read little-endian, as on every target
+// the addon is built for.
+
+static const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+static const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t Read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * Prime2;
+    acc = Rotl(acc, 31);
+    return acc * Prime1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t val) {
+    acc ^= Round(0, val);
+    return acc * Prime1 + Prime4;
+}
+
+ContentHash::ContentHash() : v1(Prime1 + Prime2), v2(Prime2), v3(0), v4(0 - Prime1) {}
+
+void ContentHash::update(std::string_view data) {
+    const unsigned char* p = (const unsigned char*)data.data();
+    size_t len = data.size();
+    total += len;
+
+    if (buffered + len < 32) {
+        memcpy(buffer + buffered, p, len);
+        buffered += len;
+        return;
+    }
+    if (buffered > 0) {
+        size_t fill = 32 - buffered;
+        memcpy(buffer + buffered, p, fill);
+        v1 = Round(v1, Read64(buffer));
+        v2 = Round(v2, Read64(buffer + 8));
+        v3 = Round(v3, Read64(buffer + 16));
+        v4 = Round(v4, Read64(buffer + 24));
+        p += fill;
+        len -= fill;
+        buffered = 0;
+    }
+    while (len >= 32) {
+        v1 = Round(v1, Read64(p));
+        v2 = Round(v2, Read64(p + 8));
+        v3 = Round(v3, Read64(p + 16));
+        v4 = Round(v4, Read64(p + 24));
+        p += 32;
+        len -= 32;
+    }
+    memcpy(buffer, p, len);
+    buffered = len;
+}
+
+uint64_t ContentHash::digest() const {
+    uint64_t h;
+    if (total >= 32) {
+        h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    } else {
+        h = Prime5; // seed 0
+    }
+    h += total;
+
+    const unsigned char* p = buffer;
+    size_t len = buffered;
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * Prime1 + Prime4;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)Read32(p) * Prime1;
+        h = Rotl(h, 23) * Prime2 + Prime3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; ++p, --len) {
+        h ^= (*p) * Prime5;
+        h = Rotl(h, 11) * Prime1;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t ContentHashOf(std::string_view data) {
+    ContentHash hash;
+    hash.update(data);
+    return hash.digest();
+}
+
+std::string ContentHashHex(uint64_t hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4) hex[i] = digits[hash & 0xF];
+    return hex;
+}
+
+void ContentHashFunction(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    const void* data = sqlite3_value_blob(argv[0]);
+    int bytes = sqlite3_value_bytes(argv[0]);
+    std::string hex = ContentHashHex(ContentHashOf(std::string_view((const char*)data, bytes)));
+    sqlite3_result_text(context, hex.c_str(), (int)hex.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include "sqlite3.h"
+
+// Streaming XXH64 (seed 0) over serialized results, fed as they are written,
+// so the HTTP layer can hand out an ETag for a graph without hashing its body
+// again. Graphs hash their plain JSON, whatever encoding they are returned in.
+class ContentHash {
+    uint64_t v1, v2, v3, v4;
+    uint64_t total = 0;
+    unsigned char buffer[32];
+    size_t buffered = 0;
+
+public:
+    ContentHash();
+    void update(std::string_view data);
+    uint64_t digest() const;
+};
+
+uint64_t ContentHashOf(std::string_view data);
+
+// 16 lowercase hex digits
+std::string ContentHashHex(uint64_t hash);
+
+// content_hash(value) - ContentHashHex of a TEXT or BLOB value's bytes, NULL for NULL
+void ContentHashFunction(sqlite3_context* context, int argc, sqlite3_value** argv);
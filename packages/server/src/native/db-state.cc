@@ -0,0 +1,183 @@
+#include "db-state.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+static std::mutex registryMutex;
+static std::unordered_map<std::string, DatabaseState*> registry;
+
+// Fixed slots so the hook can read them without taking a lock while another
+// thread's connection is still registering
+static const int MaxListeners = 16;
+static std::atomic<ChangeListener> listeners[MaxListeners];
+
+DatabaseState& GetDatabaseState(sqlite3* db) {
+    const char* filename = sqlite3_db_filename(db, "main");
+    std::string key;
+    if (filename && filename[0]) {
+        key = filename;
+    } else {
+        // In-memory and temp databases are private to their connection
+        char buf[32];
+        snprintf(buf, sizeof(buf), "memory:%p", (void*)db);
+        key = buf;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto it = registry.find(key);
+    if (it != registry.end()) return *it->second;
+
+    DatabaseState* state = new DatabaseState();
+    state->key = key;
+    registry.emplace(key, state);
+    return *state;
+}
+
+void AddChangeListener(ChangeListener listener) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (int i = 0; i < MaxListeners; ++i) {
+        ChangeListener l = listeners[i].load();
+        if (l == listener) return;
+        if (!l) {
+            listeners[i].store(listener);
+            return;
+        }
+    }
+}
+
+// --- Change Hook ---
+//
+// sqlite3_commit_hook runs before the commit is written, while every other
+// connection still reads the old rows; a listener settled then would rebuild
+// from those and file them under the new generations. So the commit hook only
+// marks the buffer, and it is delivered from the profile trace of the
+// statement that committed, which SQLite invokes after the statement has
+// finished. A COMMIT that failed with SQLITE_BUSY leaves its transaction open
+// and the buffer waiting for the retry or the rollback.
+//
+// The statement trace records how many commits had been delivered when the
+// connection's read transaction began, which is what SnapshotCurrent compares.
+//
+// A connection's state is only touched on its own thread. Nothing else in the
+// server sets a trace; if something replaces it, a committed buffer is still
+// delivered before the connection's next write.
+
+static const size_t KeptBufferCapacity = 4096; // larger buffers are released once delivered
+
+struct BufferedChange {
+    sqlite3_int64 rowid;
+    int op;
+    uint32_t table; // index into ConnectionChanges::tables
+};
+
+// Kept after the connection closes (a close trace may come from a close that
+// fails) and reused by the next connection opened at the same address
+struct ConnectionChanges {
+    DatabaseState* state = nullptr;
+    std::vector<std::string> tables;
+    std::vector<BufferedChange> changes;
+    bool committing = false;
+    uint64_t snapshot = 0; // state->commits when the read transaction began
+};
+
+static std::unordered_map<sqlite3*, ConnectionChanges*> connections; // guarded by registryMutex
+
+static void Discard(ConnectionChanges& conn) {
+    conn.committing = false;
+    conn.changes.clear();
+    if (conn.changes.capacity() > KeptBufferCapacity) std::vector<BufferedChange>().swap(conn.changes);
+}
+
+static void Deliver(ConnectionChanges& conn) {
+    // Counted first, so whoever finds one of the changes queued finds it counted too
+    conn.state->commits.fetch_add(1);
+    for (const BufferedChange& change : conn.changes) {
+        const char* table = conn.tables[change.table].c_str();
+        for (int i = 0; i < MaxListeners; ++i) {
+            ChangeListener l = listeners[i].load(std::memory_order_acquire);
+            if (!l) break;
+            l(*conn.state, change.op, table, change.rowid);
+        }
+    }
+    Discard(conn);
+}
+
+static void UpdateHook(void* userData, int op, const char* database, const char* table, sqlite3_int64 rowid) {
+    if (!table || !database || strcmp(database, "main") != 0) return;
+
+    ConnectionChanges& conn = *(ConnectionChanges*)userData;
+    if (conn.committing) Deliver(conn); // the trace was replaced; that commit finished long ago
+
+    uint32_t index = 0;
+    while (index < conn.tables.size() && conn.tables[index] != table) ++index;
+    if (index == conn.tables.size()) conn.tables.emplace_back(table);
+    conn.changes.push_back({ rowid, op, index });
+}
+
+static int CommitHook(void* userData) {
+    ConnectionChanges& conn = *(ConnectionChanges*)userData;
+    conn.committing = !conn.changes.empty();
+    return 0;
+}
+
+static void RollbackHook(void* userData) {
+    Discard(*(ConnectionChanges*)userData);
+}
+
+static int TraceHook(unsigned type, void* userData, void* p, void* x) {
+    ConnectionChanges& conn = *(ConnectionChanges*)userData;
+    if (type == SQLITE_TRACE_STMT) {
+        // Starting outside a transaction, the statement is about to open one
+        if (sqlite3_txn_state(sqlite3_db_handle((sqlite3_stmt*)p), "main") == SQLITE_TXN_NONE) {
+            conn.snapshot = conn.state->commits.load();
+        }
+    } else if (type == SQLITE_TRACE_PROFILE && conn.committing) {
+        // Still writing means the commit failed and the transaction stays open
+        if (sqlite3_txn_state(sqlite3_db_handle((sqlite3_stmt*)p), "main") == SQLITE_TXN_WRITE) {
+            conn.committing = false;
+        } else {
+            Deliver(conn);
+        }
+    } else if (type == SQLITE_TRACE_CLOSE) {
+        Discard(conn);
+    }
+    return 0;
+}
+
+void InstallChangeHook(sqlite3* db) {
+    DatabaseState& state = GetDatabaseState(db);
+    ConnectionChanges* conn;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ConnectionChanges*& slot = connections[db];
+        if (!slot) slot = new ConnectionChanges();
+        conn = slot;
+    }
+    Discard(*conn);
+    conn->state = &state;
+    conn->snapshot = state.commits.load();
+    sqlite3_update_hook(db, UpdateHook, conn);
+    sqlite3_commit_hook(db, CommitHook, conn);
+    sqlite3_rollback_hook(db, RollbackHook, conn);
+    sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_CLOSE, TraceHook, conn);
+}
+
+bool SnapshotCurrent(sqlite3* db) {
+    int txn = sqlite3_txn_state(db, "main");
+    if (txn != SQLITE_TXN_READ) return txn == SQLITE_TXN_NONE;
+
+    ConnectionChanges* conn;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = connections.find(db);
+        if (it == connections.end()) return false;
+        conn = it->second;
+    }
+    return conn->snapshot == conn->state->commits.load();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "sqlite3.h"
+
+struct FuzzyIndex;
+struct ResultCache;
+struct TraversalPlanner;
+struct BranchStore;
+struct GraphDeltaLog;
+
+// Process-wide state for one database file.
+//
+// The addon is loaded once per process but the extension is initialized on
+// every connection (each piscina worker opens its own), so anything that must
+// outlive a connection or be shared between them hangs off this struct. One
+// instance exists per database file and is never freed.
+struct DatabaseState {
+    std::string key; // main database filename, or a per-connection key for in-memory databases
+
+    // Built lazily by the first node_fuzzy_search call
+    std::atomic<FuzzyIndex*> fuzzyIndex{ nullptr };
+
+    // Created by the first cached graph call
+    std::atomic<ResultCache*> resultCache{ nullptr };
+
+    // Created by the first traversal that needs a plan
+    std::atomic<TraversalPlanner*> traversalPlanner{ nullptr };
+
+    // Created by the first call that loads a branch graph
+    std::atomic<BranchStore*> branchStore{ nullptr };
+
+    // Created by the first project graph delta call
+    std::atomic<GraphDeltaLog*> graphDeltaLog{ nullptr };
+
+    // Commits handed to the change listeners so far
+    std::atomic<uint64_t> commits{ 0 };
+};
+
+DatabaseState& GetDatabaseState(sqlite3* db);
+
+// --- Change Hook ---
+//
+// The hooks installed on every connection buffer the rows a transaction
+// writes and hand them to the listeners below once it has committed; a
+// rollback drops them. Listeners therefore only see committed writes, and a
+// read transaction started after a listener ran sees those rows. They run at
+// the end of the committing statement on the writer's thread, so they must
+// not touch the connection; they only record what changed.
+
+using ChangeListener = void (*)(DatabaseState& state, int op, const char* table, sqlite3_int64 rowid);
+
+void AddChangeListener(ChangeListener listener);
+void InstallChangeHook(sqlite3* db);
+
+// True if what db reads includes every commit the listeners have seen: it has
+// no transaction open, so its next statement reads the latest rows, or the
+// one it has open began after the last delivery and holds no writes of its own.
+// Otherwise nothing derived from the listeners should be used or built on it.
+bool SnapshotCurrent(sqlite3* db);
@@ -0,0 +1,451 @@
+#include "fuzzy-index.h"
+
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "graph.h"
+#include "sqlite3ext.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FUZZY_SSE2 1
+#endif
+
+SQLITE_EXTENSION_INIT3
+
+// --- Trigram Index ---
+//
+// Each indexed column keeps a dictionary of its distinct values; trigram
+// posting lists point at value ids, and every value lists the Node rowids that
+// carry it. Values get increasing ids as they are first seen, so appending to
+// a posting list keeps it sorted and the lists can be intersected directly.
+//
+// The index only ever grows. Rows that were deleted or changed since they were
+// indexed are dropped when candidates are re-read from Node, so stale entries
+// cost a little extra verification but never produce wrong results.
+
+enum FuzzyField { FIELD_NAME, FIELD_PROJECT_NAME, FIELD_RELATIVE_PATH, FIELD_COUNT };
+
+static const char* FuzzyFieldNames[FIELD_COUNT] = { "name", "projectName", "relativePath" };
+
+// Substring matches shorter queries than this can't be answered from trigrams
+static const size_t MinTrigramQuery = 3;
+
+// Candidates below this similarity are not returned as typo-tolerant matches
+static const double MinSimilarity = 0.3;
+
+static std::string ToLowerAscii(std::string_view s) {
+    std::string out(s);
+    for (char& c : out) {
+        if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    }
+    return out;
+}
+
+// Sorted, de-duplicated trigrams of an already lower-cased string
+static void Trigrams(std::string_view s, std::vector<uint32_t>& out) {
+    out.clear();
+    if (s.size() < 3) return;
+    for (size_t i = 0; i + 2 < s.size(); ++i) {
+        out.push_back(((uint32_t)(unsigned char)s[i] << 16) |
+                      ((uint32_t)(unsigned char)s[i + 1] << 8) |
+                      (uint32_t)(unsigned char)s[i + 2]);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+static size_t CountShared(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    size_t i = 0, j = 0, n = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) ++i;
+        else if (a[i] > b[j]) ++j;
+        else { ++n; ++i; ++j; }
+    }
+    return n;
+}
+
+static double Similarity(const std::vector<uint32_t>& q, const std::vector<uint32_t>& v) {
+    if (q.empty() || v.empty()) return 0;
+    size_t shared = CountShared(q, v);
+    return (double)shared / (double)(q.size() + v.size() - shared);
+}
+
+// --- Sorted-set intersection ---
+
+static size_t IntersectScalar(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    size_t i = 0, j = 0, n = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) ++i;
+        else if (a[i] > b[j]) ++j;
+        else { out[n++] = a[i]; ++i; ++j; }
+    }
+    return n;
+}
+
+// For very unequal sizes, binary-search each element of the short list
+static size_t IntersectGalloping(const uint32_t* small, size_t ns, const uint32_t* large, size_t nl, uint32_t* out) {
+    size_t n = 0;
+    const uint32_t* lo = large;
+    const uint32_t* end = large + nl;
+    for (size_t i = 0; i < ns && lo < end; ++i) {
+        size_t step = 1;
+        const uint32_t* hi = lo;
+        while (hi < end && *hi < small[i]) {
+            lo = hi;
+            hi = (size_t)(end - hi) > step ? hi + step : end;
+            step <<= 1;
+        }
+        lo = std::lower_bound(lo, hi == end ? end : hi + 1, small[i]);
+        if (lo < end && *lo == small[i]) out[n++] = small[i];
+    }
+    return n;
+}
+
+#ifdef FUZZY_SSE2
+// Block-wise intersection: every 4x4 pair of lanes is compared with three
+// rotations of the B block, and matching A lanes are emitted in order.
+static size_t IntersectSSE2(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    size_t i = 0, j = 0, n = 0;
+    const size_t na4 = na & ~(size_t)3, nb4 = nb & ~(size_t)3;
+    while (i < na4 && j < nb4) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+        __m128i eq = _mm_cmpeq_epi32(va, vb);
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        for (int k = 0; k < 4; ++k) {
+            if (mask & (1 << k)) out[n++] = a[i + k];
+        }
+        uint32_t amax = a[i + 3], bmax = b[j + 3];
+        if (amax <= bmax) i += 4;
+        if (bmax <= amax) j += 4;
+    }
+    return n + IntersectScalar(a + i, na - i, b + j, nb - j, out + n);
+}
+#endif
+
+// out must have room for min(na, nb) elements; may alias a
+static size_t Intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+    if (na > nb) { std::swap(a, b); std::swap(na, nb); }
+    if (na == 0) return 0;
+    if (nb / na >= 32) return IntersectGalloping(a, na, b, nb, out);
+#ifdef FUZZY_SSE2
+    return IntersectSSE2(a, na, b, nb, out);
+#else
+    return IntersectScalar(a, na, b, nb, out);
+#endif
+}
+
+struct FieldIndex {
+    std::unordered_map<std::string, uint32_t> valueIds;
+    std::vector<std::string> values;             // lower-cased
+    std::vector<std::vector<uint32_t>> rows;     // value id -> Node rowids
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings; // trigram -> value ids
+
+    void Add(const char* raw, uint32_t rowid, std::vector<uint32_t>& scratch) {
+        if (!raw || !raw[0]) return;
+        auto it = valueIds.find(raw);
+        if (it == valueIds.end()) {
+            uint32_t id = (uint32_t)values.size();
+            it = valueIds.emplace(raw, id).first;
+            values.push_back(ToLowerAscii(raw));
+            rows.emplace_back();
+            Trigrams(values.back(), scratch);
+            for (uint32_t t : scratch) postings[t].push_back(id);
+        }
+        rows[it->second].push_back(rowid);
+    }
+};
+
+struct FuzzyIndex {
+    std::mutex mutex;                // guards everything below except pending
+    sqlite3_int64 indexedMax = 0;    // highest Node rowid scanned so far
+    FieldIndex fields[FIELD_COUNT];
+
+    std::mutex pendingMutex;
+    std::atomic<sqlite3_int64> hookMax{ 0 }; // indexedMax as seen by the change hook
+    std::vector<sqlite3_int64> pending;      // rowids at or below indexedMax that were written since
+};
+
+void FuzzyIndexOnChange(DatabaseState& state, int op, const char* table, sqlite3_int64 rowid) {
+    if (op == SQLITE_DELETE || strcmp(table, "Node") != 0) return;
+    FuzzyIndex* index = state.fuzzyIndex.load(std::memory_order_acquire);
+    // Rows past indexedMax are picked up by the tail scan anyway
+    if (!index || rowid > index->hookMax.load(std::memory_order_relaxed)) return;
+
+    std::lock_guard<std::mutex> lock(index->pendingMutex);
+    index->pending.push_back(rowid);
+}
+
+static FuzzyIndex& GetFuzzyIndex(DatabaseState& state) {
+    static std::mutex createMutex;
+    FuzzyIndex* index = state.fuzzyIndex.load(std::memory_order_acquire);
+    if (index) return *index;
+
+    std::lock_guard<std::mutex> lock(createMutex);
+    index = state.fuzzyIndex.load();
+    if (!index) {
+        index = new FuzzyIndex();
+        state.fuzzyIndex.store(index, std::memory_order_release);
+    }
+    return *index;
+}
+
+static void IndexRows(FuzzyIndex& index, sqlite3_stmt* stmt) {
+    std::vector<uint32_t> scratch;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        sqlite3_int64 rowid = sqlite3_column_int64(stmt, 0);
+        if (rowid < 0 || rowid > UINT32_MAX) continue;
+        for (int f = 0; f < FIELD_COUNT; ++f) {
+            index.fields[f].Add((const char*)sqlite3_column_text(stmt, 1 + f), (uint32_t)rowid, scratch);
+        }
+        if (rowid > index.indexedMax) index.indexedMax = rowid;
+    }
+}
+
+// Brings the index up to date: scans rows appended since the last refresh and
+// re-reads rows the change hook reported at or below the indexed range
+// (updates, and inserts that reused the rowid of a deleted row).
+// Caller holds index.mutex.
+static int RefreshFuzzyIndex(sqlite3* db, FuzzyIndex& index) {
+    std::vector<sqlite3_int64> pending;
+    {
+        std::lock_guard<std::mutex> lock(index.pendingMutex);
+        pending.swap(index.pending);
+    }
+
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, "SELECT rowid, name, projectName, relativePath FROM Node WHERE rowid > ? ORDER BY rowid", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) return rc;
+    sqlite3_bind_int64(stmt, 1, index.indexedMax);
+    IndexRows(index, stmt);
+    sqlite3_finalize(stmt);
+
+    std::sort(pending.begin(), pending.end());
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+    for (size_t start = 0; start < pending.size(); start += 500) {
+        std::string idList;
+        for (size_t i = start; i < pending.size() && i < start + 500; ++i) {
+            if (i > start) idList += ",";
+            idList += std::to_string(pending[i]);
+        }
+        std::string sql = "SELECT rowid, name, projectName, relativePath FROM Node WHERE rowid IN (" + idList + ")";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+            IndexRows(index, stmt);
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    index.hookMax.store(index.indexedMax, std::memory_order_relaxed);
+    return SQLITE_OK;
+}
+
+static const char* ColumnText(sqlite3_stmt* stmt, int col) {
+    const char* v = (const char*)sqlite3_column_text(stmt, col);
+    return v ? v : "";
+}
+
+struct ValueMatch {
+    int field;
+    uint32_t valueId;
+    double score;
+    bool contains;
+};
+
+// Values of one field that contain the query, plus (when typo tolerance is
+// on) values sharing enough trigrams with it
+static void MatchField(const FieldIndex& fi, int field, const std::string& q,
+                       const std::vector<uint32_t>& qTrigrams, bool similar,
+                       std::vector<ValueMatch>& out) {
+    std::vector<uint32_t> scratch;
+
+    if (qTrigrams.empty()) {
+        // Too short for trigrams; the dictionary is much smaller than Node, so scan it
+        for (uint32_t id = 0; id < fi.values.size(); ++id) {
+            if (fi.values[id].find(q) != std::string::npos) {
+                out.push_back({ field, id, (double)q.size() / fi.values[id].size(), true });
+            }
+        }
+        return;
+    }
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    bool missing = false;
+    for (uint32_t t : qTrigrams) {
+        auto it = fi.postings.find(t);
+        if (it == fi.postings.end()) { missing = true; continue; }
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+
+    std::unordered_set<uint32_t> contained;
+    if (!missing && !lists.empty()) {
+        std::vector<uint32_t> candidates(*lists[0]);
+        size_t n = candidates.size();
+        for (size_t i = 1; i < lists.size() && n > 0; ++i) {
+            n = Intersect(candidates.data(), n, lists[i]->data(), lists[i]->size(), candidates.data());
+        }
+        candidates.resize(n);
+        for (uint32_t id : candidates) {
+            if (fi.values[id].find(q) == std::string::npos) continue;
+            Trigrams(fi.values[id], scratch);
+            out.push_back({ field, id, Similarity(qTrigrams, scratch), true });
+            contained.insert(id);
+        }
+    }
+
+    if (!similar) return;
+
+    // T-occurrence count: a value needs at least this many shared trigrams to
+    // possibly reach MinSimilarity
+    std::unordered_map<uint32_t, uint32_t> counts;
+    for (auto* list : lists) {
+        for (uint32_t id : *list) counts[id]++;
+    }
+    size_t minShared = (size_t)(MinSimilarity * qTrigrams.size());
+    if (minShared < 1) minShared = 1;
+    for (const auto& [id, shared] : counts) {
+        if (shared < minShared || contained.count(id)) continue;
+        Trigrams(fi.values[id], scratch);
+        double score = Similarity(qTrigrams, scratch);
+        if (score >= MinSimilarity) out.push_back({ field, id, score, false });
+    }
+}
+
+// node_fuzzy_search(query, limit [, field [, branch]])
+//
+// Returns a JSON array of matching nodes, best first: nodes whose field
+// contains the query (case-insensitive, like LIKE '%q%'), ranked by trigram
+// similarity, followed by typo-tolerant matches when there is room. field is
+// 'name', 'projectName', 'relativePath' or '*' (default, all three).
+void NodeFuzzySearch(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* queryRaw = (const char*)sqlite3_value_text(argv[0]);
+    if (!queryRaw || !queryRaw[0]) {
+        sqlite3_result_text(context, "[]", -1, SQLITE_STATIC);
+        return;
+    }
+    int limit = argc >= 2 ? sqlite3_value_int(argv[1]) : 50;
+    if (limit <= 0) limit = 50;
+
+    int onlyField = -1;
+    if (argc >= 3 && sqlite3_value_type(argv[2]) != SQLITE_NULL) {
+        const char* f = (const char*)sqlite3_value_text(argv[2]);
+        if (strcmp(f, "*") != 0) {
+            for (int i = 0; i < FIELD_COUNT; ++i) {
+                if (strcmp(f, FuzzyFieldNames[i]) == 0) onlyField = i;
+            }
+            if (onlyField < 0) {
+                sqlite3_result_error(context, "field must be one of 'name', 'projectName', 'relativePath', '*'", -1);
+                return;
+            }
+        }
+    }
+    std::string branch;
+    bool filterBranch = argc >= 4 && sqlite3_value_type(argv[3]) != SQLITE_NULL;
+    if (filterBranch) branch = (const char*)sqlite3_value_text(argv[3]);
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    FuzzyIndex& index = GetFuzzyIndex(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(index.mutex);
+
+    int rc = RefreshFuzzyIndex(db, index);
+    if (rc != SQLITE_OK) {
+        sqlite3_result_error_code(context, rc);
+        return;
+    }
+
+    std::string q = ToLowerAscii(queryRaw);
+    std::vector<uint32_t> qTrigrams;
+    if (q.size() >= MinTrigramQuery) Trigrams(q, qTrigrams);
+
+    std::vector<ValueMatch> matches;
+    for (int f = 0; f < FIELD_COUNT; ++f) {
+        if (onlyField >= 0 && f != onlyField) continue;
+        MatchField(index.fields[f], f, q, qTrigrams, true, matches);
+    }
+    std::sort(matches.begin(), matches.end(), [&](const ValueMatch& a, const ValueMatch& b) {
+        if (a.contains != b.contains) return a.contains;
+        if (a.score != b.score) return a.score > b.score;
+        return index.fields[a.field].values[a.valueId].size() < index.fields[b.field].values[b.valueId].size();
+    });
+
+    // Re-read candidates in rank order until enough live rows are found; this
+    // drops deleted rows, rows whose value changed, and other branches.
+    JsonBuilder jb;
+    jb.beginArray();
+    int emitted = 0;
+    std::unordered_set<uint32_t> seenRows;
+    std::string sql = "SELECT id, name, type, projectName, branch, relativePath FROM Node WHERE rowid = ?";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        sqlite3_result_error(context, sqlite3_errmsg(db), -1);
+        return;
+    }
+    for (const auto& m : matches) {
+        if (emitted >= limit) break;
+        const FieldIndex& fi = index.fields[m.field];
+        for (uint32_t rowid : fi.rows[m.valueId]) {
+            if (emitted >= limit) break;
+            if (!seenRows.insert(rowid).second) continue;
+
+            sqlite3_bind_int64(stmt, 1, rowid);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                const char* current = ColumnText(stmt, m.field == FIELD_NAME ? 1 : m.field == FIELD_PROJECT_NAME ? 3 : 5);
+                const char* rowBranch = ColumnText(stmt, 4);
+                bool live = ToLowerAscii(current) == fi.values[m.valueId];
+                if (live && (!filterBranch || branch == rowBranch)) {
+                    if (emitted > 0) jb.comma();
+                    jb.beginObject();
+                    jb.key("id"); jb.string(ColumnText(stmt, 0)); jb.comma();
+                    jb.key("name"); jb.string(ColumnText(stmt, 1)); jb.comma();
+                    jb.key("type"); jb.string(ColumnText(stmt, 2)); jb.comma();
+                    jb.key("projectName"); jb.string(ColumnText(stmt, 3)); jb.comma();
+                    jb.key("branch"); jb.string(rowBranch); jb.comma();
+                    jb.key("relativePath"); jb.string(ColumnText(stmt, 5)); jb.comma();
+                    jb.key("field"); jb.string(FuzzyFieldNames[m.field]); jb.comma();
+                    jb.key("score"); jb.raw(std::to_string(m.score)); jb.comma();
+                    jb.key("contains"); jb.raw(m.contains ? "true" : "false");
+                    jb.endObject();
+                    emitted++;
+                }
+            }
+            sqlite3_reset(stmt);
+        }
+    }
+    sqlite3_finalize(stmt);
+    jb.endArray();
+
+    std::string json = jb.str();
+    sqlite3_result_text(context, json.c_str(), -1, SQLITE_TRANSIENT);
+}
+
+// node_fuzzy_reindex() - drops the in-memory index so the next search rebuilds
+// it. Only needed after writes the change hook cannot see (other processes
+// reusing rowids of deleted rows).
+void NodeFuzzyReindex(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    sqlite3* db = sqlite3_context_db_handle(context);
+    FuzzyIndex& index = GetFuzzyIndex(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(index.mutex);
+    {
+        std::lock_guard<std::mutex> pendingLock(index.pendingMutex);
+        index.pending.clear();
+        index.hookMax.store(0);
+    }
+    for (auto& f : index.fields) f = FieldIndex();
+    index.indexedMax = 0;
+
+    int rc = RefreshFuzzyIndex(db, index);
+    if (rc != SQLITE_OK) {
+        sqlite3_result_error_code(context, rc);
+        return;
+    }
+    sqlite3_result_int64(context, index.indexedMax);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "db-state.h"
+#include "sqlite3.h"
+
+// Trigram index over Node.name, Node.projectName and Node.relativePath, kept
+// per database file and updated incrementally from the change hook.
+
+void NodeFuzzySearch(sqlite3_context* context, int argc, sqlite3_value** argv);
+void NodeFuzzyReindex(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+// ChangeListener queuing Node writes for the next refresh
+void FuzzyIndexOnChange(DatabaseState& state, int op, const char* table, sqlite3_int64 rowid);
@@ -0,0 +1,457 @@
+#include <node_api.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "content-hash.h"
+#include "db-state.h"
+#include "graph-query.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- N-API Graph Binding ---
+//
+//   const addon = require('./build/Release/sqlite_hook.node')
+//   const buffer = await addon.getNodeGraph(dbPath, nodeId, depth, filterJson, layout, encoding)
+//   const buffer = await addon.getProjectGraph(dbPath, projectId, branch, depth, filterJson, layout, encoding)
+//   buffer.contentHash // XXH64 of the plain JSON, 16 hex digits
+//   await addon.streamNodeGraph(dbPath, nodeId, depth, filterJson, (line) => keepGoing | Promise<keepGoing>)
+//
+// The same graph queries as the SQL functions, without the Prisma round trip:
+// the work runs on the libuv threadpool against read-only connections owned by
+// the addon, and the JSON is handed to JavaScript as an ArrayBuffer that wraps
+// the native string instead of copying it. encoding 'gzip' returns the graph
+// compressed as it was serialized, ready to be stored or sent as is.
+//
+// The addon links no SQLite of its own; it calls through the API table that
+// better-sqlite3 passes in when the same file is loaded as an extension, so
+// that has to happen first (prisma.ts does it on connect).
+
+static const int ReadBusyTimeoutMs = 5000;
+
+// Idle read-only connections per database path. Never closed: one per
+// threadpool thread at most, kept for the life of the process. The extension
+// isn't loaded into them, so they register with the change hook themselves;
+// otherwise the result cache could never tell how current their reads are.
+static std::mutex readPoolMutex;
+static std::map<std::string, std::vector<sqlite3*>> readPool;
+
+static sqlite3* AcquireReadConnection(const std::string& path, std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(readPoolMutex);
+        std::vector<sqlite3*>& idle = readPool[path];
+        if (!idle.empty()) {
+            sqlite3* db = idle.back();
+            idle.pop_back();
+            return db;
+        }
+    }
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        error = db ? sqlite3_errmsg(db) : "out of memory";
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, ReadBusyTimeoutMs);
+    InstallChangeHook(db);
+    return db;
+}
+
+static void ReleaseReadConnection(const std::string& path, sqlite3* db) {
+    std::lock_guard<std::mutex> lock(readPoolMutex);
+    readPool[path].push_back(db);
+}
+
+struct GraphWork {
+    napi_async_work work = nullptr;
+    napi_deferred deferred = nullptr;
+    std::string path;
+    bool project = false;
+    NodeGraphQuery nodeQuery;
+    ProjectGraphQuery projectQuery;
+    std::string* json = nullptr; // owned by the ArrayBuffer once resolved
+    uint64_t contentHash = 0;
+    std::string error;
+};
+
+static void ExecuteGraphWork(napi_env env, void* data) {
+    GraphWork* w = (GraphWork*)data;
+    sqlite3* db = AcquireReadConnection(w->path, w->error);
+    if (!db) return;
+
+    w->json = new std::string();
+    // One read transaction: node graphs are walked first and their rows read
+    // afterwards, and both have to see the same snapshot
+    sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+    bool ok = w->project ? QueryProjectGraph(db, w->projectQuery, *w->json, w->error, &w->contentHash)
+                         : QueryNodeGraph(db, w->nodeQuery, *w->json, w->error, &w->contentHash);
+    sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+    ReleaseReadConnection(w->path, db);
+    if (!ok) {
+        delete w->json;
+        w->json = nullptr;
+    }
+}
+
+static void FreeJson(napi_env env, void* data, void* hint) {
+    delete (std::string*)hint;
+}
+
+// An ArrayBuffer that takes ownership of json
+static napi_value WrapJson(napi_env env, std::string* json) {
+    napi_value buffer;
+    if (napi_create_external_arraybuffer(env, (void*)json->data(), json->size(), FreeJson, json, &buffer) != napi_ok) {
+        // Runtimes with a V8 sandbox refuse external memory: fall back to one copy
+        void* copy;
+        napi_create_arraybuffer(env, json->size(), &copy, &buffer);
+        memcpy(copy, json->data(), json->size());
+        delete json;
+    }
+    return buffer;
+}
+
+static void CompleteGraphWork(napi_env env, napi_status status, void* data) {
+    GraphWork* w = (GraphWork*)data;
+    if (status == napi_ok && w->json) {
+        napi_value buffer = WrapJson(env, w->json);
+        std::string hex = ContentHashHex(w->contentHash);
+        napi_value hash;
+        napi_create_string_utf8(env, hex.c_str(), hex.size(), &hash);
+        napi_set_named_property(env, buffer, "contentHash", hash);
+        napi_resolve_deferred(env, w->deferred, buffer);
+    } else {
+        delete w->json;
+        napi_value message, error;
+        napi_create_string_utf8(env, w->error.empty() ? "Graph query failed" : w->error.c_str(), NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &error);
+        napi_reject_deferred(env, w->deferred, error);
+    }
+    napi_delete_async_work(env, w->work);
+    delete w;
+}
+
+// --- Argument Helpers ---
+
+static bool GetString(napi_env env, napi_value value, std::string& out) {
+    size_t length;
+    if (napi_get_value_string_utf8(env, value, NULL, 0, &length) != napi_ok) return false;
+    out.resize(length);
+    return napi_get_value_string_utf8(env, value, &out[0], length + 1, &length) == napi_ok;
+}
+
+// undefined/null leave out untouched
+static bool GetOptionalString(napi_env env, napi_value value, std::string& out) {
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    if (type == napi_undefined || type == napi_null) return true;
+    return GetString(env, value, out);
+}
+
+static bool GetOptionalInt(napi_env env, napi_value value, int& out) {
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    if (type == napi_undefined || type == napi_null) return true;
+    return napi_get_value_int32(env, value, &out) == napi_ok;
+}
+
+static bool GetOptionalBool(napi_env env, napi_value value, bool& out) {
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    if (type == napi_undefined || type == napi_null) return true;
+    return napi_get_value_bool(env, value, &out) == napi_ok;
+}
+
+// undefined/null mean plain JSON; anything but 'gzip' is rejected
+static bool GetOptionalEncoding(napi_env env, napi_value value, bool& gzip) {
+    std::string encoding;
+    if (!GetOptionalString(env, value, encoding)) return false;
+    if (encoding.empty()) return true;
+    gzip = encoding == "gzip";
+    return gzip;
+}
+
+static napi_value Queue(napi_env env, GraphWork* w) {
+    napi_value promise, name;
+    napi_create_promise(env, &w->deferred, &promise);
+    napi_create_string_utf8(env, "sqlite_hook:graph", NAPI_AUTO_LENGTH, &name);
+    napi_create_async_work(env, NULL, name, ExecuteGraphWork, CompleteGraphWork, w, &w->work);
+    napi_queue_async_work(env, w->work);
+    return promise;
+}
+
+static bool EnsureSqliteApi(napi_env env) {
+    if (sqlite3_api) return true;
+    napi_throw_error(env, NULL, "sqlite_hook must be loaded as an SQLite extension before its graph API is used");
+    return false;
+}
+
+// getNodeGraph(dbPath, nodeId, depth?, filterJson?, layout?, encoding?) -> Promise<ArrayBuffer>
+static napi_value GetNodeGraph(napi_env env, napi_callback_info info) {
+    size_t argc = 6;
+    napi_value argv[6];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    if (!EnsureSqliteApi(env)) return NULL;
+
+    GraphWork* w = new GraphWork();
+    if (argc < 2 || !GetString(env, argv[0], w->path) || !GetString(env, argv[1], w->nodeQuery.nodeId) ||
+        (argc > 2 && !GetOptionalInt(env, argv[2], w->nodeQuery.depth)) ||
+        (argc > 3 && !GetOptionalString(env, argv[3], w->nodeQuery.filter)) ||
+        (argc > 4 && !GetOptionalBool(env, argv[4], w->nodeQuery.layout)) ||
+        (argc > 5 && !GetOptionalEncoding(env, argv[5], w->nodeQuery.gzip))) {
+        delete w;
+        napi_throw_type_error(env, NULL, "Expected (dbPath, nodeId, depth?, filterJson?, layout?, encoding?)");
+        return NULL;
+    }
+    return Queue(env, w);
+}
+
+// getProjectGraph(dbPath, projectId, branch, depth?, filterJson?, layout?, encoding?) -> Promise<ArrayBuffer>
+static napi_value GetProjectGraph(napi_env env, napi_callback_info info) {
+    size_t argc = 7;
+    napi_value argv[7];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    if (!EnsureSqliteApi(env)) return NULL;
+
+    GraphWork* w = new GraphWork();
+    w->project = true;
+    if (argc < 3 || !GetString(env, argv[0], w->path) || !GetString(env, argv[1], w->projectQuery.projectId) ||
+        !GetString(env, argv[2], w->projectQuery.branch) ||
+        (argc > 3 && !GetOptionalInt(env, argv[3], w->projectQuery.depth)) ||
+        (argc > 4 && !GetOptionalString(env, argv[4], w->projectQuery.filter)) ||
+        (argc > 5 && !GetOptionalBool(env, argv[5], w->projectQuery.layout)) ||
+        (argc > 6 && !GetOptionalEncoding(env, argv[6], w->projectQuery.gzip))) {
+        delete w;
+        napi_throw_type_error(env, NULL, "Expected (dbPath, projectId, branch, depth?, filterJson?, layout?, encoding?)");
+        return NULL;
+    }
+    return Queue(env, w);
+}
+
+// --- Level Streaming ---
+//
+// streamNodeGraph runs StreamNodeGraphLevels on the threadpool and hands each
+// NDJSON line to onLine as an ArrayBuffer while later levels are still being
+// walked. At most StreamQueueLines lines wait for the main thread; past that
+// the walk blocks, so a busy event loop slows the traversal down instead of
+// letting lines pile up natively. onLine returning a promise (the consumer's
+// buffer is full) pauses the walk until it settles, so a slow client holds
+// back the traversal rather than the lines piling up in JavaScript; returning
+// false, or resolving to it (the client went away), stops the walk. A pause
+// that outlasts StreamPauseTimeoutMs fails the stream instead of holding a
+// threadpool thread (and a read transaction) for a client that stalled. The
+// promise settles after the last line was delivered.
+
+static const size_t StreamQueueLines = 8;
+static const int StreamPauseTimeoutMs = 30000;
+
+struct StreamWork {
+    napi_async_work work = nullptr;
+    napi_deferred deferred = nullptr;
+    napi_threadsafe_function onLine = nullptr;
+    std::string path;
+    NodeGraphQuery query;
+    std::atomic<bool> stopped{ false };
+    std::mutex pauseMutex;
+    std::condition_variable resumed;
+    int paused = 0;         // onLine promises not settled yet, guarded by pauseMutex
+    bool finalized = false; // the promise settled before they did; guarded by pauseMutex
+    bool ok = false;
+    std::string error;         // set on the threadpool
+    std::string callbackError; // set on the main thread, by onLine throwing
+};
+
+static void ExecuteStreamWork(napi_env env, void* data) {
+    StreamWork* w = (StreamWork*)data;
+    sqlite3* db = AcquireReadConnection(w->path, w->error);
+    if (!db) return;
+
+    bool stalled = false;
+    GraphLevelSink sink = [w, &stalled](std::string&& line) {
+        {
+            std::unique_lock<std::mutex> lock(w->pauseMutex);
+            stalled = !w->resumed.wait_for(lock, std::chrono::milliseconds(StreamPauseTimeoutMs),
+                                           [w] { return w->paused == 0 || w->stopped; });
+            if (stalled) w->stopped = true;
+        }
+        if (w->stopped) return false;
+        std::string* queued = new std::string(std::move(line));
+        if (napi_call_threadsafe_function(w->onLine, queued, napi_tsfn_blocking) != napi_ok) {
+            delete queued;
+            return false;
+        }
+        return !w->stopped;
+    };
+    sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+    w->ok = StreamNodeGraphLevels(db, w->query, sink, w->error);
+    if (stalled) {
+        w->ok = false;
+        w->error = "Stream consumer did not drain within " + std::to_string(StreamPauseTimeoutMs) + " ms";
+    }
+    sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+    ReleaseReadConnection(w->path, db);
+}
+
+// Called on the main thread, and by the environment's teardown, which would
+// otherwise leave the walk waiting for a promise that never settles
+static void StopStream(void* data) {
+    StreamWork* w = (StreamWork*)data;
+    std::lock_guard<std::mutex> lock(w->pauseMutex);
+    w->stopped = true;
+    w->resumed.notify_all();
+}
+
+// Settles one pause; the last one also frees a stream finalized meanwhile
+static void Resume(StreamWork* w, bool keepGoing) {
+    bool release;
+    {
+        std::lock_guard<std::mutex> lock(w->pauseMutex);
+        if (!keepGoing) w->stopped = true;
+        release = --w->paused == 0 && w->finalized;
+        w->resumed.notify_all();
+    }
+    if (release) delete w;
+}
+
+static napi_value OnPauseResolved(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value value;
+    void* data;
+    napi_get_cb_info(env, info, &argc, &value, NULL, &data);
+    napi_valuetype type = napi_undefined;
+    bool keepGoing = true;
+    if (argc > 0) napi_typeof(env, value, &type);
+    if (type == napi_boolean) napi_get_value_bool(env, value, &keepGoing);
+    Resume((StreamWork*)data, keepGoing);
+    return NULL;
+}
+
+static napi_value OnPauseRejected(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value reason, message;
+    void* data;
+    napi_get_cb_info(env, info, &argc, &reason, NULL, &data);
+    StreamWork* w = (StreamWork*)data;
+    if (argc > 0 && napi_coerce_to_string(env, reason, &message) == napi_ok) GetString(env, message, w->callbackError);
+    if (w->callbackError.empty()) w->callbackError = "onLine rejected";
+    Resume(w, false);
+    return NULL;
+}
+
+// Holds the walk back until the promise onLine returned settles
+static void PauseStream(napi_env env, StreamWork* w, napi_value promise) {
+    napi_value then, handlers[2], ignored;
+    napi_get_named_property(env, promise, "then", &then);
+    napi_create_function(env, "resume", NAPI_AUTO_LENGTH, OnPauseResolved, w, &handlers[0]);
+    napi_create_function(env, "stop", NAPI_AUTO_LENGTH, OnPauseRejected, w, &handlers[1]);
+    {
+        std::lock_guard<std::mutex> lock(w->pauseMutex);
+        ++w->paused;
+    }
+    napi_call_function(env, promise, then, 2, handlers, &ignored);
+}
+
+static void CallOnLine(napi_env env, napi_value onLine, void* context, void* data) {
+    StreamWork* w = (StreamWork*)context;
+    std::string* line = (std::string*)data;
+    // env is NULL while the function is torn down
+    if (!env || w->stopped) {
+        delete line;
+        return;
+    }
+    napi_value undefined, buffer = WrapJson(env, line), result;
+    napi_get_undefined(env, &undefined);
+    if (napi_call_function(env, undefined, onLine, 1, &buffer, &result) != napi_ok) {
+        napi_value exception, message;
+        napi_get_and_clear_last_exception(env, &exception);
+        napi_coerce_to_string(env, exception, &message);
+        GetString(env, message, w->callbackError);
+        StopStream(w);
+        return;
+    }
+    bool isPromise = false;
+    napi_is_promise(env, result, &isPromise);
+    if (isPromise) return PauseStream(env, w, result);
+
+    napi_valuetype type;
+    bool keepGoing = true;
+    napi_typeof(env, result, &type);
+    if (type == napi_boolean) napi_get_value_bool(env, result, &keepGoing);
+    if (!keepGoing) StopStream(w);
+}
+
+// Runs once the queue is drained and the work is complete
+static void FinalizeStream(napi_env env, void* data, void* hint) {
+    StreamWork* w = (StreamWork*)data;
+    napi_remove_env_cleanup_hook(env, StopStream, w);
+    if (w->ok && w->callbackError.empty()) {
+        napi_value undefined;
+        napi_get_undefined(env, &undefined);
+        napi_resolve_deferred(env, w->deferred, undefined);
+    } else {
+        const std::string& error = w->callbackError.empty() ? w->error : w->callbackError;
+        napi_value message, exception;
+        napi_create_string_utf8(env, error.empty() ? "Graph query failed" : error.c_str(), NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &exception);
+        napi_reject_deferred(env, w->deferred, exception);
+    }
+    bool pending;
+    {
+        std::lock_guard<std::mutex> lock(w->pauseMutex);
+        pending = w->paused > 0;
+        w->finalized = pending;
+    }
+    if (!pending) delete w; // otherwise the last onLine promise to settle does
+}
+
+static void CompleteStreamWork(napi_env env, napi_status status, void* data) {
+    StreamWork* w = (StreamWork*)data;
+    if (status != napi_ok) w->ok = false;
+    napi_delete_async_work(env, w->work);
+    napi_release_threadsafe_function(w->onLine, napi_tsfn_release);
+}
+
+// streamNodeGraph(dbPath, nodeId, depth?, filterJson?, onLine) -> Promise<void>
+static napi_value StreamNodeGraph(napi_env env, napi_callback_info info) {
+    size_t argc = 5;
+    napi_value argv[5];
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    if (!EnsureSqliteApi(env)) return NULL;
+
+    StreamWork* w = new StreamWork();
+    napi_valuetype callbackType = napi_undefined;
+    if (argc == 5) napi_typeof(env, argv[4], &callbackType);
+    if (argc < 5 || !GetString(env, argv[0], w->path) || !GetString(env, argv[1], w->query.nodeId) ||
+        !GetOptionalInt(env, argv[2], w->query.depth) || !GetOptionalString(env, argv[3], w->query.filter) ||
+        callbackType != napi_function) {
+        delete w;
+        napi_throw_type_error(env, NULL, "Expected (dbPath, nodeId, depth?, filterJson?, onLine)");
+        return NULL;
+    }
+
+    napi_value promise, name;
+    napi_create_promise(env, &w->deferred, &promise);
+    napi_create_string_utf8(env, "sqlite_hook:graph-stream", NAPI_AUTO_LENGTH, &name);
+    napi_create_threadsafe_function(env, argv[4], NULL, name, StreamQueueLines, 1, w, FinalizeStream, w, CallOnLine,
+                                    &w->onLine);
+    napi_add_env_cleanup_hook(env, StopStream, w);
+    napi_create_async_work(env, NULL, name, ExecuteStreamWork, CompleteStreamWork, w, &w->work);
+    napi_queue_async_work(env, w->work);
+    return promise;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+    napi_property_descriptor properties[] = {
+        { "getNodeGraph", NULL, GetNodeGraph, NULL, NULL, NULL, napi_default, NULL },
+        { "getProjectGraph", NULL, GetProjectGraph, NULL, NULL, NULL, napi_default, NULL },
+        { "streamNodeGraph", NULL, StreamNodeGraph, NULL, NULL, NULL, napi_default, NULL },
+    };
+    napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties);
+    return exports;
+}
+
+NAPI_MODULE(sqlite_hook, Init)
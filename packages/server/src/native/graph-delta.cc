@@ -0,0 +1,310 @@
+#include "graph-delta.h"
+
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "branch-overlay.h"
+#include "db-state.h"
+#include "graph.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Graph Delta Log ---
+//
+// An open dashboard holds the project graph of a branch and only needs what
+// changed after an analysis run, which is usually a handful of projects. Each
+// branch keeps the snapshot it last served (vertex and edge records, sorted by
+// id) and the differences between its last few snapshots. A call whose branch
+// generation moved on takes a new snapshot from the branch store, appends the
+// difference to the log and answers by folding the entries since the caller's
+// generation together.
+//
+// Generations handed out are snapshot sequence numbers, not result cache
+// generations: those restart with the process, while sequences start from the
+// clock, so a generation from an earlier process is never mistaken for a
+// current one and gets a reload.
+
+static const size_t MaxLogEntries = 32;
+static const size_t MaxLoggedBranches = 32;
+
+// (id, JSON object) - what the '*' graphs put in a vertex's or edge's "data"
+using GraphRecord = std::pair<std::string, std::string>;
+using GraphRecords = std::vector<GraphRecord>;
+
+struct GraphChanges {
+    GraphRecords addedVertices, removedVertices, addedEdges, removedEdges;
+};
+
+struct DeltaEntry {
+    uint64_t from, to; // sequences
+    GraphChanges changes;
+};
+
+struct BranchDeltaLog {
+    uint64_t generation = 0; // result cache generation of the snapshot
+    uint64_t sequence = 0;
+    GraphRecords vertices, edges;
+    std::deque<DeltaEntry> entries;
+    uint64_t lastUsed = 0;
+};
+
+struct GraphDeltaLog {
+    std::mutex mutex; // guards everything below
+    std::unordered_map<std::string, BranchDeltaLog> branches;
+    uint64_t sequence = (uint64_t)time(NULL) * 1000;
+    uint64_t clock = 0;
+};
+
+static GraphDeltaLog& GetGraphDeltaLog(DatabaseState& state) {
+    static std::mutex createMutex;
+    GraphDeltaLog* log = state.graphDeltaLog.load(std::memory_order_acquire);
+    if (log) return *log;
+
+    std::lock_guard<std::mutex> lock(createMutex);
+    log = state.graphDeltaLog.load();
+    if (!log) {
+        log = new GraphDeltaLog();
+        state.graphDeltaLog.store(log, std::memory_order_release);
+    }
+    return *log;
+}
+
+// --- Snapshots ---
+
+// Vertices are every project, as in the '*' graphs; edges the project pairs
+// joined by a connection between nodes of branch. False with error empty when
+// the branch store can't track changes right now.
+static bool ReadSnapshot(sqlite3* db, const std::string& branch, GraphRecords& vertices, GraphRecords& edges,
+                         std::string& error) {
+    BranchGraph graph;
+    if (!LoadBranchGraph(db, branch, graph, error)) return false;
+
+    std::string record;
+    JsonBuilder jb([&record](std::string_view data) { record.append(data); });
+    auto take = [&]() {
+        jb.flush();
+        std::string out;
+        out.swap(record);
+        return out;
+    };
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, name, addr, type FROM Project", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    std::set<std::string> projects;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* id = (const char*)sqlite3_column_text(stmt, 0);
+        jb.beginObject();
+            jb.key("id"); jb.string(id); jb.comma();
+            jb.key("name"); jb.string((const char*)sqlite3_column_text(stmt, 1)); jb.comma();
+            jb.key("type"); jb.string((const char*)sqlite3_column_text(stmt, 3)); jb.comma();
+            jb.key("branch"); jb.string(branch); jb.comma();
+            jb.key("addr"); jb.string((const char*)sqlite3_column_text(stmt, 2));
+        jb.endObject();
+        vertices.emplace_back(id, take());
+        projects.insert(id);
+    }
+    sqlite3_finalize(stmt);
+
+    std::set<std::pair<int, int>> pairs; // segments
+    for (const auto& e : graph.edges) {
+        int from = graph.SegmentOf(e.first), to = graph.SegmentOf(e.second);
+        if (from != to) pairs.emplace(from, to);
+    }
+    for (const auto& p : pairs) {
+        const std::string& fromId = graph.segments[p.first]->projectId;
+        const std::string& toId = graph.segments[p.second]->projectId;
+        if (!projects.count(fromId) || !projects.count(toId)) continue;
+        std::string id = fromId + "-" + toId;
+        jb.beginObject();
+            jb.key("id"); jb.string(id); jb.comma();
+            jb.key("fromId"); jb.string(fromId); jb.comma();
+            jb.key("toId"); jb.string(toId);
+        jb.endObject();
+        edges.emplace_back(std::move(id), take());
+    }
+
+    std::sort(vertices.begin(), vertices.end());
+    std::sort(edges.begin(), edges.end());
+    return true;
+}
+
+static void Diff(const GraphRecords& before, const GraphRecords& after, GraphRecords& added, GraphRecords& removed) {
+    std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(added));
+    std::set_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(removed));
+}
+
+// Called with log.mutex held
+static void EvictBranches(GraphDeltaLog& log) {
+    while (log.branches.size() > MaxLoggedBranches) {
+        auto oldest = log.branches.begin();
+        for (auto it = log.branches.begin(); it != log.branches.end(); ++it) {
+            if (it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        log.branches.erase(oldest);
+    }
+}
+
+// --- Folding ---
+
+// Applies next on top of the changes folded so far: adding a record removed
+// earlier (or the other way round) cancels out
+static void Fold(std::set<GraphRecord>& added, std::set<GraphRecord>& removed, const GraphRecords& nextAdded,
+                 const GraphRecords& nextRemoved) {
+    for (const GraphRecord& r : nextRemoved) {
+        if (!added.erase(r)) removed.insert(r);
+    }
+    for (const GraphRecord& r : nextAdded) {
+        if (!removed.erase(r)) added.insert(r);
+    }
+}
+
+static void WriteChanges(JsonBuilder& jb, const char* name, const std::set<GraphRecord>& added,
+                         const std::set<GraphRecord>& removed) {
+    jb.key(name);
+    jb.beginObject();
+    jb.key("added");
+    jb.beginArray();
+    bool first = true;
+    for (const GraphRecord& r : added) {
+        if (!first) jb.comma();
+        first = false;
+        jb.raw(r.second);
+    }
+    jb.endArray();
+    jb.comma();
+    jb.key("removed");
+    jb.beginArray();
+    first = true;
+    for (const GraphRecord& r : removed) {
+        if (!first) jb.comma();
+        first = false;
+        jb.string(r.first);
+    }
+    jb.endArray();
+    jb.endObject();
+}
+
+static std::string ReloadJson(const std::string& branch, const uint64_t* sequence) {
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("branch"); jb.string(branch); jb.comma();
+    jb.key("generation"); jb.raw(sequence ? std::to_string(*sequence) : "null"); jb.comma();
+    jb.key("reload"); jb.raw("true");
+    jb.endObject();
+    return jb.str();
+}
+
+void ProjectGraphDelta(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* rawBranch = (const char*)sqlite3_value_text(argv[0]);
+    if (!rawBranch) {
+        sqlite3_result_error(context, "branch is required", -1);
+        return;
+    }
+    std::string branch = rawBranch;
+    bool hasSince = argc > 1 && sqlite3_value_type(argv[1]) != SQLITE_NULL;
+    uint64_t since = hasSince ? (uint64_t)sqlite3_value_int64(argv[1]) : 0;
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    auto untracked = [&]() {
+        std::string json = ReloadJson(branch, nullptr);
+        sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+    };
+    uint64_t generation;
+    if (!ResultCacheBranchGeneration(db, branch, generation)) return untracked();
+
+    GraphDeltaLog& log = GetGraphDeltaLog(GetDatabaseState(db));
+    bool known;
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        auto it = log.branches.find(branch);
+        known = it != log.branches.end() && it->second.generation == generation;
+    }
+
+    // Snapshots are read outside the lock; a concurrent call for the same
+    // generation may read one too, and the second to arrive drops its copy
+    GraphRecords vertices, edges;
+    if (!known) {
+        std::string error;
+        if (!ReadSnapshot(db, branch, vertices, edges, error)) {
+            if (!error.empty()) {
+                sqlite3_result_error(context, error.c_str(), -1);
+                return;
+            }
+            return untracked();
+        }
+    }
+
+    std::set<GraphRecord> addedVertices, removedVertices, addedEdges, removedEdges;
+    uint64_t sequence;
+    bool reload = !hasSince;
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        bool existed = log.branches.count(branch) > 0;
+        if (!existed && known) return untracked(); // evicted since
+        BranchDeltaLog& branchLog = log.branches[branch];
+        branchLog.lastUsed = ++log.clock;
+        if (!existed) {
+            branchLog.generation = generation;
+            branchLog.sequence = ++log.sequence;
+            branchLog.vertices = std::move(vertices);
+            branchLog.edges = std::move(edges);
+            reload = true;
+        } else if (generation > branchLog.generation) {
+            DeltaEntry entry{ branchLog.sequence, ++log.sequence, {} };
+            Diff(branchLog.vertices, vertices, entry.changes.addedVertices, entry.changes.removedVertices);
+            Diff(branchLog.edges, edges, entry.changes.addedEdges, entry.changes.removedEdges);
+            branchLog.generation = generation;
+            branchLog.sequence = entry.to;
+            branchLog.vertices = std::move(vertices);
+            branchLog.edges = std::move(edges);
+            branchLog.entries.push_back(std::move(entry));
+            if (branchLog.entries.size() > MaxLogEntries) branchLog.entries.pop_front();
+        }
+        sequence = branchLog.sequence;
+
+        if (!reload && since != sequence) {
+            auto first = std::find_if(branchLog.entries.begin(), branchLog.entries.end(),
+                                      [since](const DeltaEntry& e) { return e.from == since; });
+            reload = first == branchLog.entries.end();
+            for (auto it = first; it != branchLog.entries.end(); ++it) {
+                const GraphChanges& c = it->changes;
+                Fold(addedVertices, removedVertices, c.addedVertices, c.removedVertices);
+                Fold(addedEdges, removedEdges, c.addedEdges, c.removedEdges);
+            }
+            // Past the size of the graph itself the full reload is cheaper
+            size_t changed = addedVertices.size() + removedVertices.size() + addedEdges.size() + removedEdges.size();
+            if (changed > branchLog.vertices.size() + branchLog.edges.size()) reload = true;
+        }
+        EvictBranches(log);
+    }
+
+    std::string json;
+    if (reload) {
+        json = ReloadJson(branch, &sequence);
+    } else {
+        JsonBuilder jb;
+        jb.beginObject();
+        jb.key("branch"); jb.string(branch); jb.comma();
+        jb.key("generation"); jb.raw(std::to_string(sequence)); jb.comma();
+        jb.key("since"); jb.raw(std::to_string(since)); jb.comma();
+        jb.key("reload"); jb.raw("false"); jb.comma();
+        WriteChanges(jb, "vertices", addedVertices, removedVertices);
+        jb.comma();
+        WriteChanges(jb, "edges", addedEdges, removedEdges);
+        jb.endObject();
+        json = jb.str();
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// get_project_dependency_graph_delta(branch[, sinceGeneration]) - changes to
+// the project graph of branch (the vertices and edges of the '*' graphs)
+// since a generation an earlier call returned:
+//
+//   {"branch","generation","since","reload":false,
+//    "vertices":{"added":[{id,name,type,branch,addr}...],"removed":[id...]},
+//    "edges":{"added":[{id,fromId,toId}...],"removed":[id...]}}
+//
+// Removals apply before additions; a vertex whose project changed is removed
+// and added again. {"reload":true} means the full graph has to be fetched
+// again: sinceGeneration is NULL/omitted, unknown or too old, or the delta
+// wouldn't be smaller. Its "generation" is the one to pass next, and is null
+// while changes can't be tracked (result cache disabled, writes pending).
+void ProjectGraphDelta(sqlite3_context* context, int argc, sqlite3_value** argv);
@@ -0,0 +1,177 @@
+#include "graph.h"
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+// Spacing in layout units; the client scales to screen pixels
+static const int NodeSpacing = 80;
+static const int LayerSpacing = 120;
+
+std::vector<int> StronglyConnectedComponents(const OrthogonalGraph& graph, int& componentCount) {
+    const int n = (int)graph.vertices.size();
+    std::vector<int> index(n, -1), low(n, 0), component(n, -1);
+    std::vector<bool> onStack(n, false);
+    std::vector<int> stack;
+    std::vector<std::pair<int, int>> callStack; // (vertex, next out-edge to visit)
+    int counter = 0;
+    componentCount = 0;
+
+    for (int root = 0; root < n; ++root) {
+        if (index[root] != -1) continue;
+        callStack.push_back({ root, graph.vertices[root].firstOut });
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = true;
+
+        while (!callStack.empty()) {
+            auto& frame = callStack.back();
+            int v = frame.first;
+            if (frame.second != -1) {
+                const OGEdge& e = graph.edges[frame.second];
+                frame.second = e.tailnext;
+                int w = e.headvertex;
+                if (index[w] == -1) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = true;
+                    callStack.push_back({ w, graph.vertices[w].firstOut });
+                } else if (onStack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            if (low[v] == index[v]) {
+                int w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    component[w] = componentCount;
+                } while (w != v);
+                componentCount++;
+            }
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                int parent = callStack.back().first;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+        }
+    }
+    return component;
+}
+
+GraphLayout ComputeLayeredLayout(const OrthogonalGraph& graph, int sweeps) {
+    GraphLayout layout;
+    const int n = (int)graph.vertices.size();
+    layout.vertices.resize(n);
+    if (n == 0) return layout;
+
+    int componentCount = 0;
+    std::vector<int> component = StronglyConnectedComponents(graph, componentCount);
+
+    // 1. Stack each component's members by BFS depth inside the component,
+    //    starting from its lowest-index member
+    std::vector<std::vector<int>> members(componentCount);
+    for (int v = 0; v < n; ++v) members[component[v]].push_back(v);
+
+    std::vector<int> localDepth(n, -1);
+    std::vector<int> componentHeight(componentCount, 1);
+    for (int c = 0; c < componentCount; ++c) {
+        if (members[c].size() == 1) {
+            localDepth[members[c][0]] = 0;
+            continue;
+        }
+        std::queue<int> queue;
+        queue.push(members[c][0]);
+        localDepth[members[c][0]] = 0;
+        while (!queue.empty()) {
+            int v = queue.front();
+            queue.pop();
+            for (int e = graph.vertices[v].firstOut; e != -1; e = graph.edges[e].tailnext) {
+                int w = graph.edges[e].headvertex;
+                if (component[w] != c || localDepth[w] != -1) continue;
+                localDepth[w] = localDepth[v] + 1;
+                componentHeight[c] = std::max(componentHeight[c], localDepth[w] + 1);
+                queue.push(w);
+            }
+        }
+    }
+
+    // 2. Longest-path ranking on the condensed DAG. Tarjan numbers components
+    //    so that every edge goes from a higher to a lower (or equal) index.
+    std::vector<int> componentLayer(componentCount, 0);
+    for (int c = componentCount - 1; c >= 0; --c) {
+        int next = componentLayer[c] + componentHeight[c];
+        for (int v : members[c]) {
+            for (int e = graph.vertices[v].firstOut; e != -1; e = graph.edges[e].tailnext) {
+                int d = component[graph.edges[e].headvertex];
+                if (d != c) componentLayer[d] = std::max(componentLayer[d], next);
+            }
+        }
+    }
+
+    int layerCount = 0;
+    for (int v = 0; v < n; ++v) {
+        layout.vertices[v].layer = componentLayer[component[v]] + localDepth[v];
+        layerCount = std::max(layerCount, layout.vertices[v].layer + 1);
+    }
+
+    // 3. Initial order is vertex order, which follows BFS discovery
+    std::vector<std::vector<int>> layers(layerCount);
+    for (int v = 0; v < n; ++v) layers[layout.vertices[v].layer].push_back(v);
+
+    std::vector<double> position(n);
+    auto updatePositions = [&](const std::vector<int>& layer) {
+        for (size_t i = 0; i < layer.size(); ++i) {
+            layout.vertices[layer[i]].order = (int)i;
+            position[layer[i]] = (i + 0.5) / layer.size();
+        }
+    };
+    for (const auto& layer : layers) updatePositions(layer);
+
+    // 4. Barycentric sweeps: order each layer by the mean position of its
+    //    neighbours in the layers above (down pass) or below (up pass)
+    std::vector<double> barycenter(n);
+    auto sortLayer = [&](std::vector<int>& layer, bool down) {
+        for (int v : layer) {
+            double sum = 0;
+            int count = 0;
+            const int l = layout.vertices[v].layer;
+            if (down) {
+                for (int e = graph.vertices[v].firstIn; e != -1; e = graph.edges[e].headnext) {
+                    int u = graph.edges[e].tailvertex;
+                    if (layout.vertices[u].layer < l) { sum += position[u]; count++; }
+                }
+            } else {
+                for (int e = graph.vertices[v].firstOut; e != -1; e = graph.edges[e].tailnext) {
+                    int w = graph.edges[e].headvertex;
+                    if (layout.vertices[w].layer > l) { sum += position[w]; count++; }
+                }
+            }
+            barycenter[v] = count > 0 ? sum / count : position[v];
+        }
+        std::stable_sort(layer.begin(), layer.end(), [&](int a, int b) { return barycenter[a] < barycenter[b]; });
+        updatePositions(layer);
+    };
+    for (int i = 0; i < sweeps; ++i) {
+        for (int l = 1; l < layerCount; ++l) sortLayer(layers[l], true);
+        for (int l = layerCount - 2; l >= 0; --l) sortLayer(layers[l], false);
+    }
+
+    // 5. Coordinates: layers are centred horizontally on x = 0
+    size_t widest = 0;
+    for (const auto& layer : layers) {
+        widest = std::max(widest, layer.size());
+        for (size_t i = 0; i < layer.size(); ++i) {
+            VertexLayout& l = layout.vertices[layer[i]];
+            l.x = (2 * (int)i - ((int)layer.size() - 1)) * NodeSpacing / 2;
+            l.y = l.layer * LayerSpacing;
+        }
+    }
+    layout.width = (int)widest * NodeSpacing;
+    layout.height = layerCount * LayerSpacing;
+    layout.layers = layerCount;
+    return layout;
+}
@@ -0,0 +1,335 @@
+#include "graph-query.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "content-hash.h"
+#include "graph.h"
+#include "graph-spill.h"
+#include "gzip-writer.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// Collects serialized graphs either as plain JSON or through a GzipWriter,
+// hashing the plain JSON on the way
+class GraphOutput {
+    std::string plain;
+    std::unique_ptr<GzipWriter> gzip;
+    ContentHash hash;
+public:
+    explicit GraphOutput(bool compress) : gzip(compress ? new GzipWriter() : nullptr) {}
+
+    void write(std::string_view data) {
+        hash.update(data);
+        if (gzip) gzip->write(data);
+        else plain.append(data);
+    }
+    uint64_t contentHash() const { return hash.digest(); }
+    JsonSink sink() {
+        return [this](std::string_view data) { write(data); };
+    }
+    bool finish(std::string& out, std::string& error) {
+        if (!gzip) {
+            out = std::move(plain);
+            return true;
+        }
+        if (gzip->finish(out)) return true;
+        error = "gzip compression failed";
+        return false;
+    }
+};
+
+// What a node graph takes until it is serialized: rowids and connections while
+// it is walked, then the OrthogonalGraph built from them
+static size_t KeyedGraphBytes(size_t nodes, size_t connections) {
+    return nodes * (sizeof(sqlite3_int64) + sizeof(OGVertex)) + connections * (sizeof(GraphConnection) + sizeof(OGEdge));
+}
+
+bool QueryNodeGraph(sqlite3* db, const NodeGraphQuery& query, std::string& json, std::string& error,
+                    uint64_t* contentHash) {
+    TraversalFilter filter;
+    if (!ParseTraversalFilter(query.filter.c_str(), filter, error)) return false;
+
+    std::string cacheKey = ResultCacheKey("get_node_dependency_graph",
+                                          { query.nodeId, std::to_string(query.depth), query.filter, query.layout ? "1" : "0",
+                                            query.gzip ? "gzip" : "" });
+    ResultCacheTicket ticket;
+    if (ResultCacheLookup(db, cacheKey, json, ticket, contentHash)) return true;
+
+    // Phase one walks rowids only; rows are read once, by SerializeNodeGraph,
+    // for the vertices that made it into the graph
+    NodeTraversal traversal(db, query.nodeId, query.depth, TraversalDirection::Both, filter);
+    traversal.RetainIds(false);
+
+    std::vector<sqlite3_int64> nodeKeys;
+    std::vector<size_t> levelStarts; // into nodeKeys; each level is ascending
+    std::vector<GraphConnection> connList;
+    std::vector<sqlite3_int64> levelKeys;
+    std::vector<GraphConnection> levelConnections;
+    std::vector<GraphNode> levelNodes;
+    std::unique_ptr<SpilledGraph> spill;
+    size_t bytes = 0;
+    while (traversal.NextKeys(levelKeys, levelConnections)) {
+        // What the traversal keeps per visited node can't be spilled; past
+        // the budget on its own the query fails rather than outgrow it
+        if (query.memoryBudget > 0 && traversal.StateBytes() > query.memoryBudget) {
+            error = "node graph traversal exceeds the memory budget of " + std::to_string(query.memoryBudget) + " bytes";
+            return false;
+        }
+        if (spill) {
+            traversal.FetchNodes(levelKeys, levelNodes);
+            if (!spill->Add(levelNodes, levelConnections, error)) return false;
+            continue;
+        }
+        bytes += KeyedGraphBytes(levelKeys.size(), levelConnections.size());
+        levelStarts.push_back(nodeKeys.size());
+        nodeKeys.insert(nodeKeys.end(), levelKeys.begin(), levelKeys.end());
+        std::move(levelConnections.begin(), levelConnections.end(), std::back_inserter(connList));
+
+        if (query.memoryBudget > 0 && bytes + traversal.StateBytes() > query.memoryBudget) {
+            spill.reset(new SpilledGraph());
+            if (!spill->Open(error)) return false;
+            levelStarts.push_back(nodeKeys.size());
+            for (size_t i = 0; i + 1 < levelStarts.size(); ++i) {
+                levelKeys.assign(nodeKeys.begin() + levelStarts[i], nodeKeys.begin() + levelStarts[i + 1]);
+                traversal.FetchNodes(levelKeys, levelNodes);
+                if (!spill->Add(levelNodes, {}, error)) return false;
+            }
+            if (!spill->Add({}, connList, error)) return false;
+            std::vector<sqlite3_int64>().swap(nodeKeys);
+            std::vector<GraphConnection>().swap(connList);
+        }
+    }
+
+    // Spilled graphs are far past what the result cache would keep
+    if (spill) {
+        GraphOutput output(query.gzip);
+        if (!spill->Serialize(output.sink(), error) || !output.finish(json, error)) return false;
+        if (contentHash) *contentHash = output.contentHash();
+        return true;
+    }
+    
+    OrthogonalGraph og = BuildKeyedOrthogonalGraph(nodeKeys, connList);
+    std::vector<GraphConnection>().swap(connList);
+    auto cycles = DetectCycles(og);
+    GraphLayout layout;
+    if (query.layout) layout = ComputeLayeredLayout(og);
+    GraphOutput output(query.gzip);
+    std::vector<std::string> branches;
+    if (!SerializeNodeGraph(db, output.sink(), og, cycles, query.layout ? &layout : nullptr, branches, error) ||
+        !output.finish(json, error)) {
+        return false;
+    }
+
+    if (contentHash) *contentHash = output.contentHash();
+
+    // An unknown root isn't cached: inserting it later wouldn't invalidate anything
+    if (!nodeKeys.empty()) ResultCacheStore(db, ticket, cacheKey, json, branches, output.contentHash());
+    return true;
+}
+
+// --- Level Streaming ---
+//
+// Unlike QueryNodeGraph, rows are read as each level is reached (Next rather
+// than NextKeys), and the cuids ResolveIds needs are kept: a line has to be
+// complete when it is handed out, and the first ones should not wait for the
+// deepest level.
+
+static const size_t LevelLineItems = 4096; // vertices + edges per NDJSON line
+
+// Writes the NDJSON lines, splitting levels past LevelLineItems
+class LevelWriter {
+    const GraphLevelSink& sink;
+    std::string line;
+    JsonBuilder jb{ [this](std::string_view data) { line.append(data); } };
+    int depth = 0;
+    int deepest = 0; // of the vertices written
+    size_t items = 0;
+    bool inEdges = false;
+    bool open = false;
+    bool stopped = false;
+
+public:
+    size_t vertexCount = 0, edgeCount = 0;
+
+    explicit LevelWriter(const GraphLevelSink& sink) : sink(sink) {}
+
+    bool Stopped() const { return stopped; }
+
+    void BeginLevel(int d) { depth = d; }
+
+    void Vertex(const GraphNode& n) {
+        Item(false);
+        jb.beginObject();
+        jb.key("data");
+        WriteGraphVertexData(jb, n);
+        jb.endObject();
+        vertexCount++;
+        deepest = depth;
+    }
+
+    void Edge(const GraphConnection& c) {
+        Item(true);
+        jb.beginObject();
+            jb.key("data");
+            jb.beginObject();
+                jb.key("id"); jb.string(c.id); jb.comma();
+                jb.key("fromId"); jb.string(c.fromId); jb.comma();
+                jb.key("toId"); jb.string(c.toId);
+            jb.endObject();
+        jb.endObject();
+        edgeCount++;
+    }
+
+    // Closes the current line, if any, and hands it to the sink
+    void EndLine() {
+        if (!open) return;
+        if (!inEdges) {
+            jb.endArray();
+            jb.comma();
+            jb.key("edges");
+            jb.beginArray();
+        }
+        jb.endArray();
+        jb.endObject();
+        Emit();
+        open = false;
+    }
+
+    void Done() {
+        EndLine();
+        if (stopped) return;
+        jb.beginObject();
+        jb.key("done"); jb.raw("true"); jb.comma();
+        jb.key("depth"); jb.number(deepest); jb.comma();
+        jb.key("vertexCount"); jb.number((int)vertexCount); jb.comma();
+        jb.key("edgeCount"); jb.number((int)edgeCount);
+        jb.endObject();
+        Emit();
+    }
+
+private:
+    void Item(bool edge) {
+        if (open && items >= LevelLineItems) EndLine();
+        if (!open) {
+            jb.beginObject();
+            jb.key("depth"); jb.number(depth); jb.comma();
+            jb.key("vertices");
+            jb.beginArray();
+            open = true;
+            items = 0;
+            inEdges = false;
+        }
+        if (edge && !inEdges) {
+            jb.endArray();
+            jb.comma();
+            jb.key("edges");
+            jb.beginArray();
+            inEdges = true;
+        } else if (items > 0) {
+            jb.comma();
+        }
+        items++;
+    }
+
+    void Emit() {
+        jb.raw("\n");
+        jb.flush();
+        if (!stopped && !sink(std::move(line))) stopped = true;
+        line.clear();
+    }
+};
+
+bool StreamNodeGraphLevels(sqlite3* db, const NodeGraphQuery& query, const GraphLevelSink& sink, std::string& error) {
+    TraversalFilter filter;
+    if (!ParseTraversalFilter(query.filter.c_str(), filter, error)) return false;
+
+    NodeTraversal traversal(db, query.nodeId, query.depth, TraversalDirection::Both, filter);
+    LevelWriter writer(sink);
+    std::vector<GraphNode> nodes;
+    std::vector<GraphConnection> connections;
+    while (!writer.Stopped() && traversal.Next(nodes, connections)) {
+        traversal.ResolveIds(connections);
+        writer.BeginLevel(traversal.Depth());
+        for (const GraphNode& n : nodes) writer.Vertex(n);
+        for (const GraphConnection& c : connections) {
+            // As in BuildOrthogonalGraph, edges to vertices that weren't handed out are dropped
+            if (!c.fromId.empty() && !c.toId.empty()) writer.Edge(c);
+        }
+        writer.EndLine();
+    }
+    writer.Done();
+    return true;
+}
+
+bool QueryProjectGraph(sqlite3* db, const ProjectGraphQuery& query, std::string& json, std::string& error,
+                       uint64_t* contentHash) {
+    TraversalFilter filter;
+    if (!ParseTraversalFilter(query.filter.c_str(), filter, error)) return false;
+
+    std::string cacheKey = ResultCacheKey("get_project_dependency_graph",
+                                          { query.projectId, query.branch, std::to_string(query.depth), query.filter,
+                                            query.layout ? "1" : "0", query.gzip ? "gzip" : "" });
+    ResultCacheTicket ticket;
+    if (ResultCacheLookup(db, cacheKey, json, ticket, contentHash)) return true;
+
+    const std::string& branch = query.branch;
+    bool withLayout = query.layout;
+    GraphOutput output(query.gzip);
+    if (query.projectId == "*") {
+        // Multi-graph mode
+        std::vector<std::string> allProjects;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT id, name FROM Project ORDER BY id", -1, &stmt, NULL) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                if (filter.excludeProjects.count((const char*)sqlite3_column_text(stmt, 1))) continue;
+                allProjects.push_back((const char*)sqlite3_column_text(stmt, 0));
+            }
+            sqlite3_finalize(stmt);
+        }
+        
+        std::unordered_set<std::string> remainingProjects(allProjects.begin(), allProjects.end());
+        bool first = true;
+        output.write("[");
+        
+        // Just iterate through the original list to maintain a stable order
+        for (const auto& pid : allProjects) {
+            // Check if still in remaining (not yet covered by another graph)
+            if (remainingProjects.find(pid) == remainingProjects.end()) {
+                continue;
+            }
+            
+            // Build graph with unlimited depth for this project
+            // Using a large number for unlimited depth
+            ProjectGraphResult res = BuildProjectGraphImpl(db, pid, branch, 100000, true, filter); // Detect cycles for * mode
+            
+            // Remove contained projects from remaining
+            for (const auto& node : res.graph.vertices) {
+                remainingProjects.erase(node.data.id);
+            }
+            
+            // Serialize straight into the output so only one graph is held at a time
+            GraphLayout layout;
+            if (withLayout) layout = ComputeLayeredLayout(res.graph);
+            if (!first) output.write(",");
+            first = false;
+            SerializeGraph(output.sink(), res.graph, res.cycles, withLayout ? &layout : nullptr);
+        }
+        output.write("]");
+    } else {
+        // Single project mode
+        ProjectGraphResult res = BuildProjectGraphImpl(db, query.projectId, branch, query.depth, false, filter); // Skip cycles for single project
+        GraphLayout layout;
+        if (withLayout) layout = ComputeLayeredLayout(res.graph);
+        SerializeGraph(output.sink(), res.graph, res.cycles, withLayout ? &layout : nullptr);
+    }
+    if (!output.finish(json, error)) return false;
+    if (contentHash) *contentHash = output.contentHash();
+
+    ResultCacheStore(db, ticket, cacheKey, json, { branch }, output.contentHash());
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include "sqlite3.h"
+
+// Entry points behind get_node_dependency_graph / get_project_dependency_graph,
+// shared by the SQL functions and the N-API binding. Results go through the
+// result cache; false (with error set) means the filter didn't parse or a
+// node graph went past its memory budget even spilled.
+//
+// With gzip set the result is a gzip stream instead of plain JSON, compressed
+// while it is serialized and cached in that form. Together with a memory
+// budget this keeps huge node graphs to roughly their compressed size.
+
+struct NodeGraphQuery {
+    std::string nodeId;
+    int depth = 100;
+    std::string filter; // TraversalFilter JSON, empty for none
+    bool layout = false;
+    bool gzip = false;
+    // Bytes the buffered graph and the traversal may take before the graph
+    // spills to a temporary database (see graph-spill.h). The traversal keeps
+    // one entry per visited node in memory regardless; past the budget on its
+    // own the query fails. 0 for no limit
+    size_t memoryBudget = 512 * 1024 * 1024;
+};
+
+struct ProjectGraphQuery {
+    std::string projectId; // "*" for every project graph of the branch
+    std::string branch;
+    int depth = 100;
+    std::string filter;
+    bool layout = false;
+    bool gzip = false;
+};
+
+// contentHash, if given, receives the XXH64 of the plain JSON (see
+// content-hash.h), the same whether the result was gzipped or cached.
+bool QueryNodeGraph(sqlite3* db, const NodeGraphQuery& query, std::string& json, std::string& error,
+                    uint64_t* contentHash = nullptr);
+bool QueryProjectGraph(sqlite3* db, const ProjectGraphQuery& query, std::string& json, std::string& error,
+                       uint64_t* contentHash = nullptr);
+
+// The node graph of query one BFS level at a time, as NDJSON:
+//
+//   {"depth":0,"vertices":[{"data":{...}}],"edges":[]}
+//   {"depth":1,"vertices":[...],"edges":[{"data":{"id":..,"fromId":..,"toId":..}}]}
+//   {"done":true,"depth":1,"vertexCount":..,"edgeCount":..}
+//
+// Vertex data is what get_node_dependency_graph writes. Large levels are split
+// over several lines of the same depth, vertices before edges, so an edge only
+// ever names vertices of its own line or earlier ones. Orthogonal-list indices,
+// cycles and layouts need the whole graph and are left out; layout, gzip and
+// the memory budget are ignored. Each line (newline included) goes to sink as
+// soon as it is written; a false return stops the walk without an error.
+// Nothing is cached.
+using GraphLevelSink = std::function<bool(std::string&& line)>;
+bool StreamNodeGraphLevels(sqlite3* db, const NodeGraphQuery& query, const GraphLevelSink& sink, std::string& error);
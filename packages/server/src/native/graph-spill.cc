@@ -0,0 +1,169 @@
+#include "graph-spill.h"
+
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Spilled Graphs ---
+//
+// A depth-unbounded traversal from a hub of a large branch produces millions
+// of rows, and the in-memory path holds each of them three times: the level
+// buffers, the OrthogonalGraph copy and the serialized JSON. Past the budget
+// the rows go to an unnamed database instead (a temporary file SQLite deletes
+// on close), whose page cache is the only memory it takes. What stays in
+// memory is the traversal's depth per visited node (see AddConnection in
+// graph.cc), which QueryNodeGraph counts against the same budget.
+//
+// The orthogonal lists are derived there rather than built: vertex and edge
+// indices are insertion order, as in BuildOrthogonalGraph, so
+//
+//   firstIn / firstOut   = the last edge into / out of the vertex
+//   headnext / tailnext  = the previous edge into the same head / out of the same tail
+//
+// and both are index lookups on (head, idx) / (tail, idx). Rows are then
+// streamed to the sink in index order.
+
+static const int SpillCacheKiB = 16 * 1024;
+
+SpilledGraph::~SpilledGraph() {
+    sqlite3_finalize(insertVertex);
+    sqlite3_finalize(insertConnection);
+    if (db) sqlite3_close(db);
+}
+
+bool SpilledGraph::fail(std::string& error) {
+    error = std::string("graph spill: ") + sqlite3_errmsg(db);
+    return false;
+}
+
+bool SpilledGraph::Open(std::string& error) {
+    // An empty filename opens a private on-disk database
+    if (sqlite3_open_v2("", &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) return fail(error);
+
+    std::string setup =
+        "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA temp_store = FILE; "
+        "PRAGMA cache_size = -" + std::to_string(SpillCacheKiB) + "; "
+        "CREATE TABLE v(idx INTEGER PRIMARY KEY, key INTEGER, id TEXT, name TEXT, type TEXT, projectName TEXT, "
+        "branch TEXT, relativePath TEXT, startLine INTEGER, startColumn INTEGER); "
+        "CREATE TABLE c(seq INTEGER PRIMARY KEY, fromKey INTEGER, toKey INTEGER); "
+        "BEGIN;";
+    if (sqlite3_exec(db, setup.c_str(), NULL, NULL, NULL) != SQLITE_OK) return fail(error);
+    if (sqlite3_prepare_v2(db, "INSERT INTO v VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", -1, &insertVertex, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT INTO c(fromKey, toKey) VALUES (?, ?)", -1, &insertConnection, NULL) != SQLITE_OK) {
+        return fail(error);
+    }
+    return true;
+}
+
+bool SpilledGraph::Add(const std::vector<GraphNode>& nodes, const std::vector<GraphConnection>& connections,
+                       std::string& error) {
+    for (const GraphNode& n : nodes) {
+        sqlite3_bind_int64(insertVertex, 1, vertexCount++);
+        sqlite3_bind_int64(insertVertex, 2, n.key);
+        sqlite3_bind_text(insertVertex, 3, n.id.c_str(), (int)n.id.size(), SQLITE_STATIC);
+        sqlite3_bind_text(insertVertex, 4, n.name.c_str(), (int)n.name.size(), SQLITE_STATIC);
+        sqlite3_bind_text(insertVertex, 5, n.type.c_str(), (int)n.type.size(), SQLITE_STATIC);
+        sqlite3_bind_text(insertVertex, 6, n.projectName.c_str(), (int)n.projectName.size(), SQLITE_STATIC);
+        sqlite3_bind_text(insertVertex, 7, n.branch.c_str(), (int)n.branch.size(), SQLITE_STATIC);
+        sqlite3_bind_text(insertVertex, 8, n.relativePath.c_str(), (int)n.relativePath.size(), SQLITE_STATIC);
+        sqlite3_bind_int(insertVertex, 9, n.startLine);
+        sqlite3_bind_int(insertVertex, 10, n.startColumn);
+        bool ok = sqlite3_step(insertVertex) == SQLITE_DONE;
+        sqlite3_reset(insertVertex);
+        if (!ok) return fail(error);
+    }
+    for (const GraphConnection& c : connections) {
+        sqlite3_bind_int64(insertConnection, 1, c.fromKey);
+        sqlite3_bind_int64(insertConnection, 2, c.toKey);
+        bool ok = sqlite3_step(insertConnection) == SQLITE_DONE;
+        sqlite3_reset(insertConnection);
+        if (!ok) return fail(error);
+    }
+    return true;
+}
+
+static const char* ColumnString(sqlite3_stmt* stmt, int col) {
+    const char* text = (const char*)sqlite3_column_text(stmt, col);
+    return text ? text : "";
+}
+
+bool SpilledGraph::Serialize(const JsonSink& sink, std::string& error) {
+    // Edges whose endpoint wasn't fetched are dropped, as BuildOrthogonalGraph does;
+    // e.idx is 1-based, the JSON indices are not
+    const char* index =
+        "CREATE INDEX v_key ON v(key); "
+        "CREATE TABLE e(idx INTEGER PRIMARY KEY, tail INTEGER, head INTEGER); "
+        "INSERT INTO e(tail, head) SELECT t.idx, h.idx FROM c JOIN v t ON t.key = c.fromKey "
+        "JOIN v h ON h.key = c.toKey ORDER BY c.seq; "
+        "CREATE INDEX e_head ON e(head, idx); "
+        "CREATE INDEX e_tail ON e(tail, idx);";
+    if (sqlite3_exec(db, index, NULL, NULL, NULL) != SQLITE_OK) return fail(error);
+
+    JsonBuilder jb(sink);
+    jb.beginObject();
+    jb.key("vertices");
+    jb.beginArray();
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT id, name, type, projectName, branch, relativePath, startLine, startColumn, "
+                           "COALESCE((SELECT MAX(idx) FROM e WHERE head = v.idx), 0) - 1, "
+                           "COALESCE((SELECT MAX(idx) FROM e WHERE tail = v.idx), 0) - 1, "
+                           "(SELECT COUNT(*) FROM e WHERE head = v.idx), "
+                           "(SELECT COUNT(*) FROM e WHERE tail = v.idx) "
+                           "FROM v ORDER BY idx",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return fail(error);
+    }
+    OGVertex v;
+    bool first = true;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        v.data.id = ColumnString(stmt, 0);
+        v.data.name = ColumnString(stmt, 1);
+        v.data.type = ColumnString(stmt, 2);
+        v.data.projectName = ColumnString(stmt, 3);
+        v.data.branch = ColumnString(stmt, 4);
+        v.data.relativePath = ColumnString(stmt, 5);
+        v.data.startLine = sqlite3_column_int(stmt, 6);
+        v.data.startColumn = sqlite3_column_int(stmt, 7);
+        v.firstIn = sqlite3_column_int(stmt, 8);
+        v.firstOut = sqlite3_column_int(stmt, 9);
+        v.inDegree = sqlite3_column_int(stmt, 10);
+        v.outDegree = sqlite3_column_int(stmt, 11);
+        if (!first) jb.comma();
+        first = false;
+        WriteGraphVertex(jb, v, nullptr);
+    }
+    if (sqlite3_finalize(stmt) != SQLITE_OK) return fail(error);
+    jb.endArray();
+    jb.comma();
+
+    jb.key("edges");
+    jb.beginArray();
+    if (sqlite3_prepare_v2(db,
+                           "SELECT e.tail, e.head, "
+                           "COALESCE((SELECT MAX(n.idx) FROM e n WHERE n.head = e.head AND n.idx < e.idx), 0) - 1, "
+                           "COALESCE((SELECT MAX(n.idx) FROM e n WHERE n.tail = e.tail AND n.idx < e.idx), 0) - 1, "
+                           "t.id, h.id "
+                           "FROM e JOIN v t ON t.idx = e.tail JOIN v h ON h.idx = e.head ORDER BY e.idx",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return fail(error);
+    }
+    OGEdge e;
+    first = true;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        e.tailvertex = sqlite3_column_int(stmt, 0);
+        e.headvertex = sqlite3_column_int(stmt, 1);
+        e.headnext = sqlite3_column_int(stmt, 2);
+        e.tailnext = sqlite3_column_int(stmt, 3);
+        if (!first) jb.comma();
+        first = false;
+        WriteGraphEdge(jb, e, ColumnString(stmt, 4), ColumnString(stmt, 5));
+    }
+    if (sqlite3_finalize(stmt) != SQLITE_OK) return fail(error);
+    jb.endArray();
+    jb.comma();
+    jb.key("spilled"); jb.raw("true");
+    jb.endObject();
+    jb.flush();
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "graph.h"
+#include "sqlite3.h"
+
+// A node graph buffered in a private temporary database instead of memory,
+// for traversals too large to hold as vectors plus an OrthogonalGraph copy.
+// Levels are appended as the traversal produces them; Serialize() writes the
+// same "vertices"/"edges" JSON as SerializeGraph, with the orthogonal-list
+// indices computed by the temporary database, followed by "spilled":true.
+// Cycles and layouts need the whole graph in memory and are left out.
+class SpilledGraph {
+    sqlite3* db = nullptr;
+    sqlite3_stmt* insertVertex = nullptr;
+    sqlite3_stmt* insertConnection = nullptr;
+    sqlite3_int64 vertexCount = 0;
+
+    bool fail(std::string& error);
+
+public:
+    SpilledGraph() = default;
+    SpilledGraph(const SpilledGraph&) = delete;
+    SpilledGraph& operator=(const SpilledGraph&) = delete;
+    ~SpilledGraph();
+
+    bool Open(std::string& error);
+    bool Add(const std::vector<GraphNode>& nodes, const std::vector<GraphConnection>& connections, std::string& error);
+    bool Serialize(const JsonSink& sink, std::string& error);
+};
@@ -0,0 +1,932 @@
+#include "graph.h"
+
+#include <string.h>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include "json-reader.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Graph Algorithms ---
+
+// Links a new edge in front of the in-list of toIndex and the out-list of fromIndex
+static void AddOrthogonalEdge(OrthogonalGraph& graph, int fromIndex, int toIndex, const GraphConnection& conn) {
+    int edgeIndex = (int)graph.edges.size();
+    
+    // Update Target (Incoming)
+    int currentFirstIn = graph.vertices[toIndex].firstIn;
+    graph.vertices[toIndex].firstIn = edgeIndex;
+    graph.vertices[toIndex].inDegree++;
+    
+    // Update Source (Outgoing)
+    int currentFirstOut = graph.vertices[fromIndex].firstOut;
+    graph.vertices[fromIndex].firstOut = edgeIndex;
+    graph.vertices[fromIndex].outDegree++;
+    
+    OGEdge edge;
+    edge.data = conn;
+    edge.tailvertex = fromIndex;
+    edge.headvertex = toIndex;
+    edge.headnext = currentFirstIn;
+    edge.tailnext = currentFirstOut;
+    
+    graph.edges.push_back(std::move(edge));
+}
+
+OrthogonalGraph BuildOrthogonalGraph(const std::vector<GraphNode>& nodes, const std::vector<GraphConnection>& connections) {
+    OrthogonalGraph graph;
+    graph.vertices.reserve(nodes.size());
+    graph.edges.reserve(connections.size());
+    
+    // Node graphs are keyed by rowid, project graphs by id
+    bool byKey = !nodes.empty() && nodes[0].key != 0;
+    std::unordered_map<sqlite3_int64, int> nodeKeyMap;
+    std::unordered_map<std::string, int> nodeIndexMap;
+    
+    // 1. Create Vertices
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (byKey) nodeKeyMap[nodes[i].key] = (int)i;
+        else nodeIndexMap[nodes[i].id] = (int)i;
+        OGVertex v;
+        v.data = nodes[i];
+        graph.vertices.push_back(std::move(v));
+    }
+    
+    // 2. Create Edges
+    for (const auto& conn : connections) {
+        int fromIndex, toIndex;
+        if (byKey) {
+            auto itFrom = nodeKeyMap.find(conn.fromKey);
+            auto itTo = nodeKeyMap.find(conn.toKey);
+            if (itFrom == nodeKeyMap.end() || itTo == nodeKeyMap.end()) continue;
+            fromIndex = itFrom->second;
+            toIndex = itTo->second;
+        } else {
+            auto itFrom = nodeIndexMap.find(conn.fromId);
+            auto itTo = nodeIndexMap.find(conn.toId);
+            if (itFrom == nodeIndexMap.end() || itTo == nodeIndexMap.end()) continue;
+            fromIndex = itFrom->second;
+            toIndex = itTo->second;
+        }
+        
+        AddOrthogonalEdge(graph, fromIndex, toIndex, conn);
+    }
+    
+    return graph;
+}
+
+OrthogonalGraph BuildKeyedOrthogonalGraph(const std::vector<sqlite3_int64>& keys,
+                                          const std::vector<GraphConnection>& connections) {
+    OrthogonalGraph graph;
+    graph.vertices.resize(keys.size());
+    graph.edges.reserve(connections.size());
+
+    std::unordered_map<sqlite3_int64, int> nodeKeyMap;
+    nodeKeyMap.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        nodeKeyMap[keys[i]] = (int)i;
+        graph.vertices[i].data.key = keys[i];
+    }
+
+    for (const auto& conn : connections) {
+        auto itFrom = nodeKeyMap.find(conn.fromKey);
+        auto itTo = nodeKeyMap.find(conn.toKey);
+        if (itFrom == nodeKeyMap.end() || itTo == nodeKeyMap.end()) continue;
+        AddOrthogonalEdge(graph, itFrom->second, itTo->second, conn);
+    }
+    return graph;
+}
+
+// Simple DFS-based cycle detection that finds all elementary cycles
+// Much faster than Johnson's algorithm - explores from each vertex independently
+
+void find_cycles_from_vertex(int start, const OrthogonalGraph& graph, std::vector<std::vector<GraphNode>>& cycles) {
+    std::vector<bool> visited(graph.vertices.size(), false);
+    std::vector<bool> on_stack(graph.vertices.size(), false);
+    std::vector<int> path;
+    
+    struct StackFrame {
+        int node;
+        int edge_idx;
+        bool first_visit;
+    };
+    
+    std::vector<StackFrame> stack;
+    stack.push_back({start, graph.vertices[start].firstOut, true});
+    
+    while (!stack.empty()) {
+        StackFrame& frame = stack.back();
+        
+        if (frame.first_visit) {
+            // First visit to this node
+            visited[frame.node] = true;
+            on_stack[frame.node] = true;
+            path.push_back(frame.node);
+            frame.first_visit = false;
+        }
+        
+        if (frame.edge_idx == -1) {
+            // No more edges, backtrack
+            on_stack[frame.node] = false;
+            path.pop_back();
+            stack.pop_back();
+            continue;
+        }
+        
+        const OGEdge& edge = graph.edges[frame.edge_idx];
+        int next = edge.headvertex;
+        frame.edge_idx = edge.tailnext; // Advance for next iteration
+        
+        if (next == start && path.size() > 1) {
+            // Found cycle back to start
+            std::vector<GraphNode> cycle;
+            for (int idx : path) {
+                cycle.push_back(graph.vertices[idx].data);
+            }
+            cycle.push_back(graph.vertices[start].data);
+            cycles.push_back(cycle);
+        } else if (!visited[next]) {
+            // Explore this path
+            stack.push_back({next, graph.vertices[next].firstOut, true});
+        }
+    }
+}
+
+std::vector<std::vector<GraphNode>> DetectCycles(const OrthogonalGraph& graph) {
+    std::vector<std::vector<GraphNode>> cycles;
+    
+    // Find cycles by starting DFS from each vertex
+    // Each vertex can be the "root" of cycles that return to it
+    for (size_t i = 0; i < graph.vertices.size(); ++i) {
+        find_cycles_from_vertex(i, graph, cycles);
+    }
+    
+    return cycles;
+}
+
+void WriteGraphVertexData(JsonBuilder& jb, const GraphNode& n) {
+    jb.beginObject();
+        jb.key("id"); jb.string(n.id); jb.comma();
+        jb.key("name"); jb.string(n.name); jb.comma();
+        jb.key("type"); jb.string(n.type); jb.comma();
+        
+        if (!n.projectName.empty()) {
+           jb.key("projectName"); jb.string(n.projectName); jb.comma();
+        }
+        if (!n.projectId.empty()) {
+           jb.key("projectId"); jb.string(n.projectId); jb.comma();
+        }
+        
+        jb.key("branch"); jb.string(n.branch); jb.comma();
+        
+        if (!n.relativePath.empty()) {
+            jb.key("relativePath"); jb.string(n.relativePath); jb.comma();
+            jb.key("startLine"); jb.number(n.startLine); jb.comma();
+            jb.key("startColumn"); jb.number(n.startColumn);
+        } else if (!n.addr.empty()) {
+            jb.key("addr"); jb.string(n.addr);
+        } else {
+            jb.key("_"); jb.number(0); // Dummy
+        }
+    jb.endObject();
+}
+
+void WriteGraphVertex(JsonBuilder& jb, const OGVertex& v, const VertexLayout* layout) {
+    jb.beginObject();
+        jb.key("data");
+        WriteGraphVertexData(jb, v.data);
+        jb.comma();
+        
+        jb.key("firstIn"); jb.number(v.firstIn); jb.comma();
+        jb.key("firstOut"); jb.number(v.firstOut); jb.comma();
+        jb.key("inDegree"); jb.number(v.inDegree); jb.comma();
+        jb.key("outDegree"); jb.number(v.outDegree);
+
+        if (layout) {
+            jb.comma();
+            jb.key("layer"); jb.number(layout->layer); jb.comma();
+            jb.key("x"); jb.number(layout->x); jb.comma();
+            jb.key("y"); jb.number(layout->y);
+        }
+    jb.endObject();
+}
+
+void WriteGraphEdge(JsonBuilder& jb, const OGEdge& e, const std::string& fromId, const std::string& toId) {
+    jb.beginObject();
+        jb.key("data");
+        jb.beginObject();
+            jb.key("id"); jb.string(fromId + "-" + toId); jb.comma();
+            jb.key("fromId"); jb.string(fromId); jb.comma();
+            jb.key("toId"); jb.string(toId);
+        jb.endObject();
+        jb.comma();
+        
+        jb.key("tailvertex"); jb.number(e.tailvertex); jb.comma();
+        jb.key("headvertex"); jb.number(e.headvertex); jb.comma();
+        jb.key("headnext"); jb.number(e.headnext); jb.comma();
+        jb.key("tailnext"); jb.number(e.tailnext);
+    jb.endObject();
+}
+
+// Everything after "edges", closing the object
+static void WriteGraphTail(JsonBuilder& jb, const std::vector<std::vector<GraphNode>>& cycles, const GraphLayout* layout) {
+    // Cycles
+    if (!cycles.empty()) {
+        jb.comma();
+        jb.key("cycles");
+        jb.beginArray();
+        for (size_t i = 0; i < cycles.size(); ++i) {
+            if (i > 0) jb.comma();
+            jb.beginArray();
+            for (size_t j = 0; j < cycles[i].size(); ++j) {
+                if (j > 0) jb.comma();
+                jb.beginObject();
+                    jb.key("id"); jb.string(cycles[i][j].id); jb.comma();
+                    jb.key("name"); jb.string(cycles[i][j].name); jb.comma();
+                    jb.key("type"); jb.string(cycles[i][j].type);
+                jb.endObject();
+            }
+            jb.endArray();
+        }
+        jb.endArray();
+    }
+
+    if (layout) {
+        jb.comma();
+        jb.key("layout");
+        jb.beginObject();
+            jb.key("width"); jb.number(layout->width); jb.comma();
+            jb.key("height"); jb.number(layout->height); jb.comma();
+            jb.key("layers"); jb.number(layout->layers);
+        jb.endObject();
+    }
+
+    jb.endObject();
+}
+
+static void WriteGraph(JsonBuilder& jb, const OrthogonalGraph& graph, const std::vector<std::vector<GraphNode>>& cycles,
+                       const GraphLayout* layout) {
+    jb.beginObject();
+    
+    // Vertices
+    jb.key("vertices");
+    jb.beginArray();
+    for (size_t i = 0; i < graph.vertices.size(); ++i) {
+        if (i > 0) jb.comma();
+        WriteGraphVertex(jb, graph.vertices[i], layout ? &layout->vertices[i] : nullptr);
+    }
+    jb.endArray();
+    jb.comma();
+    
+    // Edges
+    jb.key("edges");
+    jb.beginArray();
+    for (size_t i = 0; i < graph.edges.size(); ++i) {
+        if (i > 0) jb.comma();
+        const auto& e = graph.edges[i];
+        // Endpoint ids come from the vertices; node connections only carry keys
+        WriteGraphEdge(jb, e, graph.vertices[e.tailvertex].data.id, graph.vertices[e.headvertex].data.id);
+    }
+    jb.endArray();
+
+    WriteGraphTail(jb, cycles, layout);
+}
+
+std::string SerializeGraph(const OrthogonalGraph& graph, const std::vector<std::vector<GraphNode>>& cycles,
+                           const GraphLayout* layout) {
+    JsonBuilder jb;
+    WriteGraph(jb, graph, cycles, layout);
+    return jb.str();
+}
+
+void SerializeGraph(const JsonSink& sink, const OrthogonalGraph& graph, const std::vector<std::vector<GraphNode>>& cycles,
+                    const GraphLayout* layout) {
+    JsonBuilder jb(sink);
+    WriteGraph(jb, graph, cycles, layout);
+    jb.flush();
+}
+
+// Rowids per metadata query when a node graph is serialized
+static const size_t MetadataBatchSize = 8192;
+
+static void AssignColumn(std::string& out, sqlite3_stmt* stmt, int col) {
+    const char* text = (const char*)sqlite3_column_text(stmt, col);
+    if (text) out.assign(text, sqlite3_column_bytes(stmt, col));
+    else out.clear();
+}
+
+bool SerializeNodeGraph(sqlite3* db, const JsonSink& sink, const OrthogonalGraph& graph,
+                        std::vector<std::vector<GraphNode>>& cycles, const GraphLayout* layout,
+                        std::vector<std::string>& branches, std::string& error) {
+    std::unordered_map<sqlite3_int64, GraphNode> cycleNodes;
+    for (const auto& cycle : cycles) {
+        for (const GraphNode& n : cycle) cycleNodes.emplace(n.key, GraphNode());
+    }
+
+    JsonBuilder jb(sink);
+    jb.beginObject();
+    jb.key("vertices");
+    jb.beginArray();
+    // Edges are written after the vertices and take their endpoint ids from here
+    std::vector<std::string> ids(graph.vertices.size());
+    std::set<std::string> branchSet;
+    OGVertex v; // reused, so the row's strings land in buffers that are already allocated
+    size_t i = 0;
+    while (i < graph.vertices.size()) {
+        // Vertices are ascending within each BFS level, which is the order a
+        // rowid IN (...) batch returns its rows in
+        size_t end = i + 1;
+        while (end < graph.vertices.size() && end - i < MetadataBatchSize &&
+               graph.vertices[end].data.key > graph.vertices[end - 1].data.key) {
+            ++end;
+        }
+        std::string sql = "SELECT rowid, id, name, type, projectName, branch, relativePath, startLine, startColumn "
+                          "FROM Node WHERE rowid IN (";
+        for (size_t k = i; k < end; ++k) {
+            if (k > i) sql += ",";
+            sql += std::to_string(graph.vertices[k].data.key);
+        }
+        sql += ")";
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+            error = sqlite3_errmsg(db);
+            return false;
+        }
+        for (; i < end && sqlite3_step(stmt) == SQLITE_ROW; ++i) {
+            const OGVertex& keyed = graph.vertices[i];
+            if (sqlite3_column_int64(stmt, 0) != keyed.data.key) break;
+            v.data.key = keyed.data.key;
+            AssignColumn(v.data.id, stmt, 1);
+            AssignColumn(v.data.name, stmt, 2);
+            AssignColumn(v.data.type, stmt, 3);
+            AssignColumn(v.data.projectName, stmt, 4);
+            AssignColumn(v.data.branch, stmt, 5);
+            AssignColumn(v.data.relativePath, stmt, 6);
+            v.data.startLine = sqlite3_column_int(stmt, 7);
+            v.data.startColumn = sqlite3_column_int(stmt, 8);
+            v.firstIn = keyed.firstIn;
+            v.firstOut = keyed.firstOut;
+            v.inDegree = keyed.inDegree;
+            v.outDegree = keyed.outDegree;
+
+            if (i > 0) jb.comma();
+            WriteGraphVertex(jb, v, layout ? &layout->vertices[i] : nullptr);
+            ids[i] = v.data.id;
+            if (branchSet.empty() || v.data.branch != *branchSet.rbegin()) branchSet.insert(v.data.branch);
+            if (!cycleNodes.empty()) {
+                auto member = cycleNodes.find(v.data.key);
+                if (member != cycleNodes.end()) member->second = v.data;
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (i < end) {
+            error = "node " + std::to_string(graph.vertices[i].data.key) + " was removed while its graph was read";
+            return false;
+        }
+    }
+    jb.endArray();
+    jb.comma();
+
+    jb.key("edges");
+    jb.beginArray();
+    for (size_t i = 0; i < graph.edges.size(); ++i) {
+        if (i > 0) jb.comma();
+        const auto& e = graph.edges[i];
+        WriteGraphEdge(jb, e, ids[e.tailvertex], ids[e.headvertex]);
+    }
+    jb.endArray();
+
+    for (auto& cycle : cycles) {
+        for (GraphNode& n : cycle) n = cycleNodes[n.key];
+    }
+    WriteGraphTail(jb, cycles, layout);
+    jb.flush();
+
+    branches.assign(branchSet.begin(), branchSet.end());
+    return true;
+}
+
+
+struct Node {
+    std::string id;
+    std::string type;
+    std::string name;
+    std::string projectName;
+    std::string branch;
+    std::string meta; // format: {"entryName":"..."}
+};
+
+// Helper: Simple JSON string extraction for "entryName"
+// Extremely naive, assumes standard formatting but fast.
+std::string_view getEntryName(std::string_view meta) {
+    std::string_view key = "\"entryName\"";
+    size_t pos = meta.find(key);
+    if (pos == std::string_view::npos) return "";
+    
+    pos += key.length();
+    // skip until first quote
+    pos = meta.find('"', pos);
+    if (pos == std::string_view::npos) return "";
+    pos++; // start of value
+    
+    size_t end = meta.find('"', pos);
+    if (end == std::string_view::npos) return "";
+    
+    return meta.substr(pos, end - pos);
+}
+
+// helper to quote string for SQL
+std::string sql_quote(const std::string& s) {
+    std::string res;
+    res.reserve(s.size() + 10);  // Pre-allocate: string + quotes + potential escapes
+    res += '\'';
+    for (char c : s) {
+        res += c;
+        if (c == '\'') res += '\'';  // Escape single quote by doubling it
+    }
+    res += '\'';
+    return res;
+}
+
+
+// --- Node Traversal ---
+
+bool ParseTraversalDirection(const char* raw, TraversalDirection& out) {
+    if (!raw || strcmp(raw, "both") == 0) { out = TraversalDirection::Both; return true; }
+    if (strcmp(raw, "out") == 0) { out = TraversalDirection::Outgoing; return true; }
+    if (strcmp(raw, "in") == 0) { out = TraversalDirection::Incoming; return true; }
+    return false;
+}
+
+// --- Traversal Filter ---
+
+static void AppendInList(std::string& sql, const char* alias, const char* column, const char* op,
+                         const std::unordered_set<std::string>& values) {
+    if (values.empty()) return;
+    sql += " AND ";
+    sql += alias;
+    sql += ".";
+    sql += column;
+    sql += op;
+    sql += "(";
+    bool first = true;
+    for (const auto& v : values) {
+        if (!first) sql += ",";
+        sql += sql_quote(v);
+        first = false;
+    }
+    sql += ")";
+}
+
+std::string TraversalFilter::ToSql(const char* alias) const {
+    std::string sql;
+    AppendInList(sql, alias, "type", " IN ", nodeTypes);
+    AppendInList(sql, alias, "projectName", " NOT IN ", excludeProjects);
+    AppendInList(sql, alias, "branch", " IN ", branches);
+    return sql;
+}
+
+static bool ReadStringArray(JsonReader& r, std::unordered_set<std::string>& out) {
+    if (r.consumeNull()) return true;
+    if (!r.expect('[')) return false;
+    if (r.consume(']')) return true;
+    std::string value;
+    do {
+        if (!r.readString(value)) return false;
+        out.insert(value);
+    } while (r.consume(','));
+    return r.expect(']');
+}
+
+bool ParseTraversalFilter(const char* json, TraversalFilter& out, std::string& error) {
+    out = TraversalFilter();
+    if (!json) return true;
+
+    JsonReader r(json);
+    if (r.atEnd()) return true;
+
+    bool ok = r.expect('{');
+    if (ok && !r.consume('}')) {
+        std::string key;
+        do {
+            if (!r.readString(key) || !r.expect(':')) { ok = false; break; }
+            std::unordered_set<std::string>* target =
+                key == "nodeTypes" ? &out.nodeTypes :
+                key == "excludeProjects" ? &out.excludeProjects :
+                key == "branches" ? &out.branches : nullptr;
+            if (!target) {
+                error = "unknown filter key '" + key + "'";
+                return false;
+            }
+            if (!ReadStringArray(r, *target)) { ok = false; break; }
+        } while (r.consume(','));
+        ok = ok && r.expect('}');
+    }
+    if (ok && !r.atEnd()) {
+        error = "invalid filter JSON: trailing characters";
+        return false;
+    }
+    if (!ok) error = "invalid filter JSON: " + r.error();
+    return ok;
+}
+
+static void ReadGraphNodeRow(sqlite3_stmt* stmt, GraphNode& n) {
+    n.key = sqlite3_column_int64(stmt, 0);
+    n.id = (const char*)sqlite3_column_text(stmt, 1);
+    n.name = (const char*)sqlite3_column_text(stmt, 2);
+    n.type = (const char*)sqlite3_column_text(stmt, 3);
+    n.projectName = (const char*)sqlite3_column_text(stmt, 4);
+    n.branch = (const char*)sqlite3_column_text(stmt, 5);
+    const char* rp = (const char*)sqlite3_column_text(stmt, 6);
+    n.relativePath = rp ? rp : "";
+    n.startLine = sqlite3_column_int(stmt, 7);
+    n.startColumn = sqlite3_column_int(stmt, 8);
+}
+
+static std::string KeyList(const std::vector<sqlite3_int64>& keys) {
+    std::string list;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i > 0) list += ",";
+        list += std::to_string(keys[i]);
+    }
+    return list;
+}
+
+NodeTraversal::NodeTraversal(sqlite3* db, std::string startNodeId, int maxDepth, TraversalDirection direction,
+                             const TraversalFilter& filter)
+    : db(db), maxDepth(maxDepth), direction(direction) {
+    sqlite3_int64 rootKey = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT rowid FROM Node WHERE id = ?", -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, startNodeId.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) rootKey = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (rootKey == 0) return; // unknown node: the traversal yields nothing but an empty root level
+    AddRoots({ rootKey }, filter);
+}
+
+NodeTraversal::NodeTraversal(sqlite3* db, const std::vector<sqlite3_int64>& startKeys, int maxDepth,
+                             TraversalDirection direction, const TraversalFilter& filter)
+    : db(db), maxDepth(maxDepth), direction(direction) {
+    AddRoots(startKeys, filter);
+}
+
+void NodeTraversal::AddRoots(const std::vector<sqlite3_int64>& keys, const TraversalFilter& filter) {
+    for (sqlite3_int64 key : keys) {
+        if (visitedDepths.emplace(key, 0).second) currentLevelKeys.push_back(key);
+    }
+    if (!filter.Empty() && !currentLevelKeys.empty()) {
+        // Connections back to a root must survive even when the root itself
+        // doesn't match, otherwise cycles through it disappear
+        neighborFilterSql = " AND (N.rowid IN (" + KeyList(currentLevelKeys) + ") OR (1" + filter.ToSql("N") + "))";
+    }
+}
+
+bool NodeTraversal::Next(std::vector<GraphNode>& nodes, std::vector<GraphConnection>& connections) {
+    std::vector<sqlite3_int64> keys;
+    if (!NextKeys(keys, connections)) {
+        nodes.clear();
+        return false;
+    }
+    FetchNodes(keys, nodes);
+    return true;
+}
+
+bool NodeTraversal::NextKeys(std::vector<sqlite3_int64>& keys, std::vector<GraphConnection>& connections) {
+    keys.clear();
+    connections.clear();
+
+    if (!started) {
+        started = true;
+        keys = currentLevelKeys;
+        std::sort(keys.begin(), keys.end());
+        return true;
+    }
+    if (Done()) return false;
+
+    // Re-planned before every probed level: the frontier may explode at any depth
+    if (!planned || (plan.strategy == TraversalStrategy::Probe && neighborFilterSql.empty())) {
+        plan = PlanTraversal(db, currentLevelKeys, maxDepth - depth, direction != TraversalDirection::Incoming,
+                             direction != TraversalDirection::Outgoing, !neighborFilterSql.empty(), growth,
+                             planned ? &plan : nullptr);
+        planned = true;
+    }
+
+    std::vector<sqlite3_int64> nextLevelKeys;
+    if (plan.adjacency) {
+        WalkLevel(nextLevelKeys, connections);
+    } else {
+        ProbeLevel(nextLevelKeys, connections);
+        if (depth > 0) growth = (double)nextLevelKeys.size() / currentLevelKeys.size();
+    }
+
+    keys = nextLevelKeys;
+    std::sort(keys.begin(), keys.end());
+
+    currentLevelKeys = std::move(nextLevelKeys);
+    depth++;
+    return true;
+}
+
+void NodeTraversal::ProbeLevel(std::vector<sqlite3_int64>& nextLevelKeys, std::vector<GraphConnection>& connections) {
+    std::string keyList = KeyList(currentLevelKeys);
+
+    std::string sql;
+    if (neighborFilterSql.empty()) {
+        switch (direction) {
+            case TraversalDirection::Outgoing:
+                sql = "SELECT fromKey, toKey FROM Connection WHERE fromKey IN (" + keyList + ")";
+                break;
+            case TraversalDirection::Incoming:
+                sql = "SELECT fromKey, toKey FROM Connection WHERE toKey IN (" + keyList + ")";
+                break;
+            default:
+                sql = "SELECT fromKey, toKey FROM Connection WHERE fromKey IN (" + keyList + ") OR toKey IN (" + keyList + ")";
+                break;
+        }
+    } else {
+        // Join the far endpoint so filtered-out nodes (and everything behind
+        // them) are never read. The third column tells AddConnection which
+        // side found the row.
+        std::string outgoing =
+            "SELECT C.fromKey, C.toKey, 0 FROM Connection C JOIN Node N ON N.rowid = C.toKey "
+            "WHERE C.fromKey IN (" + keyList + ")" + neighborFilterSql;
+        std::string incoming =
+            "SELECT C.fromKey, C.toKey, 1 FROM Connection C JOIN Node N ON N.rowid = C.fromKey "
+            "WHERE C.toKey IN (" + keyList + ")" + neighborFilterSql;
+        switch (direction) {
+            case TraversalDirection::Outgoing: sql = outgoing; break;
+            case TraversalDirection::Incoming: sql = incoming; break;
+            default: sql = outgoing + " UNION ALL " + incoming; break;
+        }
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            GraphConnection conn;
+            conn.fromKey = sqlite3_column_int64(stmt, 0);
+            conn.toKey = sqlite3_column_int64(stmt, 1);
+            bool incoming = sqlite3_column_count(stmt) > 2 && sqlite3_column_int(stmt, 2) != 0;
+            AddConnection(std::move(conn), incoming, nextLevelKeys, connections);
+        }
+        sqlite3_finalize(stmt);
+    }
+}
+
+void NodeTraversal::WalkLevel(std::vector<sqlite3_int64>& nextLevelKeys, std::vector<GraphConnection>& connections) {
+    // Same order the probe queries return: by level key, outgoing before incoming
+    std::vector<sqlite3_int64> levelKeys = currentLevelKeys;
+    std::sort(levelKeys.begin(), levelKeys.end());
+    const ConnectionAdjacency& adjacency = *plan.adjacency;
+    if (direction != TraversalDirection::Incoming) {
+        for (sqlite3_int64 key : levelKeys) {
+            adjacency.ForEachNeighbor(key, true, [&](sqlite3_int64 to) {
+                GraphConnection conn;
+                conn.fromKey = key;
+                conn.toKey = to;
+                AddConnection(std::move(conn), false, nextLevelKeys, connections);
+            });
+        }
+    }
+    if (direction != TraversalDirection::Outgoing) {
+        for (sqlite3_int64 key : levelKeys) {
+            adjacency.ForEachNeighbor(key, false, [&](sqlite3_int64 from) {
+                GraphConnection conn;
+                conn.fromKey = from;
+                conn.toKey = key;
+                AddConnection(std::move(conn), true, nextLevelKeys, connections);
+            });
+        }
+    }
+}
+
+// Connections are deduplicated by the levels of their endpoints rather than a
+// set of the pairs seen, so the traversal holds one entry per node instead of
+// one per edge. Walking one direction, every connection is met exactly once,
+// from the level of the node it leaves (or enters). Walking both, it is met
+// again from its other endpoint: it is kept at the shallower endpoint's level,
+// and when both endpoints are on the current level the probes and the walk
+// meet it from the outgoing side first (the unfiltered probe only once).
+void NodeTraversal::AddConnection(GraphConnection conn, bool incoming, std::vector<sqlite3_int64>& nextLevelKeys,
+                                  std::vector<GraphConnection>& connections) {
+    auto from = visitedDepths.find(conn.fromKey);
+    auto to = visitedDepths.find(conn.toKey);
+    bool fromVisited = from != visitedDepths.end();
+    bool toVisited = to != visitedDepths.end();
+
+    if (direction == TraversalDirection::Both && fromVisited && toVisited) {
+        int shallower = std::min(from->second, to->second);
+        if (shallower < depth || (incoming && from->second == depth)) return;
+    }
+
+    sqlite3_int64 neighbor = 0;
+    if (fromVisited && !toVisited) {
+        neighbor = conn.toKey;
+    } else if (toVisited && !fromVisited) {
+        neighbor = conn.fromKey;
+    }
+
+    if (neighbor != 0) {
+        visitedDepths.emplace(neighbor, depth + 1);
+        nextLevelKeys.push_back(neighbor);
+    }
+    connections.push_back(std::move(conn));
+}
+
+void NodeTraversal::ResolveIds(std::vector<GraphConnection>& connections) const {
+    for (auto& conn : connections) {
+        auto from = nodeIds.find(conn.fromKey);
+        auto to = nodeIds.find(conn.toKey);
+        if (from != nodeIds.end()) conn.fromId = from->second;
+        if (to != nodeIds.end()) conn.toId = to->second;
+        conn.id = conn.fromId + "-" + conn.toId;
+    }
+}
+
+void NodeTraversal::RetainIds(bool retain) {
+    retainIds = retain;
+    if (!retain) std::unordered_map<sqlite3_int64, std::string>().swap(nodeIds);
+}
+
+size_t NodeTraversal::StateBytes() const {
+    // A hash node (next pointer, key and value, rounded up by the allocator)
+    // plus its share of the bucket array; a retained cuid adds its string
+    const size_t depthEntryBytes = 2 * sizeof(void*) + sizeof(std::pair<sqlite3_int64, int>);
+    const size_t idEntryBytes = 2 * sizeof(void*) + sizeof(std::pair<sqlite3_int64, std::string>) + 32;
+    return visitedDepths.size() * depthEntryBytes + nodeIds.size() * idEntryBytes +
+           currentLevelKeys.capacity() * sizeof(sqlite3_int64);
+}
+
+void NodeTraversal::FetchNodes(const std::vector<sqlite3_int64>& keys, std::vector<GraphNode>& out) {
+    out.clear();
+    if (keys.empty()) return;
+
+    std::string sql = "SELECT rowid, id, name, type, projectName, branch, relativePath, startLine, startColumn FROM Node WHERE rowid IN (" + KeyList(keys) + ")";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            GraphNode n;
+            ReadGraphNodeRow(stmt, n);
+            if (retainIds) nodeIds.emplace(n.key, n.id);
+            out.push_back(std::move(n));
+        }
+        sqlite3_finalize(stmt);
+    }
+}
+
+// --- Project Graph ---
+
+ProjectGraphResult BuildProjectGraphImpl(sqlite3* db, std::string startProjectId, std::string branch, int maxDepth, bool detectCycles,
+                                         const TraversalFilter& filter) {
+    TraversalFilter nodeFilter = filter;
+    nodeFilter.branches.clear();
+    std::string filterSql = nodeFilter.ToSql("N1") + nodeFilter.ToSql("N2");
+
+    std::unordered_set<std::string> visitedProjectIds;
+    std::unordered_map<std::string, GraphNode> projectInfos;
+    std::unordered_map<std::string, GraphConnection> projectConnections;
+    
+    std::vector<std::string> currentLevelIds;
+    currentLevelIds.push_back(startProjectId);
+    visitedProjectIds.insert(startProjectId);
+    
+    // 1. Fetch Root Project
+    {
+         // GraphNode reused for Project info: name, addr, type
+         std::string sql = "SELECT id, name, addr, type FROM Project WHERE id = ?";
+         sqlite3_stmt* stmt;
+         if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+             sqlite3_bind_text(stmt, 1, startProjectId.c_str(), -1, SQLITE_STATIC);
+             if (sqlite3_step(stmt) == SQLITE_ROW) {
+                 GraphNode p;
+                 p.id = (const char*)sqlite3_column_text(stmt, 0);
+                 p.name = (const char*)sqlite3_column_text(stmt, 1);
+                 p.addr = (const char*)sqlite3_column_text(stmt, 2);
+                 p.type = (const char*)sqlite3_column_text(stmt, 3);
+                 p.branch = branch;
+                 
+                 projectInfos[p.id] = p;
+             }
+             sqlite3_finalize(stmt);
+         }
+    }
+    
+    // BFS
+    int depth = 0;
+    while (!currentLevelIds.empty() && depth < maxDepth) {
+        std::string idListParam;
+        for (size_t i = 0; i < currentLevelIds.size(); ++i) {
+            if (i > 0) idListParam += ",";
+            idListParam += sql_quote(currentLevelIds[i]);
+        }
+        
+        if (idListParam.empty()) break;
+
+        // Find connections between NODES where nodes belong to these projects
+        // SELECT N1.projectId as fromPid, N2.projectId as toPid 
+        // FROM Connection C 
+        // JOIN Node N1 ON N1.rowid = C.fromKey 
+        // JOIN Node N2 ON N2.rowid = C.toKey 
+        // WHERE (N1.projectId IN (...) OR N2.projectId IN (...)) 
+        // AND N1.branch = ? AND N2.branch = ?
+        
+        // Optimization: Single query 
+        std::string sql = 
+            "SELECT DISTINCT N1.projectId, N2.projectId "
+            "FROM Connection C "
+            "JOIN Node N1 ON N1.rowid = C.fromKey "
+            "JOIN Node N2 ON N2.rowid = C.toKey "
+            "WHERE (N1.projectId IN (" + idListParam + ") OR N2.projectId IN (" + idListParam + ")) "
+            "AND N1.branch = ? AND N2.branch = ? "
+            "AND N1.projectId != N2.projectId" + filterSql;
+            
+        sqlite3_stmt* stmt;
+        std::vector<std::string> nextLevelIds;
+        std::unordered_set<std::string> newProjectsToFetch;
+        
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
+            
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                 std::string fromPid = (const char*)sqlite3_column_text(stmt, 0);
+                 std::string toPid = (const char*)sqlite3_column_text(stmt, 1);
+                 
+                 std::string connId = fromPid + "-" + toPid;
+                 if (projectConnections.find(connId) == projectConnections.end()) {
+                     GraphConnection gc;
+                     gc.id = connId;
+                     gc.fromId = fromPid;
+                     gc.toId = toPid;
+                     projectConnections[connId] = gc;
+                     
+                     // Identify new discovery
+                     if (visitedProjectIds.find(fromPid) == visitedProjectIds.end()) {
+                         visitedProjectIds.insert(fromPid);
+                         newProjectsToFetch.insert(fromPid);
+                         nextLevelIds.push_back(fromPid);
+                     }
+                     if (visitedProjectIds.find(toPid) == visitedProjectIds.end()) {
+                         visitedProjectIds.insert(toPid);
+                         newProjectsToFetch.insert(toPid);
+                         nextLevelIds.push_back(toPid);
+                     }
+                 }
+            }
+            sqlite3_finalize(stmt);
+        }
+        
+        // Fetch newly discovered projects
+        if (!newProjectsToFetch.empty()) {
+             std::string pIds;
+             bool first = true;
+             for (const auto& pid : newProjectsToFetch) {
+                 if (!first) pIds += ",";
+                 pIds += sql_quote(pid);
+                 first = false;
+             }
+             
+             std::string pSql = "SELECT id, name, addr, type FROM Project WHERE id IN (" + pIds + ")";
+             if (sqlite3_prepare_v2(db, pSql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
+                 while (sqlite3_step(stmt) == SQLITE_ROW) {
+                     GraphNode p;
+                     p.id = (const char*)sqlite3_column_text(stmt, 0);
+                     p.name = (const char*)sqlite3_column_text(stmt, 1);
+                     p.addr = (const char*)sqlite3_column_text(stmt, 2);
+                     p.type = (const char*)sqlite3_column_text(stmt, 3);
+                     p.branch = branch;
+                     projectInfos[p.id] = p;
+                 }
+                 sqlite3_finalize(stmt);
+             }
+        }
+        
+        currentLevelIds = nextLevelIds;
+        depth++;
+    }
+    
+    // Canonical order, so equal graphs serialize (and hash) the same: the maps
+    // iterate in whatever order their buckets fall
+    std::vector<GraphNode> nodesList;
+    for (const auto& p : projectInfos) nodesList.push_back(p.second);
+    std::sort(nodesList.begin(), nodesList.end(),
+              [](const GraphNode& a, const GraphNode& b) { return a.id < b.id; });
+    std::vector<GraphConnection> connList;
+    for (const auto& p : projectConnections) connList.push_back(p.second);
+    std::sort(connList.begin(), connList.end(), [](const GraphConnection& a, const GraphConnection& b) {
+        return a.fromId != b.fromId ? a.fromId < b.fromId : a.toId < b.toId;
+    });
+    
+    OrthogonalGraph og = BuildOrthogonalGraph(nodesList, connList);
+    std::vector<std::vector<GraphNode>> cycles;
+    if (detectCycles) {
+        cycles = DetectCycles(og);
+    }
+    
+    return { og, cycles };
+}
+
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "sqlite3.h"
+#include "traversal-planner.h"
+
+// --- Graph Structures ---
+
+struct GraphNode {
+    sqlite3_int64 key = 0; // Node rowid; 0 for project vertices
+    std::string id;
+    std::string name;
+    std::string type;
+    std::string projectName;
+    std::string projectId; // Added for project graph
+    std::string branch;
+    std::string relativePath;
+    int startLine = 0;
+    int startColumn = 0;
+    std::string addr; // for project
+};
+
+// Node-level connections carry only the integer keys (Connection.fromKey/toKey);
+// the string ids are filled in for project connections and resolved from the
+// endpoint vertices when the graph is serialized.
+struct GraphConnection {
+    std::string id;
+    std::string fromId;
+    std::string toId;
+    sqlite3_int64 fromKey = 0;
+    sqlite3_int64 toKey = 0;
+};
+
+// Orthogonal Graph Structures (Indices)
+struct OGVertex {
+    GraphNode data;
+    int firstIn = -1;
+    int firstOut = -1;
+    int inDegree = 0;
+    int outDegree = 0;
+};
+
+struct OGEdge {
+    GraphConnection data;
+    int tailvertex = -1;
+    int headvertex = -1;
+    int headnext = -1;
+    int tailnext = -1;
+};
+
+struct OrthogonalGraph {
+    std::vector<OGVertex> vertices;
+    std::vector<OGEdge> edges;
+};
+
+// --- JSON Builder ---
+
+// Receives serialized JSON piece by piece (see JsonBuilder(JsonSink))
+using JsonSink = std::function<void(std::string_view)>;
+
+class JsonBuilder {
+    static const size_t SinkFlushBytes = 256 * 1024;
+
+    std::string json;
+    JsonSink sink;
+public:
+    JsonBuilder() { json.reserve(4 * 1024 * 1024); } // 4MB
+    // Hands the output to sink whenever an object closes past SinkFlushBytes,
+    // so only a bounded tail is buffered; call flush() at the end.
+    explicit JsonBuilder(JsonSink sink) : sink(std::move(sink)) { json.reserve(SinkFlushBytes + 64 * 1024); }
+    
+    void beginObject() { json += "{"; }
+    void endObject() {
+        json += "}";
+        if (sink && json.size() >= SinkFlushBytes) flush();
+    }
+    void beginArray() { json += "["; }
+    void endArray() { json += "]"; }
+    void key(std::string_view k) { 
+        json += "\""; json += k; json += "\":"; 
+    }
+    void string(std::string_view s) {
+        json += "\"";
+        size_t lastPos = 0;
+        size_t pos = s.find_first_of("\"\\/\b\f\n\r\t", lastPos);
+        
+        if (pos == std::string_view::npos) {
+            json += s;
+        } else {
+            while (pos != std::string_view::npos) {
+                json.append(s.data() + lastPos, pos - lastPos);
+                switch(s[pos]) {
+                    case '"': json += "\\\""; break;
+                    case '\\': json += "\\\\"; break;
+                    case '\b': json += "\\b"; break;
+                    case '\f': json += "\\f"; break;
+                    case '\n': json += "\\n"; break;
+                    case '\r': json += "\\r"; break;
+                    case '\t': json += "\\t"; break;
+                    default: json += s[pos]; break; 
+                }
+                lastPos = pos + 1;
+                pos = s.find_first_of("\"\\/\b\f\n\r\t", lastPos);
+            }
+            json.append(s.data() + lastPos, s.length() - lastPos);
+        }
+        json += "\"";
+    }
+    void number(int n) { json += std::to_string(n); }
+    void raw(std::string_view v) { json += v; } // pre-formatted JSON value
+    void comma() { json += ","; }
+    
+    std::string str() { return json; }
+    void flush() {
+        if (sink && !json.empty()) sink(json);
+        json.clear();
+    }
+};
+
+// --- Graph Algorithms ---
+
+OrthogonalGraph BuildOrthogonalGraph(const std::vector<GraphNode>& nodes, const std::vector<GraphConnection>& connections);
+// Same graph from Node rowids alone: vertex i is keys[i] with only data.key set.
+// The rows are read when the graph is serialized (see SerializeNodeGraph).
+OrthogonalGraph BuildKeyedOrthogonalGraph(const std::vector<sqlite3_int64>& keys,
+                                          const std::vector<GraphConnection>& connections);
+std::vector<std::vector<GraphNode>> DetectCycles(const OrthogonalGraph& graph);
+
+// Iterative Tarjan; returns the component index of every vertex. Components are
+// numbered in reverse topological order of the condensed graph, so every edge
+// u -> v between components has component[u] > component[v].
+std::vector<int> StronglyConnectedComponents(const OrthogonalGraph& graph, int& componentCount);
+
+// --- Layered Layout ---
+
+struct VertexLayout {
+    int layer = 0;
+    int order = 0; // position within the layer
+    int x = 0;
+    int y = 0;
+};
+
+struct GraphLayout {
+    std::vector<VertexLayout> vertices; // parallel to OrthogonalGraph::vertices
+    int width = 0;
+    int height = 0;
+    int layers = 0;
+};
+
+// Sugiyama-style layout: strongly connected components are condensed so the
+// ranking runs on a DAG, layers come from longest paths, and barycentric sweeps
+// reduce crossings. Members of one component are stacked over consecutive
+// layers in BFS order instead of sharing a single (very wide) layer.
+GraphLayout ComputeLayeredLayout(const OrthogonalGraph& graph, int sweeps = 4);
+
+// One element of the "vertices" / "edges" arrays SerializeGraph writes
+void WriteGraphVertexData(JsonBuilder& jb, const GraphNode& n); // the vertex's "data" object
+void WriteGraphVertex(JsonBuilder& jb, const OGVertex& v, const VertexLayout* layout);
+void WriteGraphEdge(JsonBuilder& jb, const OGEdge& e, const std::string& fromId, const std::string& toId);
+
+std::string SerializeGraph(const OrthogonalGraph& graph, const std::vector<std::vector<GraphNode>>& cycles,
+                           const GraphLayout* layout = nullptr);
+// Same JSON, streamed to sink instead of returned
+void SerializeGraph(const JsonSink& sink, const OrthogonalGraph& graph, const std::vector<std::vector<GraphNode>>& cycles,
+                    const GraphLayout* layout = nullptr);
+// Same JSON for a graph from BuildKeyedOrthogonalGraph: each vertex's Node row
+// is read as the vertex is written, and the cycle members are filled in on the
+// way. branches receives the distinct branches of the vertices. False when a
+// row is missing, i.e. the graph wasn't built from the same snapshot.
+bool SerializeNodeGraph(sqlite3* db, const JsonSink& sink, const OrthogonalGraph& graph,
+                        std::vector<std::vector<GraphNode>>& cycles, const GraphLayout* layout,
+                        std::vector<std::string>& branches, std::string& error);
+
+std::string_view getEntryName(std::string_view meta);
+std::string sql_quote(const std::string& s);
+
+// --- Node Traversal ---
+
+enum class TraversalDirection {
+    Both,       // dependencies and dependents
+    Outgoing,   // follow fromId -> toId (what the root depends on)
+    Incoming,   // follow toId -> fromId (what depends on the root)
+};
+
+bool ParseTraversalDirection(const char* raw, TraversalDirection& out);
+
+// Restricts which nodes a traversal may reach. Empty sets mean "no restriction".
+// The root is always kept, so a filter never turns a lookup into "not found".
+//
+//   {"nodeTypes": ["NamedImport", "NamedExport"], "excludeProjects": ["vendor"], "branches": ["main"]}
+struct TraversalFilter {
+    std::unordered_set<std::string> nodeTypes;        // Node.type allow-list
+    std::unordered_set<std::string> excludeProjects;  // Node.projectName deny-list
+    std::unordered_set<std::string> branches;         // Node.branch allow-list
+
+    bool Empty() const { return nodeTypes.empty() && excludeProjects.empty() && branches.empty(); }
+
+    // " AND ..." conditions on the Node table aliased as alias; empty for an empty filter
+    std::string ToSql(const char* alias) const;
+};
+
+// Parses the JSON filter argument. NULL or empty input yields an empty filter.
+bool ParseTraversalFilter(const char* json, TraversalFilter& out, std::string& error);
+
+// Level-by-level BFS over Node/Connection that can be suspended between levels.
+// Only ids are retained across levels; node rows and connections are handed to
+// the caller per level, so consumers that stream (the graph_* virtual tables)
+// never hold the whole graph in memory.
+//
+// The walk runs on Node rowids and the integer Connection.fromKey/toKey columns;
+// cuids are only read for the nodes that are handed out.
+class NodeTraversal {
+    sqlite3* db;
+    int maxDepth;
+    TraversalDirection direction;
+    int depth = 0;
+    bool started = false;
+    std::unordered_map<sqlite3_int64, int> visitedDepths; // key -> level it was reached at
+    std::unordered_map<sqlite3_int64, std::string> nodeIds; // key -> cuid of every node handed out
+    bool retainIds = true;
+    std::vector<sqlite3_int64> currentLevelKeys;
+    std::string neighborFilterSql; // applied to the Node row on the far side of each connection
+    TraversalPlan plan;            // how the remaining levels are expanded; see traversal-planner.h
+    bool planned = false;
+    double growth = 0;             // frontier growth of the last probed level
+
+public:
+    NodeTraversal(sqlite3* db, std::string startNodeId, int maxDepth, TraversalDirection direction,
+                  const TraversalFilter& filter = TraversalFilter());
+
+    // Multi-source variant: every key in startKeys (Node rowids) is a root at depth 0
+    NodeTraversal(sqlite3* db, const std::vector<sqlite3_int64>& startKeys, int maxDepth, TraversalDirection direction,
+                  const TraversalFilter& filter = TraversalFilter());
+
+    // Depth of the nodes produced by the last call to Next().
+    int Depth() const { return started ? depth : 0; }
+
+    bool Done() const { return started && (currentLevelKeys.empty() || depth >= maxDepth); }
+
+    // Produces the next BFS level: the first call yields the root node, later
+    // calls yield the nodes discovered one hop further and the connections
+    // leading to them. Returns false once the traversal is exhausted.
+    // Connections only carry keys; the string ids are filled in on demand.
+    bool Next(std::vector<GraphNode>& nodes, std::vector<GraphConnection>& connections);
+
+    // Next() without reading any Node row: keys are the rowids of the level in
+    // the order Next() would hand the nodes out (ascending). Nothing is kept
+    // for ResolveIds; FetchNodes() reads the rows if they are needed after all.
+    bool NextKeys(std::vector<sqlite3_int64>& keys, std::vector<GraphConnection>& connections);
+
+    // Replaces out with the Node rows of keys, ascending by rowid
+    void FetchNodes(const std::vector<sqlite3_int64>& keys, std::vector<GraphNode>& out);
+
+    // Fills fromId/toId/id of connections produced by Next()
+    void ResolveIds(std::vector<GraphConnection>& connections) const;
+
+    // Stops keeping the cuids ResolveIds needs, for consumers that take ids
+    // from the nodes themselves and would rather not hold one per node
+    void RetainIds(bool retain);
+
+    // Estimated heap held by the traversal itself: one entry per visited node
+    // (plus the retained cuids), whatever has been handed out
+    size_t StateBytes() const;
+
+private:
+    void AddRoots(const std::vector<sqlite3_int64>& keys, const TraversalFilter& filter);
+    void ProbeLevel(std::vector<sqlite3_int64>& nextLevelKeys, std::vector<GraphConnection>& connections);
+    void WalkLevel(std::vector<sqlite3_int64>& nextLevelKeys, std::vector<GraphConnection>& connections);
+    void AddConnection(GraphConnection conn, bool incoming, std::vector<sqlite3_int64>& nextLevelKeys,
+                       std::vector<GraphConnection>& connections);
+};
+
+// --- Project Graph ---
+
+struct ProjectGraphResult {
+    OrthogonalGraph graph;
+    std::vector<std::vector<GraphNode>> cycles;
+};
+
+// Only nodeTypes and excludeProjects apply here; the graph is already scoped to one branch.
+ProjectGraphResult BuildProjectGraphImpl(sqlite3* db, std::string startProjectId, std::string branch, int maxDepth, bool detectCycles = true,
+                                         const TraversalFilter& filter = TraversalFilter());
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <zlib.h>
+
+// Streaming gzip compressor for serialized graphs. Input is deflated as it
+// arrives, so a caller feeding it chunk by chunk never holds the plain JSON of
+// the whole result. Addons resolve zlib from the Node binary, which exports it;
+// the standalone bench links the system library.
+class GzipWriter {
+    static const size_t ChunkBytes = 64 * 1024;
+
+    z_stream zs{};
+    std::string out;
+    bool ok;
+
+    bool deflateInput(std::string_view data, int flush) {
+        zs.next_in = (Bytef*)data.data();
+        zs.avail_in = (uInt)data.size();
+        int rc;
+        do {
+            size_t used = out.size();
+            out.resize(used + ChunkBytes);
+            zs.next_out = (Bytef*)&out[used];
+            zs.avail_out = (uInt)ChunkBytes;
+            rc = deflate(&zs, flush);
+            out.resize(used + ChunkBytes - zs.avail_out);
+            if (rc == Z_STREAM_ERROR) return false;
+        } while (zs.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+        return true;
+    }
+
+public:
+    explicit GzipWriter(int level = Z_DEFAULT_COMPRESSION) {
+        // 15 + 16: largest window, gzip framing instead of a raw zlib stream
+        ok = deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~GzipWriter() { deflateEnd(&zs); }
+    GzipWriter(const GzipWriter&) = delete;
+    GzipWriter& operator=(const GzipWriter&) = delete;
+
+    void write(std::string_view data) {
+        if (ok && !data.empty()) ok = deflateInput(data, Z_NO_FLUSH);
+    }
+
+    // Completes the stream; false if zlib failed at any point
+    bool finish(std::string& result) {
+        if (ok) ok = deflateInput(std::string_view(), Z_FINISH);
+        result = std::move(out);
+        return ok;
+    }
+};
@@ -0,0 +1,378 @@
+#include "impact-sketch.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "graph.h"
+#include "json-reader.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Impact Sketches ---
+//
+// "Blast radius" of a node = the nodes (and their projects) with a path to it,
+// i.e. everything that transitively depends on it. Exact sets per node are
+// quadratic, so each node gets two HyperLogLog sketches instead, built in one
+// pass over the SCC condensation: components are visited dependents-first and
+// a component's sketch is the union of the sketches of the components pointing
+// at it. Members of a cycle reach each other, so they count as their own
+// dependents; an acyclic node does not.
+
+static const int SketchPrecision = 8;
+static const int SketchRegisters = 1 << SketchPrecision; // ~6.5% standard error
+// Up to this many elements the raw hashes are kept and counted exactly (the
+// same idea as HLL++'s sparse mode): typical badges are small numbers, where a
+// single register collision would already be visible. Sized so the exact form
+// never encodes larger than the dense one.
+static const size_t ExactLimit = SketchRegisters / 8;
+
+struct Sketch {
+    std::vector<uint64_t> exact;  // sorted unique hashes while registers is empty
+    std::vector<uint8_t> registers;
+
+    bool Empty() const { return exact.empty() && registers.empty(); }
+};
+
+static uint64_t Mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t HashString(const std::string& s) {
+    uint64_t h = 0xCBF29CE484222325ULL; // FNV-1a
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    return Mix64(h);
+}
+
+static void AddToRegisters(std::vector<uint8_t>& registers, uint64_t hash) {
+    size_t index = hash >> (64 - SketchPrecision);
+    uint64_t rest = hash << SketchPrecision;
+    uint8_t rank = rest == 0 ? (uint8_t)(64 - SketchPrecision + 1) : (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > registers[index]) registers[index] = rank;
+}
+
+static void ToRegisters(Sketch& sketch) {
+    if (!sketch.registers.empty()) return;
+    sketch.registers.assign(SketchRegisters, 0);
+    for (uint64_t h : sketch.exact) AddToRegisters(sketch.registers, h);
+    std::vector<uint64_t>().swap(sketch.exact);
+}
+
+static void SketchAdd(Sketch& sketch, uint64_t hash) {
+    if (!sketch.registers.empty()) {
+        AddToRegisters(sketch.registers, hash);
+        return;
+    }
+    auto it = std::lower_bound(sketch.exact.begin(), sketch.exact.end(), hash);
+    if (it != sketch.exact.end() && *it == hash) return;
+    sketch.exact.insert(it, hash);
+    if (sketch.exact.size() > ExactLimit) ToRegisters(sketch);
+}
+
+static void SketchMerge(Sketch& into, const Sketch& from) {
+    if (from.Empty()) return;
+    if (into.Empty()) {
+        into = from;
+        return;
+    }
+    if (from.registers.empty()) {
+        for (uint64_t h : from.exact) SketchAdd(into, h);
+        return;
+    }
+    ToRegisters(into);
+    for (int i = 0; i < SketchRegisters; ++i) {
+        if (from.registers[i] > into.registers[i]) into.registers[i] = from.registers[i];
+    }
+}
+
+static int SketchEstimate(const Sketch& sketch) {
+    if (sketch.registers.empty()) return (int)sketch.exact.size();
+    const double m = SketchRegisters;
+    double sum = 0;
+    int zeros = 0;
+    for (uint8_t r : sketch.registers) {
+        sum += ldexp(1.0, -r);
+        if (r == 0) zeros++;
+    }
+    double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+    // Linear counting is far more accurate while registers are still empty
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * log(m / zeros);
+    return (int)(estimate + 0.5);
+}
+
+// Encoded as 'E' + 8-byte hashes (exact form) or 'D' + registers; an empty
+// sketch is an empty blob
+static std::string EncodeSketch(const Sketch& sketch) {
+    std::string out;
+    if (sketch.Empty()) return out;
+    if (sketch.registers.empty()) {
+        out += 'E';
+        out.append((const char*)sketch.exact.data(), sketch.exact.size() * sizeof(uint64_t));
+    } else {
+        out += 'D';
+        out.append((const char*)sketch.registers.data(), sketch.registers.size());
+    }
+    return out;
+}
+
+static bool DecodeSketch(const unsigned char* data, int size, Sketch& out) {
+    out = Sketch();
+    if (size == 0) return true;
+    if (data[0] == 'D' && size == 1 + SketchRegisters) {
+        out.registers.assign(data + 1, data + size);
+        return true;
+    }
+    if (data[0] == 'E' && (size - 1) % sizeof(uint64_t) == 0) {
+        out.exact.resize((size - 1) / sizeof(uint64_t));
+        memcpy(out.exact.data(), data + 1, size - 1);
+        return true;
+    }
+    return false;
+}
+
+static bool BuildBranch(sqlite3* db, const std::string& branch, int& written, std::string& error) {
+    std::vector<GraphNode> nodes;
+    std::vector<GraphConnection> connections;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT rowid, id, projectId FROM Node WHERE branch = ?", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        GraphNode n;
+        n.key = sqlite3_column_int64(stmt, 0);
+        n.id = (const char*)sqlite3_column_text(stmt, 1);
+        n.projectId = (const char*)sqlite3_column_text(stmt, 2);
+        nodes.push_back(std::move(n));
+    }
+    sqlite3_finalize(stmt);
+
+    // Connections only ever join nodes of the same branch
+    if (sqlite3_prepare_v2(db,
+            "SELECT C.fromKey, C.toKey FROM Connection C JOIN Node N ON N.rowid = C.toKey WHERE N.branch = ?",
+            -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        GraphConnection c;
+        c.fromKey = sqlite3_column_int64(stmt, 0);
+        c.toKey = sqlite3_column_int64(stmt, 1);
+        connections.push_back(c);
+    }
+    sqlite3_finalize(stmt);
+
+    OrthogonalGraph graph = BuildOrthogonalGraph(nodes, connections);
+    nodes.clear();
+    connections.clear();
+
+    const int n = (int)graph.vertices.size();
+    int componentCount = 0;
+    std::vector<int> component = StronglyConnectedComponents(graph, componentCount);
+
+    std::vector<std::vector<int>> members(componentCount);
+    for (int v = 0; v < n; ++v) members[component[v]].push_back(v);
+
+    // Outgoing cross-component edges still to be consumed; a component's
+    // sketches are dropped once every component it points at has read them
+    std::vector<int> pendingReaders(componentCount, 0);
+    std::vector<bool> cyclic(componentCount, false);
+    for (const OGEdge& e : graph.edges) {
+        int from = component[e.tailvertex], to = component[e.headvertex];
+        if (from != to) pendingReaders[from]++;
+        else cyclic[from] = true; // multi-member component or self-loop
+    }
+
+    std::vector<Sketch> reachNodes(componentCount), reachProjects(componentCount);
+
+    sqlite3_stmt* insert;
+    if (sqlite3_prepare_v2(db,
+            "INSERT OR REPLACE INTO ImpactSketch (nodeId, branch, dependents, projects, nodeSketch, projectSketch) "
+            "VALUES (?, ?, ?, ?, ?, ?)", -1, &insert, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+
+    // Edges point from dependent to dependency, so dependents-first is
+    // descending component order
+    for (int c = componentCount - 1; c >= 0; --c) {
+        Sketch dependents, dependentProjects;
+        for (int v : members[c]) {
+            for (int ei = graph.vertices[v].firstIn; ei != -1; ei = graph.edges[ei].headnext) {
+                int from = component[graph.edges[ei].tailvertex];
+                if (from == c) continue;
+                SketchMerge(dependents, reachNodes[from]);
+                SketchMerge(dependentProjects, reachProjects[from]);
+                if (--pendingReaders[from] == 0) {
+                    reachNodes[from] = Sketch();
+                    reachProjects[from] = Sketch();
+                }
+            }
+        }
+
+        Sketch withMembers = dependents, withMemberProjects = dependentProjects;
+        for (int v : members[c]) {
+            SketchAdd(withMembers, Mix64((uint64_t)graph.vertices[v].data.key));
+            SketchAdd(withMemberProjects, HashString(graph.vertices[v].data.projectId));
+        }
+        if (cyclic[c]) {
+            dependents = withMembers;
+            dependentProjects = withMemberProjects;
+        }
+
+        std::string nodeBlob = EncodeSketch(dependents);
+        std::string projectBlob = EncodeSketch(dependentProjects);
+        int dependentCount = SketchEstimate(dependents);
+        int projectCount = SketchEstimate(dependentProjects);
+        for (int v : members[c]) {
+            const GraphNode& node = graph.vertices[v].data;
+            sqlite3_bind_text(insert, 1, node.id.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(insert, 2, branch.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int(insert, 3, dependentCount);
+            sqlite3_bind_int(insert, 4, projectCount);
+            sqlite3_bind_blob(insert, 5, nodeBlob.data(), (int)nodeBlob.size(), SQLITE_STATIC);
+            sqlite3_bind_blob(insert, 6, projectBlob.data(), (int)projectBlob.size(), SQLITE_STATIC);
+            int rc = sqlite3_step(insert);
+            sqlite3_reset(insert);
+            if (rc != SQLITE_DONE) {
+                error = sqlite3_errmsg(db);
+                sqlite3_finalize(insert);
+                return false;
+            }
+            written++;
+        }
+
+        if (pendingReaders[c] > 0) {
+            reachNodes[c] = std::move(withMembers);
+            reachProjects[c] = std::move(withMemberProjects);
+        }
+    }
+    sqlite3_finalize(insert);
+    return true;
+}
+
+void ImpactSketchBuild(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    sqlite3* db = sqlite3_context_db_handle(context);
+
+    std::vector<std::string> branches;
+    if (argc >= 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
+        branches.push_back((const char*)sqlite3_value_text(argv[0]));
+    } else {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT DISTINCT branch FROM Node", -1, &stmt, NULL) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) branches.push_back((const char*)sqlite3_column_text(stmt, 0));
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    sqlite3_exec(db, "SAVEPOINT impact_sketch_build", NULL, NULL, NULL);
+
+    std::string error;
+    int written = 0;
+    sqlite3_stmt* clear = nullptr;
+    if (sqlite3_prepare_v2(db, "DELETE FROM ImpactSketch WHERE branch = ?", -1, &clear, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+    }
+    for (size_t i = 0; error.empty() && i < branches.size(); ++i) {
+        sqlite3_bind_text(clear, 1, branches[i].c_str(), -1, SQLITE_STATIC);
+        int rc = sqlite3_step(clear);
+        sqlite3_reset(clear);
+        if (rc != SQLITE_DONE) {
+            error = sqlite3_errmsg(db);
+            break;
+        }
+        BuildBranch(db, branches[i], written, error);
+    }
+    sqlite3_finalize(clear);
+
+    if (!error.empty()) {
+        sqlite3_exec(db, "ROLLBACK TO impact_sketch_build; RELEASE impact_sketch_build", NULL, NULL, NULL);
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+    sqlite3_exec(db, "RELEASE impact_sketch_build", NULL, NULL, NULL);
+    sqlite3_result_int(context, written);
+}
+
+void ImpactEstimate(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* raw = (const char*)sqlite3_value_text(argv[0]);
+    if (!raw) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    std::vector<std::string> ids;
+    JsonReader r(raw);
+    if (r.peek() == '[') {
+        r.consume('[');
+        if (!r.consume(']')) {
+            std::string id;
+            do {
+                if (!r.readString(id)) break;
+                ids.push_back(id);
+            } while (r.consume(','));
+            r.expect(']');
+        }
+        if (!r.error().empty()) {
+            std::string error = "invalid node id list: " + r.error();
+            sqlite3_result_error(context, error.c_str(), -1);
+            return;
+        }
+    } else {
+        ids.push_back(raw);
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT dependents, projects, nodeSketch, projectSketch FROM ImpactSketch WHERE nodeId = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        sqlite3_result_error(context, sqlite3_errmsg(db), -1);
+        return;
+    }
+
+    Sketch dependents, projects, decoded;
+    int found = 0, dependentCount = 0, projectCount = 0;
+    for (const std::string& id : ids) {
+        sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            found++;
+            dependentCount = sqlite3_column_int(stmt, 0);
+            projectCount = sqlite3_column_int(stmt, 1);
+            if (DecodeSketch((const unsigned char*)sqlite3_column_blob(stmt, 2), sqlite3_column_bytes(stmt, 2), decoded)) {
+                SketchMerge(dependents, decoded);
+            }
+            if (DecodeSketch((const unsigned char*)sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3), decoded)) {
+                SketchMerge(projects, decoded);
+            }
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    if (found == 0) {
+        sqlite3_result_null(context);
+        return;
+    }
+    // A single node reports the stored estimates; merged ones are re-estimated
+    if (ids.size() > 1) {
+        dependentCount = SketchEstimate(dependents);
+        projectCount = SketchEstimate(projects);
+    }
+
+    std::string json = "{\"dependents\":" + std::to_string(dependentCount) +
+                       ",\"projects\":" + std::to_string(projectCount) +
+                       ",\"nodes\":" + std::to_string(found) + "}";
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
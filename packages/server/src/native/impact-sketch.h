@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// impact_sketch_build([branch]) - recomputes the ImpactSketch rows of one branch
+// (all branches when omitted). Returns the number of rows written.
+void ImpactSketchBuild(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+// impact_estimate(nodeId | nodeIdsJson) - approximate number of nodes and
+// projects that transitively depend on the node(s), read from the persisted
+// sketches: {"dependents":n,"projects":n,"nodes":found}. For a JSON array the
+// sketches are merged, so shared dependents are counted once. NULL when none of
+// the nodes has a sketch.
+void ImpactEstimate(sqlite3_context* context, int argc, sqlite3_value** argv);
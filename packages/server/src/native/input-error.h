@@ -0,0 +1,9 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// Result code of SQL functions that reject their arguments - a malformed
+// payload or pattern - rather than fail on the database. SQLite itself never
+// returns SQLITE_FORMAT, so callers can answer these with a client error by
+// the code alone; the message is set with sqlite3_result_error first.
+static const int InvalidInputError = SQLITE_FORMAT;
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string>
+#include <string_view>
+
+// Minimal pull-style JSON reader for the argument payloads the extension
+// accepts. Values are read in place; callers drive the structure:
+//
+//   if (!r.expect('{')) return false;
+//   if (!r.consume('}')) {
+//       do { r.readString(key); r.expect(':'); ... } while (r.consume(','));
+//       if (!r.expect('}')) return false;
+//   }
+class JsonReader {
+    std::string_view s;
+    size_t pos = 0;
+    std::string err;
+
+    bool fail(const std::string& msg) {
+        if (err.empty()) err = msg + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    static void appendUtf8(std::string& out, unsigned cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool readHex4(unsigned& out) {
+        if (pos + 4 > s.size()) return fail("truncated \\u escape");
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = s[pos++];
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+public:
+    explicit JsonReader(std::string_view input) : s(input) {}
+
+    const std::string& error() const { return err; }
+    size_t position() const { return pos; }
+
+    void skipSpace() {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r')) ++pos;
+    }
+
+    bool atEnd() {
+        skipSpace();
+        return pos >= s.size();
+    }
+
+    char peek() {
+        skipSpace();
+        return pos < s.size() ? s[pos] : '\0';
+    }
+
+    bool consume(char c) {
+        if (peek() != c) return false;
+        ++pos;
+        return true;
+    }
+
+    bool expect(char c) {
+        if (consume(c)) return true;
+        return fail(std::string("expected '") + c + "'");
+    }
+
+    bool consumeNull() {
+        skipSpace();
+        if (s.substr(pos, 4) != "null") return false;
+        pos += 4;
+        return true;
+    }
+
+    bool readString(std::string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (pos < s.size() && s[pos] != '"') {
+            char c = s[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= s.size()) break;
+            char e = s[pos++];
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case '"': case '\\': case '/': out += e; break;
+                case 'u': {
+                    unsigned cp = 0;
+                    if (!readHex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00 && s.substr(pos, 2) == "\\u") {
+                        pos += 2;
+                        unsigned low = 0;
+                        if (!readHex4(low)) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+            }
+        }
+        if (pos >= s.size()) return fail("unterminated string");
+        ++pos;
+        return true;
+    }
+
+    bool readNumber(double& out) {
+        skipSpace();
+        size_t start = pos;
+        while (pos < s.size() && (isdigit((unsigned char)s[pos]) || s[pos] == '-' || s[pos] == '+' ||
+                                  s[pos] == '.' || s[pos] == 'e' || s[pos] == 'E')) ++pos;
+        if (pos == start) return fail("expected number");
+        out = strtod(std::string(s.substr(start, pos - start)).c_str(), nullptr);
+        return true;
+    }
+
+    // Skips one value of any type and returns its source text
+    bool readRaw(std::string_view& out) {
+        skipSpace();
+        size_t start = pos;
+        int nesting = 0;
+        do {
+            if (pos >= s.size()) return fail("unexpected end of input");
+            char c = s[pos];
+            if (c == '"') {
+                ++pos;
+                while (pos < s.size() && s[pos] != '"') pos += s[pos] == '\\' ? 2 : 1;
+                if (pos >= s.size()) return fail("unterminated string");
+                ++pos;
+            } else if (c == '{' || c == '[') {
+                ++nesting;
+                ++pos;
+            } else if (c == '}' || c == ']') {
+                if (nesting == 0) return fail("unexpected closing bracket");
+                --nesting;
+                ++pos;
+            } else if (nesting == 0) {
+                // Scalar literal: runs until a delimiter
+                while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ']' &&
+                       s[pos] != ' ' && s[pos] != '\n' && s[pos] != '\r' && s[pos] != '\t') ++pos;
+            } else {
+                ++pos;
+            }
+        } while (nesting > 0);
+        out = s.substr(start, pos - start);
+        return true;
+    }
+};
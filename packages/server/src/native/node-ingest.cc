@@ -0,0 +1,305 @@
+#include "node-ingest.h"
+
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "graph.h"
+#include "input-error.h"
+#include "json-reader.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Bulk Node Ingest ---
+//
+// Replaces Prisma createMany for analysis uploads: the payload is parsed here,
+// the connection join columns are derived from name/meta, and rows go through
+// one prepared INSERT inside a savepoint, so a batch is all-or-nothing.
+
+// Keep in sync with enum NodeType in prisma/schema.prisma
+static const char* const NodeTypes[] = {
+    "NamedExport", "NamedImport", "RuntimeDynamicImport", "GlobalVarRead", "GlobalVarWrite",
+    "WebStorageRead", "WebStorageWrite", "EventOn", "EventEmit",
+    "DynamicModuleFederationReference", "UrlParamRead", "UrlParamWrite",
+};
+
+static bool IsNodeType(const std::string& type) {
+    for (const char* t : NodeTypes) {
+        if (type == t) return true;
+    }
+    return false;
+}
+
+struct IngestNode {
+    std::string projectName, branch, type, name, relativePath, version, qlsVersion;
+    int startLine = 0, startColumn = 0, endLine = 0, endColumn = 0;
+    std::string meta = "{}";
+    // Join columns; has* is false when the payload didn't provide them
+    std::string importPkg, importName, importSubpkg, exportEntry;
+    bool hasImportPkg = false, hasImportName = false, hasImportSubpkg = false, hasExportEntry = false;
+};
+
+static bool ReadOptionalString(JsonReader& r, std::string& out, bool& present) {
+    if (r.consumeNull()) {
+        present = false;
+        return true;
+    }
+    present = true;
+    return r.readString(out);
+}
+
+static bool ReadInt(JsonReader& r, int& out) {
+    double v = 0;
+    if (!r.readNumber(v)) return false;
+    out = (int)v;
+    return true;
+}
+
+static bool ReadNode(JsonReader& r, IngestNode& n) {
+    n = IngestNode();
+    if (!r.expect('{')) return false;
+    if (r.consume('}')) return true;
+
+    std::string key;
+    std::string_view raw;
+    do {
+        if (!r.readString(key) || !r.expect(':')) return false;
+        bool ok;
+        if (key == "projectName") ok = r.readString(n.projectName);
+        else if (key == "branch") ok = r.readString(n.branch);
+        else if (key == "type") ok = r.readString(n.type);
+        else if (key == "name") ok = r.readString(n.name);
+        else if (key == "relativePath") ok = r.readString(n.relativePath);
+        else if (key == "version") ok = r.readString(n.version);
+        else if (key == "qlsVersion") ok = r.readString(n.qlsVersion);
+        else if (key == "startLine") ok = ReadInt(r, n.startLine);
+        else if (key == "startColumn") ok = ReadInt(r, n.startColumn);
+        else if (key == "endLine") ok = ReadInt(r, n.endLine);
+        else if (key == "endColumn") ok = ReadInt(r, n.endColumn);
+        else if (key == "meta") {
+            ok = r.readRaw(raw);
+            if (ok) n.meta = raw == "null" ? "{}" : std::string(raw);
+        }
+        else if (key == "import_pkg") ok = ReadOptionalString(r, n.importPkg, n.hasImportPkg);
+        else if (key == "import_name") ok = ReadOptionalString(r, n.importName, n.hasImportName);
+        else if (key == "import_subpkg") ok = ReadOptionalString(r, n.importSubpkg, n.hasImportSubpkg);
+        else if (key == "export_entry") ok = ReadOptionalString(r, n.exportEntry, n.hasExportEntry);
+        else ok = r.readRaw(raw); // unknown fields (e.g. CLI-internal ones) are ignored
+        if (!ok) return false;
+    } while (r.consume(','));
+    return r.expect('}');
+}
+
+// Fills join columns the payload left out, following the CLI query parsers:
+//   NamedImport / DynamicModuleFederationReference: "<pkg>.<name>"
+//   RuntimeDynamicImport: "<pkg>.<subpkg>.<name>"
+//   NamedExport: export_entry = meta.entryName
+static void DeriveJoinColumns(IngestNode& n) {
+    if (n.type == "NamedImport" || n.type == "DynamicModuleFederationReference") {
+        size_t dot = n.name.find('.');
+        if (dot != std::string::npos) {
+            if (!n.hasImportPkg) { n.importPkg = n.name.substr(0, dot); n.hasImportPkg = true; }
+            if (!n.hasImportName) { n.importName = n.name.substr(dot + 1); n.hasImportName = true; }
+        }
+    } else if (n.type == "RuntimeDynamicImport") {
+        size_t first = n.name.find('.');
+        size_t second = first == std::string::npos ? first : n.name.find('.', first + 1);
+        if (second != std::string::npos) {
+            if (!n.hasImportPkg) { n.importPkg = n.name.substr(0, first); n.hasImportPkg = true; }
+            if (!n.hasImportSubpkg) { n.importSubpkg = n.name.substr(first + 1, second - first - 1); n.hasImportSubpkg = true; }
+            if (!n.hasImportName) { n.importName = n.name.substr(second + 1); n.hasImportName = true; }
+        }
+    } else if (n.type == "NamedExport" && !n.hasExportEntry) {
+        std::string_view entry = getEntryName(n.meta);
+        if (!entry.empty()) {
+            n.exportEntry = std::string(entry);
+            n.hasExportEntry = true;
+        }
+    }
+}
+
+// cuid-shaped ids ('c' + time + counter + random, base36) so rows inserted
+// here are indistinguishable from ones Prisma created
+static void AppendBase36(std::string& out, uint64_t v, int width) {
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    char buf[16];
+    for (int i = width - 1; i >= 0; --i) {
+        buf[i] = digits[v % 36];
+        v /= 36;
+    }
+    out.append(buf, width);
+}
+
+static std::string GenerateNodeId() {
+    static std::atomic<uint32_t> counter{ 0 };
+    thread_local std::mt19937_64 rng(std::random_device{}());
+
+    uint64_t ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string id = "c";
+    AppendBase36(id, ms, 8);
+    AppendBase36(id, counter.fetch_add(1) % (36 * 36 * 36 * 36), 4);
+    AppendBase36(id, rng() % 2821109907456ULL /* 36^8 */, 8);
+    AppendBase36(id, rng() % 1679616ULL /* 36^4 */, 4);
+    return id;
+}
+
+// Same text format the Prisma SQLite adapter writes for DateTime columns
+static std::string CurrentTimestamp() {
+    auto now = std::chrono::system_clock::now();
+    time_t secs = std::chrono::system_clock::to_time_t(now);
+    int ms = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000);
+    struct tm tm;
+    gmtime_r(&secs, &tm);
+    char buf[40];
+    size_t len = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + len, sizeof(buf) - len, ".%03d+00:00", ms);
+    return buf;
+}
+
+static void BindText(sqlite3_stmt* stmt, int i, const std::string& v) {
+    sqlite3_bind_text(stmt, i, v.data(), (int)v.size(), SQLITE_STATIC);
+}
+
+static void BindOptional(sqlite3_stmt* stmt, int i, const std::string& v, bool present) {
+    if (present) BindText(stmt, i, v);
+    else sqlite3_bind_null(stmt, i);
+}
+
+void IngestNodes(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* payload = (const char*)sqlite3_value_text(argv[0]);
+    int payloadSize = sqlite3_value_bytes(argv[0]);
+    const char* shallowBranchRaw = argc >= 2 ? (const char*)sqlite3_value_text(argv[1]) : nullptr;
+    if (!payload) {
+        sqlite3_result_int(context, 0);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_stmt* projectLookup = nullptr;
+    const char* insertSql =
+        "INSERT INTO Node (id, branch, projectId, projectName, version, type, name, relativePath, "
+        "startLine, startColumn, endLine, endColumn, meta, createdAt, updatedAt, qlsVersion, "
+        "import_pkg, import_name, import_subpkg, export_entry) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14, ?14, ?15, ?16, ?17, ?18, ?19)";
+    if (sqlite3_prepare_v2(db, insertSql, -1, &insert, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT id FROM Project WHERE name = ?", -1, &projectLookup, NULL) != SQLITE_OK) {
+        sqlite3_result_error(context, sqlite3_errmsg(db), -1);
+        sqlite3_finalize(insert);
+        return;
+    }
+
+    // A savepoint nests inside a caller's transaction and opens one otherwise
+    sqlite3_exec(db, "SAVEPOINT dms_ingest_nodes", NULL, NULL, NULL);
+
+    std::string error;
+    bool invalidInput = true; // false once the database, not the payload, is at fault
+    std::string timestamp = CurrentTimestamp();
+    std::unordered_map<std::string, std::string> projectIds;
+    std::string firstBranch, firstVersion, firstQlsVersion;
+    // BindText binds SQLITE_STATIC, so whatever it binds has to outlive the step
+    const std::string shallowBranch = shallowBranchRaw ? shallowBranchRaw : "";
+    int count = 0;
+
+    JsonReader r(std::string_view(payload, payloadSize));
+    bool isArray = r.consume('[');
+    IngestNode n;
+    while (error.empty()) {
+        if (isArray) {
+            if (r.consume(']')) break;
+            if (count > 0 && !r.expect(',')) { error = r.error(); break; }
+        } else if (r.atEnd()) {
+            break;
+        }
+        if (!ReadNode(r, n)) {
+            error = "invalid node JSON: " + r.error();
+            break;
+        }
+
+        if (!IsNodeType(n.type)) {
+            error = "invalid node type '" + n.type + "'";
+            break;
+        }
+        // Same invariants the /nodes/batch-create route checks
+        if (count == 0) {
+            firstBranch = n.branch;
+            firstVersion = n.version;
+            firstQlsVersion = n.qlsVersion;
+        } else if (n.branch != firstBranch) {
+            error = "Expected only 1 branch";
+            break;
+        } else if (n.version != firstVersion) {
+            error = "Expected only 1 version";
+            break;
+        } else if (n.qlsVersion != firstQlsVersion) {
+            error = "Expected only 1 qls version";
+            break;
+        }
+
+        // Like /nodes/batch-create, the project comes from projectName; a
+        // projectId in the payload is ignored rather than trusted
+        auto project = projectIds.find(n.projectName);
+        if (project == projectIds.end()) {
+            BindText(projectLookup, 1, n.projectName);
+            std::string id;
+            if (sqlite3_step(projectLookup) == SQLITE_ROW) id = (const char*)sqlite3_column_text(projectLookup, 0);
+            sqlite3_reset(projectLookup);
+            project = projectIds.emplace(n.projectName, id).first;
+        }
+        if (project->second.empty()) {
+            error = "Project not found: " + n.projectName;
+            break;
+        }
+        if (n.qlsVersion.empty()) n.qlsVersion = "0.1.0";
+        DeriveJoinColumns(n);
+
+        std::string id = GenerateNodeId();
+        BindText(insert, 1, id);
+        BindText(insert, 2, shallowBranchRaw ? shallowBranch : n.branch);
+        BindText(insert, 3, project->second);
+        BindText(insert, 4, n.projectName);
+        BindText(insert, 5, n.version);
+        BindText(insert, 6, n.type);
+        BindText(insert, 7, n.name);
+        BindText(insert, 8, n.relativePath);
+        sqlite3_bind_int(insert, 9, n.startLine);
+        sqlite3_bind_int(insert, 10, n.startColumn);
+        sqlite3_bind_int(insert, 11, n.endLine);
+        sqlite3_bind_int(insert, 12, n.endColumn);
+        BindText(insert, 13, n.meta);
+        BindText(insert, 14, timestamp);
+        BindText(insert, 15, n.qlsVersion);
+        BindOptional(insert, 16, n.importPkg, n.hasImportPkg);
+        BindOptional(insert, 17, n.importName, n.hasImportName);
+        BindOptional(insert, 18, n.importSubpkg, n.hasImportSubpkg);
+        BindOptional(insert, 19, n.exportEntry, n.hasExportEntry);
+
+        int rc = sqlite3_step(insert);
+        sqlite3_reset(insert);
+        if (rc != SQLITE_DONE) {
+            error = std::string(sqlite3_errmsg(db)) + " (" + n.projectName + " " + n.relativePath + " " + n.name + ")";
+            invalidInput = false;
+            break;
+        }
+        count++;
+    }
+    if (error.empty() && !r.atEnd()) error = "invalid node JSON: trailing characters";
+
+    sqlite3_finalize(insert);
+    sqlite3_finalize(projectLookup);
+
+    if (!error.empty()) {
+        sqlite3_exec(db, "ROLLBACK TO dms_ingest_nodes; RELEASE dms_ingest_nodes", NULL, NULL, NULL);
+        sqlite3_result_error(context, error.c_str(), -1);
+        if (invalidInput) sqlite3_result_error_code(context, InvalidInputError);
+        return;
+    }
+    sqlite3_exec(db, "RELEASE dms_ingest_nodes", NULL, NULL, NULL);
+    sqlite3_result_int(context, count);
+}
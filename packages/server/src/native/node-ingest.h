@@ -0,0 +1,8 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// dms_ingest_nodes(payload, shallowBranch) - bulk insert of CodeQL result nodes.
+// payload is NDJSON (one node object per line) or a JSON array of node objects
+// in the shape the CLI uploads. Returns the number of inserted rows.
+void IngestNodes(sqlite3_context* context, int argc, sqlite3_value** argv);
@@ -0,0 +1,197 @@
+#include "orphan-nodes.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "graph.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Orphan Nodes ---
+//
+// NOT EXISTS per node probes the Connection indexes once for every export or
+// import of the branch. Here one sequential pass over Connection (through the
+// covering (fromKey, toKey) index) marks every Node rowid with an incoming or
+// outgoing connection, and the branch's nodes are then read project by
+// project through the (projectId, branch, relativePath, type, ...) unique
+// index, which hands them out in report order. Both reports come out of the
+// same two passes, so the second one requested is a cache hit.
+
+enum : uint8_t { HasIncoming = 1, HasOutgoing = 2 };
+
+static bool IsImportType(const char* type) {
+    return strcmp(type, "NamedImport") == 0 || strcmp(type, "RuntimeDynamicImport") == 0 ||
+           strcmp(type, "DynamicModuleFederationReference") == 0;
+}
+
+static std::string ColumnText(sqlite3_stmt* stmt, int col) {
+    const char* text = (const char*)sqlite3_column_text(stmt, col);
+    return text ? text : "";
+}
+
+// marks[rowid] = HasIncoming | HasOutgoing for every Node rowid
+static bool MarkConnected(sqlite3* db, std::vector<uint8_t>& marks, std::string& error) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT MAX(rowid) FROM Node", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_int64 maxKey = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    marks.assign((size_t)maxKey + 1, 0);
+
+    if (sqlite3_prepare_v2(db, "SELECT fromKey, toKey FROM Connection", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        sqlite3_int64 from = sqlite3_column_int64(stmt, 0);
+        sqlite3_int64 to = sqlite3_column_int64(stmt, 1);
+        if (from > 0 && from <= maxKey) marks[from] |= HasOutgoing;
+        if (to > 0 && to <= maxKey) marks[to] |= HasIncoming;
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+struct OrphanNode {
+    std::string id, name, type, relativePath;
+    int startLine, startColumn;
+};
+
+// One report: projects are appended as they are scanned
+class OrphanReport {
+    JsonBuilder jb;
+    int count = 0;
+    bool firstProject = true;
+
+public:
+    explicit OrphanReport(const std::string& branch) {
+        jb.beginObject();
+        jb.key("branch"); jb.string(branch); jb.comma();
+        jb.key("projects");
+        jb.beginArray();
+    }
+
+    void addProject(const std::string& projectId, const std::string& projectName, const std::vector<OrphanNode>& nodes) {
+        if (nodes.empty()) return;
+        if (!firstProject) jb.comma();
+        firstProject = false;
+        jb.beginObject();
+        jb.key("projectId"); jb.string(projectId); jb.comma();
+        jb.key("projectName"); jb.string(projectName); jb.comma();
+        jb.key("nodes");
+        jb.beginArray();
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (i > 0) jb.comma();
+            const OrphanNode& n = nodes[i];
+            jb.beginObject();
+                jb.key("id"); jb.string(n.id); jb.comma();
+                jb.key("name"); jb.string(n.name); jb.comma();
+                jb.key("type"); jb.string(n.type); jb.comma();
+                jb.key("relativePath"); jb.string(n.relativePath); jb.comma();
+                jb.key("startLine"); jb.number(n.startLine); jb.comma();
+                jb.key("startColumn"); jb.number(n.startColumn);
+            jb.endObject();
+        }
+        jb.endArray();
+        jb.endObject();
+        count += (int)nodes.size();
+    }
+
+    std::string finish() {
+        jb.endArray();
+        jb.comma();
+        jb.key("count"); jb.number(count);
+        jb.endObject();
+        return jb.str();
+    }
+};
+
+static bool BuildReports(sqlite3* db, const std::string& branch, std::string& unusedExports,
+                         std::string& unresolvedImports, std::string& error) {
+    std::vector<uint8_t> marks;
+    if (!MarkConnected(db, marks, error)) return false;
+
+    std::vector<std::pair<std::string, std::string>> projects; // id, name
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, name FROM Project ORDER BY name", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) projects.emplace_back(ColumnText(stmt, 0), ColumnText(stmt, 1));
+    sqlite3_finalize(stmt);
+
+    // The ORDER BY is the unique index order, so no sort is needed
+    if (sqlite3_prepare_v2(db,
+                           "SELECT rowid, id, name, type, relativePath, startLine, startColumn FROM Node "
+                           "WHERE projectId = ? AND branch = ? AND type IN "
+                           "('NamedExport', 'NamedImport', 'RuntimeDynamicImport', 'DynamicModuleFederationReference') "
+                           "ORDER BY relativePath, type, name, startLine, startColumn",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    OrphanReport exportsReport(branch), importsReport(branch);
+    std::vector<OrphanNode> exports, imports;
+    for (const auto& project : projects) {
+        exports.clear();
+        imports.clear();
+        sqlite3_bind_text(stmt, 1, project.first.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            sqlite3_int64 key = sqlite3_column_int64(stmt, 0);
+            uint8_t mark = key > 0 && (size_t)key < marks.size() ? marks[key] : 0;
+            const char* type = (const char*)sqlite3_column_text(stmt, 3);
+            bool isExport = strcmp(type, "NamedExport") == 0;
+            if (isExport ? (mark & HasIncoming) : (!IsImportType(type) || (mark & HasOutgoing))) continue;
+            OrphanNode n{ ColumnText(stmt, 1), ColumnText(stmt, 2), type, ColumnText(stmt, 4),
+                          sqlite3_column_int(stmt, 5), sqlite3_column_int(stmt, 6) };
+            (isExport ? exports : imports).push_back(std::move(n));
+        }
+        sqlite3_reset(stmt);
+        exportsReport.addProject(project.first, project.second, exports);
+        importsReport.addProject(project.first, project.second, imports);
+    }
+    sqlite3_finalize(stmt);
+
+    unusedExports = exportsReport.finish();
+    unresolvedImports = importsReport.finish();
+    return true;
+}
+
+static void FindOrphans(sqlite3_context* context, sqlite3_value** argv, bool exports) {
+    const char* branch = (const char*)sqlite3_value_text(argv[0]);
+    if (!branch) {
+        sqlite3_result_error(context, "branch is required", -1);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::string exportsKey = ResultCacheKey("find_unused_exports", { branch });
+    std::string importsKey = ResultCacheKey("find_unresolved_imports", { branch });
+    std::string json;
+    ResultCacheTicket ticket;
+    if (!ResultCacheLookup(db, exports ? exportsKey : importsKey, json, ticket)) {
+        std::string unusedExports, unresolvedImports, error;
+        if (!BuildReports(db, branch, unusedExports, unresolvedImports, error)) {
+            sqlite3_result_error(context, error.c_str(), -1);
+            return;
+        }
+        ResultCacheStore(db, ticket, exportsKey, unusedExports, { branch });
+        ResultCacheStore(db, ticket, importsKey, unresolvedImports, { branch });
+        json = exports ? unusedExports : unresolvedImports;
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
+
+void FindUnusedExports(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    FindOrphans(context, argv, true);
+}
+
+void FindUnresolvedImports(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    FindOrphans(context, argv, false);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// find_unused_exports(branch) - NamedExport nodes of branch no connection
+// points to.
+// find_unresolved_imports(branch) - import nodes of branch (NamedImport,
+// RuntimeDynamicImport, DynamicModuleFederationReference) with no outgoing
+// connection.
+//
+// Both return nodes grouped by project, projects by name and nodes in
+// (relativePath, type, name, position) order:
+//   {"branch","count","projects":[{"projectId","projectName",
+//     "nodes":[{id,name,type,relativePath,startLine,startColumn}...]}...]}
+// One call computes and caches both reports.
+void FindUnusedExports(sqlite3_context* context, int argc, sqlite3_value** argv);
+void FindUnresolvedImports(sqlite3_context* context, int argc, sqlite3_value** argv);
@@ -0,0 +1,484 @@
+#include "path-match.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "branch-overlay.h"
+#include "graph.h"
+#include "input-error.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Path Patterns ---
+//
+// Patterns are matched on the project graph of a branch, where each arc
+// carries the set of node types its connections start from. The graph comes
+// from the resident branch store (or one pass of SQL when that is
+// unavailable) and is small next to the node graph, so evaluation is plain
+// set work:
+//
+//   1. Candidates per step: id and name constraints are looked up directly,
+//      the rest filter the project list.
+//   2. A forward and a backward semi-join pass over the edge steps drop every
+//      candidate that can't be part of a complete match. Path patterns are
+//      acyclic joins, so after both passes no partial binding dead-ends.
+//   3. Bindings are enumerated depth-first in project name order and the
+//      search stops as soon as limit + 1 matches were seen.
+//
+// Variable-length steps follow walks of exactly h hops for each h in the
+// bounds, so "*1..3" means reachable in one to three hops.
+
+static const int DefaultLimit = 100;
+static const int MaxLimit = 10000;
+static const int MaxHops = 8;
+
+static const char* const NodeTypes[] = {
+    "NamedExport", "NamedImport", "RuntimeDynamicImport", "GlobalVarRead", "GlobalVarWrite", "WebStorageRead",
+    "WebStorageWrite", "EventOn", "EventEmit", "DynamicModuleFederationReference", "UrlParamRead", "UrlParamWrite",
+};
+static const int NodeTypeCount = sizeof(NodeTypes) / sizeof(NodeTypes[0]);
+static const uint32_t AnyNodeType = (1u << NodeTypeCount) - 1;
+
+static int NodeTypeIndex(const std::string& name) {
+    for (int i = 0; i < NodeTypeCount; ++i) {
+        if (name == NodeTypes[i]) return i;
+    }
+    return -1;
+}
+
+// --- Parsing ---
+
+struct PatternStep {
+    std::string projectType; // empty for any
+    std::string id;
+    std::string name;
+    int has = -1; // node type the project must contain
+};
+
+struct PatternEdge {
+    uint32_t types = AnyNodeType; // node types the connections may start from
+    int minHops = 1, maxHops = 1;
+    bool forward = true;          // '->' from the previous step, '<-' towards it
+};
+
+struct Pattern {
+    std::vector<PatternStep> steps;
+    std::vector<PatternEdge> edges; // edges[i] joins steps[i] and steps[i + 1]
+};
+
+class PatternParser {
+    const std::string& s;
+    size_t pos = 0;
+    std::string error;
+
+    void skipSpace() {
+        while (pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+    }
+
+    bool consume(const char* token) {
+        skipSpace();
+        size_t n = strlen(token);
+        if (s.compare(pos, n, token) != 0) return false;
+        pos += n;
+        return true;
+    }
+
+    bool fail(const std::string& message) {
+        if (error.empty()) error = "pattern: " + message + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    bool expect(const char* token) {
+        return consume(token) || fail(std::string("expected '") + token + "'");
+    }
+
+    bool ident(std::string& out) {
+        skipSpace();
+        size_t start = pos;
+        while (pos < s.size() && (isalnum((unsigned char)s[pos]) || s[pos] == '_' || s[pos] == '-')) pos++;
+        out = s.substr(start, pos - start);
+        return !out.empty();
+    }
+
+    bool quoted(std::string& out) {
+        skipSpace();
+        if (pos >= s.size() || (s[pos] != '\'' && s[pos] != '"')) return fail("expected a quoted string");
+        char quote = s[pos++];
+        size_t end = s.find(quote, pos);
+        if (end == std::string::npos) return fail("unterminated string");
+        out = s.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    }
+
+    bool number(int& out) {
+        skipSpace();
+        if (pos >= s.size() || !isdigit((unsigned char)s[pos])) return false;
+        out = 0;
+        while (pos < s.size() && isdigit((unsigned char)s[pos]) && out <= MaxHops) out = out * 10 + (s[pos++] - '0');
+        return true;
+    }
+
+    bool nodeType(int& out) {
+        std::string name;
+        if (!ident(name)) return fail("expected a node type");
+        out = NodeTypeIndex(name);
+        return out >= 0 || fail("unknown node type '" + name + "'");
+    }
+
+    bool step(PatternStep& st) {
+        if (!expect("(")) return false;
+        consume(":");
+        ident(st.projectType);
+        if (consume("{")) {
+            do {
+                std::string key, value;
+                if (!ident(key)) return fail("expected id, name or has");
+                if (!expect(":") || !quoted(value)) return false;
+                if (key == "id") st.id = value;
+                else if (key == "name") st.name = value;
+                else if (key == "has") {
+                    st.has = NodeTypeIndex(value);
+                    if (st.has < 0) return fail("unknown node type '" + value + "'");
+                } else return fail("unknown property '" + key + "'");
+            } while (consume(","));
+            if (!expect("}")) return false;
+        }
+        return expect(")");
+    }
+
+    bool edge(PatternEdge& e) {
+        e.forward = !consume("<");
+        if (!expect("-[")) return false;
+        consume(":");
+        skipSpace();
+        if (pos < s.size() && isalpha((unsigned char)s[pos])) {
+            e.types = 0;
+            do {
+                int type;
+                if (!nodeType(type)) return false;
+                e.types |= 1u << type;
+            } while (consume("|"));
+        }
+        if (consume("*")) {
+            bool hasMin = number(e.minHops);
+            if (consume("..")) {
+                if (!hasMin) e.minHops = 1;
+                if (!number(e.maxHops)) e.maxHops = MaxHops;
+            } else {
+                e.maxHops = hasMin ? e.minHops : MaxHops;
+                if (!hasMin) e.minHops = 1;
+            }
+            if (e.minHops < 1 || e.minHops > e.maxHops) return fail("hop bounds must satisfy 1 <= min <= max");
+            if (e.maxHops > MaxHops) return fail("at most " + std::to_string(MaxHops) + " hops per step");
+        }
+        return expect(e.forward ? "]->" : "]-");
+    }
+
+public:
+    explicit PatternParser(const std::string& source) : s(source) {}
+
+    bool parse(Pattern& out, std::string& err) {
+        out.steps.emplace_back();
+        bool ok = step(out.steps.back());
+        while (ok) {
+            skipSpace();
+            if (pos == s.size()) break;
+            out.edges.emplace_back();
+            out.steps.emplace_back();
+            ok = edge(out.edges.back()) && step(out.steps.back());
+        }
+        err = error;
+        return ok;
+    }
+};
+
+// --- Project Graph ---
+
+struct ProjectArc {
+    int to;
+    uint32_t types; // node types of the connections behind the arc
+};
+
+struct ProjectVertex {
+    std::string id, name, type;
+    uint32_t nodeTypes = 0;
+};
+
+struct ProjectGraph {
+    std::vector<ProjectVertex> vertices; // by project name
+    std::vector<std::vector<ProjectArc>> out, in;
+};
+
+static uint32_t TypeBit(const char* type) {
+    int t = type ? NodeTypeIndex(type) : -1;
+    return t < 0 ? 0 : 1u << t;
+}
+
+// Arc masks keyed by (from, to) projectId
+using ArcMasks = std::map<std::pair<std::string, std::string>, uint32_t>;
+
+static bool LoadResidentArcs(sqlite3* db, const std::string& branch, std::map<std::string, uint32_t>& projects,
+                             ArcMasks& arcs, std::string& error) {
+    BranchGraph graph;
+    if (!LoadBranchGraph(db, branch, graph, error)) return false;
+    for (const auto& segment : graph.segments) {
+        uint32_t& mask = projects[segment->projectId];
+        for (const SegmentNode& n : segment->nodes) mask |= TypeBit(n.type.c_str());
+    }
+    for (const auto& e : graph.edges) {
+        int from = graph.SegmentOf(e.first), to = graph.SegmentOf(e.second);
+        if (from == to) continue;
+        arcs[{ graph.segments[from]->projectId, graph.segments[to]->projectId }] |=
+            TypeBit(graph.Node(e.first).type.c_str());
+    }
+    return true;
+}
+
+static bool LoadArcs(sqlite3* db, const std::string& branch, std::map<std::string, uint32_t>& projects,
+                     ArcMasks& arcs, std::string& error) {
+    if (LoadResidentArcs(db, branch, projects, arcs, error)) return true;
+    if (!error.empty()) return false;
+    projects.clear();
+    arcs.clear();
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT DISTINCT projectId, type FROM Node WHERE branch = ?", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        projects[(const char*)sqlite3_column_text(stmt, 0)] |= TypeBit((const char*)sqlite3_column_text(stmt, 1));
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db,
+                           "SELECT DISTINCT N1.projectId, N1.type, N2.projectId FROM Connection C "
+                           "JOIN Node N1 ON N1.rowid = C.fromKey JOIN Node N2 ON N2.rowid = C.toKey "
+                           "WHERE N1.branch = ?1 AND N2.branch = ?1 AND N1.projectId != N2.projectId",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        arcs[{ (const char*)sqlite3_column_text(stmt, 0), (const char*)sqlite3_column_text(stmt, 2) }] |=
+            TypeBit((const char*)sqlite3_column_text(stmt, 1));
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+static bool LoadProjectGraph(sqlite3* db, const std::string& branch, ProjectGraph& g, std::string& error) {
+    std::map<std::string, uint32_t> projects; // projectId -> node types on the branch
+    ArcMasks arcs;
+    if (!LoadArcs(db, branch, projects, arcs, error)) return false;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, name, type FROM Project", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto it = projects.find((const char*)sqlite3_column_text(stmt, 0));
+        if (it == projects.end()) continue;
+        const char* type = (const char*)sqlite3_column_text(stmt, 2);
+        g.vertices.push_back({ it->first, (const char*)sqlite3_column_text(stmt, 1), type ? type : "", it->second });
+    }
+    sqlite3_finalize(stmt);
+    std::sort(g.vertices.begin(), g.vertices.end(),
+              [](const ProjectVertex& a, const ProjectVertex& b) { return a.name < b.name; });
+
+    std::unordered_map<std::string, int> vertexOf;
+    for (int v = 0; v < (int)g.vertices.size(); ++v) vertexOf.emplace(g.vertices[v].id, v);
+    g.out.resize(g.vertices.size());
+    g.in.resize(g.vertices.size());
+    for (const auto& arc : arcs) {
+        auto from = vertexOf.find(arc.first.first), to = vertexOf.find(arc.first.second);
+        if (from == vertexOf.end() || to == vertexOf.end()) continue;
+        g.out[from->second].push_back({ to->second, arc.second });
+        g.in[to->second].push_back({ from->second, arc.second });
+    }
+    return true;
+}
+
+// --- Evaluation ---
+
+// hops[v] = shortest h in [minHops, maxHops] with a walk of exactly h arcs
+// from one of the sources to v, 0 when there is none
+static std::vector<int> Reach(const ProjectGraph& g, const PatternEdge& e, bool forward, const std::vector<int>& sources) {
+    const std::vector<std::vector<ProjectArc>>& arcs = forward == e.forward ? g.out : g.in;
+    int n = (int)g.vertices.size();
+    std::vector<int> hops(n, 0);
+    std::vector<char> current(n, 0), next(n, 0);
+    for (int v : sources) current[v] = 1;
+    for (int h = 1; h <= e.maxHops; ++h) {
+        std::fill(next.begin(), next.end(), 0);
+        bool any = false;
+        for (int v = 0; v < n; ++v) {
+            if (!current[v]) continue;
+            for (const ProjectArc& a : arcs[v]) {
+                if (!(a.types & e.types) || next[a.to]) continue;
+                next[a.to] = 1;
+                any = true;
+                if (h >= e.minHops && !hops[a.to]) hops[a.to] = h;
+            }
+        }
+        if (!any) break;
+        current.swap(next);
+    }
+    return hops;
+}
+
+static std::vector<int> Candidates(const ProjectGraph& g, const PatternStep& st) {
+    std::vector<int> out;
+    for (int v = 0; v < (int)g.vertices.size(); ++v) {
+        const ProjectVertex& p = g.vertices[v];
+        if (!st.id.empty() && p.id != st.id) continue;
+        if (!st.name.empty() && p.name != st.name) continue;
+        if (!st.projectType.empty() && p.type != st.projectType) continue;
+        if (st.has >= 0 && !(p.nodeTypes & (1u << st.has))) continue;
+        out.push_back(v);
+    }
+    return out;
+}
+
+static void Restrict(std::vector<int>& candidates, const std::vector<int>& hops) {
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](int v) { return !hops[v]; }),
+                     candidates.end());
+}
+
+struct PatternMatch {
+    std::vector<int> projects;
+    std::vector<int> hops;
+};
+
+class Matcher {
+    const ProjectGraph& g;
+    const Pattern& pattern;
+    std::vector<std::vector<int>> alive; // per step, candidates that complete some match
+    size_t stopAt;
+    PatternMatch current;
+
+    void extend(size_t step, std::vector<PatternMatch>& out) {
+        if (step == pattern.steps.size()) {
+            out.push_back(current);
+            return;
+        }
+        const PatternEdge& e = pattern.edges[step - 1];
+        std::vector<int> hops = Reach(g, e, true, { current.projects.back() });
+        for (int v : alive[step]) {
+            if (!hops[v]) continue;
+            current.projects.push_back(v);
+            current.hops.push_back(hops[v]);
+            extend(step + 1, out);
+            current.projects.pop_back();
+            current.hops.pop_back();
+            if (out.size() >= stopAt) return;
+        }
+    }
+
+public:
+    Matcher(const ProjectGraph& graph, const Pattern& p, size_t limit) : g(graph), pattern(p), stopAt(limit + 1) {}
+
+    void run(std::vector<PatternMatch>& out) {
+        size_t k = pattern.steps.size();
+        for (const PatternStep& st : pattern.steps) alive.push_back(Candidates(g, st));
+        for (size_t i = 1; i < k; ++i) Restrict(alive[i], Reach(g, pattern.edges[i - 1], true, alive[i - 1]));
+        for (size_t i = k - 1; i > 0; --i) Restrict(alive[i - 1], Reach(g, pattern.edges[i - 1], false, alive[i]));
+
+        for (int v : alive[0]) {
+            current.projects.assign(1, v);
+            current.hops.clear();
+            extend(1, out);
+            if (out.size() >= stopAt) return;
+        }
+    }
+};
+
+static std::string BuildMatches(const ProjectGraph& g, const Pattern& pattern, const std::string& branch, int limit) {
+    std::vector<PatternMatch> matches;
+    Matcher(g, pattern, limit).run(matches);
+    bool truncated = matches.size() > (size_t)limit;
+    if (truncated) matches.resize(limit);
+
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("branch"); jb.string(branch); jb.comma();
+    jb.key("matches");
+    jb.beginArray();
+    for (size_t i = 0; i < matches.size(); ++i) {
+        if (i > 0) jb.comma();
+        jb.beginObject();
+        jb.key("projects");
+        jb.beginArray();
+        for (size_t s = 0; s < matches[i].projects.size(); ++s) {
+            if (s > 0) jb.comma();
+            const ProjectVertex& p = g.vertices[matches[i].projects[s]];
+            jb.beginObject();
+                jb.key("id"); jb.string(p.id); jb.comma();
+                jb.key("name"); jb.string(p.name); jb.comma();
+                jb.key("type"); jb.string(p.type);
+            jb.endObject();
+        }
+        jb.endArray();
+        jb.comma();
+        jb.key("hops");
+        jb.beginArray();
+        for (size_t h = 0; h < matches[i].hops.size(); ++h) {
+            if (h > 0) jb.comma();
+            jb.number(matches[i].hops[h]);
+        }
+        jb.endArray();
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.comma();
+    jb.key("truncated"); jb.raw(truncated ? "true" : "false");
+    jb.endObject();
+    return jb.str();
+}
+
+void MatchPattern(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* rawPattern = (const char*)sqlite3_value_text(argv[0]);
+    const char* branch = (const char*)sqlite3_value_text(argv[1]);
+    if (!rawPattern || !branch) {
+        sqlite3_result_error(context, "pattern and branch are required", -1);
+        sqlite3_result_error_code(context, InvalidInputError);
+        return;
+    }
+    int limit = DefaultLimit;
+    if (argc > 2 && sqlite3_value_type(argv[2]) != SQLITE_NULL) limit = sqlite3_value_int(argv[2]);
+    limit = std::max(1, std::min(limit, MaxLimit));
+
+    std::string source = rawPattern, error;
+    Pattern pattern;
+    if (!PatternParser(source).parse(pattern, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        sqlite3_result_error_code(context, InvalidInputError);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::string key = ResultCacheKey("dms_match", { branch, source, std::to_string(limit) });
+    std::string json;
+    ResultCacheTicket ticket;
+    if (!ResultCacheLookup(db, key, json, ticket)) {
+        ProjectGraph g;
+        if (!LoadProjectGraph(db, branch, g, error)) {
+            sqlite3_result_error(context, error.c_str(), -1);
+            return;
+        }
+        json = BuildMatches(g, pattern, branch, limit);
+        ResultCacheStore(db, ticket, key, json, { branch });
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// dms_match(pattern, branch[, limit]) - projects of branch bound to the steps
+// of a path pattern over the project graph, where an edge A -> B of type T
+// exists when a node of type T in A is connected to a node in B:
+//
+//   pattern := step (edge step)*
+//   step    := '(' [projectType] ['{' prop (',' prop)* '}'] ')'
+//   prop    := ('id' | 'name' | 'has') ':' quoted     has: contains a node of that type
+//   edge    := '-[' [nodeType ('|' nodeType)*] [hops] ']->'  |  '<-[' ... ']-'
+//   hops    := '*' [min] ['..' [max]]                 default 1..1, '*' alone 1..8
+//
+// e.g. (App)-[NamedImport*1..3]->({name:'x', has:'EventEmit'}). Returns
+//   {"branch","matches":[{"projects":[{id,name,type}...],"hops":[...]}],"truncated"}
+// with one match per distinct binding, hops being the shortest qualifying
+// length of each edge step, and at most limit (default 100) matches.
+void MatchPattern(sqlite3_context* context, int argc, sqlite3_value** argv);
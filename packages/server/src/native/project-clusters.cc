@@ -0,0 +1,425 @@
+#include "project-clusters.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "branch-overlay.h"
+#include "graph.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Project Clusters ---
+//
+// The '*' project graph walks and serializes every project before the client
+// can draw anything. Clusters answer the first screen instead: one pass over
+// the branch's nodes maps them to projects, one pass over its connections
+// counts cross-project connections per project pair. Both come from the
+// resident branch store when it can serve the branch, otherwise from the
+// Node rows and the (fromKey, toKey) index.
+// Payload size depends on the number of projects, not nodes. Expanding a
+// project probes only that project's rows through the
+// (projectId, branch, ...) unique index and the Connection key indexes.
+
+struct ProjectInfo {
+    std::string id;
+    std::string name;
+    std::string type;
+    std::string addr;
+};
+
+static std::string ColumnText(sqlite3_stmt* stmt, int col) {
+    const char* text = (const char*)sqlite3_column_text(stmt, col);
+    return text ? text : "";
+}
+
+static void ReadProjectRow(sqlite3_stmt* stmt, ProjectInfo& p) {
+    p.id = ColumnText(stmt, 0);
+    p.name = ColumnText(stmt, 1);
+    p.type = ColumnText(stmt, 2);
+    p.addr = ColumnText(stmt, 3);
+}
+
+static void WriteProject(JsonBuilder& jb, const ProjectInfo& p, const std::string& branch) {
+    jb.beginObject();
+        jb.key("id"); jb.string(p.id); jb.comma();
+        jb.key("name"); jb.string(p.name); jb.comma();
+        jb.key("type"); jb.string(p.type); jb.comma();
+        jb.key("branch"); jb.string(branch); jb.comma();
+        jb.key("addr"); jb.string(p.addr);
+    jb.endObject();
+}
+
+// The view is already scoped to one branch; only nodeTypes/excludeProjects apply
+static bool ParseClusterFilter(int argc, sqlite3_value** argv, int index, std::string& raw, TraversalFilter& filter,
+                               std::string& error) {
+    if (argc > index && sqlite3_value_type(argv[index]) != SQLITE_NULL) raw = (const char*)sqlite3_value_text(argv[index]);
+    if (!ParseTraversalFilter(raw.c_str(), filter, error)) return false;
+    filter.branches.clear();
+    return true;
+}
+
+struct Cluster {
+    int project = -1; // index into projects, -1 until Project rows are read
+    int nodeCount = 0;
+    int boundaryCount = 0;
+};
+
+struct ClusterNode {
+    int cluster;
+    bool boundary = false;
+};
+
+struct ClusterCounts {
+    std::unordered_map<std::string, int> clusterIndex; // Project.id -> clusters
+    std::vector<Cluster> clusters;
+    std::map<std::pair<int, int>, int> weights;
+
+    int ClusterOf(const std::string& projectId) {
+        auto inserted = clusterIndex.emplace(projectId, (int)clusters.size());
+        if (inserted.second) clusters.emplace_back();
+        return inserted.first->second;
+    }
+
+    void Connect(ClusterNode& from, ClusterNode& to) {
+        if (from.cluster == to.cluster) return;
+        weights[{ from.cluster, to.cluster }]++;
+        for (ClusterNode* n : { &from, &to }) {
+            if (n->boundary) continue;
+            n->boundary = true;
+            clusters[n->cluster].boundaryCount++;
+        }
+    }
+};
+
+// False (with error empty) when the branch store can't serve the branch
+static bool CountResidentClusters(sqlite3* db, const std::string& branch, const TraversalFilter& filter,
+                                  ClusterCounts& counts, std::string& error) {
+    BranchGraph graph;
+    if (!LoadBranchGraph(db, branch, graph, error)) return false;
+
+    std::vector<ClusterNode> nodes(graph.VertexCount(), ClusterNode{ -1 });
+    for (size_t s = 0; s < graph.segments.size(); ++s) {
+        const ProjectSegment& segment = *graph.segments[s];
+        if (filter.excludeProjects.count(segment.projectName)) continue;
+        for (size_t i = 0; i < segment.nodes.size(); ++i) {
+            if (!filter.nodeTypes.empty() && !filter.nodeTypes.count(segment.nodes[i].type)) continue;
+            int c = counts.ClusterOf(segment.projectId);
+            counts.clusters[c].nodeCount++;
+            nodes[graph.offsets[s] + i].cluster = c;
+        }
+    }
+    for (const auto& e : graph.edges) {
+        if (nodes[e.first].cluster >= 0 && nodes[e.second].cluster >= 0) counts.Connect(nodes[e.first], nodes[e.second]);
+    }
+    return true;
+}
+
+static bool CountClusters(sqlite3* db, const std::string& branch, const TraversalFilter& filter, ClusterCounts& counts,
+                          std::string& error) {
+    if (CountResidentClusters(db, branch, filter, counts, error)) return true;
+    if (!error.empty()) return false;
+    counts = ClusterCounts();
+
+    std::unordered_map<sqlite3_int64, ClusterNode> nodes;
+    sqlite3_stmt* stmt;
+    std::string sql = "SELECT N.rowid, N.projectId FROM Node N WHERE N.branch = ?" + filter.ToSql("N");
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int c = counts.ClusterOf(ColumnText(stmt, 1));
+        counts.clusters[c].nodeCount++;
+        nodes.emplace(sqlite3_column_int64(stmt, 0), ClusterNode{ c });
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db, "SELECT fromKey, toKey FROM Connection", -1, &stmt, NULL) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        auto from = nodes.find(sqlite3_column_int64(stmt, 0));
+        if (from == nodes.end()) continue;
+        auto to = nodes.find(sqlite3_column_int64(stmt, 1));
+        if (to != nodes.end()) counts.Connect(from->second, to->second);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+static bool BuildClusters(sqlite3* db, const std::string& branch, const TraversalFilter& filter, std::string& json,
+                          std::string& error) {
+    ClusterCounts counts;
+    if (!CountClusters(db, branch, filter, counts, error)) return false;
+    std::unordered_map<std::string, int>& clusterIndex = counts.clusterIndex;
+    std::vector<Cluster>& clusters = counts.clusters;
+    std::map<std::pair<int, int>, int>& weights = counts.weights;
+    sqlite3_stmt* stmt;
+
+    std::vector<ProjectInfo> projects;
+    if (sqlite3_prepare_v2(db, "SELECT id, name, type, addr FROM Project", -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto it = clusterIndex.find(ColumnText(stmt, 0));
+            if (it == clusterIndex.end()) continue;
+            clusters[it->second].project = (int)projects.size();
+            projects.emplace_back();
+            ReadProjectRow(stmt, projects.back());
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Stable output: clusters by project name, edges by endpoint position
+    std::vector<int> order;
+    for (int c = 0; c < (int)clusters.size(); ++c) {
+        if (clusters[c].project >= 0) order.push_back(c);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return projects[clusters[a].project].name < projects[clusters[b].project].name;
+    });
+    std::vector<int> rank(clusters.size(), -1);
+    for (size_t i = 0; i < order.size(); ++i) rank[order[i]] = (int)i;
+
+    std::vector<std::pair<std::pair<int, int>, int>> edges;
+    for (const auto& w : weights) {
+        int from = rank[w.first.first], to = rank[w.first.second];
+        if (from >= 0 && to >= 0) edges.push_back({ { from, to }, w.second });
+    }
+    std::sort(edges.begin(), edges.end());
+
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("vertices");
+    jb.beginArray();
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i > 0) jb.comma();
+        const Cluster& c = clusters[order[i]];
+        jb.beginObject();
+            jb.key("data"); WriteProject(jb, projects[c.project], branch); jb.comma();
+            jb.key("nodeCount"); jb.number(c.nodeCount); jb.comma();
+            jb.key("boundaryCount"); jb.number(c.boundaryCount);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.comma();
+    jb.key("edges");
+    jb.beginArray();
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (i > 0) jb.comma();
+        const std::string& fromId = projects[clusters[order[edges[i].first.first]].project].id;
+        const std::string& toId = projects[clusters[order[edges[i].first.second]].project].id;
+        jb.beginObject();
+            jb.key("data");
+            jb.beginObject();
+                jb.key("id"); jb.string(fromId + "-" + toId); jb.comma();
+                jb.key("fromId"); jb.string(fromId); jb.comma();
+                jb.key("toId"); jb.string(toId);
+            jb.endObject();
+            jb.comma();
+            jb.key("weight"); jb.number(edges[i].second);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.endObject();
+    json = jb.str();
+    return true;
+}
+
+void ProjectClusters(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* branch = (const char*)sqlite3_value_text(argv[0]);
+    if (!branch) {
+        sqlite3_result_error(context, "branch is required", -1);
+        return;
+    }
+    std::string rawFilter, error;
+    TraversalFilter filter;
+    if (!ParseClusterFilter(argc, argv, 1, rawFilter, filter, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::string key = ResultCacheKey("project_clusters", { branch, rawFilter });
+    std::string json;
+    ResultCacheTicket ticket;
+    if (!ResultCacheLookup(db, key, json, ticket)) {
+        if (!BuildClusters(db, branch, filter, json, error)) {
+            sqlite3_result_error(context, error.c_str(), -1);
+            return;
+        }
+        ResultCacheStore(db, ticket, key, json, { branch });
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
+
+// --- Project Expansion ---
+
+struct BoundaryNode {
+    GraphNode node;
+    int inDegree = 0;
+    int outDegree = 0;
+};
+
+struct BoundaryEdge {
+    std::string fromId;
+    std::string toId;
+    std::string fromProjectId;
+    std::string toProjectId;
+};
+
+static bool BuildExpansion(sqlite3* db, const ProjectInfo& project, const std::string& branch, const TraversalFilter& filter,
+                           std::string& json, std::string& error) {
+    std::unordered_map<sqlite3_int64, size_t> nodeIndex; // rowid -> nodes
+    std::vector<BoundaryNode> nodes;
+    std::vector<BoundaryEdge> edges;
+
+    // N is a node of the project, T the endpoint in another project
+    std::string filterSql = filter.ToSql("N") + filter.ToSql("T");
+    const char* joins[] = {
+        "JOIN Connection C ON C.fromKey = N.rowid JOIN Node T ON T.rowid = C.toKey ", // outgoing
+        "JOIN Connection C ON C.toKey = N.rowid JOIN Node T ON T.rowid = C.fromKey ", // incoming
+    };
+    for (int pass = 0; pass < 2; ++pass) {
+        bool outgoing = pass == 0;
+        std::string sql =
+            "SELECT N.rowid, N.id, N.name, N.type, N.projectName, N.branch, N.relativePath, N.startLine, N.startColumn, "
+            "T.id, T.projectId FROM Node N " + std::string(joins[pass]) +
+            "WHERE N.projectId = ?1 AND N.branch = ?2 AND T.branch = ?2 AND T.projectId != ?1" + filterSql;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+            error = sqlite3_errmsg(db);
+            return false;
+        }
+        sqlite3_bind_text(stmt, 1, project.id.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            auto inserted = nodeIndex.emplace(sqlite3_column_int64(stmt, 0), nodes.size());
+            if (inserted.second) {
+                nodes.emplace_back();
+                GraphNode& n = nodes.back().node;
+                n.key = sqlite3_column_int64(stmt, 0);
+                n.id = ColumnText(stmt, 1);
+                n.name = ColumnText(stmt, 2);
+                n.type = ColumnText(stmt, 3);
+                n.projectName = ColumnText(stmt, 4);
+                n.projectId = project.id;
+                n.branch = ColumnText(stmt, 5);
+                n.relativePath = ColumnText(stmt, 6);
+                n.startLine = sqlite3_column_int(stmt, 7);
+                n.startColumn = sqlite3_column_int(stmt, 8);
+            }
+            BoundaryNode& b = nodes[inserted.first->second];
+            BoundaryEdge e;
+            if (outgoing) {
+                b.outDegree++;
+                e = { b.node.id, ColumnText(stmt, 9), project.id, ColumnText(stmt, 10) };
+            } else {
+                b.inDegree++;
+                e = { ColumnText(stmt, 9), b.node.id, ColumnText(stmt, 10), project.id };
+            }
+            edges.push_back(std::move(e));
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    std::sort(nodes.begin(), nodes.end(), [](const BoundaryNode& a, const BoundaryNode& b) {
+        return std::tie(a.node.relativePath, a.node.startLine, a.node.startColumn, a.node.name) <
+               std::tie(b.node.relativePath, b.node.startLine, b.node.startColumn, b.node.name);
+    });
+
+    JsonBuilder jb;
+    jb.beginObject();
+    jb.key("project"); WriteProject(jb, project, branch); jb.comma();
+    jb.key("vertices");
+    jb.beginArray();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (i > 0) jb.comma();
+        const GraphNode& n = nodes[i].node;
+        jb.beginObject();
+            jb.key("data");
+            jb.beginObject();
+                jb.key("id"); jb.string(n.id); jb.comma();
+                jb.key("name"); jb.string(n.name); jb.comma();
+                jb.key("type"); jb.string(n.type); jb.comma();
+                jb.key("projectName"); jb.string(n.projectName); jb.comma();
+                jb.key("projectId"); jb.string(n.projectId); jb.comma();
+                jb.key("branch"); jb.string(n.branch); jb.comma();
+                jb.key("relativePath"); jb.string(n.relativePath); jb.comma();
+                jb.key("startLine"); jb.number(n.startLine); jb.comma();
+                jb.key("startColumn"); jb.number(n.startColumn);
+            jb.endObject();
+            jb.comma();
+            jb.key("inDegree"); jb.number(nodes[i].inDegree); jb.comma();
+            jb.key("outDegree"); jb.number(nodes[i].outDegree);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.comma();
+    jb.key("edges");
+    jb.beginArray();
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (i > 0) jb.comma();
+        const BoundaryEdge& e = edges[i];
+        jb.beginObject();
+            jb.key("data");
+            jb.beginObject();
+                jb.key("id"); jb.string(e.fromId + "-" + e.toId); jb.comma();
+                jb.key("fromId"); jb.string(e.fromId); jb.comma();
+                jb.key("toId"); jb.string(e.toId);
+            jb.endObject();
+            jb.comma();
+            jb.key("fromProjectId"); jb.string(e.fromProjectId); jb.comma();
+            jb.key("toProjectId"); jb.string(e.toProjectId);
+        jb.endObject();
+    }
+    jb.endArray();
+    jb.endObject();
+    json = jb.str();
+    return true;
+}
+
+void ExpandProject(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    const char* projectId = (const char*)sqlite3_value_text(argv[0]);
+    const char* branch = (const char*)sqlite3_value_text(argv[1]);
+    if (!projectId || !branch) {
+        sqlite3_result_error(context, "projectId and branch are required", -1);
+        return;
+    }
+    std::string rawFilter, error;
+    TraversalFilter filter;
+    if (!ParseClusterFilter(argc, argv, 2, rawFilter, filter, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    std::string key = ResultCacheKey("expand_project", { projectId, branch, rawFilter });
+    std::string json;
+    ResultCacheTicket ticket;
+    if (!ResultCacheLookup(db, key, json, ticket)) {
+        ProjectInfo project;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT id, name, type, addr FROM Project WHERE id = ?", -1, &stmt, NULL) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, projectId, -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) == SQLITE_ROW) ReadProjectRow(stmt, project);
+            sqlite3_finalize(stmt);
+        }
+        if (project.id.empty()) {
+            sqlite3_result_error(context, "project not found", -1);
+            return;
+        }
+        if (!BuildExpansion(db, project, branch, filter, json, error)) {
+            sqlite3_result_error(context, error.c_str(), -1);
+            return;
+        }
+        ResultCacheStore(db, ticket, key, json, { branch });
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "sqlite3.h"
+
+// Two-level view of a branch for clients that draw projects first and drill
+// into them on demand; neither call materializes the node-level graph.
+//
+// project_clusters(branch [, filterJson]) - every project with nodes on the
+// branch as one super-vertex, and one edge per ordered project pair weighted by
+// the number of node connections between them:
+//   {"vertices":[{"data":{id,name,type,branch,addr},"nodeCount","boundaryCount"}],
+//    "edges":[{"data":{id,fromId,toId},"weight"}]}
+void ProjectClusters(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+// expand_project(projectId, branch [, filterJson]) - the project's boundary
+// nodes (those with a connection to another project on the branch) and those
+// cross-project connections. The far endpoint is only referenced by id and
+// projectId, so it can be attached to its cluster or to its own expansion:
+//   {"project":{id,name,type,branch,addr},
+//    "vertices":[{"data":{node},"inDegree","outDegree"}],
+//    "edges":[{"data":{id,fromId,toId},"fromProjectId","toProjectId"}]}
+void ExpandProject(sqlite3_context* context, int argc, sqlite3_value** argv);
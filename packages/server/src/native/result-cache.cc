@@ -0,0 +1,472 @@
+#include "result-cache.h"
+
+#include <string.h>
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Result Cache ---
+//
+// The change hook delivers committed writes only and may not query, so the
+// listener only queues (table, op, rowid). The queue is settled by the next
+// lookup, which can read the rows back and turn each write into a
+// (branch, project) slot:
+//
+//   Node        the row's slot (before and after, for updates)
+//   Connection  the slots of both endpoints
+//   Project     every slot (the global generation)
+//
+// A write bumps the generation of its slots and of their branches. Cached
+// results are checked against branch generations; the branch store (see
+// branch-overlay.h) checks slot generations to reload only the projects of a
+// branch that changed.
+//
+// Deleted rows can no longer be read, so the cache keeps a rowid -> slot map
+// of both tables. It is built by one scan when the cache is created and
+// maintained from the queue afterwards.
+//
+// Writes reach the queue after their commit, so a connection whose snapshot
+// is current (see SnapshotCurrent) reads them back, and a graph it then
+// computes includes them. One reading an older snapshot, or its own
+// uncommitted rows, neither settles nor uses the cache. A row a later commit
+// deleted again is simply not found; its delete is queued too.
+
+static const size_t DefaultBudgetBytes = 64 * 1024 * 1024;
+static const size_t MaxPendingChanges = 256 * 1024;     // beyond this the whole cache is dropped instead
+static const size_t EntryOverheadBytes = 128;
+
+enum class ChangedTable : uint8_t { Node, Connection, Project };
+
+struct Change {
+    ChangedTable table;
+    int op;
+    sqlite3_int64 rowid;
+};
+
+struct Slot {
+    uint32_t branch = 0; // branch id
+    std::string projectId;
+    uint64_t generation = 0;
+    sqlite3_int64 nodes = 0;
+};
+
+struct CacheEntry {
+    std::string key;
+    std::string value;
+    std::vector<std::pair<uint32_t, uint64_t>> branches; // branch id, generation when stored
+    uint64_t global;
+    size_t bytes;
+    uint64_t contentHash;
+};
+
+struct ResultCache {
+    std::mutex mutex; // guards everything below except pending
+    size_t budget = DefaultBudgetBytes;
+    size_t bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    std::list<CacheEntry> lru; // most recently used first
+    std::unordered_map<std::string, std::list<CacheEntry>::iterator> entries;
+
+    std::unordered_map<std::string, uint32_t> branchIds;
+    std::vector<uint64_t> generations{ 0 }; // by branch id; 0 means "unknown branch"
+    std::vector<std::vector<uint32_t>> branchSlots{ {} }; // by branch id
+    std::unordered_map<std::string, uint32_t> slotIds;    // branch '\x1f' projectId -> index into slots
+    std::vector<Slot> slots{ Slot() };                    // 0 means "unknown row"
+    uint64_t global = 0; // bumped for writes that can't be attributed to a branch
+    uint64_t epoch = 0;  // bumped on every invalidation
+
+    bool mapped = false;
+    std::unordered_map<sqlite3_int64, uint32_t> nodeSlot; // Node rowid -> slot
+    // Connection rowid -> endpoint slots
+    std::unordered_map<sqlite3_int64, std::pair<uint32_t, uint32_t>> connectionSlots;
+
+    std::mutex pendingMutex;
+    std::vector<Change> pending;
+    bool overflow = false;
+};
+
+static ResultCache& GetResultCache(DatabaseState& state) {
+    static std::mutex createMutex;
+    ResultCache* cache = state.resultCache.load(std::memory_order_acquire);
+    if (cache) return *cache;
+
+    std::lock_guard<std::mutex> lock(createMutex);
+    cache = state.resultCache.load();
+    if (!cache) {
+        cache = new ResultCache();
+        state.resultCache.store(cache, std::memory_order_release);
+    }
+    return *cache;
+}
+
+void ResultCacheOnChange(DatabaseState& state, int op, const char* table, sqlite3_int64 rowid) {
+    ChangedTable changed;
+    if (strcmp(table, "Node") == 0) {
+        changed = ChangedTable::Node;
+    } else if (strcmp(table, "Connection") == 0) {
+        changed = ChangedTable::Connection;
+    } else if (strcmp(table, "Project") == 0) {
+        changed = ChangedTable::Project;
+    } else {
+        return;
+    }
+    ResultCache* cache = state.resultCache.load(std::memory_order_acquire);
+    if (!cache) return;
+
+    std::lock_guard<std::mutex> lock(cache->pendingMutex);
+    if (cache->pending.size() >= MaxPendingChanges) {
+        cache->overflow = true;
+        return;
+    }
+    cache->pending.push_back({ changed, op, rowid });
+}
+
+// --- Generations ---
+
+static uint32_t BranchId(ResultCache& cache, const std::string& branch) {
+    auto it = cache.branchIds.find(branch);
+    if (it != cache.branchIds.end()) return it->second;
+    uint32_t id = (uint32_t)cache.generations.size();
+    cache.branchIds.emplace(branch, id);
+    cache.generations.push_back(0);
+    cache.branchSlots.emplace_back();
+    return id;
+}
+
+static uint32_t SlotId(ResultCache& cache, const std::string& branch, const std::string& projectId) {
+    std::string key = branch + '\x1f' + projectId;
+    auto it = cache.slotIds.find(key);
+    if (it != cache.slotIds.end()) return it->second;
+    uint32_t id = (uint32_t)cache.slots.size();
+    uint32_t branchId = BranchId(cache, branch);
+    cache.slotIds.emplace(std::move(key), id);
+    cache.slots.push_back({ branchId, projectId, 0, 0 });
+    cache.branchSlots[branchId].push_back(id);
+    return id;
+}
+
+static void Bump(ResultCache& cache, uint32_t slot) {
+    if (slot == 0) {
+        cache.global++;
+    } else {
+        cache.slots[slot].generation++;
+        cache.generations[cache.slots[slot].branch]++;
+    }
+    cache.epoch++;
+}
+
+static void ClearEntries(ResultCache& cache) {
+    cache.lru.clear();
+    cache.entries.clear();
+    cache.bytes = 0;
+}
+
+static void EvictToBudget(ResultCache& cache) {
+    while (cache.bytes > cache.budget && !cache.lru.empty()) {
+        CacheEntry& last = cache.lru.back();
+        cache.bytes -= last.bytes;
+        cache.entries.erase(last.key);
+        cache.lru.pop_back();
+    }
+}
+
+// --- Row -> Slot Map ---
+//
+// Keyed by rowid rather than indexed by it: Node keys are AUTOINCREMENT and
+// only grow, so a dense map would keep growing with every re-upload while
+// only the live rows matter. Deleted rows are erased.
+
+template <typename T>
+static void SetTracked(std::unordered_map<sqlite3_int64, T>& map, sqlite3_int64 rowid, T value) {
+    if (value == T()) {
+        map.erase(rowid);
+    } else {
+        map[rowid] = value;
+    }
+}
+
+template <typename T>
+static T GetTracked(const std::unordered_map<sqlite3_int64, T>& map, sqlite3_int64 rowid) {
+    auto it = map.find(rowid);
+    return it == map.end() ? T() : it->second;
+}
+
+// Moves a Node row to slot (0 once deleted), keeping the per-slot node counts
+static void TrackNode(ResultCache& cache, sqlite3_int64 rowid, uint32_t before, uint32_t after) {
+    if (before) cache.slots[before].nodes--;
+    if (after) cache.slots[after].nodes++;
+    SetTracked(cache.nodeSlot, rowid, after);
+}
+
+static void BuildRowMap(ResultCache& cache, sqlite3* db) {
+    cache.nodeSlot.clear();
+    cache.connectionSlots.clear();
+    for (Slot& slot : cache.slots) slot.nodes = 0;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT rowid, branch, projectId FROM Node", -1, &stmt, NULL) == SQLITE_OK) {
+        std::string branch, projectId;
+        uint32_t id = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* rawBranch = (const char*)sqlite3_column_text(stmt, 1);
+            const char* rawProject = (const char*)sqlite3_column_text(stmt, 2);
+            if (!rawBranch || !rawProject) continue;
+            if (branch != rawBranch || projectId != rawProject) { // rows of one upload tend to be contiguous
+                branch = rawBranch;
+                projectId = rawProject;
+                id = SlotId(cache, branch, projectId);
+            }
+            TrackNode(cache, sqlite3_column_int64(stmt, 0), 0, id);
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (sqlite3_prepare_v2(db, "SELECT rowid, fromKey, toKey FROM Connection", -1, &stmt, NULL) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            std::pair<uint32_t, uint32_t> slots(GetTracked(cache.nodeSlot, sqlite3_column_int64(stmt, 1)),
+                                                GetTracked(cache.nodeSlot, sqlite3_column_int64(stmt, 2)));
+            SetTracked(cache.connectionSlots, sqlite3_column_int64(stmt, 0), slots);
+        }
+        sqlite3_finalize(stmt);
+    }
+    cache.mapped = true;
+}
+
+struct SettleStatements {
+    sqlite3_stmt* node = nullptr;
+    sqlite3_stmt* connection = nullptr;
+
+    ~SettleStatements() {
+        sqlite3_finalize(node);
+        sqlite3_finalize(connection);
+    }
+};
+
+// Current slot of a Node row; 0 if the row isn't visible
+static uint32_t ReadNodeSlot(ResultCache& cache, sqlite3_stmt* stmt, sqlite3_int64 rowid) {
+    if (!stmt) return 0;
+    uint32_t id = 0;
+    sqlite3_bind_int64(stmt, 1, rowid);
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0) && sqlite3_column_text(stmt, 1)) {
+        id = SlotId(cache, (const char*)sqlite3_column_text(stmt, 0), (const char*)sqlite3_column_text(stmt, 1));
+    }
+    sqlite3_reset(stmt);
+    return id;
+}
+
+static uint32_t NodeSlot(ResultCache& cache, SettleStatements& stmts, sqlite3_int64 key) {
+    uint32_t id = GetTracked(cache.nodeSlot, key);
+    return id ? id : ReadNodeSlot(cache, stmts.node, key);
+}
+
+static void ApplyChange(ResultCache& cache, SettleStatements& stmts, const Change& change) {
+    switch (change.table) {
+        case ChangedTable::Project:
+            Bump(cache, 0);
+            return;
+
+        case ChangedTable::Node: {
+            uint32_t before = GetTracked(cache.nodeSlot, change.rowid);
+            uint32_t after = change.op == SQLITE_DELETE ? 0 : ReadNodeSlot(cache, stmts.node, change.rowid);
+            if (before) Bump(cache, before);
+            if (after && after != before) Bump(cache, after);
+            if (!before && !after) Bump(cache, 0);
+            TrackNode(cache, change.rowid, before, after);
+            return;
+        }
+
+        case ChangedTable::Connection: {
+            std::pair<uint32_t, uint32_t> before = GetTracked(cache.connectionSlots, change.rowid);
+            std::pair<uint32_t, uint32_t> after(0, 0);
+            if (change.op != SQLITE_DELETE && stmts.connection) {
+                sqlite3_bind_int64(stmts.connection, 1, change.rowid);
+                if (sqlite3_step(stmts.connection) == SQLITE_ROW) {
+                    after.first = NodeSlot(cache, stmts, sqlite3_column_int64(stmts.connection, 0));
+                    after.second = NodeSlot(cache, stmts, sqlite3_column_int64(stmts.connection, 1));
+                }
+                sqlite3_reset(stmts.connection);
+            }
+            uint32_t touched[4] = { before.first, before.second, after.first, after.second };
+            std::sort(touched, touched + 4);
+            uint32_t* end = std::unique(touched, touched + 4);
+            bool attributed = false;
+            for (uint32_t* id = touched; id != end; ++id) {
+                if (*id == 0) continue;
+                Bump(cache, *id);
+                attributed = true;
+            }
+            if (!attributed) Bump(cache, 0);
+            SetTracked(cache.connectionSlots, change.rowid, after);
+            return;
+        }
+    }
+}
+
+// Folds the queued writes into the generations. Called with cache.mutex held.
+// False, leaving the queue alone, if db reads a snapshot older than the
+// commits queued.
+static bool Settle(ResultCache& cache, sqlite3* db) {
+    std::vector<Change> changes;
+    bool overflow;
+    {
+        std::lock_guard<std::mutex> lock(cache.pendingMutex);
+        // Checked under the lock, so every change queued so far is a commit it compares against
+        if (!SnapshotCurrent(db)) return false;
+        changes.swap(cache.pending);
+        overflow = cache.overflow;
+        cache.overflow = false;
+    }
+
+    if (overflow) {
+        // Too many writes to attribute one by one (a bulk load): start over
+        ClearEntries(cache);
+        Bump(cache, 0);
+        cache.mapped = false;
+    }
+    if (!cache.mapped) {
+        BuildRowMap(cache, db);
+        return true; // the scan already reflects everything queued so far
+    }
+
+    if (changes.empty()) return true;
+
+    SettleStatements stmts;
+    sqlite3_prepare_v2(db, "SELECT branch, projectId FROM Node WHERE rowid = ?", -1, &stmts.node, NULL);
+    sqlite3_prepare_v2(db, "SELECT fromKey, toKey FROM Connection WHERE rowid = ?", -1, &stmts.connection, NULL);
+    for (const Change& change : changes) ApplyChange(cache, stmts, change);
+    return true;
+}
+
+// --- Lookup / Store ---
+
+static bool IsCurrent(const ResultCache& cache, const CacheEntry& entry) {
+    if (entry.global != cache.global) return false;
+    for (const auto& branch : entry.branches) {
+        if (cache.generations[branch.first] != branch.second) return false;
+    }
+    return true;
+}
+
+bool ResultCacheLookup(sqlite3* db, const std::string& key, std::string& out, ResultCacheTicket& ticket,
+                       uint64_t* contentHash) {
+    ResultCache& cache = GetResultCache(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    ticket.enabled = false;
+    if (cache.budget == 0 || !Settle(cache, db)) return false;
+
+    auto it = cache.entries.find(key);
+    if (it != cache.entries.end()) {
+        if (IsCurrent(cache, *it->second)) {
+            cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+            cache.hits++;
+            out = it->second->value;
+            if (contentHash) *contentHash = it->second->contentHash;
+            return true;
+        }
+        cache.bytes -= it->second->bytes;
+        cache.lru.erase(it->second);
+        cache.entries.erase(it);
+    }
+    cache.misses++;
+    ticket.epoch = cache.epoch;
+    ticket.enabled = true;
+    return false;
+}
+
+void ResultCacheStore(sqlite3* db, const ResultCacheTicket& ticket, const std::string& key, const std::string& value,
+                      const std::vector<std::string>& branches, uint64_t contentHash) {
+    if (!ticket.enabled) return;
+    ResultCache& cache = GetResultCache(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    // Writes that landed while the result was computed may not be in it
+    if (!Settle(cache, db) || cache.epoch != ticket.epoch) return;
+
+    size_t bytes = key.size() + value.size() + EntryOverheadBytes + branches.size() * 16;
+    if (bytes > cache.budget / 4) return; // one graph shouldn't flush everything else
+
+    CacheEntry entry{ key, value, {}, cache.global, bytes, contentHash };
+    for (const std::string& branch : branches) {
+        uint32_t id = BranchId(cache, branch);
+        entry.branches.emplace_back(id, cache.generations[id]);
+    }
+
+    auto existing = cache.entries.find(key);
+    if (existing != cache.entries.end()) {
+        cache.bytes -= existing->second->bytes;
+        cache.lru.erase(existing->second);
+        cache.entries.erase(existing);
+    }
+    cache.lru.push_front(std::move(entry));
+    cache.entries.emplace(key, cache.lru.begin());
+    cache.bytes += bytes;
+    EvictToBudget(cache);
+}
+
+bool ResultCacheEpoch(sqlite3* db, uint64_t& epoch) {
+    ResultCache& cache = GetResultCache(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.budget == 0 || !Settle(cache, db)) return false;
+
+    epoch = cache.epoch;
+    return true;
+}
+
+bool ResultCacheBranchProjects(sqlite3* db, const std::string& branch, std::vector<ProjectGeneration>& projects,
+                               uint64_t& global) {
+    ResultCache& cache = GetResultCache(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    projects.clear();
+    if (cache.budget == 0 || !Settle(cache, db)) return false;
+
+    global = cache.global;
+    auto it = cache.branchIds.find(branch);
+    if (it == cache.branchIds.end()) return true;
+    for (uint32_t id : cache.branchSlots[it->second]) {
+        const Slot& slot = cache.slots[id];
+        if (slot.nodes > 0) projects.push_back({ slot.projectId, slot.generation });
+    }
+    return true;
+}
+
+bool ResultCacheBranchGeneration(sqlite3* db, const std::string& branch, uint64_t& generation) {
+    ResultCache& cache = GetResultCache(GetDatabaseState(db));
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.budget == 0 || !Settle(cache, db)) return false;
+
+    // Both counters only grow, so the sum changes whenever either does
+    generation = cache.global + cache.generations[BranchId(cache, branch)];
+    return true;
+}
+
+std::string ResultCacheKey(const char* function, std::initializer_list<std::string> args) {
+    std::string key = function;
+    for (const std::string& arg : args) {
+        key += '\x1f';
+        key += arg;
+    }
+    return key;
+}
+
+void ResultCacheStats(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    ResultCache& cache = GetResultCache(GetDatabaseState(sqlite3_context_db_handle(context)));
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    if (argc > 0 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
+        sqlite3_int64 budget = sqlite3_value_int64(argv[0]);
+        cache.budget = budget > 0 ? (size_t)budget : 0;
+        EvictToBudget(cache);
+    }
+
+    std::string json = "{\"entries\":" + std::to_string(cache.entries.size()) +
+                       ",\"bytes\":" + std::to_string(cache.bytes) +
+                       ",\"budget\":" + std::to_string(cache.budget) +
+                       ",\"hits\":" + std::to_string(cache.hits) +
+                       ",\"misses\":" + std::to_string(cache.misses) + "}";
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "db-state.h"
+#include "sqlite3.h"
+
+// Bounded LRU cache for the JSON produced by the graph functions, kept per
+// database file and shared by every connection. Entries remember the
+// generation of each branch their result was built from; the change hook bumps
+// the generations of the branches a write touches, so a write to one branch
+// leaves the cached graphs of every other branch alone.
+
+struct ResultCacheTicket {
+    uint64_t epoch = 0;
+    bool enabled = false;
+};
+
+// Looks key up. On a miss the returned ticket must be handed to
+// ResultCacheStore; it makes the store a no-op if something changed while the
+// result was being computed. contentHash, if given, receives what was stored
+// with the value. Always a miss, and the store a no-op, while db reads an
+// older snapshot than the cache knows of (see SnapshotCurrent).
+bool ResultCacheLookup(sqlite3* db, const std::string& key, std::string& out, ResultCacheTicket& ticket,
+                       uint64_t* contentHash = nullptr);
+
+// Caches value as depending on the listed branches, together with the content
+// hash of the result (see content-hash.h) for callers that have one.
+void ResultCacheStore(sqlite3* db, const ResultCacheTicket& ticket, const std::string& key, const std::string& value,
+                      const std::vector<std::string>& branches, uint64_t contentHash = 0);
+
+// Current invalidation epoch, for state derived from the whole database rather
+// than cached per call (the planner's resident adjacency). Any committed
+// write to Node/Connection/Project changes it. False while the cache is
+// disabled or db reads an older snapshot (see SnapshotCurrent); nothing
+// derived should be used or kept then.
+bool ResultCacheEpoch(sqlite3* db, uint64_t& epoch);
+
+struct ProjectGeneration {
+    std::string projectId;
+    uint64_t generation; // changes with every write to the project's rows on the branch or their connections
+};
+
+// Projects with nodes on branch and their generations, plus the generation of
+// writes that couldn't be attributed to a project (which invalidate all).
+// False while the cache is disabled or db reads an older snapshot.
+bool ResultCacheBranchProjects(sqlite3* db, const std::string& branch, std::vector<ProjectGeneration>& projects,
+                               uint64_t& global);
+
+// A counter that changes with every write the project graph of branch
+// depends on (its rows, their connections, any Project row). False while the
+// cache is disabled or db reads an older snapshot.
+bool ResultCacheBranchGeneration(sqlite3* db, const std::string& branch, uint64_t& generation);
+
+// "function\x1farg\x1farg..."
+std::string ResultCacheKey(const char* function, std::initializer_list<std::string> args);
+
+// result_cache_stats([budgetBytes]) - {"entries","bytes","budget","hits","misses"};
+// a budget argument resizes the cache first (0 disables it).
+void ResultCacheStats(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+// ChangeListener recording committed Node/Connection/Project writes for the next lookup
+void ResultCacheOnChange(DatabaseState& state, int op, const char* table, sqlite3_int64 rowid);
@@ -14,7 +14,26 @@
 #include <map>
 #include <stack>
 #include <string_view>
+#include <iterator>
 #include "sqlite3ext.h"
+#include "graph.h"
+#include "db-state.h"
+#include "fuzzy-index.h"
+#include "node-ingest.h"
+#include "branch-commit.h"
+#include "impact-sketch.h"
+#include "change-impact.h"
+#include "project-clusters.h"
+#include "centrality.h"
+#include "result-cache.h"
+#include "traversal-planner.h"
+#include "branch-overlay.h"
+#include "content-hash.h"
+#include "connection-matcher.h"
+#include "path-match.h"
+#include "graph-delta.h"
+#include "orphan-nodes.h"
+#include "graph-query.h"
 #include <stdarg.h>
 
 
@@ -79,710 +98,348 @@ SQLITE_EXTENSION_INIT1
 //     return NULL;
 // }
 
-// --- Graph Algorithms & Structures ---
-
-struct GraphNode {
-    std::string id;
-    std::string name;
-    std::string type;
-    std::string projectName;
-    std::string projectId; // Added for project graph
-    std::string branch;
-    std::string relativePath;
-    int startLine = 0;
-    int startColumn = 0;
-    std::string addr; // for project
-};
+// Get Node Dependency Graph
+static void GetNodeDependencyGraph(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    if (argc < 1) {
+        sqlite3_result_error(context, "Requires nodeId", -1);
+        return;
+    }
+    
+    const char* nodeIdRaw = (const char*)sqlite3_value_text(argv[0]);
+    if (!nodeIdRaw) {
+        sqlite3_result_null(context);
+        return;
+    }
+    
+    NodeGraphQuery query;
+    query.nodeId = nodeIdRaw;
+    if (argc >= 2) {
+        query.depth = sqlite3_value_int(argv[1]);
+    }
+    if (argc >= 3 && sqlite3_value_text(argv[2])) query.filter = (const char*)sqlite3_value_text(argv[2]);
+    query.layout = argc >= 4 && sqlite3_value_int(argv[3]) != 0;
+    if (argc >= 5 && sqlite3_value_type(argv[4]) != SQLITE_NULL) {
+        sqlite3_int64 budget = sqlite3_value_int64(argv[4]);
+        query.memoryBudget = budget > 0 ? (size_t)budget : 0;
+    }
 
-struct GraphConnection {
-    std::string id;
-    std::string fromId;
-    std::string toId;
-};
+    std::string json, error;
+    if (!QueryNodeGraph(sqlite3_context_db_handle(context), query, json, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
 
-// Orthogonal Graph Structures (Indices)
-struct OGVertex {
-    GraphNode data;
-    int firstIn = -1;
-    int firstOut = -1;
-    int inDegree = 0;
-    int outDegree = 0;
-};
 
-struct OGEdge {
-    GraphConnection data;
-    int tailvertex = -1;
-    int headvertex = -1;
-    int headnext = -1;
-    int tailnext = -1;
-};
+// get_node_dependency_graph_levels(nodeId, depth?, filter?): the NDJSON lines
+// of StreamNodeGraphLevels as one value, for callers that can't consume them
+// as they are produced
+static void GetNodeDependencyGraphLevels(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    const char* nodeIdRaw = (const char*)sqlite3_value_text(argv[0]);
+    if (!nodeIdRaw) {
+        sqlite3_result_null(context);
+        return;
+    }
 
-struct OrthogonalGraph {
-    std::vector<OGVertex> vertices;
-    std::vector<OGEdge> edges;
-};
+    NodeGraphQuery query;
+    query.nodeId = nodeIdRaw;
+    if (argc >= 2) query.depth = sqlite3_value_int(argv[1]);
+    if (argc >= 3 && sqlite3_value_text(argv[2])) query.filter = (const char*)sqlite3_value_text(argv[2]);
+
+    std::string ndjson, error;
+    GraphLevelSink sink = [&ndjson](std::string&& line) {
+        ndjson += line;
+        return true;
+    };
+    if (!StreamNodeGraphLevels(sqlite3_context_db_handle(context), query, sink, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
+    }
+    sqlite3_result_text(context, ndjson.c_str(), (int)ndjson.size(), SQLITE_TRANSIENT);
+}
 
-// --- JSON Builder ---
 
-class JsonBuilder {
-    std::string json;
-public:
-    JsonBuilder() { json.reserve(4 * 1024 * 1024); } // 4MB
-    
-    void beginObject() { json += "{"; }
-    void endObject() { json += "}"; }
-    void beginArray() { json += "["; }
-    void endArray() { json += "]"; }
-    void key(std::string_view k) { 
-        json += "\""; json += k; json += "\":"; 
+// Get Project Dependency Graph
+static void GetProjectDependencyGraph(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    if (argc < 2) {
+        sqlite3_result_error(context, "Requires projectId, branch", -1);
+        return;
     }
-    void string(std::string_view s) {
-        json += "\"";
-        size_t lastPos = 0;
-        size_t pos = s.find_first_of("\"\\/\b\f\n\r\t", lastPos);
-        
-        if (pos == std::string_view::npos) {
-            json += s;
-        } else {
-            while (pos != std::string_view::npos) {
-                json.append(s.data() + lastPos, pos - lastPos);
-                switch(s[pos]) {
-                    case '"': json += "\\\""; break;
-                    case '\\': json += "\\\\"; break;
-                    case '\b': json += "\\b"; break;
-                    case '\f': json += "\\f"; break;
-                    case '\n': json += "\\n"; break;
-                    case '\r': json += "\\r"; break;
-                    case '\t': json += "\\t"; break;
-                    default: json += s[pos]; break; 
-                }
-                lastPos = pos + 1;
-                pos = s.find_first_of("\"\\/\b\f\n\r\t", lastPos);
-            }
-            json.append(s.data() + lastPos, s.length() - lastPos);
-        }
-        json += "\"";
+
+    ProjectGraphQuery query;
+    query.projectId = (const char*)sqlite3_value_text(argv[0]);
+    query.branch = (const char*)sqlite3_value_text(argv[1]);
+    if (argc >= 3) query.depth = sqlite3_value_int(argv[2]);
+    if (argc >= 4 && sqlite3_value_text(argv[3])) query.filter = (const char*)sqlite3_value_text(argv[3]);
+    query.layout = argc >= 5 && sqlite3_value_int(argv[4]) != 0;
+
+    std::string json, error;
+    if (!QueryProjectGraph(sqlite3_context_db_handle(context), query, json, error)) {
+        sqlite3_result_error(context, error.c_str(), -1);
+        return;
     }
-    void number(int n) { json += std::to_string(n); }
-    void comma() { json += ","; }
-    
-    std::string str() { return json; }
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
+
+
+// --- Streaming Graph Virtual Tables ---
+//
+//   SELECT * FROM graph_vertices('<nodeId>', 5, 'both') LIMIT 500 OFFSET 1000;
+//   SELECT * FROM graph_edges('<nodeId>') WHERE level <= 2;
+//   SELECT * FROM graph_vertices('<nodeId>', 5, 'out', '{"nodeTypes":["NamedImport","NamedExport"]}');
+//
+// Both tables are eponymous and table-valued: the hidden columns root, depth,
+// direction and filter are the arguments. Rows are produced while the BFS advances, one
+// level at a time, so only the current level is buffered.
+
+enum class GraphTableKind { Vertices, Edges };
+
+// Positions of the hidden argument columns, shared by both tables
+enum { GRAPH_ARG_ROOT = 0, GRAPH_ARG_DEPTH = 1, GRAPH_ARG_DIRECTION = 2, GRAPH_ARG_FILTER = 3, GRAPH_ARG_COUNT = 4 };
+
+enum {
+    GV_COL_ID, GV_COL_NAME, GV_COL_TYPE, GV_COL_PROJECT_NAME, GV_COL_BRANCH,
+    GV_COL_RELATIVE_PATH, GV_COL_START_LINE, GV_COL_START_COLUMN, GV_COL_LEVEL,
+    GV_COL_ROOT
 };
 
-// --- Logic ---
+enum { GE_COL_FROM_ID, GE_COL_TO_ID, GE_COL_LEVEL, GE_COL_ROOT };
 
-OrthogonalGraph BuildOrthogonalGraph(const std::vector<GraphNode>& nodes, const std::vector<GraphConnection>& connections) {
-    OrthogonalGraph graph;
-    graph.vertices.reserve(nodes.size());
-    graph.edges.reserve(connections.size());
-    
-    std::unordered_map<std::string, int> nodeIndexMap;
-    
-    // 1. Create Vertices
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        nodeIndexMap[nodes[i].id] = (int)i;
-        OGVertex v;
-        v.data = nodes[i];
-        graph.vertices.push_back(std::move(v));
-    }
-    
-    // 2. Create Edges
-    for (const auto& conn : connections) {
-        auto itFrom = nodeIndexMap.find(conn.fromId);
-        auto itTo = nodeIndexMap.find(conn.toId);
-        
-        if (itFrom == nodeIndexMap.end() || itTo == nodeIndexMap.end()) continue;
-        
-        int fromIndex = itFrom->second;
-        int toIndex = itTo->second;
-        
-        int edgeIndex = (int)graph.edges.size();
-        
-        // Update Target (Incoming)
-        int currentFirstIn = graph.vertices[toIndex].firstIn;
-        graph.vertices[toIndex].firstIn = edgeIndex;
-        graph.vertices[toIndex].inDegree++;
-        
-        // Update Source (Outgoing)
-        int currentFirstOut = graph.vertices[fromIndex].firstOut;
-        graph.vertices[fromIndex].firstOut = edgeIndex;
-        graph.vertices[fromIndex].outDegree++;
-        
-        OGEdge edge;
-        edge.data = conn;
-        edge.tailvertex = fromIndex;
-        edge.headvertex = toIndex;
-        edge.headnext = currentFirstIn;
-        edge.tailnext = currentFirstOut;
-        
-        graph.edges.push_back(std::move(edge));
-    }
-    
-    return graph;
+struct GraphVtab {
+    sqlite3_vtab base;
+    sqlite3* db;
+    GraphTableKind kind;
+};
+
+struct GraphVtabCursor {
+    sqlite3_vtab_cursor base;
+    NodeTraversal* traversal = nullptr;
+    std::vector<GraphNode> nodes;
+    std::vector<GraphConnection> connections;
+    size_t pos = 0;
+    int level = 0;
+    sqlite3_int64 rowid = 0;
+    bool eof = true;
+};
+
+static int GraphVtabConnect(sqlite3* db, void* pAux, int argc, const char* const* argv,
+                            sqlite3_vtab** ppVtab, char** pzErr) {
+    GraphTableKind kind = *(GraphTableKind*)pAux;
+    const char* schema = kind == GraphTableKind::Vertices
+        ? "CREATE TABLE x(id TEXT, name TEXT, type TEXT, projectName TEXT, branch TEXT, "
+          "relativePath TEXT, startLine INTEGER, startColumn INTEGER, level INTEGER, "
+          "root HIDDEN, depth HIDDEN, direction HIDDEN, filter HIDDEN)"
+        : "CREATE TABLE x(fromId TEXT, toId TEXT, level INTEGER, "
+          "root HIDDEN, depth HIDDEN, direction HIDDEN, filter HIDDEN)";
+
+    int rc = sqlite3_declare_vtab(db, schema);
+    if (rc != SQLITE_OK) return rc;
+
+    GraphVtab* vtab = new GraphVtab();
+    vtab->db = db;
+    vtab->kind = kind;
+    *ppVtab = &vtab->base;
+    return SQLITE_OK;
 }
 
-// Simple DFS-based cycle detection that finds all elementary cycles
-// Much faster than Johnson's algorithm - explores from each vertex independently
+static int GraphVtabDisconnect(sqlite3_vtab* pVtab) {
+    delete (GraphVtab*)pVtab;
+    return SQLITE_OK;
+}
 
-void find_cycles_from_vertex(int start, const OrthogonalGraph& graph, std::vector<std::vector<GraphNode>>& cycles) {
-    std::vector<bool> visited(graph.vertices.size(), false);
-    std::vector<bool> on_stack(graph.vertices.size(), false);
-    std::vector<int> path;
-    
-    struct StackFrame {
-        int node;
-        int edge_idx;
-        bool first_visit;
-    };
-    
-    std::vector<StackFrame> stack;
-    stack.push_back({start, graph.vertices[start].firstOut, true});
-    
-    while (!stack.empty()) {
-        StackFrame& frame = stack.back();
-        
-        if (frame.first_visit) {
-            // First visit to this node
-            visited[frame.node] = true;
-            on_stack[frame.node] = true;
-            path.push_back(frame.node);
-            frame.first_visit = false;
-        }
-        
-        if (frame.edge_idx == -1) {
-            // No more edges, backtrack
-            on_stack[frame.node] = false;
-            path.pop_back();
-            stack.pop_back();
+static int GraphVtabBestIndex(sqlite3_vtab* pVtab, sqlite3_index_info* info) {
+    GraphVtab* vtab = (GraphVtab*)pVtab;
+    int firstHidden = vtab->kind == GraphTableKind::Vertices ? (int)GV_COL_ROOT : (int)GE_COL_ROOT;
+
+    // idxNum is a bitmask of the arguments supplied, in GRAPH_ARG_* order
+    int argConstraint[GRAPH_ARG_COUNT] = { -1, -1, -1, -1 };
+    for (int i = 0; i < info->nConstraint; ++i) {
+        const auto& c = info->aConstraint[i];
+        int arg = c.iColumn - firstHidden;
+        if (arg < 0 || arg >= GRAPH_ARG_COUNT) continue;
+        if (c.op != SQLITE_INDEX_CONSTRAINT_EQ) continue;
+        if (!c.usable) {
+            if (arg == GRAPH_ARG_ROOT) return SQLITE_CONSTRAINT;
             continue;
         }
-        
-        const OGEdge& edge = graph.edges[frame.edge_idx];
-        int next = edge.headvertex;
-        frame.edge_idx = edge.tailnext; // Advance for next iteration
-        
-        if (next == start && path.size() > 1) {
-            // Found cycle back to start
-            std::vector<GraphNode> cycle;
-            for (int idx : path) {
-                cycle.push_back(graph.vertices[idx].data);
-            }
-            cycle.push_back(graph.vertices[start].data);
-            cycles.push_back(cycle);
-        } else if (!visited[next]) {
-            // Explore this path
-            stack.push_back({next, graph.vertices[next].firstOut, true});
-        }
+        argConstraint[arg] = i;
     }
-}
 
-std::vector<std::vector<GraphNode>> DetectCycles(const OrthogonalGraph& graph) {
-    std::vector<std::vector<GraphNode>> cycles;
-    
-    // Find cycles by starting DFS from each vertex
-    // Each vertex can be the "root" of cycles that return to it
-    for (size_t i = 0; i < graph.vertices.size(); ++i) {
-        find_cycles_from_vertex(i, graph, cycles);
+    if (argConstraint[GRAPH_ARG_ROOT] < 0) {
+        // A traversal needs a root; make any plan without one prohibitively expensive
+        info->estimatedCost = 1e99;
+        info->idxNum = 0;
+        return SQLITE_OK;
     }
-    
-    return cycles;
-}
 
-std::string SerializeGraph(const OrthogonalGraph& graph, const std::vector<std::vector<GraphNode>>& cycles) {
-    JsonBuilder jb;
-    jb.beginObject();
-    
-    // Vertices
-    jb.key("vertices");
-    jb.beginArray();
-    for (size_t i = 0; i < graph.vertices.size(); ++i) {
-        if (i > 0) jb.comma();
-        const auto& v = graph.vertices[i];
-        jb.beginObject();
-            jb.key("data");
-            jb.beginObject();
-                jb.key("id"); jb.string(v.data.id); jb.comma();
-                jb.key("name"); jb.string(v.data.name); jb.comma();
-                jb.key("type"); jb.string(v.data.type); jb.comma();
-                
-                if (!v.data.projectName.empty()) {
-                   jb.key("projectName"); jb.string(v.data.projectName); jb.comma();
-                }
-                if (!v.data.projectId.empty()) {
-                   jb.key("projectId"); jb.string(v.data.projectId); jb.comma();
-                }
-                
-                jb.key("branch"); jb.string(v.data.branch); jb.comma();
-                
-                if (!v.data.relativePath.empty()) {
-                    jb.key("relativePath"); jb.string(v.data.relativePath); jb.comma();
-                    jb.key("startLine"); jb.number(v.data.startLine); jb.comma();
-                    jb.key("startColumn"); jb.number(v.data.startColumn);
-                } else if (!v.data.addr.empty()) {
-                    jb.key("addr"); jb.string(v.data.addr);
-                } else {
-                    jb.key("_"); jb.number(0); // Dummy
-                }
-            jb.endObject();
-            jb.comma();
-            
-            jb.key("firstIn"); jb.number(v.firstIn); jb.comma();
-            jb.key("firstOut"); jb.number(v.firstOut); jb.comma();
-            jb.key("inDegree"); jb.number(v.inDegree); jb.comma();
-            jb.key("outDegree"); jb.number(v.outDegree);
-        jb.endObject();
-    }
-    jb.endArray();
-    jb.comma();
-    
-    // Edges
-    jb.key("edges");
-    jb.beginArray();
-    for (size_t i = 0; i < graph.edges.size(); ++i) {
-        if (i > 0) jb.comma();
-        const auto& e = graph.edges[i];
-        jb.beginObject();
-            jb.key("data");
-            jb.beginObject();
-                jb.key("id"); jb.string(e.data.id); jb.comma();
-                jb.key("fromId"); jb.string(e.data.fromId); jb.comma();
-                jb.key("toId"); jb.string(e.data.toId);
-            jb.endObject();
-            jb.comma();
-            
-            jb.key("tailvertex"); jb.number(e.tailvertex); jb.comma();
-            jb.key("headvertex"); jb.number(e.headvertex); jb.comma();
-            jb.key("headnext"); jb.number(e.headnext); jb.comma();
-            jb.key("tailnext"); jb.number(e.tailnext);
-        jb.endObject();
+    int argvIndex = 1;
+    int idxNum = 0;
+    for (int arg = 0; arg < GRAPH_ARG_COUNT; ++arg) {
+        if (argConstraint[arg] < 0) continue;
+        info->aConstraintUsage[argConstraint[arg]].argvIndex = argvIndex++;
+        info->aConstraintUsage[argConstraint[arg]].omit = 1;
+        idxNum |= 1 << arg;
     }
-    jb.endArray();
-
-    // Cycles
-    if (!cycles.empty()) {
-        jb.comma();
-        jb.key("cycles");
-        jb.beginArray();
-        for (size_t i = 0; i < cycles.size(); ++i) {
-            if (i > 0) jb.comma();
-            jb.beginArray();
-            for (size_t j = 0; j < cycles[i].size(); ++j) {
-                if (j > 0) jb.comma();
-                jb.beginObject();
-                    jb.key("id"); jb.string(cycles[i][j].id); jb.comma();
-                    jb.key("name"); jb.string(cycles[i][j].name); jb.comma();
-                    jb.key("type"); jb.string(cycles[i][j].type);
-                jb.endObject();
-            }
-            jb.endArray();
-        }
-        jb.endArray();
-    }
-
-    jb.endObject();
-    return jb.str();
+    info->idxNum = idxNum;
+    info->estimatedCost = 1000;
+    return SQLITE_OK;
 }
 
+static int GraphVtabOpen(sqlite3_vtab* pVtab, sqlite3_vtab_cursor** ppCursor) {
+    GraphVtabCursor* cur = new GraphVtabCursor();
+    *ppCursor = &cur->base;
+    return SQLITE_OK;
+}
 
-struct Node {
-    std::string id;
-    std::string type;
-    std::string name;
-    std::string projectName;
-    std::string branch;
-    std::string meta; // format: {"entryName":"..."}
-};
+static int GraphVtabClose(sqlite3_vtab_cursor* pCursor) {
+    GraphVtabCursor* cur = (GraphVtabCursor*)pCursor;
+    delete cur->traversal;
+    delete cur;
+    return SQLITE_OK;
+}
 
-// Helper: Simple JSON string extraction for "entryName"
-// Extremely naive, assumes standard formatting but fast.
-std::string_view getEntryName(std::string_view meta) {
-    std::string_view key = "\"entryName\"";
-    size_t pos = meta.find(key);
-    if (pos == std::string_view::npos) return "";
-    
-    pos += key.length();
-    // skip until first quote
-    pos = meta.find('"', pos);
-    if (pos == std::string_view::npos) return "";
-    pos++; // start of value
-    
-    size_t end = meta.find('"', pos);
-    if (end == std::string_view::npos) return "";
-    
-    return meta.substr(pos, end - pos);
+static size_t GraphVtabBufferSize(GraphVtabCursor* cur, GraphTableKind kind) {
+    return kind == GraphTableKind::Vertices ? cur->nodes.size() : cur->connections.size();
 }
 
-// helper to quote string for SQL
-std::string sql_quote(const std::string& s) {
-    std::string res;
-    res.reserve(s.size() + 10);  // Pre-allocate: string + quotes + potential escapes
-    res += '\'';
-    for (char c : s) {
-        res += c;
-        if (c == '\'') res += '\'';  // Escape single quote by doubling it
+// Advances the traversal until the buffer for this table kind has rows, or the
+// traversal is exhausted.
+static void GraphVtabFill(GraphVtabCursor* cur, GraphTableKind kind) {
+    cur->pos = 0;
+    while (cur->traversal->Next(cur->nodes, cur->connections)) {
+        cur->level = cur->traversal->Depth();
+        if (kind == GraphTableKind::Edges) cur->traversal->ResolveIds(cur->connections);
+        if (GraphVtabBufferSize(cur, kind) > 0) {
+            cur->eof = false;
+            return;
+        }
     }
-    res += '\'';
-    return res;
+    cur->nodes.clear();
+    cur->connections.clear();
+    cur->eof = true;
 }
 
+static int GraphVtabFilter(sqlite3_vtab_cursor* pCursor, int idxNum, const char* idxStr,
+                           int argc, sqlite3_value** argv) {
+    GraphVtabCursor* cur = (GraphVtabCursor*)pCursor;
+    GraphVtab* vtab = (GraphVtab*)pCursor->pVtab;
 
-// Get Node Dependency Graph
-static void GetNodeDependencyGraph(sqlite3_context *context, int argc, sqlite3_value **argv) {
-    if (argc < 1) {
-        sqlite3_result_error(context, "Requires nodeId", -1);
-        return;
-    }
-    
-    const char* nodeIdRaw = (const char*)sqlite3_value_text(argv[0]);
-    if (!nodeIdRaw) {
-        sqlite3_result_null(context);
-        return;
-    }
-    std::string startNodeId(nodeIdRaw);
-    
+    delete cur->traversal;
+    cur->traversal = nullptr;
+    cur->rowid = 0;
+    cur->eof = true;
+
+    const char* root = nullptr;
     int maxDepth = 100;
-    if (argc >= 2) {
-        maxDepth = sqlite3_value_int(argv[1]);
-    }
+    TraversalDirection direction = TraversalDirection::Both;
 
-    sqlite3 *db = sqlite3_context_db_handle(context);
-    
-    std::unordered_set<std::string> visitedNodeIds;
-    std::unordered_map<std::string, GraphNode> nodesMap;
-    std::unordered_map<std::string, GraphConnection> connectionsMap;
-    
-    std::vector<std::string> currentLevelIds;
-    currentLevelIds.push_back(startNodeId);
-    visitedNodeIds.insert(startNodeId);
-    
-    // Fetch Root Node
-    {
-        std::string sql = "SELECT id, name, type, projectName, branch, relativePath, startLine, startColumn FROM Node WHERE id = ?";
-        sqlite3_stmt* stmt;
-        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, startNodeId.c_str(), -1, SQLITE_STATIC);
-            if (sqlite3_step(stmt) == SQLITE_ROW) {
-                GraphNode n;
-                n.id = (const char*)sqlite3_column_text(stmt, 0);
-                n.name = (const char*)sqlite3_column_text(stmt, 1);
-                n.type = (const char*)sqlite3_column_text(stmt, 2);
-                n.projectName = (const char*)sqlite3_column_text(stmt, 3);
-                n.branch = (const char*)sqlite3_column_text(stmt, 4);
-                
-                const char* rp = (const char*)sqlite3_column_text(stmt, 5);
-                n.relativePath = rp ? rp : "";
-                n.startLine = sqlite3_column_int(stmt, 6);
-                n.startColumn = sqlite3_column_int(stmt, 7);
-                
-                nodesMap[n.id] = n;
-            }
-            sqlite3_finalize(stmt);
-        }
+    int argi = 0;
+    if (idxNum & (1 << GRAPH_ARG_ROOT)) {
+        root = (const char*)sqlite3_value_text(argv[argi++]);
     }
-    
-    // BFS
-    int depth = 0;
-    while (!currentLevelIds.empty() && depth < maxDepth) {
-        std::string idListParam;
-        for (size_t i = 0; i < currentLevelIds.size(); ++i) {
-            if (i > 0) idListParam += ",";
-            idListParam += sql_quote(currentLevelIds[i]);
-        }
-        
-        if (idListParam.empty()) break;
-        
-        if (idListParam.empty()) break;
-
-        // Fetch Connections
-        std::string sql = "SELECT fromId, toId FROM Connection WHERE fromId IN (" + idListParam + ") OR toId IN (" + idListParam + ")";
-        
-        sqlite3_stmt* stmt;
-        std::vector<std::string> nextLevelIds;
-        std::unordered_set<std::string> newIdsToFetch;
-        
-        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                GraphConnection conn;
-                conn.fromId = (const char*)sqlite3_column_text(stmt, 0);
-                conn.toId = (const char*)sqlite3_column_text(stmt, 1);
-                conn.id = conn.fromId + "-" + conn.toId; // Synthesize ID
-                
-                if (connectionsMap.find(conn.id) == connectionsMap.end()) {
-                    connectionsMap[conn.id] = conn;
-                    
-                    std::string neighbor;
-                    if (visitedNodeIds.count(conn.fromId) && !visitedNodeIds.count(conn.toId)) {
-                        neighbor = conn.toId;
-                    } else if (visitedNodeIds.count(conn.toId) && !visitedNodeIds.count(conn.fromId)) {
-                        neighbor = conn.fromId;
-                    }
-                    
-                    if (!neighbor.empty()) {
-                        visitedNodeIds.insert(neighbor);
-                        newIdsToFetch.insert(neighbor);
-                        nextLevelIds.push_back(neighbor);
-                    }
-                }
-            }
-            sqlite3_finalize(stmt);
+    if (idxNum & (1 << GRAPH_ARG_DEPTH)) {
+        maxDepth = sqlite3_value_int(argv[argi++]);
+    }
+    if (idxNum & (1 << GRAPH_ARG_DIRECTION)) {
+        const char* raw = (const char*)sqlite3_value_text(argv[argi++]);
+        if (!ParseTraversalDirection(raw, direction)) {
+            sqlite3_free(pCursor->pVtab->zErrMsg);
+            pCursor->pVtab->zErrMsg = sqlite3_mprintf("direction must be one of 'both', 'out', 'in'");
+            return SQLITE_ERROR;
         }
-        
-        // Fetch New Nodes Info
-        if (!newIdsToFetch.empty()) {
-             std::string newIdListParam;
-             bool first = true;
-             for (const auto& id : newIdsToFetch) {
-                 if (!first) newIdListParam += ",";
-                 newIdListParam += sql_quote(id);
-                 first = false;
-             }
-             
-             std::string nodesSql = "SELECT id, name, type, projectName, branch, relativePath, startLine, startColumn FROM Node WHERE id IN (" + newIdListParam + ")";
-             if (sqlite3_prepare_v2(db, nodesSql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
-                 while (sqlite3_step(stmt) == SQLITE_ROW) {
-                     GraphNode n;
-                     n.id = (const char*)sqlite3_column_text(stmt, 0);
-                     n.name = (const char*)sqlite3_column_text(stmt, 1);
-                     n.type = (const char*)sqlite3_column_text(stmt, 2);
-                     n.projectName = (const char*)sqlite3_column_text(stmt, 3);
-                     n.branch = (const char*)sqlite3_column_text(stmt, 4);
-                     const char* rp = (const char*)sqlite3_column_text(stmt, 5);
-                     n.relativePath = rp ? rp : "";
-                     n.startLine = sqlite3_column_int(stmt, 6);
-                     n.startColumn = sqlite3_column_int(stmt, 7);
-                     
-                     nodesMap[n.id] = n;
-                 }
-                 sqlite3_finalize(stmt);
-             }
+    }
+    TraversalFilter filter;
+    if (idxNum & (1 << GRAPH_ARG_FILTER)) {
+        std::string error;
+        if (!ParseTraversalFilter((const char*)sqlite3_value_text(argv[argi++]), filter, error)) {
+            sqlite3_free(pCursor->pVtab->zErrMsg);
+            pCursor->pVtab->zErrMsg = sqlite3_mprintf("%s", error.c_str());
+            return SQLITE_ERROR;
         }
-        
-        currentLevelIds = nextLevelIds;
-        depth++;
     }
-    
-    std::vector<GraphNode> nodesList;
-    for (const auto& p : nodesMap) nodesList.push_back(p.second);
-    std::vector<GraphConnection> connList;
-    for (const auto& p : connectionsMap) connList.push_back(p.second);
-    
-    OrthogonalGraph og = BuildOrthogonalGraph(nodesList, connList);
-    auto cycles = DetectCycles(og);
-    std::string json = SerializeGraph(og, cycles);
-    
-    sqlite3_result_text(context, json.c_str(), -1, SQLITE_TRANSIENT);
-}
 
-// Helper struct for result
-struct ProjectGraphResult {
-    OrthogonalGraph graph;
-    std::vector<std::vector<GraphNode>> cycles;
-};
+    if (!root) return SQLITE_OK; // Empty result for missing or NULL root
 
-static ProjectGraphResult BuildProjectGraphImpl(sqlite3* db, std::string startProjectId, std::string branch, int maxDepth, bool detectCycles = true) {
-    std::unordered_set<std::string> visitedProjectIds;
-    std::unordered_map<std::string, GraphNode> projectInfos;
-    std::unordered_map<std::string, GraphConnection> projectConnections;
-    
-    std::vector<std::string> currentLevelIds;
-    currentLevelIds.push_back(startProjectId);
-    visitedProjectIds.insert(startProjectId);
-    
-    // 1. Fetch Root Project
-    {
-         // GraphNode reused for Project info: name, addr, type
-         std::string sql = "SELECT id, name, addr, type FROM Project WHERE id = ?";
-         sqlite3_stmt* stmt;
-         if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
-             sqlite3_bind_text(stmt, 1, startProjectId.c_str(), -1, SQLITE_STATIC);
-             if (sqlite3_step(stmt) == SQLITE_ROW) {
-                 GraphNode p;
-                 p.id = (const char*)sqlite3_column_text(stmt, 0);
-                 p.name = (const char*)sqlite3_column_text(stmt, 1);
-                 p.addr = (const char*)sqlite3_column_text(stmt, 2);
-                 p.type = (const char*)sqlite3_column_text(stmt, 3);
-                 p.branch = branch;
-                 
-                 projectInfos[p.id] = p;
-             }
-             sqlite3_finalize(stmt);
-         }
-    }
-    
-    // BFS
-    int depth = 0;
-    while (!currentLevelIds.empty() && depth < maxDepth) {
-        std::string idListParam;
-        for (size_t i = 0; i < currentLevelIds.size(); ++i) {
-            if (i > 0) idListParam += ",";
-            idListParam += sql_quote(currentLevelIds[i]);
-        }
-        
-        if (idListParam.empty()) break;
-
-        // Find connections between NODES where nodes belong to these projects
-        // SELECT N1.projectId as fromPid, N2.projectId as toPid 
-        // FROM Connection C 
-        // JOIN Node N1 ON C.fromId = N1.id 
-        // JOIN Node N2 ON C.toId = N2.id 
-        // WHERE (N1.projectId IN (...) OR N2.projectId IN (...)) 
-        // AND N1.branch = ? AND N2.branch = ?
-        
-        // Optimization: Single query 
-        std::string sql = 
-            "SELECT DISTINCT N1.projectId, N2.projectId "
-            "FROM Connection C "
-            "JOIN Node N1 ON C.fromId = N1.id "
-            "JOIN Node N2 ON C.toId = N2.id "
-            "WHERE (N1.projectId IN (" + idListParam + ") OR N2.projectId IN (" + idListParam + ")) "
-            "AND N1.branch = ? AND N2.branch = ? "
-            "AND N1.projectId != N2.projectId";
-            
-        sqlite3_stmt* stmt;
-        std::vector<std::string> nextLevelIds;
-        std::unordered_set<std::string> newProjectsToFetch;
-        
-        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, branch.c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_text(stmt, 2, branch.c_str(), -1, SQLITE_STATIC);
-            
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                 std::string fromPid = (const char*)sqlite3_column_text(stmt, 0);
-                 std::string toPid = (const char*)sqlite3_column_text(stmt, 1);
-                 
-                 std::string connId = fromPid + "-" + toPid;
-                 if (projectConnections.find(connId) == projectConnections.end()) {
-                     GraphConnection gc;
-                     gc.id = connId;
-                     gc.fromId = fromPid;
-                     gc.toId = toPid;
-                     projectConnections[connId] = gc;
-                     
-                     // Identify new discovery
-                     if (visitedProjectIds.find(fromPid) == visitedProjectIds.end()) {
-                         visitedProjectIds.insert(fromPid);
-                         newProjectsToFetch.insert(fromPid);
-                         nextLevelIds.push_back(fromPid);
-                     }
-                     if (visitedProjectIds.find(toPid) == visitedProjectIds.end()) {
-                         visitedProjectIds.insert(toPid);
-                         newProjectsToFetch.insert(toPid);
-                         nextLevelIds.push_back(toPid);
-                     }
-                 }
-            }
-            sqlite3_finalize(stmt);
-        }
-        
-        // Fetch newly discovered projects
-        if (!newProjectsToFetch.empty()) {
-             std::string pIds;
-             bool first = true;
-             for (const auto& pid : newProjectsToFetch) {
-                 if (!first) pIds += ",";
-                 pIds += sql_quote(pid);
-                 first = false;
-             }
-             
-             std::string pSql = "SELECT id, name, addr, type FROM Project WHERE id IN (" + pIds + ")";
-             if (sqlite3_prepare_v2(db, pSql.c_str(), -1, &stmt, NULL) == SQLITE_OK) {
-                 while (sqlite3_step(stmt) == SQLITE_ROW) {
-                     GraphNode p;
-                     p.id = (const char*)sqlite3_column_text(stmt, 0);
-                     p.name = (const char*)sqlite3_column_text(stmt, 1);
-                     p.addr = (const char*)sqlite3_column_text(stmt, 2);
-                     p.type = (const char*)sqlite3_column_text(stmt, 3);
-                     p.branch = branch;
-                     projectInfos[p.id] = p;
-                 }
-                 sqlite3_finalize(stmt);
-             }
-        }
-        
-        currentLevelIds = nextLevelIds;
-        depth++;
-    }
-    
-    std::vector<GraphNode> nodesList;
-    for (const auto& p : projectInfos) nodesList.push_back(p.second);
-    std::vector<GraphConnection> connList;
-    for (const auto& p : projectConnections) connList.push_back(p.second);
-    
-    OrthogonalGraph og = BuildOrthogonalGraph(nodesList, connList);
-    std::vector<std::vector<GraphNode>> cycles;
-    if (detectCycles) {
-        cycles = DetectCycles(og);
-    }
-    
-    return { og, cycles };
+    cur->traversal = new NodeTraversal(vtab->db, root, maxDepth, direction, filter);
+    GraphVtabFill(cur, vtab->kind);
+    return SQLITE_OK;
 }
 
-// Get Project Dependency Graph
-static void GetProjectDependencyGraph(sqlite3_context *context, int argc, sqlite3_value **argv) {
-    if (argc < 2) {
-        sqlite3_result_error(context, "Requires projectId, branch", -1);
-        return;
+static int GraphVtabNext(sqlite3_vtab_cursor* pCursor) {
+    GraphVtabCursor* cur = (GraphVtabCursor*)pCursor;
+    GraphVtab* vtab = (GraphVtab*)pCursor->pVtab;
+
+    cur->rowid++;
+    cur->pos++;
+    if (cur->pos >= GraphVtabBufferSize(cur, vtab->kind)) {
+        GraphVtabFill(cur, vtab->kind);
     }
+    return SQLITE_OK;
+}
 
-    std::string startProjectId((const char*)sqlite3_value_text(argv[0]));
-    std::string branch((const char*)sqlite3_value_text(argv[1]));
-    int maxDepth = 100;
-    if (argc >= 3) maxDepth = sqlite3_value_int(argv[2]);
+static int GraphVtabEof(sqlite3_vtab_cursor* pCursor) {
+    return ((GraphVtabCursor*)pCursor)->eof;
+}
 
-    sqlite3 *db = sqlite3_context_db_handle(context);
-    
-    if (startProjectId == "*") {
-        // Multi-graph mode
-        std::vector<std::string> allProjects;
-        sqlite3_stmt* stmt;
-        if (sqlite3_prepare_v2(db, "SELECT id FROM Project", -1, &stmt, NULL) == SQLITE_OK) {
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                allProjects.push_back((const char*)sqlite3_column_text(stmt, 0));
-            }
-            sqlite3_finalize(stmt);
-        }
-        
-        std::unordered_set<std::string> remainingProjects(allProjects.begin(), allProjects.end());
-        std::vector<std::string> graphJsons;
-        
-        // Just iterate through the original list to maintain a stable order
-        for (const auto& pid : allProjects) {
-            // Check if still in remaining (not yet covered by another graph)
-            if (remainingProjects.find(pid) == remainingProjects.end()) {
-                continue;
-            }
-            
-            // Build graph with unlimited depth for this project
-            // Using a large number for unlimited depth
-            ProjectGraphResult res = BuildProjectGraphImpl(db, pid, branch, 100000, true); // Detect cycles for * mode
-            
-            // Remove contained projects from remaining
-            for (const auto& node : res.graph.vertices) {
-                remainingProjects.erase(node.data.id);
-            }
-            
-            // Serialize
-            graphJsons.push_back(SerializeGraph(res.graph, res.cycles));
-        }
-        
-        // Construct JSON Array
-        std::string json = "[";
-        for (size_t i = 0; i < graphJsons.size(); ++i) {
-            if (i > 0) json += ",";
-            json += graphJsons[i];
+static int GraphVtabColumn(sqlite3_vtab_cursor* pCursor, sqlite3_context* ctx, int col) {
+    GraphVtabCursor* cur = (GraphVtabCursor*)pCursor;
+    GraphVtab* vtab = (GraphVtab*)pCursor->pVtab;
+
+    if (vtab->kind == GraphTableKind::Vertices) {
+        const GraphNode& n = cur->nodes[cur->pos];
+        switch (col) {
+            case GV_COL_ID: sqlite3_result_text(ctx, n.id.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GV_COL_NAME: sqlite3_result_text(ctx, n.name.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GV_COL_TYPE: sqlite3_result_text(ctx, n.type.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GV_COL_PROJECT_NAME: sqlite3_result_text(ctx, n.projectName.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GV_COL_BRANCH: sqlite3_result_text(ctx, n.branch.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GV_COL_RELATIVE_PATH: sqlite3_result_text(ctx, n.relativePath.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GV_COL_START_LINE: sqlite3_result_int(ctx, n.startLine); break;
+            case GV_COL_START_COLUMN: sqlite3_result_int(ctx, n.startColumn); break;
+            case GV_COL_LEVEL: sqlite3_result_int(ctx, cur->level); break;
+            default: sqlite3_result_null(ctx); break;
         }
-        json += "]";
-        
-        sqlite3_result_text(context, json.c_str(), -1, SQLITE_TRANSIENT);
-        
     } else {
-        // Single project mode
-        ProjectGraphResult res = BuildProjectGraphImpl(db, startProjectId, branch, maxDepth, false); // Skip cycles for single project
-        std::string json = SerializeGraph(res.graph, res.cycles);
-        sqlite3_result_text(context, json.c_str(), -1, SQLITE_TRANSIENT);
+        const GraphConnection& c = cur->connections[cur->pos];
+        switch (col) {
+            case GE_COL_FROM_ID: sqlite3_result_text(ctx, c.fromId.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GE_COL_TO_ID: sqlite3_result_text(ctx, c.toId.c_str(), -1, SQLITE_TRANSIENT); break;
+            case GE_COL_LEVEL: sqlite3_result_int(ctx, cur->level); break;
+            default: sqlite3_result_null(ctx); break;
+        }
     }
+    return SQLITE_OK;
 }
 
+static int GraphVtabRowid(sqlite3_vtab_cursor* pCursor, sqlite3_int64* pRowid) {
+    *pRowid = ((GraphVtabCursor*)pCursor)->rowid;
+    return SQLITE_OK;
+}
+
+// Value-initialized and filled in by name: the members after xRowid differ
+// between SQLite versions (xShadowName, xIntegrity, ...) and all stay null
+static sqlite3_module MakeGraphVtabModule() {
+    sqlite3_module module{};
+    module.iVersion = 0;
+    module.xCreate = nullptr; // eponymous-only
+    module.xConnect = GraphVtabConnect;
+    module.xBestIndex = GraphVtabBestIndex;
+    module.xDisconnect = GraphVtabDisconnect;
+    module.xOpen = GraphVtabOpen;
+    module.xClose = GraphVtabClose;
+    module.xFilter = GraphVtabFilter;
+    module.xNext = GraphVtabNext;
+    module.xEof = GraphVtabEof;
+    module.xColumn = GraphVtabColumn;
+    module.xRowid = GraphVtabRowid;
+    return module;
+}
+
+static sqlite3_module GraphVtabModule = MakeGraphVtabModule();
+
+static GraphTableKind GraphVerticesKind = GraphTableKind::Vertices;
+static GraphTableKind GraphEdgesKind = GraphTableKind::Edges;
 
 #ifdef __cplusplus
 extern "C" {
@@ -798,9 +455,84 @@ extern "C" {
         // New Functions
         sqlite3_create_function(db, "get_node_dependency_graph", 1, SQLITE_UTF8, NULL, GetNodeDependencyGraph, NULL, NULL);
         sqlite3_create_function(db, "get_node_dependency_graph", 2, SQLITE_UTF8, NULL, GetNodeDependencyGraph, NULL, NULL); // Optional depth
+        sqlite3_create_function(db, "get_node_dependency_graph", 3, SQLITE_UTF8, NULL, GetNodeDependencyGraph, NULL, NULL); // Optional filter JSON
+        sqlite3_create_function(db, "get_node_dependency_graph", 4, SQLITE_UTF8, NULL, GetNodeDependencyGraph, NULL, NULL); // Optional layout flag
+        sqlite3_create_function(db, "get_node_dependency_graph", 5, SQLITE_UTF8, NULL, GetNodeDependencyGraph, NULL, NULL); // Optional memory budget in bytes
+        sqlite3_create_function(db, "get_node_dependency_graph_levels", 1, SQLITE_UTF8, NULL, GetNodeDependencyGraphLevels, NULL, NULL);
+        sqlite3_create_function(db, "get_node_dependency_graph_levels", 2, SQLITE_UTF8, NULL, GetNodeDependencyGraphLevels, NULL, NULL); // Optional depth
+        sqlite3_create_function(db, "get_node_dependency_graph_levels", 3, SQLITE_UTF8, NULL, GetNodeDependencyGraphLevels, NULL, NULL); // Optional filter JSON
         
         sqlite3_create_function(db, "get_project_dependency_graph", 2, SQLITE_UTF8, NULL, GetProjectDependencyGraph, NULL, NULL);
         sqlite3_create_function(db, "get_project_dependency_graph", 3, SQLITE_UTF8, NULL, GetProjectDependencyGraph, NULL, NULL);
+        sqlite3_create_function(db, "get_project_dependency_graph", 4, SQLITE_UTF8, NULL, GetProjectDependencyGraph, NULL, NULL);
+        sqlite3_create_function(db, "get_project_dependency_graph", 5, SQLITE_UTF8, NULL, GetProjectDependencyGraph, NULL, NULL);
+        sqlite3_create_function(db, "get_project_dependency_graph_delta", 1, SQLITE_UTF8, NULL, ProjectGraphDelta, NULL, NULL);
+        sqlite3_create_function(db, "get_project_dependency_graph_delta", 2, SQLITE_UTF8, NULL, ProjectGraphDelta, NULL, NULL); // Optional since generation
+
+        // XXH64 of a serialized result, as used for graph ETags
+        sqlite3_create_function(db, "content_hash", 1, SQLITE_UTF8, NULL, ContentHashFunction, NULL, NULL);
+
+        // Streaming table-valued variants of get_node_dependency_graph
+        sqlite3_create_module(db, "graph_vertices", &GraphVtabModule, &GraphVerticesKind);
+        sqlite3_create_module(db, "graph_edges", &GraphVtabModule, &GraphEdgesKind);
+
+        // Trigram search over node names and paths
+        sqlite3_create_function(db, "node_fuzzy_search", 1, SQLITE_UTF8, NULL, NodeFuzzySearch, NULL, NULL);
+        sqlite3_create_function(db, "node_fuzzy_search", 2, SQLITE_UTF8, NULL, NodeFuzzySearch, NULL, NULL);
+        sqlite3_create_function(db, "node_fuzzy_search", 3, SQLITE_UTF8, NULL, NodeFuzzySearch, NULL, NULL);
+        sqlite3_create_function(db, "node_fuzzy_search", 4, SQLITE_UTF8, NULL, NodeFuzzySearch, NULL, NULL);
+        sqlite3_create_function(db, "node_fuzzy_reindex", 0, SQLITE_UTF8, NULL, NodeFuzzyReindex, NULL, NULL);
+
+        // Bulk insert of uploaded analysis results
+        sqlite3_create_function(db, "dms_ingest_nodes", 1, SQLITE_UTF8, NULL, IngestNodes, NULL, NULL);
+        sqlite3_create_function(db, "dms_ingest_nodes", 2, SQLITE_UTF8, NULL, IngestNodes, NULL, NULL); // Optional shallow branch
+        sqlite3_create_function(db, "dms_commit_shallow", 3, SQLITE_UTF8, NULL, CommitShallowBranch, NULL, NULL);
+        sqlite3_create_function(db, "dms_match_connections", 0, SQLITE_UTF8, NULL, MatchConnections, NULL, NULL);
+        sqlite3_create_function(db, "dms_match_connections", 1, SQLITE_UTF8, NULL, MatchConnections, NULL, NULL); // Optional branch
+
+        // Exports nothing imports, imports that resolve to nothing
+        sqlite3_create_function(db, "find_unused_exports", 1, SQLITE_UTF8, NULL, FindUnusedExports, NULL, NULL);
+        sqlite3_create_function(db, "find_unresolved_imports", 1, SQLITE_UTF8, NULL, FindUnresolvedImports, NULL, NULL);
+
+        // Path-pattern queries over the project graph
+        sqlite3_create_function(db, "dms_match", 2, SQLITE_UTF8, NULL, MatchPattern, NULL, NULL);
+        sqlite3_create_function(db, "dms_match", 3, SQLITE_UTF8, NULL, MatchPattern, NULL, NULL); // Optional limit
+
+        // Approximate transitive dependent counts
+        sqlite3_create_function(db, "impact_sketch_build", 0, SQLITE_UTF8, NULL, ImpactSketchBuild, NULL, NULL);
+        sqlite3_create_function(db, "impact_sketch_build", 1, SQLITE_UTF8, NULL, ImpactSketchBuild, NULL, NULL); // Optional branch
+        sqlite3_create_function(db, "impact_estimate", 1, SQLITE_UTF8, NULL, ImpactEstimate, NULL, NULL);
+
+        // Exact dependents of the nodes touched by a diff
+        sqlite3_create_function(db, "impact_of_changes", 3, SQLITE_UTF8, NULL, ImpactOfChanges, NULL, NULL);
+        sqlite3_create_function(db, "impact_of_changes", 4, SQLITE_UTF8, NULL, ImpactOfChanges, NULL, NULL); // Optional depth
+
+        // Projects as super-vertices, expanded to their boundary nodes on demand
+        sqlite3_create_function(db, "project_clusters", 1, SQLITE_UTF8, NULL, ProjectClusters, NULL, NULL);
+        sqlite3_create_function(db, "project_clusters", 2, SQLITE_UTF8, NULL, ProjectClusters, NULL, NULL); // Optional filter
+        sqlite3_create_function(db, "expand_project", 2, SQLITE_UTF8, NULL, ExpandProject, NULL, NULL);
+        sqlite3_create_function(db, "expand_project", 3, SQLITE_UTF8, NULL, ExpandProject, NULL, NULL); // Optional filter
+
+        // Hotspot ranking (in-degree, PageRank, sampled betweenness) per branch
+        sqlite3_create_function(db, "rank_nodes", 2, SQLITE_UTF8, NULL, RankNodes, NULL, NULL);
+        sqlite3_create_function(db, "rank_nodes", 3, SQLITE_UTF8, NULL, RankNodes, NULL, NULL); // Optional topK
+        sqlite3_create_function(db, "rank_nodes", 4, SQLITE_UTF8, NULL, RankNodes, NULL, NULL); // Optional filter
+
+        // LRU cache behind the graph functions, invalidated per branch by the change hook
+        sqlite3_create_function(db, "result_cache_stats", 0, SQLITE_UTF8, NULL, ResultCacheStats, NULL, NULL);
+        sqlite3_create_function(db, "result_cache_stats", 1, SQLITE_UTF8, NULL, ResultCacheStats, NULL, NULL); // Optional budget in bytes
+
+        // Strategy choices of the traversal planner
+        sqlite3_create_function(db, "traversal_stats", 0, SQLITE_UTF8, NULL, TraversalStats, NULL, NULL);
+        sqlite3_create_function(db, "traversal_stats", 1, SQLITE_UTF8, NULL, TraversalStats, NULL, NULL); // Optional mode
+
+        // Branches as shared per-project segments plus an overlay
+        sqlite3_create_function(db, "branch_overlay", 2, SQLITE_UTF8, NULL, BranchOverlay, NULL, NULL);
+        sqlite3_create_function(db, "branch_store_stats", 0, SQLITE_UTF8, NULL, BranchStoreStats, NULL, NULL);
+
+        AddChangeListener(FuzzyIndexOnChange);
+        AddChangeListener(ResultCacheOnChange);
+        InstallChangeHook(db);
 
         return SQLITE_OK;
     }
@@ -808,12 +540,4 @@ extern "C" {
 }
 #endif
 
-// NAPI 
-// napi_value Init(napi_env env, napi_value exports) {
-//     napi_value setup_fn;
-//     napi_create_function(env, "setup", NAPI_AUTO_LENGTH, Setup, NULL, &setup_fn);
-//     napi_set_named_property(env, exports, "setup", setup_fn);
-//     return exports;
-// }
-
-// NAPI_MODULE(sqlite_hook, Init)
+// The N-API entry point (NAPI_MODULE) lives in graph-binding.cc
@@ -0,0 +1,326 @@
+#include "traversal-planner.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include "db-state.h"
+#include "result-cache.h"
+#include "sqlite3ext.h"
+
+SQLITE_EXTENSION_INIT3
+
+// --- Traversal Planner ---
+//
+// Before each level of a traversal the planner projects how many nodes the
+// remaining levels will reach: the next frontier is counted exactly on the
+// Connection key indexes while it is small, and later levels grow by the
+// growth observed on the previous level (the average degree before there is
+// one), capped at the number of nodes. Probing costs an index seek per
+// reached node and direction; scanning costs a pass over every connection
+// plus a cheap in-memory step per reached node. A leaf at depth 2 never gets
+// past the first estimate, while a hub at depth 100 switches to a scan after
+// a level or two.
+//
+// A scanned adjacency is kept as long as the result cache epoch it was read
+// at is current, so repeated large traversals skip straight to it. The epoch
+// only moves for committed writes (see db-state.h), and a traversal whose
+// snapshot is older than the last of them neither uses nor keeps one; it
+// reads its own from the rows it sees. Sizes come from max(rowid), which is
+// an index lookup; deleted rows only make the scan look a little more
+// expensive than it is.
+
+// Measured with bench/graph-bench.cc (bfs_probe vs bfs_scan); fetching the
+// reached Node rows costs the same either way and is left out
+static const double ProbeCostPerNode = 1.0;   // microseconds per reached node and direction
+static const double ScanCostPerEdge = 0.45;   // microseconds per connection read into the adjacency
+static const double MemoryCostPerNode = 0.1;  // microseconds per reached node in the adjacency
+static const double ScanSetupCost = 500;      // keeps tiny databases probing instead of swapping adjacencies
+static const size_t MaxCountedFrontier = 256; // larger frontiers are estimated from their growth
+static const double MaxResidentEdges = 32e6;  // bigger adjacencies are built per traversal and dropped
+static const int MaxProjectedLevels = 1000;
+
+enum class PlannerMode { Auto, Probe, Scan };
+
+struct TraversalPlanner {
+    std::mutex mutex; // guards everything below
+    PlannerMode mode = PlannerMode::Auto;
+    std::shared_ptr<const ConnectionAdjacency> resident;
+    uint64_t traversals[3] = { 0, 0, 0 }; // by TraversalStrategy of the first plan
+    uint64_t switches = 0;
+    double lastBuildMs = 0;
+    TraversalPlan last;
+    bool hasLast = false;
+
+    std::mutex buildMutex; // one adjacency build at a time
+};
+
+static TraversalPlanner& GetPlanner(DatabaseState& state) {
+    static std::mutex createMutex;
+    TraversalPlanner* planner = state.traversalPlanner.load(std::memory_order_acquire);
+    if (planner) return *planner;
+
+    std::lock_guard<std::mutex> lock(createMutex);
+    planner = state.traversalPlanner.load();
+    if (!planner) {
+        planner = new TraversalPlanner();
+        state.traversalPlanner.store(planner, std::memory_order_release);
+    }
+    return *planner;
+}
+
+size_t ConnectionAdjacency::Bytes() const {
+    return keys.size() * sizeof(sqlite3_int64) + (outOffsets.size() + inOffsets.size()) * sizeof(uint32_t) +
+           (outKeys.size() + inKeys.size()) * sizeof(sqlite3_int64);
+}
+
+// --- Adjacency ---
+
+static std::shared_ptr<ConnectionAdjacency> ReadAdjacency(sqlite3* db) {
+    // The (fromKey, toKey) primary key hands the rows over already grouped and sorted
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT fromKey, toKey FROM Connection ORDER BY fromKey, toKey",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return nullptr;
+    }
+    std::vector<std::pair<sqlite3_int64, sqlite3_int64>> edges;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        edges.push_back({ sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1) });
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) return nullptr;
+
+    auto adjacency = std::make_shared<ConnectionAdjacency>();
+    std::vector<sqlite3_int64>& keys = adjacency->keys;
+    keys.reserve(edges.size() * 2);
+    for (const auto& e : edges) {
+        keys.push_back(e.first);
+        keys.push_back(e.second);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    keys.shrink_to_fit();
+
+    size_t n = keys.size();
+    auto indexOf = [&](sqlite3_int64 key) { return (size_t)(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin()); };
+    std::vector<uint32_t> to(edges.size());
+    adjacency->outOffsets.assign(n + 1, 0);
+    adjacency->inOffsets.assign(n + 1, 0);
+    for (size_t e = 0; e < edges.size(); ++e) {
+        to[e] = (uint32_t)indexOf(edges[e].second);
+        adjacency->outOffsets[indexOf(edges[e].first) + 1]++;
+        adjacency->inOffsets[to[e] + 1]++;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        adjacency->outOffsets[i + 1] += adjacency->outOffsets[i];
+        adjacency->inOffsets[i + 1] += adjacency->inOffsets[i];
+    }
+
+    // Rows are in (fromKey, toKey) order, so both groupings come out sorted
+    adjacency->outKeys.resize(edges.size());
+    adjacency->inKeys.resize(edges.size());
+    std::vector<uint32_t> next(adjacency->inOffsets.begin(), adjacency->inOffsets.end() - 1);
+    for (size_t e = 0; e < edges.size(); ++e) {
+        adjacency->outKeys[e] = edges[e].second;
+        adjacency->inKeys[next[to[e]]++] = edges[e].first;
+    }
+    return adjacency;
+}
+
+// The kept adjacency if nothing was committed since it was read
+static std::shared_ptr<const ConnectionAdjacency> CurrentResident(TraversalPlanner& planner, sqlite3* db) {
+    if (!SnapshotCurrent(db)) return nullptr; // left for the connections that can use it
+    std::shared_ptr<const ConnectionAdjacency> resident;
+    {
+        std::lock_guard<std::mutex> lock(planner.mutex);
+        resident = planner.resident;
+    }
+    if (!resident) return nullptr;
+
+    uint64_t epoch;
+    if (ResultCacheEpoch(db, epoch) && epoch == resident->epoch) return resident;
+    std::lock_guard<std::mutex> lock(planner.mutex);
+    if (planner.resident == resident) planner.resident.reset();
+    return nullptr;
+}
+
+// Builds an adjacency and keeps it if no write raced the scan. Sets
+// resident instead when another traversal finished a build meanwhile.
+static std::shared_ptr<const ConnectionAdjacency> BuildAdjacency(TraversalPlanner& planner, sqlite3* db, double edges,
+                                                                 bool& resident) {
+    std::lock_guard<std::mutex> build(planner.buildMutex);
+    if (auto current = CurrentResident(planner, db)) {
+        resident = true;
+        return current;
+    }
+    resident = false;
+
+    uint64_t before = 0, after = 0;
+    bool keep = edges <= MaxResidentEdges && ResultCacheEpoch(db, before);
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<ConnectionAdjacency> adjacency = ReadAdjacency(db);
+    if (!adjacency) return nullptr;
+    adjacency->epoch = before;
+    keep = keep && ResultCacheEpoch(db, after) && after == before;
+
+    std::lock_guard<std::mutex> lock(planner.mutex);
+    planner.lastBuildMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (keep) planner.resident = adjacency;
+    return adjacency;
+}
+
+// --- Estimates ---
+
+static double QueryNumber(sqlite3* db, const char* sql) {
+    double value = 0;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = (double)sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// Connections leaving the frontier in the traversed directions, counted on the key indexes
+static double FrontierDegree(sqlite3* db, const std::vector<sqlite3_int64>& frontier, bool outgoing, bool incoming) {
+    std::string list;
+    for (size_t i = 0; i < frontier.size(); ++i) {
+        if (i > 0) list += ",";
+        list += std::to_string(frontier[i]);
+    }
+    std::string sql = "SELECT ";
+    sql += outgoing ? "(SELECT count(*) FROM Connection WHERE fromKey IN (" + list + "))" : "0";
+    sql += incoming ? " + (SELECT count(*) FROM Connection WHERE toKey IN (" + list + "))" : " + 0";
+    return QueryNumber(db, sql.c_str());
+}
+
+static void Record(TraversalPlanner& planner, const TraversalPlan& plan, const TraversalPlan* previous) {
+    std::lock_guard<std::mutex> lock(planner.mutex);
+    if (!previous) {
+        planner.traversals[(int)plan.strategy]++;
+    } else if (previous->strategy == TraversalStrategy::Probe && plan.strategy != TraversalStrategy::Probe) {
+        planner.switches++;
+    }
+    planner.last = plan;
+    planner.last.adjacency.reset();
+    planner.hasLast = true;
+}
+
+TraversalPlan PlanTraversal(sqlite3* db, const std::vector<sqlite3_int64>& frontier, int remainingDepth, bool outgoing,
+                            bool incoming, bool filtered, double growth, const TraversalPlan* previous) {
+    TraversalPlanner& planner = GetPlanner(GetDatabaseState(db));
+    PlannerMode mode;
+    {
+        std::lock_guard<std::mutex> lock(planner.mutex);
+        mode = planner.mode;
+    }
+
+    TraversalPlan plan;
+    if (filtered || mode == PlannerMode::Probe) {
+        plan.reason = filtered ? "filter" : "forced";
+        Record(planner, plan, previous);
+        return plan;
+    }
+
+    double nodes = QueryNumber(db, "SELECT max(rowid) FROM Node");
+    double edges = QueryNumber(db, "SELECT max(rowid) FROM Connection");
+    int directions = (outgoing ? 1 : 0) + (incoming ? 1 : 0);
+    if (growth <= 0 && nodes > 0) {
+        // Walking both ways, one connection of every reached node leads back
+        // to where it was reached from
+        growth = std::max(0.0, directions * edges / nodes - (directions - 1));
+    }
+
+    double next = frontier.size() <= MaxCountedFrontier ? FrontierDegree(db, frontier, outgoing, incoming)
+                                                        : frontier.size() * growth;
+    double reached = 0;
+    for (int level = 0; level < std::min(remainingDepth, MaxProjectedLevels) && next >= 0.5 && reached < nodes; ++level) {
+        reached += next;
+        next *= growth;
+    }
+    plan.estimatedNodes = std::min(reached, nodes);
+    plan.probeCost = plan.estimatedNodes * directions * ProbeCostPerNode;
+    plan.scanCost = ScanSetupCost + edges * ScanCostPerEdge + plan.estimatedNodes * MemoryCostPerNode;
+
+    if (auto resident = CurrentResident(planner, db)) {
+        plan.strategy = TraversalStrategy::Resident;
+        plan.reason = "resident";
+        plan.adjacency = resident;
+    } else if (mode == PlannerMode::Scan || plan.scanCost < plan.probeCost) {
+        bool resident;
+        plan.adjacency = BuildAdjacency(planner, db, edges, resident);
+        if (plan.adjacency) {
+            plan.strategy = resident ? TraversalStrategy::Resident : TraversalStrategy::Scan;
+            plan.reason = resident ? "resident" : mode == PlannerMode::Scan ? "forced" : "frontier growth";
+        } else {
+            plan.reason = "scan failed";
+        }
+    } else {
+        plan.reason = "small frontier";
+    }
+    Record(planner, plan, previous);
+    return plan;
+}
+
+// --- Stats ---
+
+static const char* StrategyName(TraversalStrategy strategy) {
+    switch (strategy) {
+        case TraversalStrategy::Scan: return "scan";
+        case TraversalStrategy::Resident: return "resident";
+        default: return "probe";
+    }
+}
+
+static std::string Number(double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", value);
+    return buf;
+}
+
+void TraversalStats(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    TraversalPlanner& planner = GetPlanner(GetDatabaseState(sqlite3_context_db_handle(context)));
+
+    if (argc > 0 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
+        const char* mode = (const char*)sqlite3_value_text(argv[0]);
+        PlannerMode parsed;
+        if (strcmp(mode, "auto") == 0) {
+            parsed = PlannerMode::Auto;
+        } else if (strcmp(mode, "probe") == 0) {
+            parsed = PlannerMode::Probe;
+        } else if (strcmp(mode, "scan") == 0) {
+            parsed = PlannerMode::Scan;
+        } else {
+            sqlite3_result_error(context, "mode must be 'auto', 'probe' or 'scan'", -1);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(planner.mutex);
+        planner.mode = parsed;
+    }
+
+    std::lock_guard<std::mutex> lock(planner.mutex);
+    const char* mode = planner.mode == PlannerMode::Probe ? "probe" : planner.mode == PlannerMode::Scan ? "scan" : "auto";
+    std::string json = std::string("{\"mode\":\"") + mode + "\"" +
+                       ",\"probe\":" + std::to_string(planner.traversals[(int)TraversalStrategy::Probe]) +
+                       ",\"scan\":" + std::to_string(planner.traversals[(int)TraversalStrategy::Scan]) +
+                       ",\"resident\":" + std::to_string(planner.traversals[(int)TraversalStrategy::Resident]) +
+                       ",\"switches\":" + std::to_string(planner.switches) +
+                       ",\"residentEdges\":" + std::to_string(planner.resident ? planner.resident->EdgeCount() : 0) +
+                       ",\"residentBytes\":" + std::to_string(planner.resident ? planner.resident->Bytes() : 0) +
+                       ",\"lastBuildMs\":" + Number(planner.lastBuildMs) + ",\"last\":";
+    if (planner.hasLast) {
+        json += std::string("{\"strategy\":\"") + StrategyName(planner.last.strategy) + "\"" +
+                ",\"reason\":\"" + planner.last.reason + "\"" +
+                ",\"estimatedNodes\":" + Number(planner.last.estimatedNodes) +
+                ",\"probeCost\":" + Number(planner.last.probeCost) +
+                ",\"scanCost\":" + Number(planner.last.scanCost) + "}";
+    } else {
+        json += "null";
+    }
+    json += "}";
+    sqlite3_result_text(context, json.c_str(), (int)json.size(), SQLITE_TRANSIENT);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "sqlite3.h"
+
+// How NodeTraversal expands its levels. Probe runs one indexed query per level
+// and is best for small neighbourhoods; Scan reads the whole Connection table
+// once into an in-memory adjacency and walks that; Resident reuses an
+// adjacency a previous Scan left behind, as long as nothing was committed since.
+enum class TraversalStrategy { Probe, Scan, Resident };
+
+// Every connection of the database as CSR arrays in both directions
+struct ConnectionAdjacency {
+    std::vector<sqlite3_int64> keys;             // node keys with at least one connection, ascending
+    std::vector<uint32_t> outOffsets, inOffsets; // per key, plus the end offset
+    std::vector<sqlite3_int64> outKeys;          // toKey of each connection, grouped by fromKey
+    std::vector<sqlite3_int64> inKeys;           // fromKey of each connection, grouped by toKey
+    uint64_t epoch = 0;                          // result cache epoch the arrays were read at
+
+    size_t EdgeCount() const { return outKeys.size(); }
+    size_t Bytes() const;
+
+    // Calls fn(neighbor) for the far endpoint of every outgoing (or incoming)
+    // connection of key, in ascending key order
+    template <typename Fn>
+    void ForEachNeighbor(sqlite3_int64 key, bool outgoing, Fn fn) const;
+};
+
+struct TraversalPlan {
+    TraversalStrategy strategy = TraversalStrategy::Probe;
+    const char* reason = "";
+    double estimatedNodes = 0; // nodes the remaining levels are expected to reach
+    double probeCost = 0;      // estimated microseconds for each strategy
+    double scanCost = 0;
+    std::shared_ptr<const ConnectionAdjacency> adjacency; // set for Scan and Resident
+};
+
+// Plans the remaining levels of a traversal whose next frontier is `frontier`.
+// growth is the frontier growth observed on the last probed level (0 before
+// any). Called once per level while the strategy is Probe, so a traversal
+// that turns out to be huge switches to Scan half-way. Filtered traversals
+// always probe: the adjacency knows nothing about node attributes.
+TraversalPlan PlanTraversal(sqlite3* db, const std::vector<sqlite3_int64>& frontier, int remainingDepth, bool outgoing,
+                            bool incoming, bool filtered, double growth, const TraversalPlan* previous);
+
+// traversal_stats([mode]) - how traversals were planned so far:
+//   {"mode","probe","scan","resident","switches","residentEdges","residentBytes",
+//    "lastBuildMs","last":{strategy,reason,estimatedNodes,probeCost,scanCost}}
+// probe/scan/resident count traversals by their first plan; switches counts
+// probing traversals that moved to an adjacency later. A mode argument ('auto',
+// 'probe' or 'scan') overrides the planner for benchmarks and tests.
+void TraversalStats(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+template <typename Fn>
+void ConnectionAdjacency::ForEachNeighbor(sqlite3_int64 key, bool outgoing, Fn fn) const {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) return;
+    size_t i = it - keys.begin();
+    const std::vector<uint32_t>& offsets = outgoing ? outOffsets : inOffsets;
+    const std::vector<sqlite3_int64>& neighbors = outgoing ? outKeys : inKeys;
+    for (uint32_t e = offsets[i]; e < offsets[i + 1]; ++e) fn(neighbors[e]);
+}
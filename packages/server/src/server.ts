@@ -32,6 +32,18 @@ export default async () => {
     }
   })
 
+  // NDJSON bodies (bulk node ingest) are handed to the route as a string
+  fastify.addContentTypeParser('application/x-ndjson', { parseAs: 'buffer' }, (req, body, done) => {
+    if (req.headers['content-encoding'] === 'gzip') {
+      zlib.gunzip(body, (err, decoded) => {
+        if (err) return done(err)
+        done(null, decoded.toString())
+      })
+    } else {
+      done(null, body.toString())
+    }
+  })
+
   // Setup CORS
   await fastify.register(cors, {
     origin: process.env.CLIENT_DOMAIN,
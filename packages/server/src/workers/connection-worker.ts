@@ -1,11 +1,15 @@
 import { optimizedAutoCreateConnections } from './create-connections'
+import { rebuildImpactSketches } from '../database/repository'
 
 export default async function run() {
   try {
     const result = await optimizedAutoCreateConnections()
+    // Impact badges depend on the full connection set, so refresh them in the same job
+    const impactSketches = await rebuildImpactSketches()
     return {
       success: true,
       ...result,
+      impactSketches: impactSketches.count,
     }
   } catch (err) {
     return {
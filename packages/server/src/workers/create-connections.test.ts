@@ -107,8 +107,8 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(readNode.id)
-    expect(connections[0].toId).toBe(writeNode.id)
+    expect(connections[0].fromKey).toBe(readNode.key)
+    expect(connections[0].toKey).toBe(writeNode.key)
   })
 
   it('should NOT create connection for UrlParamRead -> UrlParamWrite within same project', async () => {
@@ -154,8 +154,8 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(importNode.id)
-    expect(connections[0].toId).toBe(exportNode.id)
+    expect(connections[0].fromKey).toBe(importNode.key)
+    expect(connections[0].toKey).toBe(exportNode.key)
   })
 
   it('should create connection for GlobalVarRead -> GlobalVarWrite', async () => {
@@ -171,8 +171,8 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(readNode.id)
-    expect(connections[0].toId).toBe(writeNode.id)
+    expect(connections[0].fromKey).toBe(readNode.key)
+    expect(connections[0].toKey).toBe(writeNode.key)
   })
 
   it('should create connection for WebStorageRead -> WebStorageWrite', async () => {
@@ -188,8 +188,8 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(readNode.id)
-    expect(connections[0].toId).toBe(writeNode.id)
+    expect(connections[0].fromKey).toBe(readNode.key)
+    expect(connections[0].toKey).toBe(writeNode.key)
   })
 
   it('should create connection for EventOn -> EventEmit', async () => {
@@ -205,8 +205,8 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(onNode.id)
-    expect(connections[0].toId).toBe(emitNode.id)
+    expect(connections[0].fromKey).toBe(onNode.key)
+    expect(connections[0].toKey).toBe(emitNode.key)
   })
 
   // Skipped Rules (Not implemented in SQL Phase 2 yet)
@@ -238,8 +238,8 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(refNode.id)
-    expect(connections[0].toId).toBe(exportNode.id)
+    expect(connections[0].fromKey).toBe(refNode.key)
+    expect(connections[0].toKey).toBe(exportNode.key)
   })
 
   it('should create connection for RuntimeDynamicImport -> NamedExport', async () => {
@@ -262,8 +262,23 @@ describe('Connection Creation Worker', () => {
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
-    expect(connections[0].fromId).toBe(importNode.id)
-    expect(connections[0].toId).toBe(exportNode.id)
+    expect(connections[0].fromKey).toBe(importNode.key)
+    expect(connections[0].toKey).toBe(exportNode.key)
+  })
+
+  it('should drop connections with their nodes', async () => {
+    const projectA = await createProject('project-a')
+    const projectB = await createProject('project-b')
+
+    const importNode = await createNode(projectA, 'project-b.myFunc', 'NamedImport')
+    const exportNode = await createNode(projectB, 'myFunc', 'NamedExport')
+
+    await optimizedAutoCreateConnections()
+    expect(await prisma.connection.count()).toBe(1)
+
+    // Connections reference their endpoints by node key
+    await prisma.node.delete({ where: { id: exportNode.id } })
+    expect(await prisma.connection.count({ where: { fromKey: importNode.key } })).toBe(0)
   })
 
   it('should skip existing connections', async () => {
@@ -280,8 +295,7 @@ describe('Connection Creation Worker', () => {
     const result = await optimizedAutoCreateConnections()
 
     expect(result.createdConnections).toBe(0)
-    // Skipped connections are not tracked with INSERT OR IGNORE optimization
-    // expect(result.skippedConnections).toBe(1)
+    expect(result.skippedConnections).toBe(1)
 
     const connections = await prisma.connection.findMany()
     expect(connections).toHaveLength(1)
@@ -300,8 +314,8 @@ describe('Connection Creation Worker', () => {
     // Manually create the back-link to form a cycle
     await prisma.connection.create({
       data: {
-        fromId: exportNode.id,
-        toId: importNode.id,
+        fromKey: exportNode.key,
+        toKey: importNode.key,
       },
     })
 
@@ -1,5 +1,17 @@
 import { prisma } from '../database/prisma'
 
+// Rules matched natively (see src/native/connection-matcher.cc), per branch
+// and across projects:
+//   NamedImport(import_pkg, import_name) -> NamedExport(projectName, name)
+//   RuntimeDynamicImport(import_pkg, import_subpkg, import_name) -> NamedExport(projectName, export_entry, name),
+//     where a 'Nil' subpackage also matches the 'index' entry
+//   DynamicModuleFederationReference(import_pkg, import_name) -> NamedExport(projectName, export_entry)
+//   GlobalVarRead/WebStorageRead/EventOn/UrlParamRead(name) -> the matching Write/Emit(name)
+type MatchResult = {
+  createdConnections: number
+  matchedConnections: number
+}
+
 export async function optimizedAutoCreateConnections(): Promise<{
   createdConnections: number
   skippedConnections: number
@@ -7,80 +19,15 @@ export async function optimizedAutoCreateConnections(): Promise<{
   cycles: string[][]
 }> {
   try {
-    let createdCount = 0
-
-    // Rule 1: NamedImport -> NamedExport
-    // Matches: Import(pkg=projectName, name=name) -> Export(projectName, name)
-    const rule1Count = await prisma.$executeRaw`
-        INSERT OR IGNORE INTO Connection (fromId, toId)
-        SELECT nFrom.id, nTo.id
-        FROM Node nFrom
-        JOIN Node nTo ON 
-            nFrom.import_pkg = nTo.projectName 
-            AND nFrom.import_name = nTo.name
-            AND nFrom.branch = nTo.branch
-        WHERE nFrom.type = 'NamedImport' 
-          AND nTo.type = 'NamedExport'
-          AND nFrom.projectName != nTo.projectName;
-    `
-    createdCount += rule1Count
-
-    // Rule 2: RuntimeDynamicImport -> NamedExport
-    // Matches: DynImport(pkg = projectName, subpkg = entryName, name = name) -> Export(projectName, export_entry, name)
-    const rule2Count = await prisma.$executeRaw`
-        INSERT OR IGNORE INTO Connection (fromId, toId)
-        SELECT nFrom.id, nTo.id
-        FROM Node nFrom
-        JOIN Node nTo ON 
-            nFrom.import_pkg = nTo.projectName 
-            AND (nFrom.import_subpkg = nTo.export_entry OR (nFrom.import_subpkg = 'Nil' AND nTo.export_entry = 'index'))
-            AND nFrom.import_name = nTo.name
-            AND nFrom.branch = nTo.branch
-        WHERE nFrom.type = 'RuntimeDynamicImport' 
-          AND nTo.type = 'NamedExport'
-          AND nFrom.projectName != nTo.projectName;
-    `
-    createdCount += rule2Count
-
-    // Rule 6: DynamicModuleFederationReference -> NamedExport
-    // Matches: RemoteLoader(appName = projectName, moduleName = entryName) -> Export(projectName, export_entry)
-    // Note: RemoteLoader 'import_name' maps to 'export_entry'(the exposed module name)
-    const rule6Count = await prisma.$executeRaw`
-        INSERT OR IGNORE INTO Connection (fromId, toId)
-        SELECT nFrom.id, nTo.id
-        FROM Node nFrom
-        JOIN Node nTo ON 
-            nFrom.import_pkg = nTo.projectName 
-            AND nFrom.import_name = nTo.export_entry
-            AND nFrom.branch = nTo.branch
-        WHERE nFrom.type = 'DynamicModuleFederationReference' 
-          AND nTo.type = 'NamedExport'
-          AND nFrom.projectName != nTo.projectName;
-    `
-    createdCount += rule6Count
-
-    // Generic Rules: GlobalVar, WebStorage, Event, UrlParam
-    const genericCount = await prisma.$executeRaw`
-        INSERT OR IGNORE INTO Connection (fromId, toId)
-        SELECT nFrom.id, nTo.id
-        FROM Node nFrom
-        JOIN Node nTo ON 
-            nFrom.name = nTo.name 
-            AND nFrom.branch = nTo.branch
-        WHERE 
-           (
-             (nFrom.type = 'GlobalVarRead' AND nTo.type = 'GlobalVarWrite') OR
-             (nFrom.type = 'WebStorageRead' AND nTo.type = 'WebStorageWrite') OR
-             (nFrom.type = 'EventOn' AND nTo.type = 'EventEmit') OR
-             (nFrom.type = 'UrlParamRead' AND nTo.type = 'UrlParamWrite')
-           )
-           AND nFrom.projectName != nTo.projectName;
-    `
-    createdCount += genericCount
+    const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+      'SELECT dms_match_connections() as json',
+    )
+    const matched: MatchResult = JSON.parse(result[0].json)
 
     return {
-      createdConnections: createdCount,
-      skippedConnections: 0, // Not tracked with INSERT OR IGNORE
+      createdConnections: matched.createdConnections,
+      // Matches that were already stored
+      skippedConnections: matched.matchedConnections - matched.createdConnections,
       errors: [],
       cycles: [], // Cycles are computed on read-time now
     }
@@ -88,7 +35,7 @@ export async function optimizedAutoCreateConnections(): Promise<{
     return {
       createdConnections: 0,
       skippedConnections: 0,
-      errors: [`Failed to auto-create connections (SQL): ${error}`],
+      errors: [`Failed to auto-create connections: ${error}`],
       cycles: [],
     }
   }
@@ -1,10 +1,31 @@
 import { fileURLToPath } from 'node:url'
 import path from 'node:path'
+import { Readable } from 'node:stream'
 import { BaseWorkerPool } from './base-pool'
+import type {
+  ChangedRange,
+  GraphFilter,
+  GraphOptions,
+  GraphResult,
+  RankMetric,
+} from './dependency-builder-worker'
+import {
+  getGraphBinding,
+  getNativeNodeGraph,
+  getNativeProjectGraph,
+  streamNativeNodeGraph,
+} from '../database/native-graph'
+import { InvalidInputError } from '../database/prisma'
 
 const __filename = fileURLToPath(import.meta.url)
 const __dirname = path.dirname(__filename)
 
+// Buffers come back from a worker as plain Uint8Arrays
+const fromWorker = (result: string | Uint8Array) =>
+  typeof result === 'string'
+    ? result
+    : Buffer.from(result.buffer, result.byteOffset, result.byteLength)
+
 let dependencyBuilderWorkerPool: DependencyBuilderWorkerPool | null = null
 
 /**
@@ -28,27 +49,148 @@ export class DependencyBuilderWorkerPool extends BaseWorkerPool {
     })
   }
 
-  async getNodeDependencyGraph(nodeId: string, opts?: { depth?: number }): Promise<string> {
+  // Graph reads go straight to the addon when it loads; the pool is the fallback
+  async getNodeDependencyGraph(
+    nodeId: string,
+    opts?: GraphOptions,
+  ): Promise<GraphResult<string | Buffer>> {
+    const native = await getGraphBinding()
+    if (native) return getNativeNodeGraph(native, nodeId, opts)
+
     const pool = this.getPoolOrThrow()
     const response = await pool.run({ type: 'GET_NODE_GRAPH', nodeId, opts })
 
     if (!response.success) {
       throw new Error(response.error || 'Failed to get node dependency graph')
     }
-    return response.result
+    return { body: fromWorker(response.result), contentHash: response.contentHash }
+  }
+
+  // Lines arrive as the addon reaches each level; the worker returns them all at once
+  async streamNodeDependencyGraph(nodeId: string, opts?: GraphOptions): Promise<Readable> {
+    const native = await getGraphBinding()
+    if (native) return streamNativeNodeGraph(native, nodeId, opts)
+
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'GET_NODE_GRAPH_LEVELS', nodeId, opts })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to get node dependency graph levels')
+    }
+    return Readable.from([response.result])
   }
 
   async getProjectLevelDependencyGraph(
     projectId: string,
     branch: string,
-    opts?: { depth?: number },
-  ): Promise<string> {
+    opts?: GraphOptions,
+  ): Promise<GraphResult<string | Buffer>> {
+    const native = await getGraphBinding()
+    if (native) return getNativeProjectGraph(native, projectId, branch, opts)
+
     const pool = this.getPoolOrThrow()
     const response = await pool.run({ type: 'GET_PROJECT_GRAPH', projectId, branch, opts })
 
     if (!response.success) {
       throw new Error(response.error || 'Failed to get project dependency graph')
     }
+    return { body: fromWorker(response.result), contentHash: response.contentHash }
+  }
+
+  async getProjectGraphDelta(branch: string, since?: number): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'GET_PROJECT_GRAPH_DELTA', branch, since })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to get project graph delta')
+    }
+    return response.result
+  }
+
+  async getImpactOfChanges(
+    projectId: string,
+    branch: string,
+    changes: ChangedRange[],
+    depth?: number,
+  ): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({
+      type: 'GET_CHANGE_IMPACT',
+      projectId,
+      branch,
+      changes,
+      depth,
+    })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to get impact of changes')
+    }
+    return response.result
+  }
+
+  async getProjectClusters(branch: string, filter?: GraphFilter): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'GET_PROJECT_CLUSTERS', branch, filter })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to get project clusters')
+    }
+    return response.result
+  }
+
+  async expandProject(projectId: string, branch: string, filter?: GraphFilter): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'EXPAND_PROJECT', projectId, branch, filter })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to expand project')
+    }
+    return response.result
+  }
+
+  async rankNodes(
+    branch: string,
+    metric: RankMetric,
+    topK?: number,
+    filter?: GraphFilter,
+  ): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'RANK_NODES', branch, metric, topK, filter })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to rank nodes')
+    }
+    return response.result
+  }
+
+  async matchPattern(branch: string, pattern: string, limit?: number): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'MATCH_PATTERN', branch, pattern, limit })
+
+    if (!response.success) {
+      const message = response.error || 'Failed to match pattern'
+      throw response.invalidInput ? new InvalidInputError(message) : new Error(message)
+    }
+    return response.result
+  }
+
+  async findUnusedExports(branch: string): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'FIND_UNUSED_EXPORTS', branch })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to find unused exports')
+    }
+    return response.result
+  }
+
+  async findUnresolvedImports(branch: string): Promise<string> {
+    const pool = this.getPoolOrThrow()
+    const response = await pool.run({ type: 'FIND_UNRESOLVED_IMPORTS', branch })
+
+    if (!response.success) {
+      throw new Error(response.error || 'Failed to find unresolved imports')
+    }
     return response.result
   }
 
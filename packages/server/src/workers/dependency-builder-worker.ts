@@ -1,55 +1,215 @@
-import { prisma } from '../database/prisma'
+import { gzipSync } from 'node:zlib'
+import { isInvalidInputError, prisma } from '../database/prisma'
 import { error } from '../logging'
 
-const getNodeDependencyGraph = async (
-  nodeId: string,
-  opts?: { depth?: number },
+/**
+ * Restricts which nodes a traversal may reach; applied inside the native BFS so
+ * pruned subtrees are never fetched. Empty or missing lists mean no restriction.
+ */
+export interface GraphFilter {
+  nodeTypes?: string[]
+  excludeProjects?: string[]
+  branches?: string[]
+}
+
+export interface GraphOptions {
+  depth?: number
+  filter?: GraphFilter
+  /** Attach layered layout coordinates (layer/x/y per vertex) computed natively */
+  layout?: boolean
+  /** Return the graph as a gzip stream instead of plain JSON */
+  encoding?: 'gzip'
+}
+
+const serializeFilter = (filter?: GraphFilter) => (filter ? JSON.stringify(filter) : null)
+
+// The SQL functions only return plain JSON; compress here, off the main thread
+const encode = (json: string, opts?: GraphOptions) =>
+  opts?.encoding === 'gzip' ? gzipSync(json) : json
+
+/** A serialized graph and the XXH64 of its plain JSON, used as its ETag */
+export interface GraphResult<T = string> {
+  body: T
+  contentHash: string
+}
+
+const EMPTY_GRAPH = JSON.stringify({ vertices: [], edges: [] })
+
+// Hashed in the same statement; MATERIALIZED keeps SQLite from substituting
+// the graph call into both columns and running it twice
+const queryGraph = async (call: string, ...args: unknown[]): Promise<GraphResult> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string; contentHash: string }>>(
+    `WITH g AS MATERIALIZED (SELECT COALESCE(${call}, ?) AS json) ` +
+      `SELECT json, content_hash(json) AS contentHash FROM g`,
+    ...args,
+    EMPTY_GRAPH,
+  )
+  return { body: result[0].json, contentHash: result[0].contentHash }
+}
+
+const getNodeDependencyGraph = (nodeId: string, opts?: GraphOptions): Promise<GraphResult> =>
+  queryGraph(
+    'get_node_dependency_graph(?, ?, ?, ?)',
+    nodeId,
+    opts?.depth ?? 100,
+    serializeFilter(opts?.filter),
+    opts?.layout ? 1 : 0,
+  )
+
+const getProjectLevelDependencyGraph = (
+  projectId: string,
+  branch: string,
+  opts?: GraphOptions,
+): Promise<GraphResult> =>
+  queryGraph(
+    'get_project_dependency_graph(?, ?, ?, ?, ?)',
+    projectId,
+    branch,
+    opts?.depth ?? 100,
+    serializeFilter(opts?.filter),
+    opts?.layout ? 1 : 0,
+  )
+
+// The node graph as NDJSON, one line per BFS level (or slice of one)
+const getNodeDependencyGraphLevels = async (nodeId: string, opts?: GraphOptions) => {
+  const result = await prisma.$queryRawUnsafe<Array<{ ndjson: string }>>(
+    `SELECT get_node_dependency_graph_levels(?, ?, ?) as ndjson`,
+    nodeId,
+    opts?.depth ?? 100,
+    serializeFilter(opts?.filter),
+  )
+  return result[0].ndjson
+}
+
+/** Lines touched in one file; omitting the lines marks the whole file as changed */
+export interface ChangedRange {
+  relativePath: string
+  startLine?: number
+  endLine?: number
+}
+
+const getImpactOfChanges = async (
+  projectId: string,
+  branch: string,
+  changes: ChangedRange[],
+  depth?: number,
 ): Promise<string> => {
-  const depth = opts?.depth ?? 100
-  // Call Native Function via SQL
-  // The native function returns a JSON string directly.
   const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
-    `SELECT get_node_dependency_graph(?, ?) as json`,
-    nodeId,
-    depth,
+    `SELECT impact_of_changes(?, ?, ?, ?) as json`,
+    projectId,
+    branch,
+    JSON.stringify(changes),
+    depth ?? 100,
   )
 
   if (!result || result.length === 0 || !result[0].json) {
-    // Return empty graph JSON if no result
-    return JSON.stringify({ vertices: [], edges: [] })
+    return JSON.stringify({ seeds: [], nodeCount: 0, projects: [] })
   }
-
-  // Return raw JSON string directly for performance
   return result[0].json
 }
 
-const getProjectLevelDependencyGraph = async (
+/** Projects of a branch as super-vertices with connection-count edge weights */
+const getProjectClusters = async (branch: string, filter?: GraphFilter): Promise<string> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    `SELECT project_clusters(?, ?) as json`,
+    branch,
+    serializeFilter(filter),
+  )
+  return result[0]?.json ?? JSON.stringify({ vertices: [], edges: [] })
+}
+
+/** Boundary nodes of one project and their cross-project connections */
+const expandProject = async (
   projectId: string,
   branch: string,
-  opts?: { depth?: number },
+  filter?: GraphFilter,
 ): Promise<string> => {
-  const depth = opts?.depth ?? 100
-
   const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
-    `SELECT get_project_dependency_graph(?, ?, ?) as json`,
+    `SELECT expand_project(?, ?, ?) as json`,
     projectId,
     branch,
-    depth,
+    serializeFilter(filter),
   )
+  return result[0].json
+}
 
-  if (!result || result.length === 0 || !result[0].json) {
-    return JSON.stringify({ vertices: [], edges: [] })
-  }
+export type RankMetric = 'indegree' | 'pagerank' | 'betweenness'
+
+/** Top nodes and projects of a branch by a centrality metric */
+const rankNodes = async (
+  branch: string,
+  metric: RankMetric,
+  topK?: number,
+  filter?: GraphFilter,
+): Promise<string> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    `SELECT rank_nodes(?, ?, ?, ?) as json`,
+    branch,
+    metric,
+    topK ?? null,
+    serializeFilter(filter),
+  )
+  return result[0].json
+}
+
+/** Project bindings of a path pattern, e.g. (App)-[NamedImport*1..3]->({has:'EventEmit'}) */
+const matchPattern = async (branch: string, pattern: string, limit?: number): Promise<string> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    `SELECT dms_match(?, ?, ?) as json`,
+    pattern,
+    branch,
+    limit ?? null,
+  )
+  return result[0].json
+}
 
-  const json = result[0].json
+/** Changes to the project graph of a branch since a generation an earlier call returned */
+const getProjectGraphDelta = async (branch: string, since?: number): Promise<string> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    `SELECT get_project_dependency_graph_delta(?, ?) as json`,
+    branch,
+    since ?? null,
+  )
+  return result[0].json
+}
 
-  return json
+/** Exports of a branch that no node imports, grouped by project */
+const findUnusedExports = async (branch: string): Promise<string> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    `SELECT find_unused_exports(?) as json`,
+    branch,
+  )
+  return result[0].json
+}
+
+/** Imports of a branch that resolve to no node, grouped by project */
+const findUnresolvedImports = async (branch: string): Promise<string> => {
+  const result = await prisma.$queryRawUnsafe<Array<{ json: string }>>(
+    `SELECT find_unresolved_imports(?) as json`,
+    branch,
+  )
+  return result[0].json
 }
 
 export type DependencyWorkerMessage =
   | { type: 'CALCULATE' }
-  | { type: 'GET_NODE_GRAPH'; nodeId: string; opts?: { depth?: number } }
-  | { type: 'GET_PROJECT_GRAPH'; projectId: string; branch: string; opts?: { depth?: number } }
+  | { type: 'GET_NODE_GRAPH'; nodeId: string; opts?: GraphOptions }
+  | { type: 'GET_NODE_GRAPH_LEVELS'; nodeId: string; opts?: GraphOptions }
+  | { type: 'GET_PROJECT_GRAPH'; projectId: string; branch: string; opts?: GraphOptions }
+  | { type: 'GET_PROJECT_GRAPH_DELTA'; branch: string; since?: number }
+  | {
+      type: 'GET_CHANGE_IMPACT'
+      projectId: string
+      branch: string
+      changes: ChangedRange[]
+      depth?: number
+    }
+  | { type: 'GET_PROJECT_CLUSTERS'; branch: string; filter?: GraphFilter }
+  | { type: 'EXPAND_PROJECT'; projectId: string; branch: string; filter?: GraphFilter }
+  | { type: 'RANK_NODES'; branch: string; metric: RankMetric; topK?: number; filter?: GraphFilter }
+  | { type: 'MATCH_PATTERN'; branch: string; pattern: string; limit?: number }
+  | { type: 'FIND_UNUSED_EXPORTS'; branch: string }
+  | { type: 'FIND_UNRESOLVED_IMPORTS'; branch: string }
 
 /**
  * Worker entry point for dependency operations.
@@ -58,16 +218,56 @@ export default async (message: DependencyWorkerMessage) => {
   try {
     switch (message.type) {
       case 'GET_NODE_GRAPH': {
-        const result = await getNodeDependencyGraph(message.nodeId, message.opts)
+        const { body, contentHash } = await getNodeDependencyGraph(message.nodeId, message.opts)
+        return { success: true, result: encode(body, message.opts), contentHash }
+      }
+      case 'GET_NODE_GRAPH_LEVELS': {
+        const result = await getNodeDependencyGraphLevels(message.nodeId, message.opts)
         return { success: true, result }
       }
       case 'GET_PROJECT_GRAPH': {
-        const result = await getProjectLevelDependencyGraph(
+        const { body, contentHash } = await getProjectLevelDependencyGraph(
           message.projectId,
           message.branch,
           message.opts,
         )
-        // result is already wrapped with move() for efficient transfer
+        return { success: true, result: encode(body, message.opts), contentHash }
+      }
+      case 'GET_PROJECT_GRAPH_DELTA': {
+        const result = await getProjectGraphDelta(message.branch, message.since)
+        return { success: true, result }
+      }
+      case 'GET_CHANGE_IMPACT': {
+        const result = await getImpactOfChanges(
+          message.projectId,
+          message.branch,
+          message.changes,
+          message.depth,
+        )
+        return { success: true, result }
+      }
+      case 'GET_PROJECT_CLUSTERS': {
+        const result = await getProjectClusters(message.branch, message.filter)
+        return { success: true, result }
+      }
+      case 'EXPAND_PROJECT': {
+        const result = await expandProject(message.projectId, message.branch, message.filter)
+        return { success: true, result }
+      }
+      case 'RANK_NODES': {
+        const result = await rankNodes(message.branch, message.metric, message.topK, message.filter)
+        return { success: true, result }
+      }
+      case 'MATCH_PATTERN': {
+        const result = await matchPattern(message.branch, message.pattern, message.limit)
+        return { success: true, result }
+      }
+      case 'FIND_UNUSED_EXPORTS': {
+        const result = await findUnusedExports(message.branch)
+        return { success: true, result }
+      }
+      case 'FIND_UNRESOLVED_IMPORTS': {
+        const result = await findUnresolvedImports(message.branch)
         return { success: true, result }
       }
       default:
@@ -78,6 +278,7 @@ export default async (message: DependencyWorkerMessage) => {
     return {
       success: false,
       error: err instanceof Error ? err.message : 'Unknown error',
+      invalidInput: isInvalidInputError(err),
     }
   } finally {
     await prisma.$disconnect()
@@ -21,7 +21,8 @@ export async function setup() {
     // to match what Prisma expects.
     const dbUrl = `file:${TEMPLATE_DB}`
 
-    execSync('npx prisma db push', {
+    // Migrations rather than `db push`, so the tests run on the schema the migrations produce
+    execSync('npx prisma migrate deploy', {
       env: {
         ...process.env,
         DATABASE_URL: dbUrl,
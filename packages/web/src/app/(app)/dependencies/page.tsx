@@ -86,17 +86,35 @@ function DependenciesContent() {
     const edges: DependencyGraph['edges'] = []
     const vertexIdSet = new Set<string>()
 
+    // Laid-out graphs are centred on x = 0; place them side by side
+    const hasLayout = allProjectsGraphData.every((graph) => graph.layout)
+    const GRAPH_GAP = 160
+    let offsetX = 0
+    let height = 0
+    let layers = 0
+
     allProjectsGraphData.forEach((graph) => {
+      const shiftX = hasLayout ? offsetX + graph.layout!.width / 2 : 0
       graph.vertices.forEach((v) => {
         if (!vertexIdSet.has(v.data.id)) {
           vertexIdSet.add(v.data.id)
-          vertices.push(v)
+          vertices.push(hasLayout ? { ...v, x: (v.x ?? 0) + shiftX } : v)
         }
       })
       edges.push(...graph.edges)
+
+      if (hasLayout) {
+        offsetX += graph.layout!.width + GRAPH_GAP
+        height = Math.max(height, graph.layout!.height)
+        layers = Math.max(layers, graph.layout!.layers)
+      }
     })
 
-    return { vertices, edges }
+    return {
+      vertices,
+      edges,
+      layout: hasLayout ? { width: offsetX, height, layers } : undefined,
+    }
   }, [allProjectsGraphData])
 
   // Determine which data to use based on view mode
@@ -63,6 +63,7 @@ const DependencyGraphVisualizer: React.FC<DependencyGraphVisualizerProps> = ({
 
     const nodeCount = nodes.length
     const isMassive = nodeCount > 500
+    const hasLayout = !!data.layout
 
     const canvas = canvasRef.current
     const context = canvas.getContext('2d', { alpha: false })
@@ -289,14 +290,21 @@ const DependencyGraphVisualizer: React.FC<DependencyGraphVisualizerProps> = ({
       context.restore()
     }
 
-    simulation.on('tick', () => {
+    const onTick = () => {
       quadtreeRef.current = d3
         .quadtree<D3Node>()
         .x((d) => d.x!)
         .y((d) => d.y!)
         .addAll(nodes)
       render()
-    })
+    }
+    simulation.on('tick', onTick)
+
+    // Positions came from the server, no need to run the physics
+    if (hasLayout) {
+      simulation.stop()
+      onTick()
+    }
 
     // --- Standard Interactions (Drag/Zoom/Hover) ---
     const canvasSelection = d3.select(canvas)
@@ -344,8 +352,11 @@ const DependencyGraphVisualizer: React.FC<DependencyGraphVisualizerProps> = ({
       })
       .on('end', (e) => {
         if (!e.active) simulation.alphaTarget(0)
-        e.subject.fx = null
-        e.subject.fy = null
+        // Laid-out nodes stay where they are dropped
+        if (!hasLayout) {
+          e.subject.fx = null
+          e.subject.fy = null
+        }
         canvas.style.cursor = 'grab'
       })
 
@@ -54,6 +54,9 @@ export interface DependencyGraph {
     firstOut: number
     inDegree: number
     outDegree: number
+    layer?: number
+    x?: number
+    y?: number
   }[]
   edges: {
     data: {
@@ -66,4 +69,10 @@ export interface DependencyGraph {
     headnext: number
     tailnext: number
   }[]
+  // Present when the server precomputed a layered layout
+  layout?: {
+    width: number
+    height: number
+    layers: number
+  }
 }
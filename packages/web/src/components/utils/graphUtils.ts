@@ -20,6 +20,11 @@ export function parseDependencyGraph(graph: DependencyGraph): {
       ...vertex.data,
       degree: vertex.inDegree + vertex.outDegree || 0,
     }
+    // Server-side layout: pin the node so the simulation doesn't move it
+    if (vertex.x !== undefined && vertex.y !== undefined) {
+      node.x = node.fx = vertex.x
+      node.y = node.fy = vertex.y
+    }
     nodes.push(node)
     nodeMap.set(vertex.data.id, node)
   })
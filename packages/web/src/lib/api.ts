@@ -507,6 +507,9 @@ export interface DependencyGraph {
     firstOut: number
     outDegree: number
     inDegree: number
+    layer?: number
+    x?: number
+    y?: number
   }[]
   edges: {
     data: {
@@ -524,15 +527,39 @@ export interface DependencyGraph {
     name: string
     type: string
   }[][]
+  // Present when the server precomputed a layered layout
+  layout?: {
+    width: number
+    height: number
+    layers: number
+  }
+}
+
+// Pruning applied by the server while traversing; lists are sent comma-separated
+export interface DependencyGraphFilter {
+  nodeTypes?: string[]
+  excludeProjects?: string[]
+  branches?: string[]
+}
+
+function appendGraphFilter(params: URLSearchParams, filter?: DependencyGraphFilter) {
+  if (!filter) return
+  for (const [key, values] of Object.entries(filter)) {
+    if (values && values.length > 0) {
+      params.append(key, values.join(','))
+    }
+  }
 }
 
 export async function getProjectDependencies(
   projectId: string,
   depth: number = 1,
   branch: string = 'test',
+  filter?: DependencyGraphFilter,
 ): Promise<DependencyGraph> {
   const params = new URLSearchParams()
   params.append('depth', depth.toString())
+  appendGraphFilter(params, filter)
   return apiRequest(`/dependencies/projects/${projectId}/${branch}?${params.toString()}`)
 }
 
@@ -542,12 +569,34 @@ export async function getAllProjectDependencies(
   return apiRequest(`/dependencies/projects/*/${branch}`)
 }
 
+export interface ProjectGraphDelta {
+  branch: string
+  // Pass to the next call; null while the server can't track changes
+  generation: number | null
+  // The full graph has to be fetched again
+  reload: boolean
+  since?: number
+  // Removals apply before additions
+  vertices?: { added: DependencyGraph['vertices'][number]['data'][]; removed: string[] }
+  edges?: { added: DependencyGraph['edges'][number]['data'][]; removed: string[] }
+}
+
+export async function getProjectGraphDelta(
+  branch: string,
+  since?: number | null,
+): Promise<ProjectGraphDelta> {
+  const query = since != null ? `?since=${since}` : ''
+  return apiRequest(`/dependencies/delta/${branch}${query}`)
+}
+
 export async function getNodeDependencies(
   nodeId: string,
   depth: number = 2,
+  filter?: DependencyGraphFilter,
 ): Promise<DependencyGraph> {
   const params = new URLSearchParams()
   params.append('depth', depth.toString())
+  appendGraphFilter(params, filter)
   return apiRequest(`/dependencies/nodes/${nodeId}?${params.toString()}`)
 }
 